@@ -14,6 +14,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include "timer.h"
+#include "timebase.h"
 #include "misc.h"
 #include "stm32f401re_rcc.h"
 #include "stm32f401re_gpio.h"
@@ -112,7 +113,6 @@ void 			BlinkLed_RGB (void);
 void 			BuzzerControl_SetBeep (uint8_t Buzzer_state);
 void 			Buzzer_Play (void);
 void 			LedBuzzer_SetStatus (void);
-uint32_t 		CalculatorTime (uint32_t dwTimeInit, uint32_t dwTimeCurrent);
 void 			ScanB3 (void);
 void 			ScanB2 (void);
 void 			ScanB4 (void);
@@ -550,34 +550,6 @@ void LedBuzzer_SetStatus (void)
 								(void*) Buzzer_Play, NULL);
 }
 
-/*
- * @func:  		CalculatorTime
- *
- * @brief:		The function calculates button press duration
- *
- * @param[1]:	dwTimeInit - Time when button press starts
- * @param[2]:	dwTimeCurrent - Current time
- *
- * @retval:		dwTimeTotal
- *
- * @note:		None
- */
-uint32_t CalculatorTime (uint32_t dwTimeInit, uint32_t dwTimeCurrent)
-{
-	uint32_t dwTimeTotal;
-
-	if (dwTimeCurrent >= dwTimeInit)
-	{
-		dwTimeTotal = dwTimeCurrent - dwTimeInit;
-	}
-	else
-	{
-		dwTimeTotal = 0xFFFFFFFFU + dwTimeCurrent - dwTimeInit;
-	}
-
-	return dwTimeTotal;
-}
-
 /*
  * @func:  		EXTI4_IRQHandler
  *
@@ -624,14 +596,14 @@ void ScanB3 (void)
 
 		if (GPIO_ReadInputDataBit(GPIOA, BUTTON_B3_IT_PIN) == RESET)
 		{
-			if (CalculatorTime(g_B3TimePress, TimeCurrent) >= 500)
+			if (TimeBase_ElapsedMs(g_B3TimePress, TimeCurrent) >= 500)
 			{
 				// Event when holding down
 			}
 		}
 		else
 		{
-			if (CalculatorTime(g_B3TimePress, TimeCurrent) >= 400)
+			if (TimeBase_ElapsedMs(g_B3TimePress, TimeCurrent) >= 400)
 			{
 				switch (g_B3CountPress)
 				{
@@ -706,7 +678,7 @@ void ScanB2 (void)
 
 		if (GPIO_ReadInputDataBit(GPIOB, BUTTON_B2_IT_PIN) == RESET)
 		{
-			if (CalculatorTime(g_B2TimePress, TimeCurrent) > 500)
+			if (TimeBase_ElapsedMs(g_B2TimePress, TimeCurrent) > 500)
 			{
 				LedControl_SetState(LED_KIT_ID0, LED_COLOR_RED, 0);
 				LedControl_SetState(LED_KIT_ID1, LED_COLOR_BLUE, 1);
@@ -714,7 +686,7 @@ void ScanB2 (void)
 		}
 		else
 		{
-			if (CalculatorTime(g_B2TimePress, TimeCurrent) >= 400)
+			if (TimeBase_ElapsedMs(g_B2TimePress, TimeCurrent) >= 400)
 			{
 				switch (g_B2CountPress)
 				{
@@ -790,7 +762,7 @@ void ScanB4 (void)
 
 		if (GPIO_ReadInputDataBit(GPIOB, BUTTON_B4_IT_PIN) == RESET)
 		{
-			if (CalculatorTime(g_B4TimePress, TimeCurrent) > 500)
+			if (TimeBase_ElapsedMs(g_B4TimePress, TimeCurrent) > 500)
 			{
 				LedControl_SetState(LED_KIT_ID0, LED_COLOR_RED, 1);
 				LedControl_SetState(LED_KIT_ID1, LED_COLOR_BLUE, 0);
@@ -798,7 +770,7 @@ void ScanB4 (void)
 		}
 		else
 		{
-			if (CalculatorTime(g_B4TimePress, TimeCurrent) >= 400)
+			if (TimeBase_ElapsedMs(g_B4TimePress, TimeCurrent) >= 400)
 			{
 				switch (g_B4CountPress)
 				{
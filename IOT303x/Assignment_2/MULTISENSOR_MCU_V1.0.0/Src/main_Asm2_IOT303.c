@@ -14,13 +14,19 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include <math.h>
 #include "timer.h"
+#include "timebase.h"
 #include "ucg.h"
 #include "Ucglib.h"
 #include "stm32f401re_rcc.h"
 #include "stm32f401re_gpio.h"
 #include "stm32f401re_i2c.h"
+#include "misc.h"
 #include "kalman_filter.h"
+#include "protothread.h"
+#include "i2casync.h"
+#include "temhumsensor.h"
 
 
 /****************************************************************************************/
@@ -36,12 +42,48 @@
 #define SCL_MASTER_PIN				GPIO_Pin_8				//PB8
 #define SDA_MASTER_PIN				GPIO_Pin_9				//PB9
 
+#define I2C_MASTER_IRQ_PRIORITY		1
+
 #define SENSOR_ADDR					0x40
 #define TEMP_CMDCODE				0xE3
 #define HUMI_CMDCODE				0xE5
 
-#define TIME_WAIT_GET_TEMP			8
-#define TIME_WAIT_GET_HUMI			8
+// User register 1 of the sensor: RES1 (bit 7) and RES0 (bit 0) give the resolution,
+// the other bits are kept (read-modify-write)
+#define CMDR_USER_REG1				0xE7
+#define CMDW_USER_REG1				0xE6
+#define USER_REG1_RES_MASK			0x81
+
+// 1: TemHum_UpdateResolution picks the resolution after each sample; 0: only
+//    TemHum_SetResolution changes it
+#define TEMHUM_ADAPTIVE_RESOLUTION	1
+
+// Resolution of the first measurements (ADC_RES_xxx of temhumsensor.h)
+#define TEMHUM_RESOLUTION			ADC_RES_RH12_T14
+
+// Samples per second asked for (TemHum_SetSampleRate), 0: back to back
+#define TEMHUM_SAMPLE_RATE			0
+
+// Change between two samples from which the readings are moving fast
+#define RES_CHANGE_TEMP				0.5
+#define RES_CHANGE_HUMI				2.0
+
+// Steady samples in a row before going back to full resolution
+#define RES_STEADY_SAMPLES			10
+
+// Resolution of the sensor not known (written before the first measurement)
+#define TEMHUM_LEVEL_UNKNOWN		0xFF
+
+// 1: one conversion per sample: RH, then the temperature the sensor measured for it
+//    (CMDR_MEASURE_VALUE, no conversion time); 0: a temperature conversion of its own
+#define TEMHUM_TEMP_FROM_RH			1
+
+// Longest I2C transfer (clock stretching of the sensor included), then it is aborted
+#define TIME_I2C_TRANSFER_MAX		20
+
+// Status given to the callback of TemHum_StartMeasure
+#define TEMHUM_OK					0
+#define TEMHUM_ERROR				1
 
 #define PERIOD_UPDATE_SENSOR		1000
 #define PERIOD_UPDATE_LCD			5000
@@ -52,6 +94,17 @@
 /****************************************************************************************/
 /*                                  STRUCTs AND ENUMs                           		*/
 /****************************************************************************************/
+// End of a measurement of TemHum_StartMeasure, called from the main loop
+typedef void (*temhum_callback_f)(uint8_t byStatus, double temp, double humi);
+
+// Resolution of the sensor and its conversion times (ms, datasheet maximum, rounded up)
+typedef struct
+{
+	uint8_t byResolution;		// ADC_RES_xxx of temhumsensor.h
+	uint8_t byWaitHumi;			// RH command: RH conversion, then the temperature one
+	uint8_t byWaitTemp;			// Temperature command
+	uint8_t bySamplesPerSec;	// Highest rate with TEMHUM_TEMP_FROM_RH: 1000 / byWaitHumi
+} temhum_resolution_t;
 
 
 /****************************************************************************************/
@@ -63,27 +116,74 @@ static char g_strHumi[30] = "";
 static double g_temp = 0;
 static double g_humi = 0;
 
+// Latest readings of TemHum_OnMeasured, and the flag telling they are new
+static double g_currentTemp = 0;
+static double g_currentHumi = 0;
+static uint8_t g_byMeasureReady = 0;
+
+// Measurement requested by TemHum_StartMeasure, NULL when none is running
+static temhum_callback_f g_pfnTemHumDone = NULL;
+
+// I2C transfer of the sensor: set by the I2C interrupt, read by Thread_TemHumRead
+static volatile uint8_t g_byI2cDone = 0;
+static volatile uint8_t g_byI2cStatus = I2C_ASYNC_OK;
+static uint32_t g_dwI2cStartTick = 0;
+static uint8_t g_byTemHumCommand;
+static uint8_t g_byTemHumData[2];
+
+// Resolutions from the finest to the fastest, the index is the level. A sample with
+// TEMHUM_TEMP_FROM_RH is one RH command; without it, add byWaitTemp to the sample time
+static const temhum_resolution_t g_aTemHumResolution[] =
+{
+	{ ADC_RES_RH12_T14, 23, 11, 43 },		// RH 12 ms + T 10.8 ms
+	{ ADC_RES_RH10_T13, 11, 7, 90 },		// RH 4.5 ms + T 6.2 ms
+	{ ADC_RES_RH11_T11, 10, 3, 100 },		// RH 7 ms + T 2.4 ms
+	{ ADC_RES_RH08_T12, 7, 4, 142 },		// RH 3.1 ms + T 3.8 ms
+};
+
+#define TEMHUM_LEVELS				(sizeof(g_aTemHumResolution) / sizeof(g_aTemHumResolution[0]))
+
+// Level written to the sensor, and the one asked for by TemHum_SetResolution
+static uint8_t g_byTemHumLevel = TEMHUM_LEVEL_UNKNOWN;
+static uint8_t g_byTemHumLevelWanted = 0;
+
+// Pace of the measurements (TemHum_SetSampleRate) and the tick of the next one
+static uint16_t g_wTemHumSampleRate = 0;
+static uint32_t g_dwTemHumNextTick = 0;
+
+// State of the protothreads run by the main loop
+static pt_t g_ptTemHum;
+static pt_t g_ptTemHumRead;
+static pt_t g_ptUpdateDisplay;
+
 /****************************************************************************************/
 /*                                 FUNCTIONs PROTOTYPE                                  */
 /****************************************************************************************/
 static void 	AppInitManager 				(void);
 static void 	LCD_Setup 					(void);
 static void 	Sensor_Init 				(void);
-static void 	I2C_Start 					(void);
-static void 	I2C_Address_Direction 		(uint8_t Address, uint8_t Direction);
-static void 	I2C_TransmitData	 		(uint8_t data);
-static uint8_t 	I2C_Receive_ACK 			(void);
-static uint8_t 	I2C_Receive_NACK 			(void);
-static void 	I2C_Stop 					(void);
-static void 	TemHumSensor_readRegister 	(uint8_t AddrSensor, uint8_t pAddrReg,
-											 uint8_t *pDataRead, uint8_t byDataLen,
-											 uint16_t rDelay);
-static double 	TemHumSensor_getTemp 		(void);
-static double 	TemHumSensor_getHumi 		(void);
+static void 	TemHum_OnTransferDone 		(uint8_t byStatus, void *pContext);
+static void 	TemHum_StartTransfer 		(const uint8_t *pTxData, uint8_t byTxLength,
+											 uint8_t *pRxData, uint8_t byRxLength);
+static uint8_t 	TemHum_IsTransferEnded 		(void);
+static uint8_t 	TemHum_StartMeasure 		(temhum_callback_f callback);
+static void 	TemHum_OnMeasured 			(uint8_t byStatus, double temp, double humi);
+static uint8_t 	TemHum_SetResolution 		(uint8_t byResolution);
+static void 	TemHum_SetSampleRate 		(uint16_t wSamplesPerSec);
+#if (TEMHUM_ADAPTIVE_RESOLUTION == 1)
+static uint8_t 	TemHum_GetRateLevel 		(void);
+static void 	TemHum_UpdateResolution 	(double temp, double humi);
+#endif
+static const temhum_resolution_t *TemHum_GetResolution (void);
+static double 	TemHumSensor_convertTemp 	(const uint8_t *pData);
+static double 	TemHumSensor_convertHumi 	(const uint8_t *pData);
+static PT_THREAD(Thread_TemHumRead 			(pt_t *pt, uint8_t byCommand, uint32_t dwWaitMs));
+static PT_THREAD(Thread_TemHumWriteLevel 	(pt_t *pt, uint8_t byLevel));
+static PT_THREAD(Thread_TemHum 				(pt_t *pt));
+static PT_THREAD(Thread_UpdateDisplay 		(pt_t *pt));
 static void 	Update_ValueSensor 			(void);
 static void		Update_LCD 					(void);
 static void 	printDataToLCD 				(void);
-static void 	delay_ms 					(uint32_t milisecond);
 
 /****************************************************************************************/
 /*                                      FUNCTIONs                                       */
@@ -106,8 +206,10 @@ int main ()
 	while (1)
 	{
 		processTimerScheduler();
-		Update_ValueSensor();
-		Update_LCD();
+
+		// Each thread runs up to its next wait, then gives the loop back
+		Thread_TemHum(&g_ptTemHum);
+		Thread_UpdateDisplay(&g_ptUpdateDisplay);
 	}
 
 	return 0;
@@ -140,6 +242,15 @@ static void AppInitManager (void)
 
 	// Initialize the Kalman filter-----------------------------------------------
 	KalmanFilterInit(0.5, 0, 0.5);
+
+	// Start the sensor and display sequences from their beginning----------------
+	PT_INIT(&g_ptTemHum);
+	PT_INIT(&g_ptUpdateDisplay);
+
+	// Measure in the background, TemHum_OnMeasured starts the next measurement--
+	TemHum_SetResolution(TEMHUM_RESOLUTION);
+	TemHum_SetSampleRate(TEMHUM_SAMPLE_RATE);
+	TemHum_StartMeasure(TemHum_OnMeasured);
 }
 
 /*
@@ -183,13 +294,14 @@ static void LCD_Setup (void)
  *
  * @retval:		None
  *
- * @note:		None
+ * @note:		The transfers are run by the I2C1 event and error interrupts (I2C-Async-Library)
  */
 static void Sensor_Init (void)
 {
-	// Declare variables of type GPIO, I2C structures-----------------------------
+	// Declare variables of type GPIO, I2C, NVIC structures-----------------------
 	GPIO_InitTypeDef 	GPIO_InitStruct;
 	I2C_InitTypeDef 	I2C_InitStruct;
+	NVIC_InitTypeDef	NVIC_InitStruct;
 
 	/* Initialize GPIO with alternate function in open-drain mode-----------------*/
 	// Enable I2C-----------------------------------------------------------------
@@ -223,256 +335,544 @@ static void Sensor_Init (void)
 
 	// Enable I2C operation-------------------------------------------------------
 	I2C_Cmd(I2C_MASTER_INSTANCE, ENABLE);
+	I2cAsync_Init();
+
+	// Enable the event and error interrupts of I2C1------------------------------
+	NVIC_InitStruct.NVIC_IRQChannelPreemptionPriority = I2C_MASTER_IRQ_PRIORITY;
+	NVIC_InitStruct.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStruct.NVIC_IRQChannelCmd = ENABLE;
+
+	NVIC_InitStruct.NVIC_IRQChannel = I2C1_EV_IRQn;
+	NVIC_Init(&NVIC_InitStruct);
+
+	NVIC_InitStruct.NVIC_IRQChannel = I2C1_ER_IRQn;
+	NVIC_Init(&NVIC_InitStruct);
 }
 
 /*
- * @func:  		I2C_Start
+ * @func:  		TemHum_OnTransferDone
  *
- * @brief:		The function sends the Start bit
+ * @brief:		The function records the end of an I2C transfer of the sensor
  *
- * @param:		None
+ * @param[1]:	byStatus - I2C_ASYNC_OK or the error of the transfer
+ * @param[2]:	pContext - Not used
  *
  * @retval:		None
  *
- * @note:		None
+ * @note:		Called from the I2C1 interrupt, or by I2cAsync_Abort with I2C_ASYNC_ABORTED
  */
-static void I2C_Start (void)
+static void TemHum_OnTransferDone (uint8_t byStatus, void *pContext)
 {
-	// Wait until the line is not busy--------------------------------------------
-	while (I2C_GetFlagStatus(I2C_MASTER_INSTANCE, I2C_FLAG_BUSY));
+	(void)pContext;
 
-	// Send the START bit---------------------------------------------------------
-	I2C_GenerateSTART(I2C_MASTER_INSTANCE, ENABLE);
-
-	// Wait for the START bit transmission to complete (wait for SET bit EV5)-----
-	while (!I2C_CheckEvent(I2C_MASTER_INSTANCE, I2C_EVENT_MASTER_MODE_SELECT));
+	g_byI2cStatus = byStatus;
+	g_byI2cDone = 1;
 }
 
 /*
- * @func:  		I2C_Address_Direction
+ * @func:  		TemHum_StartTransfer
  *
- * @brief:		The function sends the address bit
+ * @brief:		The function starts an I2C transfer with the sensor
  *
- * @param[1]:	Address - the address to be transmitted
- * @param[2]:	Direction - transmit or receive data
+ * @param[1]:	pTxData - Bytes to write (NULL if byTxLength is 0)
+ * @param[2]:	byTxLength - Number of bytes to write
+ * @param[3]:	pRxData - Bytes read (NULL if byRxLength is 0)
+ * @param[4]:	byRxLength - Number of bytes to read
  *
  * @retval:		None
  *
- * @note:		None
+ * @note:		Wait for TemHum_IsTransferEnded, then read g_byI2cStatus
  */
-static void I2C_Address_Direction (uint8_t Address, uint8_t Direction)
+static void TemHum_StartTransfer (const uint8_t *pTxData, uint8_t byTxLength,
+								  uint8_t *pRxData, uint8_t byRxLength)
 {
-	// Transmit the address-------------------------------------------------------
-	I2C_Send7bitAddress(I2C_MASTER_INSTANCE, Address, Direction);
+	i2c_async_transfer_t transfer;
 
-	// Check the condition: transmit or receive data------------------------------
-	if (Direction == I2C_Direction_Transmitter)
+	transfer.byAddress = SENSOR_ADDR;
+	transfer.pTxData = pTxData;
+	transfer.byTxLength = byTxLength;
+	transfer.pRxData = pRxData;
+	transfer.byRxLength = byRxLength;
+	transfer.callback = TemHum_OnTransferDone;
+	transfer.pContext = NULL;
+
+	g_byI2cDone = 0;
+	g_dwI2cStartTick = GetMilSecTick();
+
+	g_byI2cStatus = I2cAsync_Start(&transfer);
+
+	if (g_byI2cStatus != I2C_ASYNC_OK)
 	{
-		// Wait for TxE = 1-------------------------------------------------------
-		while (!I2C_CheckEvent(I2C_MASTER_INSTANCE, I2C_EVENT_MASTER_TRANSMITTER_MODE_SELECTED));
+		// Not started: ended at once, with the error
+		g_byI2cDone = 1;
 	}
-	else if (Direction == I2C_Direction_Receiver)
+}
+
+/*
+ * @func:  		TemHum_IsTransferEnded
+ *
+ * @brief:		The function tells whether the I2C transfer of the sensor has ended
+ *
+ * @param:		None
+ *
+ * @retval:		1 if ended (g_byI2cStatus tells how), 0 while running
+ *
+ * @note:		A transfer running for more than TIME_I2C_TRANSFER_MAX is aborted
+ */
+static uint8_t TemHum_IsTransferEnded (void)
+{
+	if (g_byI2cDone)
 	{
-		// Wait for RxNE = 1------------------------------------------------------
-		while (!I2C_CheckEvent(I2C_MASTER_INSTANCE, I2C_EVENT_MASTER_RECEIVER_MODE_SELECTED));
+		return 1;
 	}
+
+	if (TimeBase_ElapsedMs(g_dwI2cStartTick, GetMilSecTick()) >= TIME_I2C_TRANSFER_MAX)
+	{
+		// Ends the transfer through TemHum_OnTransferDone, with I2C_ASYNC_ABORTED
+		I2cAsync_Abort();
+
+		return 1;
+	}
+
+	return 0;
 }
 
 /*
- * @func:  		I2C_TransmitData
+ * @func:  		TemHum_StartMeasure
  *
- * @brief:		The function transmits data of the sensor registers
+ * @brief:		The function starts a temperature and humidity measurement in the background
  *
- * @param:		data
+ * @param:		callback - Called with the result, from the main loop (Thread_TemHum)
  *
- * @retval:		None
+ * @retval:		1 if started, 0 if a measurement is already running
  *
- * @note:		None
+ * @note:		The callback may start the next measurement
  */
-static void I2C_TransmitData (uint8_t data)
+static uint8_t TemHum_StartMeasure (temhum_callback_f callback)
 {
-	// Transmit data--------------------------------------------------------------
-	I2C_SendData(I2C_MASTER_INSTANCE, data);
+	if ((g_pfnTemHumDone != NULL) || (callback == NULL))
+	{
+		return 0;
+	}
+
+	g_pfnTemHumDone = callback;
 
-	// Wait for the transmission to complete (wait for I2C_EV8_2)-----------------
-	while (!I2C_CheckEvent(I2C_MASTER_INSTANCE, I2C_EVENT_MASTER_BYTE_TRANSMITTED));
+	return 1;
 }
 
+/*
+ * @func:  		TemHum_OnMeasured
+ *
+ * @brief:		The function keeps the result of a measurement for the display
+ *
+ * @param[1]:	byStatus - TEMHUM_OK or TEMHUM_ERROR
+ * @param[2]:	temp - Temperature (oC)
+ * @param[3]:	humi - Humidity (%)
+ *
+ * @retval:		None
+ *
+ * @note:		Measures again at once, as the blocking loop used to (paced by
+ * 				TemHum_SetSampleRate)
+ */
+static void TemHum_OnMeasured (uint8_t byStatus, double temp, double humi)
+{
+	if (byStatus == TEMHUM_OK)
+	{
+		g_currentTemp = temp;
+		g_currentHumi = humi;
+		g_byMeasureReady = 1;
+
+#if (TEMHUM_ADAPTIVE_RESOLUTION == 1)
+		TemHum_UpdateResolution(temp, humi);
+#endif
+	}
+
+	TemHum_StartMeasure(TemHum_OnMeasured);
+}
 
 /*
- * @func:  		I2C_Receive_ACK
+ * @func:  		TemHum_SetResolution
  *
- * @brief:		The function receives data with ACK
+ * @brief:		The function sets the resolution of the next measurements
  *
- * @param:		None
+ * @param:		byResolution - ADC_RES_RH12_T14, ADC_RES_RH10_T13, ADC_RES_RH11_T11
+ * 				or ADC_RES_RH08_T12
  *
- * @retval:		data_receive
+ * @retval:		1 if set, 0 if unknown
  *
- * @note:		None
+ * @note:		Written to the sensor by Thread_TemHum before the next measurement.
+ * 				With TEMHUM_ADAPTIVE_RESOLUTION, the next sample picks it again
  */
-static uint8_t I2C_Receive_ACK (void)
+static uint8_t TemHum_SetResolution (uint8_t byResolution)
 {
-	uint8_t data_receive;
+	uint8_t i;
 
-	// Use the ACK bit------------------------------------------------------------
-	I2C_AcknowledgeConfig(I2C_MASTER_INSTANCE, ENABLE);
+	for (i = 0; i < TEMHUM_LEVELS; i++)
+	{
+		if (g_aTemHumResolution[i].byResolution == byResolution)
+		{
+			g_byTemHumLevelWanted = i;
 
-	// Wait for the data reception to complete------------------------------------
-	while (!I2C_CheckEvent(I2C_MASTER_INSTANCE, I2C_EVENT_MASTER_BYTE_RECEIVED));
+			return 1;
+		}
+	}
 
-	data_receive = I2C_ReceiveData(I2C_MASTER_INSTANCE);
+	return 0;
+}
 
-	return data_receive;
+/*
+ * @func:  		TemHum_SetSampleRate
+ *
+ * @brief:		The function sets the pace of the measurements
+ *
+ * @param:		wSamplesPerSec - Samples per second, 0: back to back
+ *
+ * @retval:		None
+ *
+ * @note:		With TEMHUM_ADAPTIVE_RESOLUTION, above the bySamplesPerSec of the full
+ * 				resolution, the finest resolution that keeps up is used (high-rate streaming)
+ */
+static void TemHum_SetSampleRate (uint16_t wSamplesPerSec)
+{
+	g_wTemHumSampleRate = wSamplesPerSec;
+	g_dwTemHumNextTick = GetMilSecTick();
 }
 
+#if (TEMHUM_ADAPTIVE_RESOLUTION == 1)
 /*
- * @func:  		I2C_Receive_NACK
+ * @func:  		TemHum_GetRateLevel
  *
- * @brief:		The function receives data with NACK
+ * @brief:		The function finds the finest resolution fast enough for the sample rate
  *
  * @param:		None
  *
- * @retval:		data_receive
+ * @retval:		Level (index of g_aTemHumResolution)
  *
- * @note:		None
+ * @note:		The fastest level when none is fast enough
  */
-static uint8_t I2C_Receive_NACK (void)
+static uint8_t TemHum_GetRateLevel (void)
 {
-	uint8_t data_receive;
+	uint8_t byLevel = 0;
 
-	// Do not use the ACK bit-----------------------------------------------------
-	I2C_AcknowledgeConfig(I2C_MASTER_INSTANCE, DISABLE);
+	while ((byLevel < (TEMHUM_LEVELS - 1)) &&
+		   (g_aTemHumResolution[byLevel].bySamplesPerSec < g_wTemHumSampleRate))
+	{
+		byLevel++;
+	}
+
+	return byLevel;
+}
 
-	// Wait for the data reception to complete------------------------------------
-	while (!I2C_CheckEvent(I2C_MASTER_INSTANCE, I2C_EVENT_MASTER_BYTE_RECEIVED));
+/*
+ * @func:  		TemHum_UpdateResolution
+ *
+ * @brief:		The resolution policy: the fastest resolution while the readings move
+ * 				fast, back to the finest one the sample rate allows once they are steady
+ *
+ * @param[1]:	temp - Temperature of the sample (oC)
+ * @param[2]:	humi - Humidity of the sample (%)
+ *
+ * @retval:		None
+ *
+ * @note:		RES_CHANGE_TEMP and RES_CHANGE_HUMI are above the steps of the fastest
+ * 				resolution (0.04 oC, 0.5 %RH): its rounding alone does not keep it
+ */
+static void TemHum_UpdateResolution (double temp, double humi)
+{
+	static double lastTemp;
+	static double lastHumi;
+	static uint8_t byHasLast = 0;
+	static uint8_t bySteadySamples = RES_STEADY_SAMPLES;
+	uint8_t byLevel = TemHum_GetRateLevel();
+
+	if (byHasLast &&
+		((fabs(temp - lastTemp) >= RES_CHANGE_TEMP) || (fabs(humi - lastHumi) >= RES_CHANGE_HUMI)))
+	{
+		bySteadySamples = 0;
+	}
+	else if (bySteadySamples < RES_STEADY_SAMPLES)
+	{
+		bySteadySamples++;
+	}
 
-	data_receive = I2C_ReceiveData(I2C_MASTER_INSTANCE);
+	lastTemp = temp;
+	lastHumi = humi;
+	byHasLast = 1;
 
-	return data_receive;
+	// Moving fast: shorter conversions, more samples to follow the change
+	if (bySteadySamples < RES_STEADY_SAMPLES)
+	{
+		byLevel = TEMHUM_LEVELS - 1;
+	}
+
+	g_byTemHumLevelWanted = byLevel;
 }
+#endif
 
 /*
- * @func:  		I2C_Stop
+ * @func:  		TemHum_GetResolution
  *
- * @brief:		The function sends the STOP bit
+ * @brief:		The function gets the resolution the sensor measures with
  *
  * @param:		None
  *
- * @retval:		None
+ * @retval:		Its conversion times, those of the full resolution when not known
  *
  * @note:		None
  */
-static void I2C_Stop (void)
+static const temhum_resolution_t *TemHum_GetResolution (void)
 {
-	// Create a stop condition----------------------------------------------------
-	I2C_GenerateSTOP(I2C_MASTER_INSTANCE, ENABLE);
+	if (g_byTemHumLevel >= TEMHUM_LEVELS)
+	{
+		return &g_aTemHumResolution[0];
+	}
+
+	return &g_aTemHumResolution[g_byTemHumLevel];
 }
 
 /*
- * @func:  		TemHumSensor_readRegister
+ * @func:  		TemHumSensor_convertTemp
  *
- * @brief:		The function communicates with the sensor registers to read values
+ * @brief:		The function processes temperature data
  *
- * @param[1]:	AddrSensor - Peripheral address (sensor)
- * @param[2]:	pAddrReg - Address of the register containing temperature and humidity data (CmdCode)
- * @param[3]:	pDataRead - Data read from the corresponding register (stored in an array)
- * @param[4]:	byDataLen - Data size
- * @param[5]:	rDelay - Delay time to read data
+ * @param:		pData - The 2 bytes returned by TEMP_CMDCODE or CMDR_MEASURE_VALUE
  *
- * @retval:		None
+ * @retval:		temperature
+ *
+ * @note:		None
+ */
+static double TemHumSensor_convertTemp (const uint8_t *pData)
+{
+	// The Temp_Code value returned by the Si7020---------------------------------
+	uint16_t tempCode = (uint16_t)(pData[0] << 8) | pData[1];
+
+	// Convert the measured temperature value to °C-------------------------------
+	return (double)((175.72 * tempCode) / 65536 - 46.85);
+}
+
+/*
+ * @func:  		TemHumSensor_convertHumi
+ *
+ * @brief:		The function processes humidity data
+ *
+ * @param:		pData - The 2 bytes returned by the humidity command
+ *
+ * @retval:		humidity
  *
  * @note:		None
  */
-static void TemHumSensor_readRegister (uint8_t AddrSensor, uint8_t pAddrReg,
-									   uint8_t *pDataRead, uint8_t byDataLen,
-									   uint16_t rDelay)
+static double TemHumSensor_convertHumi (const uint8_t *pData)
+{
+	// The RH_Code value returned by the Si7020-----------------------------------
+	uint16_t RHCode = (uint16_t)((pData[0] << 8) | pData[1]);
+
+	// Convert the measured humidity value to relative humidity percentage--------
+	return (double)((125 * RHCode) / 65536 - 6);
+}
+
+/*
+ * @func:  		Thread_TemHumRead
+ *
+ * @brief:		The protothread running one command of the sensor: command, conversion
+ * 				time, then the 2 bytes of the result into g_byTemHumData
+ *
+ * @param[1]:	pt - State of the protothread
+ * @param[2]:	byCommand - Measurement command (TEMP_CMDCODE or HUMI_CMDCODE)
+ * @param[3]:	dwWaitMs - Conversion time of the command
+ *
+ * @retval:		PT_WAITING during the transfers and the conversion
+ *
+ * @note:		g_byI2cStatus tells whether it succeeded
+ */
+static PT_THREAD(Thread_TemHumRead (pt_t *pt, uint8_t byCommand, uint32_t dwWaitMs))
 {
-	I2C_Start();
-	I2C_Address_Direction(AddrSensor << 1, I2C_Direction_Transmitter);
-	I2C_TransmitData(pAddrReg);
+	PT_BEGIN(pt);
 
-	// Delay to wait for data transmission to complete----------------------------
-	if (rDelay > 0)
+	g_byTemHumCommand = byCommand;
+	TemHum_StartTransfer(&g_byTemHumCommand, 1, NULL, 0);
+	PT_WAIT_UNTIL(pt, TemHum_IsTransferEnded());
+
+	if (g_byI2cStatus != I2C_ASYNC_OK)
 	{
-		delay_ms(rDelay);
+		PT_EXIT(pt);
 	}
 
-	I2C_Stop();
+	PT_AWAIT_MS(pt, dwWaitMs);
+
+	TemHum_StartTransfer(NULL, 0, g_byTemHumData, sizeof(g_byTemHumData));
+	PT_WAIT_UNTIL(pt, TemHum_IsTransferEnded());
 
-	// Receive data from the Slave------------------------------------------------
-	I2C_Start();
-	I2C_Address_Direction(AddrSensor << 1, I2C_Direction_Receiver);
+	PT_END(pt);
+}
 
-	for(uint8_t i = 0 ; i < byDataLen; i++)
+/*
+ * @func:  		Thread_TemHumWriteLevel
+ *
+ * @brief:		The protothread writing a resolution to the user register 1 of the sensor
+ *
+ * @param[1]:	pt - State of the protothread
+ * @param[2]:	byLevel - Level (index of g_aTemHumResolution)
+ *
+ * @retval:		PT_WAITING during the transfers
+ *
+ * @note:		g_byTemHumLevel is set when it succeeded, kept otherwise (tried again
+ * 				before the next measurement)
+ */
+static PT_THREAD(Thread_TemHumWriteLevel (pt_t *pt, uint8_t byLevel))
+{
+	// Kept across the waits: the argument is read again at each call
+	static uint8_t byNewLevel;
+	uint8_t byResolution;
+
+	PT_BEGIN(pt);
+
+	byNewLevel = byLevel;
+
+	g_byTemHumCommand = CMDR_USER_REG1;
+	TemHum_StartTransfer(&g_byTemHumCommand, 1, g_byTemHumData, 1);
+	PT_WAIT_UNTIL(pt, TemHum_IsTransferEnded());
+
+	if (g_byI2cStatus != I2C_ASYNC_OK)
 	{
-		// If it is the last byte, return NACK: signal to the Slave not to send more data
-		if (i == byDataLen - 1)
-		{
-			pDataRead[i] = I2C_Receive_NACK();
-		}
-		else		// Return ACK: request the slave to continue sending data
-		{
-			pDataRead[i] = I2C_Receive_ACK();
-		}
+		PT_EXIT(pt);
 	}
 
-	I2C_Stop();
+	// ADC_RES_xxx is RES1:RES0
+	byResolution = g_aTemHumResolution[byNewLevel].byResolution;
+	g_byTemHumData[1] = (uint8_t)((g_byTemHumData[0] & ~USER_REG1_RES_MASK) |
+								  ((byResolution & 0x02) << 6) | (byResolution & 0x01));
+	g_byTemHumData[0] = CMDW_USER_REG1;
+
+	TemHum_StartTransfer(g_byTemHumData, 2, NULL, 0);
+	PT_WAIT_UNTIL(pt, TemHum_IsTransferEnded());
+
+	if (g_byI2cStatus == I2C_ASYNC_OK)
+	{
+		g_byTemHumLevel = byNewLevel;
+	}
+
+	PT_END(pt);
 }
 
 /*
- * @func:  		TemHumSensor_getTemp
+ * @func:  		Thread_TemHum
  *
- * @brief:		The function processes temperature data
+ * @brief:		The protothread measuring temperature and humidity when TemHum_StartMeasure
+ * 				asks for it
  *
- * @param:		None
+ * @param:		pt - State of the protothread
  *
- * @retval:		temperature
+ * @retval:		PT_WAITING while idle or measuring
  *
- * @note:		None
+ * @note:		The I2C transfers run on interrupts and the conversion times are waits:
+ * 				the main loop goes on during the whole measurement. With
+ * 				TEMHUM_TEMP_FROM_RH, a sample takes one conversion instead of two.
+ * 				The waits follow the resolution, written before the measurement
  */
-static double TemHumSensor_getTemp (void)
+static PT_THREAD(Thread_TemHum (pt_t *pt))
 {
-	double temperature = 0;
-	uint8_t strTemp[2] = {0};	// Array storing values received from the corresponding register
+	// Kept across the waits: locals of a protothread do not survive them
+	static double temp;
+	static double humi;
+	temhum_callback_f pfnDone;
 
-	// Get the temperature value from the corresponding register------------------
-	TemHumSensor_readRegister(SENSOR_ADDR, TEMP_CMDCODE, strTemp, 2, TIME_WAIT_GET_TEMP);
+	PT_BEGIN(pt);
 
-	// The Temp_Code value returned by the Si7020---------------------------------
-	uint16_t tempCode = (uint16_t)(strTemp[0] << 8) | strTemp[1];
+	while (1)
+	{
+		PT_WAIT_UNTIL(pt, g_pfnTemHumDone != NULL);
 
-	// Convert the measured temperature value to °C-------------------------------
-	temperature =  (double)((175.72 * tempCode) / 65536 - 46.85);
+		// Pace of TemHum_SetSampleRate
+		if (g_wTemHumSampleRate != 0)
+		{
+			PT_WAIT_UNTIL(pt, TimeBase_IsReachedMs(g_dwTemHumNextTick, GetMilSecTick()));
+
+			g_dwTemHumNextTick += 1000 / g_wTemHumSampleRate;
+
+			// More than a period late (rate too high for the resolution): from now on
+			if (TimeBase_IsReachedMs(g_dwTemHumNextTick, GetMilSecTick()))
+			{
+				g_dwTemHumNextTick = GetMilSecTick() + 1000 / g_wTemHumSampleRate;
+			}
+		}
+
+		if (g_byTemHumLevelWanted != g_byTemHumLevel)
+		{
+			PT_SPAWN(pt, &g_ptTemHumRead,
+					 Thread_TemHumWriteLevel(&g_ptTemHumRead, g_byTemHumLevelWanted));
+		}
+
+#if (TEMHUM_TEMP_FROM_RH == 1)
+		PT_SPAWN(pt, &g_ptTemHumRead,
+				 Thread_TemHumRead(&g_ptTemHumRead, HUMI_CMDCODE, TemHum_GetResolution()->byWaitHumi));
+
+		if (g_byI2cStatus == I2C_ASYNC_OK)
+		{
+			humi = TemHumSensor_convertHumi(g_byTemHumData);
+
+			// Captured during the RH conversion: read at once, after a repeated START
+			g_byTemHumCommand = CMDR_MEASURE_VALUE;
+			TemHum_StartTransfer(&g_byTemHumCommand, 1, g_byTemHumData, sizeof(g_byTemHumData));
+			PT_WAIT_UNTIL(pt, TemHum_IsTransferEnded());
+
+			temp = TemHumSensor_convertTemp(g_byTemHumData);
+		}
+#else
+		PT_SPAWN(pt, &g_ptTemHumRead,
+				 Thread_TemHumRead(&g_ptTemHumRead, TEMP_CMDCODE, TemHum_GetResolution()->byWaitTemp));
+
+		if (g_byI2cStatus == I2C_ASYNC_OK)
+		{
+			temp = TemHumSensor_convertTemp(g_byTemHumData);
+
+			PT_SPAWN(pt, &g_ptTemHumRead,
+					 Thread_TemHumRead(&g_ptTemHumRead, HUMI_CMDCODE, TemHum_GetResolution()->byWaitHumi));
+
+			humi = TemHumSensor_convertHumi(g_byTemHumData);
+		}
+#endif
+
+		// Free before the call: the callback may start the next measurement
+		pfnDone = g_pfnTemHumDone;
+		g_pfnTemHumDone = NULL;
+
+		if (g_byI2cStatus == I2C_ASYNC_OK)
+		{
+			pfnDone(TEMHUM_OK, temp, humi);
+		}
+		else
+		{
+			pfnDone(TEMHUM_ERROR, 0, 0);
+		}
+	}
 
-	return temperature;
+	PT_END(pt);
 }
 
 /*
- * @func:  		TemHumSensor_getHumi
+ * @func:  		Thread_UpdateDisplay
  *
- * @brief:		The function processes humidity data
+ * @brief:		The protothread updating the values and the LCD on each new measurement
  *
- * @param:		None
+ * @param:		pt - State of the protothread
  *
- * @retval:		humidity
+ * @retval:		PT_WAITING until TemHum_OnMeasured has new readings
  *
  * @note:		None
  */
-static double TemHumSensor_getHumi (void)
+static PT_THREAD(Thread_UpdateDisplay (pt_t *pt))
 {
-	double humidity = 0;
-	uint8_t strHumi[2] = {0};
+	PT_BEGIN(pt);
 
-	// Get the humidity value from the corresponding register---------------------
-	TemHumSensor_readRegister(SENSOR_ADDR, HUMI_CMDCODE, strHumi, 2, TIME_WAIT_GET_HUMI);
-
-	// The RH_Code value returned by the Si7020-----------------------------------
-	uint16_t RHCode = (uint16_t)((strHumi[0] << 8) | strHumi[1]);
+	while (1)
+	{
+		PT_AWAIT_FLAG(pt, g_byMeasureReady);
 
-	// Convert the measured humidity value to relative humidity percentage--------
-	humidity = (double)((125 * RHCode) / 65536 - 6);
+		Update_ValueSensor();
+		Update_LCD();
+	}
 
-	return humidity;
+	PT_END(pt);
 }
 
 /*
@@ -489,30 +889,17 @@ static double TemHumSensor_getHumi (void)
  */
 static void Update_ValueSensor (void)
 {
-	static uint32_t TimeCurrent, TimeInit;
-	static uint32_t TimeTotal;
-
-	TimeCurrent = GetMilSecTick();
-
-	if (TimeCurrent >= TimeInit)
-	{
-		TimeTotal += TimeCurrent - TimeInit;
-	}
-	else
-	{
-		TimeTotal += 0xFFFFFFFFU - TimeCurrent + TimeInit;
-	}
+	static uint32_t TimeInit;
+	uint32_t TimeCurrent = GetMilSecTick();
 
-	if (TimeTotal >= PERIOD_UPDATE_SENSOR)
+	if (TimeBase_ElapsedMs(TimeInit, TimeCurrent) >= PERIOD_UPDATE_SENSOR)
 	{
 		// Time scan 1s-----------------------------------------------------------
-		g_temp = TemHumSensor_getTemp();
-		g_humi = TemHumSensor_getHumi();
+		g_temp = g_currentTemp;
+		g_humi = g_currentHumi;
 
-		TimeTotal = 0;
+		TimeInit = TimeCurrent;
 	}
-
-	TimeInit = TimeCurrent;
 }
 
 /*
@@ -524,32 +911,21 @@ static void Update_ValueSensor (void)
  *
  * @retval:		None
  *
- * @note:		None
+ * @note:		Called by Thread_UpdateDisplay with the latest readings
  */
 static void Update_LCD (void)
 {
-	static uint32_t TimeCurrent, TimeInit;
-	static uint32_t TimeTotal;
-
-	double currentTemp = TemHumSensor_getTemp();
-	double currentHumi = TemHumSensor_getHumi();
+	static uint32_t TimeInit;
+	uint32_t TimeCurrent = GetMilSecTick();
 
-	TimeCurrent = GetMilSecTick();
-
-	if (TimeCurrent >= TimeInit)
-	{
-		TimeTotal += TimeCurrent - TimeInit;
-	}
-	else
-	{
-		TimeTotal += 0xFFFFFFFFU + TimeCurrent - TimeInit;
-	}
+	double currentTemp = g_currentTemp;
+	double currentHumi = g_currentHumi;
 
 	// Update the temperature value immediately when there is a significant change
 	if (((currentTemp > g_temp) && (currentTemp - g_temp >= CHANGE_VALUE_TEMP)) ||
 		((currentTemp < g_temp) && (g_temp - currentTemp >= CHANGE_VALUE_TEMP)))
 	{
-		g_temp = TemHumSensor_getTemp();
+		g_temp = currentTemp;
 		printDataToLCD();
 	}
 
@@ -557,21 +933,19 @@ static void Update_LCD (void)
 	if (((currentHumi > g_humi) && (currentHumi - g_humi >= CHANGE_VALUE_HUMI)) ||
 		((currentHumi < g_humi) && (g_humi - currentHumi >= CHANGE_VALUE_HUMI)))
 	{
-		g_humi = TemHumSensor_getHumi();
+		g_humi = currentHumi;
 		printDataToLCD();
 	}
 
 	// Update the temperature and humidity values on the LCD screen with a 5-second interval
-	if (TimeTotal >= PERIOD_UPDATE_LCD)
+	if (TimeBase_ElapsedMs(TimeInit, TimeCurrent) >= PERIOD_UPDATE_LCD)
 	{
-		g_temp = TemHumSensor_getTemp();
-		g_humi = TemHumSensor_getHumi();
+		g_temp = currentTemp;
+		g_humi = currentHumi;
 		printDataToLCD();
 
-		TimeTotal = 0;
+		TimeInit = TimeCurrent;
 	}
-
-	TimeInit = TimeCurrent;
 }
 
 /*
@@ -600,25 +974,6 @@ static void printDataToLCD (void)
 	ucg_DrawString(&ucg, 0, 75, 0, g_strHumi);
 }
 
-/*
- * @func:  		delay_ms
- *
- * @brief:		The function creates a delay
- *
- * @param:		milisecond - Delay time
- *
- * @retval:		None
- *
- * @note:		None
- */
-static void delay_ms (uint32_t milisecond)
-{
-	for (uint32_t i = 0; i < milisecond; i++)
-	{
-		for (uint32_t j = 0; j < 5000; j++);
-	}
-}
-
 
 /* END FILE */
 
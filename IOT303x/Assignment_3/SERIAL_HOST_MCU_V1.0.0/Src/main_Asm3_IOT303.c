@@ -25,10 +25,24 @@
 #include "button.h"
 #include "ucg.h"
 #include "Ucglib.h"
-#include "buff.h"
+#include "queue.h"
+#include "typed_queue.h"
+#include "serial.h"
+#include "serialcmd.h"
+#include "frameparser.h"
+#include "reliablelink.h"
+#include "crc32.h"
+#include "serialtrace.h"
+#include "idlesleep.h"
+#include "eventqueue.h"
+#include "timebase.h"
+#ifdef USE_SCHED_PROFILER
+#include "schedprofiler.h"
+#endif
 #include "stm32f401re_rcc.h"
 #include "stm32f401re_gpio.h"
 #include "stm32f401re_usart.h"
+#include "stm32f401re_dma.h"
 #include "misc.h"
 
 /****************************************************************************************/
@@ -44,50 +58,103 @@
 #define USART2_RCC				RCC_APB1Periph_USART2
 #define USART_BAUDRATE				57600
 
-// The size of the array storing data retrieved from the queue
-#define RX_BUFFER_SIZE 				16
+// Highest rate the PC may ask for with CMD_ID_BAUDRATE
+#define USART_BAUDRATE_MAX			BAUD2000000
 
-#define FRAME_SOF 				0xB1
-#define FRAME_ACK 				0x06
-#define FRAME_NACK 				0x15
-#define CXOR_INIT_VAL 				0xFF
+// Largest error (per mille) between a requested rate and the rate the BRR divider gives
+#define USART_BAUDRATE_TOLERANCE		20
 
-// Message retrieving information and status of the device from the host computer
-#define CMD_TYPE_GET               		0x00
+// USART2_RX is served by DMA1 Stream5 Channel4 (RM0368, DMA1 request mapping)
+#define USART2_RX_DMA_RCC			RCC_AHB1Periph_DMA1
+#define USART2_RX_DMA_STREAM			DMA1_Stream5
+#define USART2_RX_DMA_CHANNEL			DMA_Channel_4
+#define USART2_RX_DMA_IRQn			DMA1_Stream5_IRQn
 
-// Message responding with the device's information and status to the host computer
-#define CMD_TYPE_RES               	 	0x01
+// USART2_TX is served by DMA1 Stream6 Channel4
+#define USART2_TX_DMA_STREAM			DMA1_Stream6
+#define USART2_TX_DMA_CHANNEL			DMA_Channel_4
+#define USART2_TX_DMA_IRQn			DMA1_Stream6_IRQn
 
-// Message for controlling the device from the host computer
-#define CMD_TYPE_SET               	 	0x02
+// 1: frames are queued and sent by DMA, 0: the former blocking transmit (to compare g_dwTxBlockedCycles)
+#define SERIAL_TX_USE_DMA			1
+
+// The number of frame slots in the TX queue (power of two)
+#define SIZE_QUEUE_FRAME_TX			8
+
+// The size of a TX frame slot: SOF, length, option, id, type, payload, sequence, CXOR or CRC-32
+#define TX_FRAME_SIZE_MAX			48
+#define TX_PAYLOAD_SIZE_MAX			(TX_FRAME_SIZE_MAX - 6 - FRAME_PARSER_CRC32_SIZE)
 
 #define CMD_OPT					0x00
 #define CMD_SEQUENCE				0x00
-#define CMD_ID_LED 				0x01
-#define CMD_ID_BUZZER				0x04
-#define CMD_ID_BUTTON 				0x82
-#define CMD_ID_TEMP_SENSOR 			0x84
-#define CMD_ID_HUMI_SENSOR 			0x85
-#define CMD_ID_LIGHT_SENSOR 			0x86
-#define CMD_ID_LCD				0x87
-
-#define CMD_ID					g_strRxBuffer[2]
-#define CMD_TYPE				g_strRxBuffer[3]
-#define CMD_DATA1				g_strRxBuffer[4]
-#define CMD_DATA2				g_strRxBuffer[5]
-#define CMD_DATA3				g_strRxBuffer[6]
-#define CMD_DATA4				g_strRxBuffer[7]
-#define CMD_DATA5				g_strRxBuffer[8]
-
-#define CMD_DATA_LED_ID				CMD_DATA1
-#define CMD_DATA_LED_COLOR			CMD_DATA2
-#define CMD_DATA_LED_NUMBLINK			CMD_DATA3
-#define CMD_DATA_LED_INTERVAL			CMD_DATA4
-#define CMD_DATA_LED_LASTSTATE			CMD_DATA5
-#define CMD_DATA_BUZZER_STATE			CMD_DATA1
-#define CMD_DATA_BUTTON_EVENT			CMD_DATA1
-#define CMD_DATA_BUTTON_STATE			CMD_DATA2
-#define CMD_DATA_LCD				CMD_DATA1
+
+// 1: frames with CMD_OPT_RELIABLE are acknowledged with FRAME_ACK + Seq, sent again on
+// FRAME_NACK or timeout, and handled once (see reliablelink.h). 0: the plain protocol
+#define SERIAL_RELIABLE_MODE			0
+
+// 1: every frame received and sent is recorded with its time in g_bySerialTrace. Dump the first
+// g_serialTrace.wUsed bytes with the debugger: they are a trace file for trace_replay
+#define SERIAL_TRACE_ENABLE			0
+#define SERIAL_TRACE_BUFFER_SIZE		4096
+
+// 1: when the main loop has nothing left to do, it sleeps (WFI) until the next timer, a serial
+// deadline or an interrupt (see idlesleep.h). The idle time is returned by CMD_ID_DIAGNOSTICS
+#define IDLE_SLEEP_ENABLE			1
+
+// Option of the state reports whose delivery must be guaranteed (LED, buzzer)
+#if (SERIAL_RELIABLE_MODE == 1)
+#define CMD_OPT_RESPOND				CMD_OPT_RELIABLE
+#else
+#define CMD_OPT_RESPOND				CMD_OPT
+#endif
+
+// Command carrying every sensor reading of one scan in a single frame
+#define CMD_ID_MULTI_SENSOR			0x88
+
+// Command changing the baud rate: SET with the new rate (4 bytes, high byte first), answered
+// (RES, at the old rate) with the new rate if it is accepted or the current rate if not
+#define CMD_ID_BAUDRATE				0x89
+
+// After a switch a valid frame must arrive within this time (ms) and before this many
+// receive errors, otherwise both sides go back to USART_BAUDRATE
+#define BAUDRATE_CONFIRM_TIMEOUT		1000
+#define BAUDRATE_CONFIRM_ERRORS_MAX		3
+
+// Command choosing the check of the frames sent by the MCU: SET with 1 byte, FRAMING_CXOR or
+// FRAMING_CRC32, answered (RES, still with the old check) with the check now in use.
+// Received frames are checked as their own CMD_OPT_CRC32 bit says
+#define CMD_ID_FRAMING				0x8A
+#define FRAMING_CXOR				0x00
+#define FRAMING_CRC32				0x01
+
+// Command returning the link counters (GET, no payload). RES payload, 4-byte values high
+// byte first: version, RX frames ok, RX CXOR / CRC-32 errors, RX length errors, RX garbage
+// bytes, RX queue overflow bytes, RX queue peak depth (2 bytes), TX bytes, TX frames refused
+// (queue full), CPU cycles spent in Serial_SendPacketCustom, then 1 byte: idle time (%) since
+// the previous request
+#define CMD_ID_DIAGNOSTICS			0x8B
+#define DIAGNOSTICS_VERSION			0x02
+
+// Command returning the statistics of one scheduler callback (USE_SCHED_PROFILER).
+// GET payload: slot index, page. RES payload: version, slot index, number of slots, page,
+// name (PROFILE_NAME_SIZE bytes, zero padded), then 4-byte values high byte first, in us:
+// - PROFILE_PAGE_RUNTIME: calls, min, avg, max run time;
+// - PROFILE_PAGE_LATENESS: min, avg, max lateness (0xFFFFFFFF: not known), then the run
+//   time histogram (< 10 us, < 100 us, < 1 ms, < 10 ms, above) in 2-byte saturated counts.
+// Past the last slot the RES stops after the page. SET (no payload) clears the statistics
+#define CMD_ID_PROFILE				0x8C
+#define PROFILE_VERSION				0x01
+#define PROFILE_PAGE_RUNTIME			0x00
+#define PROFILE_PAGE_LATENESS			0x01
+#define PROFILE_NAME_SIZE			11
+
+// Its payload: schema version, timestamp (ms, 4 bytes, high byte first), then one
+// TLV per sensor: tag = CMD_ID of the sensor, length, value (high byte first)
+#define TELEMETRY_SCHEMA_VERSION		0x01
+#define TELEMETRY_TLV_VALUE_SIZE		2
+
+// 1: report the sensors with three separate frames, for the legacy PC_Simulator_KIT
+#define TELEMETRY_LEGACY_FRAMES			0
 
 // LED brightness adjustment cycle
 #define CYCLE_LED_CHANGE			20
@@ -112,22 +179,46 @@ typedef enum
 	STATE_APP_RESET
 } state_app_t;
 
-typedef enum 
+// Events of the EventQueue, their data travels in the payload
+typedef enum
 {
-	RX_STATE_START_BYTE,
-	RX_STATE_DATA_BYTES,
-	RX_STATE_CXOR_BYTE
-} RX_STATE;
+	APP_EVENT_BUTTON_CMD,				// HIGH, payload: epoint, state
+	APP_EVENT_LCD_SENSORS,				// LOW coalesced, payload: lcd_sensors_t
+	APP_EVENT_LCD_SYSTEM_INFO,			// LOW, no payload
+	APP_EVENT_LCD_TEXT,				// LOW, payload: text without its 0x0D
+	APP_EVENT_LCD_CLEAR				// LOW, no payload
+} app_event_t;
+
+// Readings drawn by APP_EVENT_LCD_SENSORS
+typedef struct
+{
+	uint16_t temperature;
+	uint16_t humidity;
+	uint16_t light;
+} lcd_sensors_t;
 
-typedef enum 
+// Link health counters, returned by CMD_ID_DIAGNOSTICS with those of g_serialQueueRxStats
+typedef struct
+{
+	uint32_t dwRxFramesOk;				// Frames with a good length and check
+	uint32_t dwRxCheckErrors;			// Frames with a bad CXOR / CRC-32
+	uint32_t dwRxLengthErrors;			// SOF followed by a length out of 2..RX_BUFFER_SIZE
+	uint32_t dwRxGarbageBytes;			// Bytes that start no message
+	uint32_t dwTxBytes;				// Bytes handed to the USART
+	uint32_t dwTxQueueFull;				// Frames refused by a full TX queue
+} serial_diag_t;
+
+// A frame prebuilt by Serial_SendPacketCustom, waiting in the TX queue
+typedef struct
 {
-	USART_STATE_IDLE,
-	USART_STATE_DATA_RECEIVED,
-	USART_STATE_ACK_RECEIVED,
-	USART_STATE_NACK_RECEIVED,
-	USART_STATE_ERROR,
-	USART_STATE_RX_TIMEOUT,
-} USART_STATE;
+	uint8_t byLength;				// Number of bytes used in aData
+	uint8_t aData[TX_FRAME_SIZE_MAX];
+} tx_frame_t;
+
+// Called when a frame has been handed to the USART, with its sequence number
+typedef void (*serial_tx_done_callback)(uint8_t bySequence);
+
+DECLARE_QUEUE(txFrameQueue, tx_frame_t, SIZE_QUEUE_FRAME_TX)
 
 /****************************************************************************************/
 /*                                  GLOBAL VARIABLEs                 			*/
@@ -146,12 +237,6 @@ uint8_t 		g_idTimerStartIncrease = NO_TIMER;
 uint8_t 		g_idTimerStartDecrease = NO_TIMER;
 uint8_t 		g_idTimerDisplayLCD = NO_TIMER;
 uint8_t 		g_idTimerSensorUpdate = NO_TIMER;
-uint8_t 		g_B3Count = 0;
-uint16_t 		g_temperature, g_humidity, g_light;
-uint8_t 		g_RxBufState;
-
-// Variable storing the position of an element in the array holding data retrieved from the queue
-uint8_t 		g_IndexRxBuf;
 
 // Array storing data passed to FIFO (input data)
 uint8_t 		g_strRxBufData[SIZE_QUEUE_DATA_RX];
@@ -159,14 +244,72 @@ uint8_t 		g_strRxBufData[SIZE_QUEUE_DATA_RX];
 // Pointer to reference the FIFO object
 buffqueue_t 		g_serialQueueRx;
 
-// Array storing data retrieved from the queue
-uint8_t 		g_strRxBuffer[RX_BUFFER_SIZE] = {0};
+// Occupancy and overflow counters of the RX FIFO, used to size SIZE_QUEUE_DATA_RX
+buffqueue_stats_t 	g_serialQueueRxStats;
+
+// Array holding a frame that straddles the wrap point of the queue storage
+uint8_t 		g_strRxBuffer[RX_BUFFER_SIZE + FRAME_PARSER_OVERHEAD] = {0};
+
+// Pointer to the length byte of the frame being dispatched (in the queue or in g_strRxBuffer)
+uint8_t 		*g_pRxFrame = &g_strRxBuffer[1];
+
+// Number of queue bytes still held by the frame being dispatched
+uint16_t 		g_wRxFrameHeld = 0;
+
+// Index in g_strRxBufData the DMA had reached when bytes were last committed to the queue
+uint16_t 		g_wRxDmaIndex = 0;
+
+// Set by the interrupts when the DMA overwrote bytes the main loop had not read yet
+volatile uint8_t 	g_byRxDmaOverrun = 0;
+
+// Frames waiting for (or being sent by) the TX DMA
+txFrameQueue_t 		g_serialQueueTx;
+
+// Set while the TX DMA is sending the oldest frame of g_serialQueueTx
+volatile uint8_t 	g_byTxDmaBusy = 0;
 
-uint8_t 		g_byCheckXorRxBuf;
-uint8_t 		g_Data_Receive = 0;
-char 			g_strTemp[30] = "";
-char 			g_strHumi[30] = "";
-char 			g_strLight[30] = "";
+serial_tx_done_callback	g_pTxDoneCallback = NULL;
+
+// CPU cycles the main loop spent inside Serial_SendPacketCustom (DWT cycle counter)
+uint32_t 		g_dwTxBlockedCycles = 0;
+
+#if (SERIAL_RELIABLE_MODE == 1)
+// Frames waiting for their FRAME_ACK, and the sequence numbers already received
+reliablelink_t 		g_serialLink;
+
+// Sequence number carried by the last FRAME_ACK / FRAME_NACK
+uint8_t 		g_byRxAckSequence = 0;
+#endif
+
+// Baud rate in use, and the accepted rate waiting for its answer to be sent (0: none)
+uint32_t 		g_dwBaudRate = USART_BAUDRATE;
+uint32_t 		g_dwBaudRatePending = 0;
+
+// Set from the switch until the first valid frame received at the new rate
+uint8_t 		g_byBaudRateConfirming = 0;
+uint8_t 		g_byBaudRateErrors = 0;
+uint32_t 		g_dwBaudRateSwitchTick = 0;
+
+// Counters of the RX and TX paths
+serial_diag_t 		g_serialDiag;
+
+#ifdef USE_SCHED_PROFILER
+// Profiler slot of AppStateManager, the handler of the SDK event scheduler
+uint8_t 		g_byProfileAppState = SCHED_PROFILER_NO_SLOT;
+#endif
+
+// g_serialQueueRxStats.dwTotalItems when PollRxBuff last ran, and whether it found a message
+uint32_t 		g_dwRxItemsPolled = 0;
+uint8_t 		g_byRxMessageFound = 0;
+
+#if (SERIAL_TRACE_ENABLE == 1)
+// Capture of the frames received and sent (see SERIAL_TRACE_ENABLE)
+serialtrace_t 		g_serialTrace;
+uint8_t 		g_bySerialTrace[SERIAL_TRACE_BUFFER_SIZE];
+#endif
+
+// FRAMING_CXOR or FRAMING_CRC32, for the frames sent by Serial_SendPacketCustom
+uint8_t 		g_byTxFraming = FRAMING_CXOR;
 
 /****************************************************************************************/
 /*                                 FUNCTIONs PROTOTYPE                                  */
@@ -175,9 +318,28 @@ void 		AppInitManager (void);
 void 		AppStateManager (uint8_t event);
 void 		SetStateApp (state_app_t state);
 state_app_t 	GetStateApp (void);
+void 		AppEventHandler (const event_t *pEvent);
+uint8_t 	AppIsBusy (void);
 void 		SerialCustom_Init (void);
 void 		USART2_Init (void);
+uint16_t 	USART2_ComputeBrr (uint32_t dwBaudRate, uint8_t *pbyOver8);
+uint8_t 	USART2_SetBaudRate (uint32_t dwBaudRate);
+void 		SerialCustom_BaudRateProcess (void);
+uint8_t 	SerialCustom_IsBusy (void);
+uint32_t 	SerialCustom_NextDeadline (void);
 void 		USART2Modify_IRQHandler (void);
+void 		USART2_RxDmaInit (void);
+void 		USART2_RxDmaUpdate (void);
+void 		USART2_RxDmaRecover (void);
+void 		DMA1_Stream5_IRQHandler (void);
+void 		USART2_TxDmaInit (void);
+void 		USART2_TxDmaStart (tx_frame_t *pFrame);
+void 		DMA1_Stream6_IRQHandler (void);
+void 		SerialCustom_TxDoneCallback (serial_tx_done_callback callback);
+uint8_t 	SerialCustom_QueueFrame (const uint8_t *pFrame, uint8_t byLength);
+void 		SerialCustom_CommitFrame (tx_frame_t *pSlot);
+void 		SerialCustom_SendReliableFrame (const uint8_t *pFrame, uint8_t byLength);
+void 		SerialCustom_SendAck (uint8_t byAck, uint8_t bySequence);
 void		LoadConfiguration (void);
 void 		DeviceStateMachine (uint8_t event);
 uint8_t 	Clamp (uint8_t value, uint8_t min , uint8_t max);
@@ -185,15 +347,35 @@ void 		Increase_LedLevel (void);
 void 		Decrease_LedLevel (void);
 void 		MultiSensorScan (void);
 void 		Task_MultiSensorScan (void);
-void 		Serial_SendPacketCustom (uint8_t byOption,uint8_t byCmdId, uint8_t byCmdType,
+uint8_t 	Serial_SendPacketCustom (uint8_t byOption,uint8_t byCmdId, uint8_t byCmdType,
 					 uint8_t *pPayload, uint8_t byLengthPayload);
+void 		LedControl_SendPacketRespondCustom (uint8_t led_id, uint8_t led_color, uint8_t led_level);
+void 		BuzzerControl_SendPacketRespondCustom (uint8_t buzzer_state);
+void 		Sensor_SendPacketRespondCustom (uint8_t byCmdId, uint16_t value);
+void 		Telemetry_SendPacketMultiSensor (uint16_t temperature, uint16_t humidity, uint16_t light);
 void 		processSerialReceiverCustom (void);
 uint8_t 	PollRxBuff (void);
+void 		SerialCustom_RegisterCommands (void);
+void 		LedCmdHandler (const cmd_receive_t *pCmd);
+void 		BuzzerCmdHandler (const cmd_receive_t *pCmd);
+void 		ButtonCmdHandler (const cmd_receive_t *pCmd);
+void 		LcdCmdHandler (const cmd_receive_t *pCmd);
+void 		BaudRateCmdHandler (const cmd_receive_t *pCmd);
+void 		FramingCmdHandler (const cmd_receive_t *pCmd);
+void 		DiagnosticsCmdHandler (const cmd_receive_t *pCmd);
+#ifdef USE_SCHED_PROFILER
+void 		ProfileCmdHandler (const cmd_receive_t *pCmd);
+void 		ProfileResetCmdHandler (const cmd_receive_t *pCmd);
+uint8_t 	Profile_PutValue (uint8_t *pPayload, uint8_t size, uint32_t dwValue);
+#endif
 void 		ButtonCmdSetState (uint8_t button_event, uint8_t button_state);
 void 		LedCmdSetState (uint8_t led_id, uint8_t led_color, uint8_t led_num_blink,
 		 	 	uint8_t led_interval, uint8_t led_last_state);
 void 		BuzzerCmdSetState (uint8_t buzzer_state);
-void 		LcdCmdSetState (char *text);
+void 		LcdCmdSetState (const char *text, uint8_t byLength);
+void 		LcdShowSystemInfo (void);
+void 		LcdShowSensors (const lcd_sensors_t *pSensors);
+void 		LcdShowText (const uint8_t *pText, uint8_t byLength);
 
 /****************************************************************************************/
 /*                                      FUNCTIONs                                       */
@@ -226,6 +408,14 @@ int main ()
 
 		// Processing received messages in the format from the simulation software
 		processSerialReceiverCustom();
+
+		// One queued event per loop, LCD redraws wait while serial bytes are pending
+		EventQueue_Process(SerialCustom_IsBusy() ? EVENT_PRIORITY_NORMAL : EVENT_PRIORITY_LOW);
+
+#if (IDLE_SLEEP_ENABLE == 1)
+		// Nothing left to do: sleep until the next timer, serial deadline or interrupt
+		IdleSleep_Enter(SerialCustom_NextDeadline());
+#endif
 	}
 }
 
@@ -243,11 +433,21 @@ int main ()
 void AppInitManager (void)
 {
 	SystemCoreClockUpdate();
+
+#ifdef USE_SCHED_PROFILER
+	// Before TimerInit: the timers and events register their slots as they start
+	SchedProfiler_Init(SystemCoreClock / 1000000);
+	g_byProfileAppState = SchedProfiler_Register("AppStateMgr");
+#endif
+
 	TimerInit();
 
 	// Initializing the buffer to store the event list of the program
 	EventSchedulerInit(AppStateManager);
 
+	// Events carrying their data, served by priority
+	EventQueue_Init(AppEventHandler);
+
 	EventButton_Init();
 	BuzzerControl_Init();
 	LedControl_Init();
@@ -258,6 +458,10 @@ void AppInitManager (void)
 
 	SerialCustom_Init();
 
+#if (IDLE_SLEEP_ENABLE == 1)
+	IdleSleep_Init(AppIsBusy);
+#endif
+
 	Ucglib4WireSWSPI_begin(&g_ucg, UCG_FONT_MODE_SOLID);
 	ucg_ClearScreen(&g_ucg);
 	ucg_SetFont(&g_ucg, ucg_font_ncenR10_hf);
@@ -279,6 +483,11 @@ void AppInitManager (void)
  */
 void AppStateManager (uint8_t event)
 {
+#ifdef USE_SCHED_PROFILER
+	// The SDK event scheduler is prebuilt: its handler is measured here, without lateness
+	uint32_t dwStartCycles = SchedProfiler_Now();
+#endif
+
 	switch (GetStateApp())
 	{
 		case STATE_APP_STARTUP:
@@ -301,6 +510,75 @@ void AppStateManager (uint8_t event)
 		default:
 			break;
 	}
+
+#ifdef USE_SCHED_PROFILER
+	SchedProfiler_Record(g_byProfileAppState, dwStartCycles, SCHED_PROFILER_NO_LATENESS);
+#endif
+}
+
+/*
+ * @func:  		AppEventHandler
+ *
+ * @brief:		The function to handle the events of the EventQueue
+ *
+ * @param:		pEvent - Event and its payload
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+void AppEventHandler (const event_t *pEvent)
+{
+	switch (pEvent->byEvent)
+	{
+		case APP_EVENT_BUTTON_CMD:
+		{
+			ButtonCmdSetState(pEvent->aPayload[0], pEvent->aPayload[1]);
+		} break;
+
+		case APP_EVENT_LCD_SENSORS:
+		{
+			lcd_sensors_t sensors;
+
+			memcpy(&sensors, pEvent->aPayload, sizeof(sensors));
+			LcdShowSensors(&sensors);
+		} break;
+
+		case APP_EVENT_LCD_SYSTEM_INFO:
+		{
+			LcdShowSystemInfo();
+		} break;
+
+		case APP_EVENT_LCD_TEXT:
+		{
+			LcdShowText(pEvent->aPayload, pEvent->byLength);
+		} break;
+
+		case APP_EVENT_LCD_CLEAR:
+		{
+			ucg_ClearScreen(&g_ucg);
+			ucg_SetFont(&g_ucg, ucg_font_ncenR10_hf);
+		} break;
+
+		default:
+			break;
+	}
+}
+
+/*
+ * @func:  		AppIsBusy
+ *
+ * @brief:		The function to tell the idle hook whether the main loop has work left
+ *
+ * @param:		None
+ *
+ * @retval:		1 if the serial link or the EventQueue has work left
+ *
+ * @note:		Called with interrupts masked
+ */
+uint8_t AppIsBusy (void)
+{
+	return (SerialCustom_IsBusy() || !EventQueue_IsEmpty());
 }
 
 /*
@@ -349,6 +627,24 @@ state_app_t GetStateApp (void)
 void SerialCustom_Init (void)
 {
 	bufInit(g_strRxBufData, &g_serialQueueRx, sizeof(g_strRxBufData[0]), SIZE_QUEUE_DATA_RX);
+	bufAttachStats(&g_serialQueueRx, &g_serialQueueRxStats);
+	txFrameQueueInit(&g_serialQueueTx);
+	SerialCustom_RegisterCommands();
+	Crc32_Init();
+
+#if (SERIAL_RELIABLE_MODE == 1)
+	ReliableLink_Init(&g_serialLink, SerialCustom_SendReliableFrame);
+#endif
+
+	// Time of the trace records, from SysTick, which keeps counting in the idle sleep.
+	// Also starts the DWT cycle counter used to measure g_dwTxBlockedCycles
+	TimeBase_Init(SystemCoreClock / 1000000);
+
+#if (SERIAL_TRACE_ENABLE == 1)
+	SerialTrace_Init(&g_serialTrace, g_bySerialTrace, sizeof(g_bySerialTrace),
+			 (uint32_t)TimeBase_GetUs());
+#endif
+
 	USART2_Init();
 }
 
@@ -403,9 +699,13 @@ void USART2_Init (void)
 
 	USART_Cmd(USART2, ENABLE);
 
+	/* Configure DMA reception and transmission-----------------------------------------*/
+	USART2_RxDmaInit();
+	USART2_TxDmaInit();
+
 	/* Configure interrupts for USART------------------------------------------------------*/
-	// Clock supply for NVIC---------------------------------------------------------------
-	USART_ITConfig(USART2, USART_IT_RXNE, ENABLE);
+	// Idle line interrupt: raised once at the end of each burst of received bytes---------
+	USART_ITConfig(USART2, USART_IT_IDLE, ENABLE);
 
 	// NVIC Configuration------------------------------------------------------------------
 	NVIC_PriorityGroupConfig(NVIC_PriorityGroup_2);
@@ -420,573 +720,1731 @@ void USART2_Init (void)
 }
 
 /*
- * @func:  		USART2Modify_IRQHandler
+ * @func:  		USART2_ComputeBrr
  *
- * @brief:		The function to handle USART2 interrupt
+ * @brief:		The function to compute the USART2 BRR value for a baud rate
  *
- * @param:		None
+ * @param[1]:		dwBaudRate - Baud rate
+ * @param[2]:		pbyOver8 - Set to 1 if the rate needs oversampling by 8
  *
- * @retval:		None
+ * @retval:		BRR value, 0 if the rate cannot be reached within USART_BAUDRATE_TOLERANCE
  *
- * @note:		None
+ * @note:		USART2 is clocked by PCLK1 (SystemCoreClock / APB1 prescaler). Oversampling
+ * 			by 16 is used up to PCLK1 / 16, by 8 above it (up to PCLK1 / 8)
  */
-void USART2Modify_IRQHandler (void)
+uint16_t USART2_ComputeBrr (uint32_t dwBaudRate, uint8_t *pbyOver8)
 {
-	if (USART_GetITStatus(USART2, USART_IT_RXNE) == SET)
+	RCC_ClocksTypeDef RCC_Clocks;
+	uint32_t dwDivider;
+	uint32_t dwActual;
+	uint32_t dwError;
+	uint8_t byOver8;
+
+	if (dwBaudRate == 0)
+	{
+		return 0;
+	}
+
+	RCC_GetClocksFreq(&RCC_Clocks);
+
+	byOver8 = (dwBaudRate > (RCC_Clocks.PCLK1_Frequency / 16)) ? 1 : 0;
+
+	// USARTDIV in 1/16 (or 1/8) steps, rounded to the nearest step
+	dwDivider = (RCC_Clocks.PCLK1_Frequency + (dwBaudRate / 2)) / dwBaudRate;
+
+	if ((dwDivider < (byOver8 ? 8 : 16)) || (dwDivider > 0xFFFF))
+	{
+		return 0;
+	}
+
+	dwActual = RCC_Clocks.PCLK1_Frequency / dwDivider;
+	dwError = (dwActual > dwBaudRate) ? (dwActual - dwBaudRate) : (dwBaudRate - dwActual);
+
+	if (((dwError * 1000) / dwBaudRate) > USART_BAUDRATE_TOLERANCE)
+	{
+		return 0;
+	}
+
+	*pbyOver8 = byOver8;
+
+	if (byOver8)
 	{
-		g_Data_Receive = (uint8_t)USART_ReceiveData(USART2);
-		bufEnDat(&g_serialQueueRx, &g_Data_Receive);
+		// DIV_Fraction[3] must stay clear: the fraction only has 3 bits
+		return (uint16_t)(((dwDivider >> 3) << 4) | (dwDivider & 0x07));
 	}
 
-	USART_ClearITPendingBit(USART2, USART_IT_RXNE);
+	return (uint16_t)dwDivider;
 }
 
 /*
- * @func:  		LoadConfiguration
+ * @func:  		USART2_SetBaudRate
  *
- * @brief		The function to display information on the LCD and PC_Simulator_KIT
- * 			when the device is powered on
+ * @brief:		The function to change the baud rate of USART2
  *
- * @param:		None
+ * @param:		dwBaudRate - New baud rate
  *
- * @retval:		None
+ * @retval:		1 if the rate is applied, 0 if it cannot be reached
  *
- * @note:		None
+ * @note:		A byte being sent or received at that moment is lost
  */
-void LoadConfiguration (void)
+uint8_t USART2_SetBaudRate (uint32_t dwBaudRate)
 {
-	ucg_DrawString(&g_ucg, 0, 40, 0, "IOT Programming");
-	ucg_DrawString(&g_ucg, 55, 65, 0, "by");
-	ucg_DrawString(&g_ucg, 5, 90, 0, "Lumi Smarthome");
+	uint8_t byOver8 = 0;
+	uint16_t wBrr = USART2_ComputeBrr(dwBaudRate, &byOver8);
 
-	char text[] = "IOT Programming by Lumi Smarthome";
-	Serial_SendPacketCustom(CMD_OPT, CMD_ID_LCD, CMD_TYPE_GET, (uint8_t*)text, sizeof(text));
+	if (wBrr == 0)
+	{
+		return 0;
+	}
+
+	USART_Cmd(USART2, DISABLE);
+	USART_OverSampling8Cmd(USART2, byOver8 ? ENABLE : DISABLE);
+	USART2->BRR = wBrr;
+	USART_Cmd(USART2, ENABLE);
+
+	g_dwBaudRate = dwBaudRate;
+
+	return 1;
 }
 
 /*
- * @func:  		DeviceStateMachine
+ * @func:  		USART2_RxDmaInit
  *
- * @brief:		- The function to control LED, Buzzer, and display information on the LCD after
- * 			pressing buttons on the KIT board
- * 			- Simultaneously, send updates of the corresponding LED color status and buzzer state
- * 			to the PC_Simulator_KIT
+ * @brief:		The function to configure DMA1 Stream5 to receive USART2 data in circular mode
  *
- * @param:		event - Event when pressing a button on the KIT board
+ * @param:		None
  *
  * @retval:		None
  *
- * @note:		None
+ * @note:		The DMA writes straight into g_strRxBufData, the storage of g_serialQueueRx,
+ * 			so SIZE_QUEUE_DATA_RX is also the DMA transfer count. The received bytes
+ * 			are handed to the queue by USART2_RxDmaUpdate.
  */
-void DeviceStateMachine (uint8_t event)
+void USART2_RxDmaInit (void)
 {
-	switch (event)
-	{
-		case EVENT_OF_BUTTON_3_PRESS_5_TIMES:
-		{
-			if (g_idTimerSensorUpdate != NO_TIMER)
-			{
-				TimerStop(g_idTimerSensorUpdate);
-				g_idTimerSensorUpdate = NO_TIMER;
-			}
+	DMA_InitTypeDef		DMA_InitStruct;
+	NVIC_InitTypeDef	NVIC_InitStruct;
 
-			// Display system status information on the LCD screen-------------------------
-			memset(g_strTemp, 0, sizeof(g_strTemp));
-			memset(g_strHumi, 0, sizeof(g_strHumi));
-			memset(g_strLight, 0, sizeof(g_strLight));
-			ucg_ClearScreen(&g_ucg);
-			ucg_SetFont(&g_ucg, ucg_font_ncenR08_hf);
-			ucg_DrawString(&g_ucg, 0, 12, 0, "Device: Board");
-			ucg_DrawString(&g_ucg, 0, 24, 0, "STM32 Nucleo.");
-			ucg_DrawString(&g_ucg, 0, 36, 0, "Code: STM32F401RE_");
-			ucg_DrawString(&g_ucg, 0, 48, 0, "NUCLEO.");
-			ucg_DrawString(&g_ucg, 0, 60, 0, "Manufacturer:");
-			ucg_DrawString(&g_ucg, 0, 72, 0, "STMicroelectronics.");
-			ucg_DrawString(&g_ucg, 0, 84, 0, "Kit expansion:");
-			ucg_DrawString(&g_ucg, 0, 97, 0, "Lumi Smarthome.");
-			ucg_DrawString(&g_ucg, 0, 110, 0, "Project:");
-			ucg_DrawString(&g_ucg, 0, 123, 0, "Simulator touch switch.");
+	// Clock supply for DMA1---------------------------------------------------------------
+	RCC_AHB1PeriphClockCmd(USART2_RX_DMA_RCC, ENABLE);
 
-			// Blink the green LED 5 times-------------------------------------------------
-			LedControl_BlinkStart(LED_ALL_ID, BLINK_GREEN, 10, 1000, LED_COLOR_BLACK);
+	// Configure DMA1 Stream5: USART2->DR to the queue storage, wrapping at the end--------
+	DMA_DeInit(USART2_RX_DMA_STREAM);
+	DMA_StructInit(&DMA_InitStruct);
 
-			// Temperature, humidity, light intensity parameters---------------------------
-			if (g_idTimerDisplayLCD != NO_TIMER)
-			{
-				TimerStop(g_idTimerDisplayLCD);
-				g_idTimerDisplayLCD = NO_TIMER;
-			}
+	DMA_InitStruct.DMA_Channel = USART2_RX_DMA_CHANNEL;
+	DMA_InitStruct.DMA_PeripheralBaseAddr = (uint32_t)&USART2->DR;
+	DMA_InitStruct.DMA_Memory0BaseAddr = (uint32_t)g_strRxBufData;
+	DMA_InitStruct.DMA_DIR = DMA_DIR_PeripheralToMemory;
+	DMA_InitStruct.DMA_BufferSize = SIZE_QUEUE_DATA_RX;
+	DMA_InitStruct.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	DMA_InitStruct.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	DMA_InitStruct.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+	DMA_InitStruct.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+	DMA_InitStruct.DMA_Mode = DMA_Mode_Circular;
+	DMA_InitStruct.DMA_Priority = DMA_Priority_High;
+	DMA_InitStruct.DMA_FIFOMode = DMA_FIFOMode_Disable;
 
-			g_idTimerDisplayLCD = TimerStart("MultiSensorScan", 7000, 1,
-											(void*) MultiSensorScan, NULL);
-		} break;
+	DMA_Init(USART2_RX_DMA_STREAM, &DMA_InitStruct);
 
-		case EVENT_OF_BUTTON_1_PRESS_LOGIC:
-		{
-			if(g_ledRed == 0)
-			{
-				g_ledRed = 1;
-				g_ledGreen = 0;
-				g_ledWhite = 0;
-				g_ledBlue = 0;
-				LedControl_SetAllColor(LED_COLOR_RED, 50);
-				LedControl_SendPacketRespond(LED_KIT_ID0, LED_COLOR_RED, 50);
-				LedControl_SendPacketRespond(LED_KIT_ID1, LED_COLOR_RED, 50);
-			}
-			else
-			{
-				g_ledRed = 0;
-				LedControl_SetAllColor(LED_COLOR_RED, 0);
-				LedControl_SendPacketRespond(LED_KIT_ID0, LED_COLOR_RED, 0);
-				LedControl_SendPacketRespond(LED_KIT_ID1, LED_COLOR_RED, 0);
-			}
+	// Half/full transfer interrupts commit long bursts that have no idle gap--------------
+	DMA_ITConfig(USART2_RX_DMA_STREAM, DMA_IT_HT | DMA_IT_TC, ENABLE);
 
-			BuzzerControl_SetMelody(pbeep);
-			BuzzerControl_SendPacketRespond(1);
-		} break;
+	NVIC_InitStruct.NVIC_IRQChannel = USART2_RX_DMA_IRQn;
+	NVIC_InitStruct.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_InitStruct.NVIC_IRQChannelPreemptionPriority = 0;
+	NVIC_InitStruct.NVIC_IRQChannelSubPriority = 0;
 
-		case EVENT_OF_BUTTON_2_PRESS_LOGIC:
-		{
-			if(g_ledGreen == 0)
-			{
-				g_ledRed = 0;
-				g_ledGreen = 1;
-				g_ledWhite = 0;
-				g_ledBlue = 0;
-				LedControl_SetAllColor(LED_COLOR_GREEN, 50);
-				LedControl_SendPacketRespond(LED_KIT_ID0, LED_COLOR_GREEN, 50);
-				LedControl_SendPacketRespond(LED_KIT_ID1, LED_COLOR_GREEN, 50);
-			}
-			else
-			{
-				g_ledGreen = 0;
-				LedControl_SetAllColor(LED_COLOR_GREEN, 0);
-				LedControl_SendPacketRespond(LED_KIT_ID0, LED_COLOR_GREEN, 0);
-				LedControl_SendPacketRespond(LED_KIT_ID1, LED_COLOR_GREEN, 0);
-			}
+	NVIC_Init(&NVIC_InitStruct);
 
-			BuzzerControl_SetMelody(pbeep);
-			BuzzerControl_SendPacketRespond(1);
-		} break;
+	g_wRxDmaIndex = 0;
+	g_byRxDmaOverrun = 0;
 
-		case EVENT_OF_BUTTON_4_PRESS_LOGIC:
-		{
-			if(g_ledWhite == 0)
-			{
-				g_ledRed = 0;
-				g_ledGreen = 0;
-				g_ledWhite = 1;
-				g_ledBlue = 0;
-				LedControl_SetAllColor(LED_COLOR_WHITE, 50);
-				LedControl_SendPacketRespond(LED_KIT_ID0, LED_COLOR_WHITE, 50);
-				LedControl_SendPacketRespond(LED_KIT_ID1, LED_COLOR_WHITE, 50);
-			}
-			else
-			{
-				g_ledWhite = 0;
-				LedControl_SetAllColor(LED_COLOR_WHITE, 0);
-				LedControl_SendPacketRespond(LED_KIT_ID0, LED_COLOR_WHITE, 0);
-				LedControl_SendPacketRespond(LED_KIT_ID1, LED_COLOR_WHITE, 0);
-			}
+	DMA_Cmd(USART2_RX_DMA_STREAM, ENABLE);
+	USART_DMACmd(USART2, USART_DMAReq_Rx, ENABLE);
+}
 
-			BuzzerControl_SetMelody(pbeep);
-			BuzzerControl_SendPacketRespond(1);
-		} break;
+/*
+ * @func:  		USART2_RxDmaUpdate
+ *
+ * @brief:		The function to commit the bytes written by the DMA since the last call to the queue
+ *
+ * @param:		None
+ *
+ * @retval:		None
+ *
+ * @note:		Called from the USART2 idle and the DMA interrupts, which share one priority.
+ * 			If the DMA lapped the main loop the unread bytes are lost: the queue is
+ * 			left as it is and USART2_RxDmaRecover restarts the reception.
+ */
+void USART2_RxDmaUpdate (void)
+{
+	uint16_t wDmaIndex;
+	uint16_t wReceived;
 
-		case EVENT_OF_BUTTON_5_PRESS_LOGIC:
-		{
-			if(g_ledBlue == 0)
-			{
-				g_ledRed = 0;
-				g_ledGreen = 0;
-				g_ledWhite = 0;
-				g_ledBlue = 1;
-				LedControl_SetAllColor(LED_COLOR_BLUE, 50);
-				LedControl_SendPacketRespond(LED_KIT_ID0, LED_COLOR_BLUE, 50);
-				LedControl_SendPacketRespond(LED_KIT_ID1, LED_COLOR_BLUE, 50);
-			}
-			else
-			{
-				g_ledBlue = 0;
-				LedControl_SetAllColor(LED_COLOR_BLUE, 0);
-				LedControl_SendPacketRespond(LED_KIT_ID0, LED_COLOR_BLUE, 0);
-				LedControl_SendPacketRespond(LED_KIT_ID1, LED_COLOR_BLUE, 0);
-			}
+	if (g_byRxDmaOverrun)
+	{
+		return;
+	}
 
-			BuzzerControl_SetMelody(pbeep);
-			BuzzerControl_SendPacketRespond(1);
-		} break;
+	wDmaIndex = (SIZE_QUEUE_DATA_RX - DMA_GetCurrDataCounter(USART2_RX_DMA_STREAM)) & (SIZE_QUEUE_DATA_RX - 1);
+	wReceived = (wDmaIndex - g_wRxDmaIndex) & (SIZE_QUEUE_DATA_RX - 1);
 
-		case EVENT_OF_BUTTON_1_HOLD_1S:
-		{
-			if(g_idTimerStartIncrease != NO_TIMER)
-			{
-				TimerStop(g_idTimerStartIncrease);
-				g_idTimerStartIncrease = NO_TIMER;
-			}
+	if (wReceived > (SIZE_QUEUE_DATA_RX - bufNumItems(&g_serialQueueRx)))
+	{
+		g_serialQueueRxStats.dwOverflowDrops += wReceived;
+		g_byRxDmaOverrun = 1;
+		return;
+	}
 
-			g_idTimerStartIncrease = TimerStart("Increase_Led",
-							     CYCLE_LED_CHANGE,
-							     100,
-							     (void*) Increase_LedLevel,
-							     NULL);
-		} break;
+	bufCommit(&g_serialQueueRx, wReceived);
+	g_wRxDmaIndex = wDmaIndex;
+}
 
-		case EVENT_OF_BUTTON_5_HOLD_1S:
-		{
-			if(g_idTimerStartDecrease != NO_TIMER)
-			{
-				TimerStop(g_idTimerStartDecrease);
-				g_idTimerStartDecrease = NO_TIMER;
+/*
+ * @func:  		USART2_RxDmaRecover
+ *
+ * @brief:		The function to restart the DMA reception after an overrun
+ *
+ * @param:		None
+ *
+ * @retval:		None
+ *
+ * @note:		Consumer side: called from the main loop while no frame is held
+ */
+void USART2_RxDmaRecover (void)
+{
+	DMA_Cmd(USART2_RX_DMA_STREAM, DISABLE);
+	while (DMA_GetCmdStatus(USART2_RX_DMA_STREAM) != DISABLE);
+
+	DMA_ClearFlag(USART2_RX_DMA_STREAM, DMA_FLAG_TCIF5 | DMA_FLAG_HTIF5 | DMA_FLAG_TEIF5 |
+					    DMA_FLAG_DMEIF5 | DMA_FLAG_FEIF5);
+
+	// Drop the corrupted data and line the queue up again with the DMA start address
+	bufFlush(&g_serialQueueRx);
+	DMA_SetCurrDataCounter(USART2_RX_DMA_STREAM, SIZE_QUEUE_DATA_RX);
+	g_wRxDmaIndex = 0;
+	g_byRxDmaOverrun = 0;
+
+	DMA_Cmd(USART2_RX_DMA_STREAM, ENABLE);
+}
+
+/*
+ * @func:  		USART2Modify_IRQHandler
+ *
+ * @brief:		The function to handle USART2 interrupt
+ *
+ * @param:		None
+ *
+ * @retval:		None
+ *
+ * @note:		Only the idle line interrupt is enabled, the data itself is moved by the DMA
+ */
+void USART2Modify_IRQHandler (void)
+{
+	if (USART_GetITStatus(USART2, USART_IT_IDLE) == SET)
+	{
+		// The IDLE flag is cleared by reading SR (above) followed by DR
+		(void)USART_ReceiveData(USART2);
+
+		USART2_RxDmaUpdate();
+	}
+}
+
+/*
+ * @func:  		DMA1_Stream5_IRQHandler
+ *
+ * @brief:		The function to handle the half and full transfer interrupts of the USART2 RX DMA
+ *
+ * @param:		None
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+void DMA1_Stream5_IRQHandler (void)
+{
+	if (DMA_GetITStatus(USART2_RX_DMA_STREAM, DMA_IT_HTIF5) == SET)
+	{
+		DMA_ClearITPendingBit(USART2_RX_DMA_STREAM, DMA_IT_HTIF5);
+	}
+
+	if (DMA_GetITStatus(USART2_RX_DMA_STREAM, DMA_IT_TCIF5) == SET)
+	{
+		DMA_ClearITPendingBit(USART2_RX_DMA_STREAM, DMA_IT_TCIF5);
+	}
+
+	USART2_RxDmaUpdate();
+}
+
+/*
+ * @func:  		USART2_TxDmaInit
+ *
+ * @brief:		The function to configure DMA1 Stream6 to send the frames of g_serialQueueTx
+ *
+ * @param:		None
+ *
+ * @retval:		None
+ *
+ * @note:		Each transfer sends one frame slot in place, see USART2_TxDmaStart
+ */
+void USART2_TxDmaInit (void)
+{
+	DMA_InitTypeDef		DMA_InitStruct;
+	NVIC_InitTypeDef	NVIC_InitStruct;
+
+	// Clock supply for DMA1 (shared with the RX stream)-----------------------------------
+	RCC_AHB1PeriphClockCmd(USART2_RX_DMA_RCC, ENABLE);
+
+	// Configure DMA1 Stream6: one frame slot to USART2->DR, normal mode------------------
+	DMA_DeInit(USART2_TX_DMA_STREAM);
+	DMA_StructInit(&DMA_InitStruct);
+
+	DMA_InitStruct.DMA_Channel = USART2_TX_DMA_CHANNEL;
+	DMA_InitStruct.DMA_PeripheralBaseAddr = (uint32_t)&USART2->DR;
+	DMA_InitStruct.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+	DMA_InitStruct.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	DMA_InitStruct.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	DMA_InitStruct.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+	DMA_InitStruct.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+	DMA_InitStruct.DMA_Mode = DMA_Mode_Normal;
+	DMA_InitStruct.DMA_Priority = DMA_Priority_Medium;
+	DMA_InitStruct.DMA_FIFOMode = DMA_FIFOMode_Disable;
+
+	DMA_Init(USART2_TX_DMA_STREAM, &DMA_InitStruct);
+
+	DMA_ITConfig(USART2_TX_DMA_STREAM, DMA_IT_TC, ENABLE);
+
+	NVIC_InitStruct.NVIC_IRQChannel = USART2_TX_DMA_IRQn;
+	NVIC_InitStruct.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_InitStruct.NVIC_IRQChannelPreemptionPriority = 1;
+	NVIC_InitStruct.NVIC_IRQChannelSubPriority = 0;
+
+	NVIC_Init(&NVIC_InitStruct);
+
+	g_byTxDmaBusy = 0;
+
+	USART_DMACmd(USART2, USART_DMAReq_Tx, ENABLE);
+}
+
+/*
+ * @func:  		USART2_TxDmaStart
+ *
+ * @brief:		The function to start sending one frame slot by DMA
+ *
+ * @param:		pFrame - The oldest frame of g_serialQueueTx
+ *
+ * @retval:		None
+ *
+ * @note:		The stream is disabled by the hardware at the end of the previous transfer
+ */
+void USART2_TxDmaStart (tx_frame_t *pFrame)
+{
+	DMA_ClearFlag(USART2_TX_DMA_STREAM, DMA_FLAG_TCIF6 | DMA_FLAG_HTIF6 | DMA_FLAG_TEIF6 |
+					    DMA_FLAG_DMEIF6 | DMA_FLAG_FEIF6);
+
+	DMA_MemoryTargetConfig(USART2_TX_DMA_STREAM, (uint32_t)pFrame->aData, DMA_Memory_0);
+	DMA_SetCurrDataCounter(USART2_TX_DMA_STREAM, pFrame->byLength);
+
+	// TC is only set again once the last byte has left (see SerialCustom_BaudRateProcess)
+	USART_ClearFlag(USART2, USART_FLAG_TC);
+
+	DMA_Cmd(USART2_TX_DMA_STREAM, ENABLE);
+}
+
+/*
+ * @func:  		DMA1_Stream6_IRQHandler
+ *
+ * @brief:		The function to release a sent frame and start the next one
+ *
+ * @param:		None
+ *
+ * @retval:		None
+ *
+ * @note:		The completion callback runs here, in interrupt context
+ */
+void DMA1_Stream6_IRQHandler (void)
+{
+	tx_frame_t *pFrame;
+
+	if (DMA_GetITStatus(USART2_TX_DMA_STREAM, DMA_IT_TCIF6) == SET)
+	{
+		DMA_ClearITPendingBit(USART2_TX_DMA_STREAM, DMA_IT_TCIF6);
+
+		pFrame = txFrameQueuePeek(&g_serialQueueTx);
+
+		if ((pFrame != NULL) && (pFrame->aData[0] == FRAME_SOF) && (g_pTxDoneCallback != NULL))
+		{
+			// The sequence number ends the Length bytes, just before the CXOR or CRC-32
+			g_pTxDoneCallback(pFrame->aData[pFrame->aData[1]]);
+		}
+
+		txFrameQueueConsume(&g_serialQueueTx);
+
+		pFrame = txFrameQueuePeek(&g_serialQueueTx);
+
+		if (pFrame != NULL)
+		{
+			USART2_TxDmaStart(pFrame);
+		}
+		else
+		{
+			g_byTxDmaBusy = 0;
+		}
+	}
+}
+
+/*
+ * @func:  		SerialCustom_TxDoneCallback
+ *
+ * @brief:		The function to register the function called after each frame is sent
+ *
+ * @param:		callback - Function receiving the sequence number of the sent frame, or NULL
+ *
+ * @retval:		None
+ *
+ * @note:		The callback runs in interrupt context and must be short
+ */
+void SerialCustom_TxDoneCallback (serial_tx_done_callback callback)
+{
+	g_pTxDoneCallback = callback;
+}
+
+/*
+ * @func:  		LoadConfiguration
+ *
+ * @brief		The function to display information on the LCD and PC_Simulator_KIT
+ * 			when the device is powered on
+ *
+ * @param:		None
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+void LoadConfiguration (void)
+{
+	ucg_DrawString(&g_ucg, 0, 40, 0, "IOT Programming");
+	ucg_DrawString(&g_ucg, 55, 65, 0, "by");
+	ucg_DrawString(&g_ucg, 5, 90, 0, "Lumi Smarthome");
+
+	char text[] = "IOT Programming by Lumi Smarthome";
+	Serial_SendPacketCustom(CMD_OPT, CMD_ID_LCD, CMD_TYPE_GET, (uint8_t*)text, sizeof(text));
+}
+
+/*
+ * @func:  		DeviceStateMachine
+ *
+ * @brief:		- The function to control LED, Buzzer, and display information on the LCD after
+ * 			pressing buttons on the KIT board
+ * 			- Simultaneously, send updates of the corresponding LED color status and buzzer state
+ * 			to the PC_Simulator_KIT
+ *
+ * @param:		event - Event when pressing a button on the KIT board
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+void DeviceStateMachine (uint8_t event)
+{
+	switch (event)
+	{
+		case EVENT_OF_BUTTON_3_PRESS_5_TIMES:
+		{
+			if (g_idTimerSensorUpdate != NO_TIMER)
+			{
+				TimerStop(g_idTimerSensorUpdate);
+				g_idTimerSensorUpdate = NO_TIMER;
 			}
 
-			g_idTimerStartDecrease = TimerStart("Decrease_Led",
-							     CYCLE_LED_CHANGE,
-							     100,
-							     (void*) Decrease_LedLevel,
-							     NULL);
+			// Display system status information on the LCD screen-------------------------
+			EventQueue_Post(EVENT_PRIORITY_LOW, APP_EVENT_LCD_SYSTEM_INFO, NULL, 0,
+					EVENT_FLAG_NONE);
+
+			// Blink the green LED 5 times-------------------------------------------------
+			LedControl_BlinkStart(LED_ALL_ID, BLINK_GREEN, 10, 1000, LED_COLOR_BLACK);
+
+			// Temperature, humidity, light intensity parameters---------------------------
+			if (g_idTimerDisplayLCD != NO_TIMER)
+			{
+				TimerStop(g_idTimerDisplayLCD);
+				g_idTimerDisplayLCD = NO_TIMER;
+			}
+
+			g_idTimerDisplayLCD = TimerStart("MultiSensorScan", 7000, 1,
+											(void*) MultiSensorScan, NULL);
+		} break;
+
+		case EVENT_OF_BUTTON_1_PRESS_LOGIC:
+		{
+			if(g_ledRed == 0)
+			{
+				g_ledRed = 1;
+				g_ledGreen = 0;
+				g_ledWhite = 0;
+				g_ledBlue = 0;
+				LedControl_SetAllColor(LED_COLOR_RED, 50);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID0, LED_COLOR_RED, 50);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID1, LED_COLOR_RED, 50);
+			}
+			else
+			{
+				g_ledRed = 0;
+				LedControl_SetAllColor(LED_COLOR_RED, 0);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID0, LED_COLOR_RED, 0);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID1, LED_COLOR_RED, 0);
+			}
+
+			BuzzerControl_SetMelody(pbeep);
+			BuzzerControl_SendPacketRespondCustom(1);
+		} break;
+
+		case EVENT_OF_BUTTON_2_PRESS_LOGIC:
+		{
+			if(g_ledGreen == 0)
+			{
+				g_ledRed = 0;
+				g_ledGreen = 1;
+				g_ledWhite = 0;
+				g_ledBlue = 0;
+				LedControl_SetAllColor(LED_COLOR_GREEN, 50);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID0, LED_COLOR_GREEN, 50);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID1, LED_COLOR_GREEN, 50);
+			}
+			else
+			{
+				g_ledGreen = 0;
+				LedControl_SetAllColor(LED_COLOR_GREEN, 0);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID0, LED_COLOR_GREEN, 0);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID1, LED_COLOR_GREEN, 0);
+			}
+
+			BuzzerControl_SetMelody(pbeep);
+			BuzzerControl_SendPacketRespondCustom(1);
+		} break;
+
+		case EVENT_OF_BUTTON_4_PRESS_LOGIC:
+		{
+			if(g_ledWhite == 0)
+			{
+				g_ledRed = 0;
+				g_ledGreen = 0;
+				g_ledWhite = 1;
+				g_ledBlue = 0;
+				LedControl_SetAllColor(LED_COLOR_WHITE, 50);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID0, LED_COLOR_WHITE, 50);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID1, LED_COLOR_WHITE, 50);
+			}
+			else
+			{
+				g_ledWhite = 0;
+				LedControl_SetAllColor(LED_COLOR_WHITE, 0);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID0, LED_COLOR_WHITE, 0);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID1, LED_COLOR_WHITE, 0);
+			}
+
+			BuzzerControl_SetMelody(pbeep);
+			BuzzerControl_SendPacketRespondCustom(1);
 		} break;
 
-		case EVENT_OF_BUTTON_1_RELEASED_1S:
-		{
-			TimerStop(g_idTimerStartIncrease);
-		} break;
+		case EVENT_OF_BUTTON_5_PRESS_LOGIC:
+		{
+			if(g_ledBlue == 0)
+			{
+				g_ledRed = 0;
+				g_ledGreen = 0;
+				g_ledWhite = 0;
+				g_ledBlue = 1;
+				LedControl_SetAllColor(LED_COLOR_BLUE, 50);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID0, LED_COLOR_BLUE, 50);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID1, LED_COLOR_BLUE, 50);
+			}
+			else
+			{
+				g_ledBlue = 0;
+				LedControl_SetAllColor(LED_COLOR_BLUE, 0);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID0, LED_COLOR_BLUE, 0);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID1, LED_COLOR_BLUE, 0);
+			}
+
+			BuzzerControl_SetMelody(pbeep);
+			BuzzerControl_SendPacketRespondCustom(1);
+		} break;
+
+		case EVENT_OF_BUTTON_1_HOLD_1S:
+		{
+			if(g_idTimerStartIncrease != NO_TIMER)
+			{
+				TimerStop(g_idTimerStartIncrease);
+				g_idTimerStartIncrease = NO_TIMER;
+			}
+
+			g_idTimerStartIncrease = TimerStart("Increase_Led",
+							     CYCLE_LED_CHANGE,
+							     100,
+							     (void*) Increase_LedLevel,
+							     NULL);
+		} break;
+
+		case EVENT_OF_BUTTON_5_HOLD_1S:
+		{
+			if(g_idTimerStartDecrease != NO_TIMER)
+			{
+				TimerStop(g_idTimerStartDecrease);
+				g_idTimerStartDecrease = NO_TIMER;
+			}
+
+			g_idTimerStartDecrease = TimerStart("Decrease_Led",
+							     CYCLE_LED_CHANGE,
+							     100,
+							     (void*) Decrease_LedLevel,
+							     NULL);
+		} break;
+
+		case EVENT_OF_BUTTON_1_RELEASED_1S:
+		{
+			TimerStop(g_idTimerStartIncrease);
+		} break;
+
+		case EVENT_OF_BUTTON_5_RELEASED_1S:
+		{
+			TimerStop(g_idTimerStartDecrease);
+		} break;
+
+		default:
+			break;
+	}
+}
+
+/*
+ * @func:  		Clamp
+ *
+ * @brief:		The function to generate a range of values
+ *
+ * @param[1]:		value - Current value
+ * @param[2]:		min - Min value
+ * @param[3]:		max - Max value
+ *
+ * @retval:		value
+ *
+ * @note:		None
+ */
+uint8_t Clamp (uint8_t value, uint8_t min , uint8_t max)
+{
+	if(value < min) value = min;
+	if(value > max) value = max;
+	return value;
+}
+
+/*
+ * @func:  		Increase_LedLevel
+ *
+ * @brief:		The function to increase the brightness of the LED
+ *
+ * @param:		None
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+void Increase_LedLevel (void)
+{
+	g_ledChange = Clamp((uint8_t)(g_ledChange + 1), 0 , 100);
+	LedControl_SetAllColor(LED_COLOR_GREEN, g_ledChange);
+}
+
+/*
+ * @func:  		Decrease_LedLevel
+ *
+ * @brief:		The function to decrease the brightness of the LED
+ *
+ * @param:		None
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+void Decrease_LedLevel (void)
+{
+	g_ledChange = Clamp((uint8_t)(g_ledChange - 1), 0, 100);
+	LedControl_SetAllColor(LED_COLOR_GREEN, g_ledChange);
+}
+
+/*
+ * @func:  		MultiSensorScan
+ *
+ * @brief:		The function to update temperature, humidity, and light intensity values
+ *
+ * @param:		None
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+void MultiSensorScan (void)
+{
+	EventQueue_Post(EVENT_PRIORITY_LOW, APP_EVENT_LCD_CLEAR, NULL, 0, EVENT_FLAG_NONE);
+
+	if (g_idTimerSensorUpdate != NO_TIMER)
+	{
+		TimerStop(g_idTimerSensorUpdate);
+		g_idTimerSensorUpdate = NO_TIMER;
+	}
+
+	g_idTimerSensorUpdate = TimerStart("Task_multiSensorScan",
+					    PERIOD_SCAN_MULTISENSOR,
+					    TIMER_REPEAT_FOREVER,
+					    (void*)Task_MultiSensorScan,
+				            NULL);
+}
+
+/*
+ * @func:  		Task_MultiSensorScan
+ *
+ * @brief:		- The function to retrieve temperature, humidity, and light intensity values from
+ * 			the sensors and send them to the PC_Simulator_KIT
+ * 			- Simultaneously, queue their display on the LCD
+ *
+ * @param:		None
+ *
+ * @retval:		None
+ *
+ * @note:		The readings of a redraw still waiting are replaced by the new ones
+ */
+void Task_MultiSensorScan (void)
+{
+	lcd_sensors_t sensors;
+
+	// Retrieve temperature, humidity, and light intensity values from the sensors---------
+	sensors.temperature = (TemHumSensor_GetTemp() / 100);
+	sensors.humidity = (TemHumSensor_GetHumi() / 100);
+	sensors.light = LightSensor_MeasureUseDMAMode();
+
+	// Send data to simulation software----------------------------------------------------
+#if (TELEMETRY_LEGACY_FRAMES == 1)
+	Sensor_SendPacketRespondCustom(CMD_ID_TEMP_SENSOR, sensors.temperature);
+	Sensor_SendPacketRespondCustom(CMD_ID_HUMI_SENSOR, sensors.humidity);
+	Sensor_SendPacketRespondCustom(CMD_ID_LIGHT_SENSOR, sensors.light);
+#else
+	Telemetry_SendPacketMultiSensor(sensors.temperature, sensors.humidity, sensors.light);
+#endif
+
+	// Display on LCD----------------------------------------------------------------------
+	EventQueue_Post(EVENT_PRIORITY_LOW, APP_EVENT_LCD_SENSORS, &sensors, sizeof(sensors),
+			EVENT_FLAG_COALESCE);
+}
+
+/*
+ * @func:  		Telemetry_SendPacketMultiSensor
+ *
+ * @brief:		The function to send every sensor reading to PC_Simulator_KIT in one frame
+ *
+ * @param[1]:		temperature - Value of the temperature sensor
+ * @param[2]:		humidity - Value of the humidity sensor
+ * @param[3]:		light - Value of the light sensor
+ *
+ * @retval:		None
+ *
+ * @note:		One SOF/length/sequence/CXOR for the three readings instead of one each.
+ * 			A receiver skips the TLVs whose tag it does not know by their length.
+ */
+void Telemetry_SendPacketMultiSensor (uint16_t temperature, uint16_t humidity, uint16_t light)
+{
+	const uint8_t byTag[] = {CMD_ID_TEMP_SENSOR, CMD_ID_HUMI_SENSOR, CMD_ID_LIGHT_SENSOR};
+	const uint16_t wValue[] = {temperature, humidity, light};
+	uint8_t byPayload[1 + 4 + sizeof(byTag) * (2 + TELEMETRY_TLV_VALUE_SIZE)];
+	uint32_t dwTimestamp = GetMilSecTick();
+	uint8_t size = 0;
+
+	byPayload[size++] = TELEMETRY_SCHEMA_VERSION;
+	byPayload[size++] = (uint8_t)(dwTimestamp >> 24);
+	byPayload[size++] = (uint8_t)(dwTimestamp >> 16);
+	byPayload[size++] = (uint8_t)(dwTimestamp >> 8);
+	byPayload[size++] = (uint8_t)dwTimestamp;
+
+	for (uint8_t i = 0; i < sizeof(byTag); i++)
+	{
+		byPayload[size++] = byTag[i];
+		byPayload[size++] = TELEMETRY_TLV_VALUE_SIZE;
+		byPayload[size++] = (uint8_t)(wValue[i] >> 8);
+		byPayload[size++] = (uint8_t)(wValue[i] & 0xFF);
+	}
+
+	Serial_SendPacketCustom(CMD_OPT, CMD_ID_MULTI_SENSOR, CMD_TYPE_RES, byPayload, size);
+}
+
+/*
+ * @func:  		Serial_SendPacketCustom
+ *
+ * @brief:		The function send text to PC_Simulator_KIT
+ *
+ * @param[1]:		byOption - Byte Option of the frame
+ * @param[2]:		byCmdId - Byte CmdID of the frame
+ * @param[3]:		byCmdType - Byte CmdType of the frame
+ * @param[4]:		pPayload - Byte Data of the frame
+ * @param[5]:		byLengthPayload - Data size
+ *
+ * @retval:		ERR_OK if the frame is queued, ERR_BUF_FULL if the TX queue has no free slot
+ * 			(or the payload is longer than TX_PAYLOAD_SIZE_MAX, or the reliable
+ * 			window is full when byOption has CMD_OPT_RELIABLE)
+ *
+ * @note:		With SERIAL_TX_USE_DMA the frame is built in place in the head slot of the
+ * 			TX queue and sent by DMA in the background. A reliable frame is built
+ * 			on the stack, because g_serialLink keeps its own copy
+ */
+uint8_t Serial_SendPacketCustom (uint8_t byOption, uint8_t byCmdId, uint8_t byCmdType,
+				 uint8_t *pPayload, uint8_t byLengthPayload)
+{
+	uint32_t dwStartCycles = DWT->CYCCNT;
+	uint8_t	byLength = 5 + byLengthPayload;
+	static uint8_t bySequence = 0;
+	uint8_t size = 0;
+	uint8_t byResult = ERR_OK;
+	uint8_t byReliable = 0;
+	uint8_t byFrame[TX_FRAME_SIZE_MAX];
+	uint8_t *pFrame = byFrame;
+	tx_frame_t *pSlot = NULL;
+	uint32_t dwCrc;
+
+	if (byLengthPayload > TX_PAYLOAD_SIZE_MAX)
+	{
+		return ERR_BUF_FULL;
+	}
+
+	if (g_byTxFraming == FRAMING_CRC32)
+	{
+		byOption |= CMD_OPT_CRC32;
+	}
+
+#if (SERIAL_RELIABLE_MODE == 1)
+	byReliable = (byOption & CMD_OPT_RELIABLE) ? 1 : 0;
+#endif
+
+#if (SERIAL_TX_USE_DMA == 1)
+	if (!byReliable)
+	{
+		pSlot = txFrameQueueReserve(&g_serialQueueTx);
+
+		if (pSlot == NULL)
+		{
+			g_serialDiag.dwTxQueueFull++;
+			g_dwTxBlockedCycles += DWT->CYCCNT - dwStartCycles;
+			return ERR_BUF_FULL;
+		}
+
+		pFrame = pSlot->aData;
+	}
+#endif
+
+	pFrame[size++] = FRAME_SOF;
+	pFrame[size++] = byLength;
+	pFrame[size++] = byOption;
+	pFrame[size++] = byCmdId;
+	pFrame[size++] = byCmdType;
+
+	for (uint8_t i = 0; i < byLengthPayload; i++)
+	{
+		pFrame[size++] = pPayload[i];
+	}
+
+	pFrame[size++] = bySequence + 1;
+
+	if (byOption & CMD_OPT_CRC32)
+	{
+		// CRC-32 over Option..Seq, high byte first
+		dwCrc = Crc32_Compute(&pFrame[2], size - 2);
+
+		pFrame[size++] = (uint8_t)(dwCrc >> 24);
+		pFrame[size++] = (uint8_t)(dwCrc >> 16);
+		pFrame[size++] = (uint8_t)(dwCrc >> 8);
+		pFrame[size++] = (uint8_t)dwCrc;
+	}
+	else
+	{
+		// CXOR over Option..Seq
+		pFrame[size] = FrameParser_Xor(&pFrame[2], size - 2, CXOR_INIT_VAL);
+		size++;
+	}
+
+#if (SERIAL_RELIABLE_MODE == 1)
+	if (byReliable)
+	{
+		byResult = ReliableLink_Send(&g_serialLink, pFrame, size, bySequence + 1, GetMilSecTick()) ?
+			   ERR_OK : ERR_BUF_FULL;
+	}
+	else
+#endif
+	if (pSlot != NULL)
+	{
+		pSlot->byLength = size;
+		SerialCustom_CommitFrame(pSlot);
+	}
+	else
+	{
+		byResult = SerialCustom_QueueFrame(pFrame, size);
+	}
+
+	if (byResult == ERR_OK)
+	{
+		bySequence++;
+	}
+
+	g_dwTxBlockedCycles += DWT->CYCCNT - dwStartCycles;
+
+	return byResult;
+}
+
+/*
+ * @func:  		SerialCustom_QueueFrame
+ *
+ * @brief:		The function to send a built frame (or a FRAME_ACK / FRAME_NACK pair)
+ *
+ * @param[1]:		pFrame - Bytes to send
+ * @param[2]:		byLength - Number of bytes (at most TX_FRAME_SIZE_MAX)
+ *
+ * @retval:		ERR_OK if the bytes are queued, ERR_BUF_FULL if the TX queue has no free slot
+ *
+ * @note:		None
+ */
+uint8_t SerialCustom_QueueFrame (const uint8_t *pFrame, uint8_t byLength)
+{
+#if (SERIAL_TX_USE_DMA == 1)
+	tx_frame_t *pSlot = txFrameQueueReserve(&g_serialQueueTx);
+
+	if (pSlot == NULL)
+	{
+		g_serialDiag.dwTxQueueFull++;
+		return ERR_BUF_FULL;
+	}
+
+	pSlot->byLength = byLength;
+	memcpy(pSlot->aData, pFrame, byLength);
+
+	SerialCustom_CommitFrame(pSlot);
+#else
+	for (uint8_t k = 0; k < byLength; k++)
+	{
+		while(USART_GetFlagStatus(USART2, USART_FLAG_TXE) == RESET);
+		USART_SendData(USART2, pFrame[k]);
+		while(USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET);
+	}
+
+	if ((pFrame[0] == FRAME_SOF) && (g_pTxDoneCallback != NULL))
+	{
+		g_pTxDoneCallback(pFrame[pFrame[1]]);
+	}
+
+	g_serialDiag.dwTxBytes += byLength;
+
+#if (SERIAL_TRACE_ENABLE == 1)
+	SerialTrace_Record(&g_serialTrace, SERIAL_TRACE_TX, (uint32_t)TimeBase_GetUs(), pFrame,
+			   byLength);
+#endif
+#endif
+
+	return ERR_OK;
+}
+
+/*
+ * @func:  		SerialCustom_CommitFrame
+ *
+ * @brief:		The function to hand a frame built in the reserved TX queue slot to the DMA
+ *
+ * @param:		pSlot - Slot returned by txFrameQueueReserve, byLength set
+ *
+ * @retval:		None
+ *
+ * @note:		The frame is traced before the commit: once committed, the DMA interrupt
+ * 			may release the slot
+ */
+void SerialCustom_CommitFrame (tx_frame_t *pSlot)
+{
+	g_serialDiag.dwTxBytes += pSlot->byLength;
+
+#if (SERIAL_TRACE_ENABLE == 1)
+	SerialTrace_Record(&g_serialTrace, SERIAL_TRACE_TX, (uint32_t)TimeBase_GetUs(), pSlot->aData,
+			   pSlot->byLength);
+#endif
+
+	txFrameQueueCommit(&g_serialQueueTx);
+
+	if (!g_byTxDmaBusy)
+	{
+		g_byTxDmaBusy = 1;
+		USART2_TxDmaStart(txFrameQueuePeek(&g_serialQueueTx));
+	}
+}
+
+/*
+ * @func:  		SerialCustom_SendReliableFrame
+ *
+ * @brief:		The transmit function of g_serialLink (first send and retransmissions)
+ *
+ * @param[1]:		pFrame - Frame to send
+ * @param[2]:		byLength - Length of the frame
+ *
+ * @retval:		None
+ *
+ * @note:		A frame refused by a full TX queue is sent again after RELIABLE_TIMEOUT_MS
+ */
+void SerialCustom_SendReliableFrame (const uint8_t *pFrame, uint8_t byLength)
+{
+	SerialCustom_QueueFrame(pFrame, byLength);
+}
+
+/*
+ * @func:  		SerialCustom_SendAck
+ *
+ * @brief:		The function to answer a frame received with CMD_OPT_RELIABLE
+ *
+ * @param[1]:		byAck - FRAME_ACK or FRAME_NACK
+ * @param[2]:		bySequence - Sequence number of the received frame
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+void SerialCustom_SendAck (uint8_t byAck, uint8_t bySequence)
+{
+	uint8_t byFrame[] = {byAck, bySequence};
+
+	SerialCustom_QueueFrame(byFrame, sizeof(byFrame));
+}
+
+/*
+ * @func:  		LedControl_SendPacketRespondCustom
+ *
+ * @brief:		The function to report the state of a LED to PC_Simulator_KIT
+ *
+ * @param[1]:		led_id - Identify of the LED
+ * @param[2]:		led_color - Color of the LED
+ * @param[3]:		led_level - Level of the LED (0 - 100%)
+ *
+ * @retval:		None
+ *
+ * @note:		Queued through Serial_SendPacketCustom instead of the blocking SDK sender
+ */
+void LedControl_SendPacketRespondCustom (uint8_t led_id, uint8_t led_color, uint8_t led_level)
+{
+	uint8_t byPayload[] = {led_id, led_color, led_level};
+
+	Serial_SendPacketCustom(CMD_OPT_RESPOND, CMD_ID_LED, CMD_TYPE_RES, byPayload, sizeof(byPayload));
+}
+
+/*
+ * @func:  		BuzzerControl_SendPacketRespondCustom
+ *
+ * @brief:		The function to report the state of the buzzer to PC_Simulator_KIT
+ *
+ * @param:		buzzer_state - State of the buzzer
+ *
+ * @retval:		None
+ *
+ * @note:		Queued through Serial_SendPacketCustom instead of the blocking SDK sender
+ */
+void BuzzerControl_SendPacketRespondCustom (uint8_t buzzer_state)
+{
+	uint8_t byPayload[] = {buzzer_state};
+
+	Serial_SendPacketCustom(CMD_OPT_RESPOND, CMD_ID_BUZZER, CMD_TYPE_RES, byPayload, sizeof(byPayload));
+}
+
+/*
+ * @func:  		Sensor_SendPacketRespondCustom
+ *
+ * @brief:		The function to report a sensor value to PC_Simulator_KIT
+ *
+ * @param[1]:		byCmdId - CMD_ID_TEMP_SENSOR, CMD_ID_HUMI_SENSOR or CMD_ID_LIGHT_SENSOR
+ * @param[2]:		value - Value of the sensor
+ *
+ * @retval:		None
+ *
+ * @note:		The value is sent high byte first
+ */
+void Sensor_SendPacketRespondCustom (uint8_t byCmdId, uint16_t value)
+{
+	uint8_t byPayload[] = {(uint8_t)(value >> 8), (uint8_t)(value & 0xFF)};
+
+	Serial_SendPacketCustom(CMD_OPT, byCmdId, CMD_TYPE_RES, byPayload, sizeof(byPayload));
+}
+
+/*
+ * @func:  		processSerialReceiverCustom
+ *
+ * @brief:		The function to check and process data received from PC_Simulator_KIT
+ *
+ * @param:		None
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+void processSerialReceiverCustom (void)
+{
+	if (g_byRxDmaOverrun)
+	{
+		USART2_RxDmaRecover();
+	}
+
+#if (SERIAL_RELIABLE_MODE == 1)
+	ReliableLink_Process(&g_serialLink, GetMilSecTick());
+#endif
+
+	SerialCustom_BaudRateProcess();
+
+	// Bytes committed after this point are seen by SerialCustom_IsBusy
+	g_dwRxItemsPolled = g_serialQueueRxStats.dwTotalItems;
+
+	uint8_t	RxState = PollRxBuff();
+
+	// One message is handled per call, more may be waiting
+	g_byRxMessageFound = (RxState != UART_STATE_IDLE);
+
+	if (RxState != UART_STATE_IDLE)
+	{
+		switch (RxState)
+		{
+			case UART_STATE_DATA_RECEIVED:
+			{
+				// A valid frame at the new baud rate: the switch is confirmed
+				g_byBaudRateConfirming = 0;
+
+#if (SERIAL_TRACE_ENABLE == 1)
+				// g_pRxFrame is the length byte, the frame starts one byte before
+				SerialTrace_Record(&g_serialTrace, SERIAL_TRACE_RX, (uint32_t)TimeBase_GetUs(),
+						   g_pRxFrame - 1, (uint8_t)g_wRxFrameHeld);
+#endif
+
+				// g_pRxFrame[0] is the length byte, [1] the option, [2] the CmdID
+#if (SERIAL_RELIABLE_MODE == 1)
+				if (g_pRxFrame[1] & CMD_OPT_RELIABLE)
+				{
+					// The sequence number ends the Length bytes
+					uint8_t bySequence = g_pRxFrame[g_pRxFrame[0] - 1];
+
+					// Every copy is acknowledged (our ACK may have been lost), but handled once
+					SerialCustom_SendAck(FRAME_ACK, bySequence);
+
+					if (ReliableLink_IsDuplicate(&g_serialLink, bySequence))
+					{
+						break;
+					}
+				}
+#endif
+				SerialCmd_Dispatch(&g_pRxFrame[2]);
+			} break;
+
+			case UART_STATE_ACK_RECEIVED:
+#if (SERIAL_RELIABLE_MODE == 1)
+				ReliableLink_OnAck(&g_serialLink, g_byRxAckSequence);
+#endif
+				break;
+
+			case UART_STATE_NACK_RECEIVED:
+#if (SERIAL_RELIABLE_MODE == 1)
+				ReliableLink_OnNack(&g_serialLink, g_byRxAckSequence, GetMilSecTick());
+#endif
+				break;
+
+			case UART_STATE_ERROR:
+			case UART_STATE_RX_TIMEOUT:
+				// No NACK: the sequence number of a corrupted frame is unknown, the
+				// sender's timeout brings it back
+				if (g_byBaudRateConfirming && (g_byBaudRateErrors < 0xFF))
+				{
+					g_byBaudRateErrors++;
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	if (g_wRxFrameHeld != 0)
+	{
+		// The handlers are done with g_pRxFrame, give the bytes back to the producer
+		bufConsume(&g_serialQueueRx, g_wRxFrameHeld);
+		g_wRxFrameHeld = 0;
+	}
+}
+
+/*
+ * @func:  		SerialCustom_BaudRateProcess
+ *
+ * @brief:		The function to switch to an accepted baud rate and fall back if it fails
+ *
+ * @param:		None
+ *
+ * @retval:		None
+ *
+ * @note:		The switch waits until the answer to CMD_ID_BAUDRATE has left at the old rate.
+ * 			The PC falls back on its side with the same BAUDRATE_CONFIRM_TIMEOUT
+ */
+void SerialCustom_BaudRateProcess (void)
+{
+	if ((g_dwBaudRatePending != 0) && !g_byTxDmaBusy &&
+	    (USART_GetFlagStatus(USART2, USART_FLAG_TC) == SET))
+	{
+		USART2_SetBaudRate(g_dwBaudRatePending);
+		g_dwBaudRatePending = 0;
+
+		g_byBaudRateConfirming = 1;
+		g_byBaudRateErrors = 0;
+		g_dwBaudRateSwitchTick = GetMilSecTick();
+	}
+	else if (g_byBaudRateConfirming &&
+		 (((GetMilSecTick() - g_dwBaudRateSwitchTick) >= BAUDRATE_CONFIRM_TIMEOUT) ||
+		  (g_byBaudRateErrors >= BAUDRATE_CONFIRM_ERRORS_MAX)))
+	{
+		// Nothing valid received at the new rate: back to the rate both sides start with
+		USART2_SetBaudRate(USART_BAUDRATE);
+		g_byBaudRateConfirming = 0;
+	}
+}
+
+/*
+ * @func:  		SerialCustom_IsBusy
+ *
+ * @brief:		The function to tell the idle hook whether the serial link has work left
+ *
+ * @param:		None
+ *
+ * @retval:		1 if processSerialReceiverCustom must run again before sleeping
+ *
+ * @note:		Called with interrupts masked. Bytes still in the DMA buffer need no check:
+ * 			the USART IDLE or DMA interrupt that commits them wakes the core up
+ */
+uint8_t SerialCustom_IsBusy (void)
+{
+	return (g_byRxMessageFound || g_byRxDmaOverrun || (g_dwBaudRatePending != 0) ||
+		(g_serialQueueRxStats.dwTotalItems != g_dwRxItemsPolled));
+}
+
+/*
+ * @func:  		SerialCustom_NextDeadline
+ *
+ * @brief:		The function to get the time the serial link may be left alone
+ *
+ * @param:		None
+ *
+ * @retval:		Milliseconds to the next retransmission or baud rate fallback,
+ * 			TIMER_WHEEL_NO_DEADLINE if none is waiting
+ *
+ * @note:		None
+ */
+uint32_t SerialCustom_NextDeadline (void)
+{
+	uint32_t dwNow = GetMilSecTick();
+	uint32_t dwDeadline = TIMER_WHEEL_NO_DEADLINE;
+	uint32_t dwElapsed;
+
+#if (SERIAL_RELIABLE_MODE == 1)
+	dwDeadline = ReliableLink_NextTimeout(&g_serialLink, dwNow);
+#endif
+
+	if (g_byBaudRateConfirming)
+	{
+		dwElapsed = dwNow - g_dwBaudRateSwitchTick;
+
+		if (dwElapsed >= BAUDRATE_CONFIRM_TIMEOUT)
+		{
+			dwDeadline = 0;
+		}
+		else if ((BAUDRATE_CONFIRM_TIMEOUT - dwElapsed) < dwDeadline)
+		{
+			dwDeadline = BAUDRATE_CONFIRM_TIMEOUT - dwElapsed;
+		}
+	}
+
+	return dwDeadline;
+}
+
+/*
+ * @func:  		PollRxBuff
+ *
+ * @brief:		The function to process received messages based on format
+ *
+ * @param:		None
+ *
+ * @retval:		State of the first message found in the queue
+ *
+ * @note:		A valid frame is validated in the queue storage and left there, pointed to
+ * 			by g_pRxFrame, until processSerialReceiverCustom releases it with bufConsume.
+ * 			Only a frame that straddles the wrap point is copied to g_strRxBuffer.
+ */
+uint8_t PollRxBuff (void)
+{
+	uint8_t *pData;
+	uint16_t wContiguous;
+	uint16_t wAvailable;
+	uint16_t wUsed;
+
+	uint8_t byUartState = (uint8_t) UART_STATE_IDLE;
+
+	while (byUartState == UART_STATE_IDLE)
+	{
+		pData = bufPeekContiguous(&g_serialQueueRx, &wContiguous);
+
+		if (wContiguous == 0)
+		{
+			break;
+		}
+
+		byUartState = FrameParser_Parse(pData, wContiguous, RX_BUFFER_SIZE, &wUsed);
+
+		wAvailable = bufNumItems(&g_serialQueueRx);
+
+		if ((byUartState == UART_STATE_IDLE) && (wAvailable > wContiguous))
+		{
+			// The message goes on at the start of the storage: parse a copy of it
+			if (wAvailable > sizeof(g_strRxBuffer))
+			{
+				wAvailable = sizeof(g_strRxBuffer);
+			}
+
+			memcpy(g_strRxBuffer, pData, wContiguous);
+			memcpy(&g_strRxBuffer[wContiguous], g_strRxBufData, wAvailable - wContiguous);
+			pData = g_strRxBuffer;
+
+			byUartState = FrameParser_Parse(pData, wAvailable, RX_BUFFER_SIZE, &wUsed);
+		}
+
+#if (SERIAL_RELIABLE_MODE == 1)
+		if ((byUartState == UART_STATE_ACK_RECEIVED) || (byUartState == UART_STATE_NACK_RECEIVED))
+		{
+			// FRAME_ACK / FRAME_NACK are followed by the sequence number they answer
+			if (wAvailable < 2)
+			{
+				byUartState = UART_STATE_IDLE;
+				break;					// Sequence byte not received yet
+			}
+
+			// The ACK byte is never parsed from the copy, the next byte may wrap
+			g_byRxAckSequence = (wContiguous > 1) ? pData[1] : g_strRxBufData[0];
+			wUsed = 2;
+		}
+#endif
+
+		if (byUartState == UART_STATE_DATA_RECEIVED)
+		{
+			g_pRxFrame = &pData[1];
+			g_wRxFrameHeld = wUsed;
+			g_serialDiag.dwRxFramesOk++;
+		}
+		else
+		{
+			if (byUartState == UART_STATE_ERROR)
+			{
+				if (pData[0] != FRAME_SOF)
+				{
+					g_serialDiag.dwRxGarbageBytes += wUsed;
+				}
+				else if ((pData[1] < 2) || (pData[1] > RX_BUFFER_SIZE))
+				{
+					g_serialDiag.dwRxLengthErrors++;
+				}
+				else
+				{
+					g_serialDiag.dwRxCheckErrors++;
+				}
+			}
+
+			// Bad length or CXOR: only the SOF is dropped, the next frame is not lost
+			bufConsume(&g_serialQueueRx, wUsed);
+		}
 
-		case EVENT_OF_BUTTON_5_RELEASED_1S:
+		if (wUsed == 0)
 		{
-			TimerStop(g_idTimerStartDecrease);
-		} break;
-
-		default:
-			break;
+			break;						// Message not complete yet
+		}
 	}
+
+	return byUartState;
 }
 
 /*
- * @func:  		Clamp
+ * @func:  		SerialCustom_RegisterCommands
  *
- * @brief:		The function to generate a range of values
+ * @brief:		The function to register the commands accepted from PC_Simulator_KIT
  *
- * @param[1]:		value - Current value
- * @param[2]:		min - Min value
- * @param[3]:		max - Max value
+ * @param:		None
  *
- * @retval:		value
+ * @retval:		None
  *
  * @note:		None
  */
-uint8_t Clamp (uint8_t value, uint8_t min , uint8_t max)
+void SerialCustom_RegisterCommands (void)
 {
-	if(value < min) value = min;
-	if(value > max) value = max;
-	return value;
+	SerialCmd_Init();
+
+	SerialCmd_Register(CMD_ID_LED, CMD_TYPE_SET, LedCmdHandler);
+	SerialCmd_Register(CMD_ID_BUZZER, CMD_TYPE_SET, BuzzerCmdHandler);
+	SerialCmd_Register(CMD_ID_BUTTON, CMD_TYPE_SET, ButtonCmdHandler);
+	SerialCmd_Register(CMD_ID_LCD, CMD_TYPE_SET, LcdCmdHandler);
+	SerialCmd_Register(CMD_ID_BAUDRATE, CMD_TYPE_SET, BaudRateCmdHandler);
+	SerialCmd_Register(CMD_ID_FRAMING, CMD_TYPE_SET, FramingCmdHandler);
+	SerialCmd_Register(CMD_ID_DIAGNOSTICS, CMD_TYPE_GET, DiagnosticsCmdHandler);
+#ifdef USE_SCHED_PROFILER
+	SerialCmd_Register(CMD_ID_PROFILE, CMD_TYPE_GET, ProfileCmdHandler);
+	SerialCmd_Register(CMD_ID_PROFILE, CMD_TYPE_SET, ProfileCmdHandler);
+#endif
 }
 
 /*
- * @func:  		Increase_LedLevel
+ * @func:  		LedCmdHandler
  *
- * @brief:		The function to increase the brightness of the LED
+ * @brief:		The function to handle the LED SET command
  *
- * @param:		None
+ * @param:		pCmd - The received command
  *
  * @retval:		None
  *
  * @note:		None
  */
-void Increase_LedLevel (void)
+void LedCmdHandler (const cmd_receive_t *pCmd)
 {
-	g_ledChange = Clamp((uint8_t)(g_ledChange + 1), 0 , 100);
-	LedControl_SetAllColor(LED_COLOR_GREEN, g_ledChange);
+	LedCmdSetState(pCmd->ledIndicator.numID, pCmd->ledIndicator.color, pCmd->ledIndicator.counter,
+		       pCmd->ledIndicator.interval, pCmd->ledIndicator.laststate);
 }
 
 /*
- * @func:  		Decrease_LedLevel
+ * @func:  		BuzzerCmdHandler
  *
- * @brief:		The function to decrease the brightness of the LED
+ * @brief:		The function to handle the buzzer SET command
  *
- * @param:		None
+ * @param:		pCmd - The received command
  *
  * @retval:		None
  *
  * @note:		None
  */
-void Decrease_LedLevel (void)
+void BuzzerCmdHandler (const cmd_receive_t *pCmd)
 {
-	g_ledChange = Clamp((uint8_t)(g_ledChange - 1), 0, 100);
-	LedControl_SetAllColor(LED_COLOR_GREEN, g_ledChange);
+	BuzzerCmdSetState(pCmd->buzzerState.state);
 }
 
 /*
- * @func:  		MultiSensorScan
+ * @func:  		ButtonCmdHandler
  *
- * @brief:		The function to update temperature, humidity, and light intensity values
+ * @brief:		The function to handle the button SET command
  *
- * @param:		None
+ * @param:		pCmd - The received command
  *
  * @retval:		None
  *
  * @note:		None
  */
-void MultiSensorScan (void)
+void ButtonCmdHandler (const cmd_receive_t *pCmd)
 {
-	ucg_ClearScreen(&g_ucg);
-	ucg_SetFont(&g_ucg, ucg_font_ncenR10_hf);
+	uint8_t byPayload[2];
 
-	if (g_idTimerSensorUpdate != NO_TIMER)
+	byPayload[0] = pCmd->buttonState.epoint;
+	byPayload[1] = pCmd->buttonState.state;
+
+	EventQueue_Post(EVENT_PRIORITY_HIGH, APP_EVENT_BUTTON_CMD, byPayload, sizeof(byPayload),
+			EVENT_FLAG_NONE);
+}
+
+/*
+ * @func:  		LcdCmdHandler
+ *
+ * @brief:		The function to handle the LCD SET command
+ *
+ * @param:		pCmd - The received command
+ *
+ * @retval:		None
+ *
+ * @note:		The text is read in place in the RX queue: only the payload bytes of the
+ * 			frame belong to it
+ */
+void LcdCmdHandler (const cmd_receive_t *pCmd)
+{
+	uint8_t byLength = 0;
+
+	// g_pRxFrame[0] counts Length, Option, CmdID, CmdType, payload and Seq
+	if (g_pRxFrame[0] > 5)
 	{
-		TimerStop(g_idTimerSensorUpdate);
-		g_idTimerSensorUpdate = NO_TIMER;
+		byLength = g_pRxFrame[0] - 5;
 	}
 
-	g_idTimerSensorUpdate = TimerStart("Task_multiSensorScan",
-					    PERIOD_SCAN_MULTISENSOR,
-					    TIMER_REPEAT_FOREVER,
-					    (void*)Task_MultiSensorScan,
-				            NULL);
+	LcdCmdSetState((const char *)pCmd->lcdDisplay.text, byLength);
 }
 
 /*
- * @func:  		Task_MultiSensorScan
+ * @func:  		BaudRateCmdHandler
  *
- * @brief:		- The function to retrieve temperature, humidity, and light intensity values from
- * 			the sensors and display them on the LCD
- * 			- Simultaneously, send these values to the PC_Simulator_KIT
+ * @brief:		The function to handle a baud rate request from PC_Simulator_KIT
  *
- * @param:		None
+ * @param:		pCmd - Received command (the rate follows CmdID and CmdType)
  *
  * @retval:		None
  *
- * @note:		None
+ * @note:		The rate is only applied by SerialCustom_BaudRateProcess, after the answer
  */
-void Task_MultiSensorScan (void)
+void BaudRateCmdHandler (const cmd_receive_t *pCmd)
 {
-	// Retrieve temperature, humidity, and light intensity values from the sensors---------
-	g_temperature = (TemHumSensor_GetTemp() / 100);
-	g_humidity =  (TemHumSensor_GetHumi() / 100);
-	g_light = LightSensor_MeasureUseDMAMode();
+	const uint8_t *pPayload = (const uint8_t *)pCmd + sizeof(cmd_common_t);
+	uint32_t dwBaudRate = g_dwBaudRate;
+	uint32_t dwRequested;
+	uint8_t byOver8;
 
-	// Store temperature, humidity, and light intensity values-----------------------------
-	memset(g_strTemp, 0, sizeof(g_strTemp));
-	memset(g_strHumi, 0, sizeof(g_strHumi));
-	memset(g_strLight, 0, sizeof(g_strLight));
+	// g_pRxFrame[0] counts Length, Option, CmdID, CmdType, payload and Seq
+	if (g_pRxFrame[0] >= (5 + 4))
+	{
+		dwRequested = ((uint32_t)pPayload[0] << 24) | ((uint32_t)pPayload[1] << 16) |
+			      ((uint32_t)pPayload[2] << 8) | (uint32_t)pPayload[3];
 
-	sprintf(g_strTemp, "Temp = %d oC     ", g_temperature);
-	sprintf(g_strHumi, "Humi = %d %%     ", g_humidity);
-	sprintf(g_strLight, "Light = %d Lux     ", g_light);
+		if ((dwRequested >= BAUD9600) && (dwRequested <= USART_BAUDRATE_MAX) &&
+		    (USART2_ComputeBrr(dwRequested, &byOver8) != 0))
+		{
+			g_dwBaudRatePending = dwRequested;
+			dwBaudRate = dwRequested;
+		}
+	}
 
-	// Display on LCD----------------------------------------------------------------------
-	ucg_DrawString(&g_ucg, 0, 40, 0, g_strTemp);
-	ucg_DrawString(&g_ucg, 0, 65, 0, g_strHumi);
-	ucg_DrawString(&g_ucg, 0, 90, 0, g_strLight);
+	uint8_t byPayload[] = {(uint8_t)(dwBaudRate >> 24), (uint8_t)(dwBaudRate >> 16),
+			       (uint8_t)(dwBaudRate >> 8), (uint8_t)dwBaudRate};
 
-	// Send data to simulation software----------------------------------------------------
-	TempSensor_SendPacketRespond(g_temperature);
-	HumiSensor_SendPacketRespond(g_humidity);
-	LightSensor_SendPacketRespond(g_light);
+	Serial_SendPacketCustom(CMD_OPT, CMD_ID_BAUDRATE, CMD_TYPE_RES, byPayload, sizeof(byPayload));
 }
 
 /*
- * @func:  		Serial_SendPacketCustom
+ * @func:  		FramingCmdHandler
  *
- * @brief:		The function send text to PC_Simulator_KIT
+ * @brief:		The function to choose the check (CXOR or CRC-32) of the frames sent
  *
- * @param[1]:		byOption - Byte Option of the frame
- * @param[2]:		byCmdId - Byte CmdID of the frame
- * @param[3]:		byCmdType - Byte CmdType of the frame
- * @param[4]:		pPayload - Byte Data of the frame
- * @param[5]:		byLengthPayload - Data size
+ * @param:		pCmd - Received command (the framing follows CmdID and CmdType)
  *
  * @retval:		None
  *
- * @note:		None
+ * @note:		The answer is built before the switch, so it still carries the old check
  */
-void Serial_SendPacketCustom (uint8_t byOption, uint8_t byCmdId, uint8_t byCmdType,
-			      uint8_t *pPayload, uint8_t byLengthPayload)
+void FramingCmdHandler (const cmd_receive_t *pCmd)
 {
-	uint8_t	byLength = 5 + byLengthPayload;
-	static uint8_t bySequence = 0;
-	uint8_t byCXOR = CXOR_INIT_VAL;
+	const uint8_t *pPayload = (const uint8_t *)pCmd + sizeof(cmd_common_t);
+	uint8_t byFraming = g_byTxFraming;
+
+	if ((g_pRxFrame[0] >= (5 + 1)) && ((pPayload[0] == FRAMING_CXOR) || (pPayload[0] == FRAMING_CRC32)))
+	{
+		byFraming = pPayload[0];
+	}
+
+	Serial_SendPacketCustom(CMD_OPT, CMD_ID_FRAMING, CMD_TYPE_RES, &byFraming, sizeof(byFraming));
+
+	g_byTxFraming = byFraming;
+}
+
+/*
+ * @func:  		DiagnosticsCmdHandler
+ *
+ * @brief:		The function to report the link counters to PC_Simulator_KIT
+ *
+ * @param:		pCmd - Received command (no payload)
+ *
+ * @retval:		None
+ *
+ * @note:		The layout of the answer is given with CMD_ID_DIAGNOSTICS
+ */
+void DiagnosticsCmdHandler (const cmd_receive_t *pCmd)
+{
+	uint32_t dwValues[] = {
+		g_serialDiag.dwRxFramesOk,
+		g_serialDiag.dwRxCheckErrors,
+		g_serialDiag.dwRxLengthErrors,
+		g_serialDiag.dwRxGarbageBytes,
+		g_serialQueueRxStats.dwOverflowDrops,
+	};
+	uint32_t dwTxValues[] = {
+		g_serialDiag.dwTxBytes,
+		g_serialDiag.dwTxQueueFull,
+		g_dwTxBlockedCycles,
+	};
+	uint8_t byPayload[1 + sizeof(dwValues) + 2 + sizeof(dwTxValues) + 1];
 	uint8_t size = 0;
-	uint8_t Frame[byLength + 2];
 
-	bySequence++;
+	(void)pCmd;
 
-	Frame[size++] = FRAME_SOF;
-	Frame[size++] = byLength;
-	Frame[size++] = byOption;
-	Frame[size++] = byCmdId;
-	Frame[size++] = byCmdType;
+	byPayload[size++] = DIAGNOSTICS_VERSION;
 
-	for (uint8_t i = 0; i < byLengthPayload; i++)
+	for (uint8_t i = 0; i < (sizeof(dwValues) / sizeof(dwValues[0])); i++)
 	{
-		Frame[size++] = pPayload[i];
+		byPayload[size++] = (uint8_t)(dwValues[i] >> 24);
+		byPayload[size++] = (uint8_t)(dwValues[i] >> 16);
+		byPayload[size++] = (uint8_t)(dwValues[i] >> 8);
+		byPayload[size++] = (uint8_t)dwValues[i];
 	}
 
-	Frame[size++] = bySequence;
+	byPayload[size++] = (uint8_t)(g_serialQueueRxStats.wPeakItems >> 8);
+	byPayload[size++] = (uint8_t)g_serialQueueRxStats.wPeakItems;
 
-	for (uint8_t j = 2; j < size; j++)
+	for (uint8_t i = 0; i < (sizeof(dwTxValues) / sizeof(dwTxValues[0])); i++)
 	{
-		byCXOR ^= Frame[j];
+		byPayload[size++] = (uint8_t)(dwTxValues[i] >> 24);
+		byPayload[size++] = (uint8_t)(dwTxValues[i] >> 16);
+		byPayload[size++] = (uint8_t)(dwTxValues[i] >> 8);
+		byPayload[size++] = (uint8_t)dwTxValues[i];
 	}
-	Frame[size++] = byCXOR;
 
-	for (uint8_t k = 0; k < size; k++)
-	{
-		while(USART_GetFlagStatus(USART2, USART_FLAG_TXE) == RESET);
-		USART_SendData(USART2, Frame[k]);
-		while(USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET);
-	}
+#if (IDLE_SLEEP_ENABLE == 1)
+	byPayload[size++] = IdleSleep_GetPercent();
+#else
+	byPayload[size++] = 0;
+#endif
+
+	Serial_SendPacketCustom(CMD_OPT, CMD_ID_DIAGNOSTICS, CMD_TYPE_RES, byPayload, size);
 }
 
+#ifdef USE_SCHED_PROFILER
 /*
- * @func:  		processSerialReceiverCustom
+ * @func:  		Profile_PutValue
  *
- * @brief:		The function to check and process data received from PC_Simulator_KIT
+ * @brief:		The function to append a 4-byte value, high byte first
  *
- * @param:		None
+ * @param[1]:		pPayload - Payload being built
+ * @param[2]:		size - Bytes already in pPayload
+ * @param[3]:		dwValue - Value to append
  *
- * @retval:		None
+ * @retval:		New size of the payload
  *
  * @note:		None
  */
-void processSerialReceiverCustom (void)
+uint8_t Profile_PutValue (uint8_t *pPayload, uint8_t size, uint32_t dwValue)
 {
-	uint8_t	RxState = PollRxBuff();
-
-	if (RxState != USART_STATE_IDLE)
-	{
-		switch (RxState)
-		{
-			case USART_STATE_DATA_RECEIVED:
-			{
-				if ((CMD_ID == CMD_ID_LED) && (CMD_TYPE == CMD_TYPE_SET))
-				{
-					LedCmdSetState(CMD_DATA_LED_ID, CMD_DATA_LED_COLOR, CMD_DATA_LED_NUMBLINK,	\
-						       CMD_DATA_LED_INTERVAL, CMD_DATA_LED_LASTSTATE);
-				}
-				else if ((CMD_ID == CMD_ID_BUZZER) && (CMD_TYPE == CMD_TYPE_SET))
-				{
-					BuzzerCmdSetState(CMD_DATA_BUZZER_STATE);
-				}
-				else if ((CMD_ID == CMD_ID_BUTTON) && (CMD_TYPE == CMD_TYPE_SET))
-				{
-					ButtonCmdSetState(CMD_DATA_BUTTON_EVENT, CMD_DATA_BUTTON_STATE);
-				}
-				else if ((CMD_ID == CMD_ID_LCD) && (CMD_TYPE == CMD_TYPE_SET))
-				{
-					LcdCmdSetState((char*)(&CMD_DATA_LCD));
-				}
-			} break;
-
-			case USART_STATE_ACK_RECEIVED:
-				break;
-
-			case USART_STATE_NACK_RECEIVED:
-				break;
+	pPayload[size++] = (uint8_t)(dwValue >> 24);
+	pPayload[size++] = (uint8_t)(dwValue >> 16);
+	pPayload[size++] = (uint8_t)(dwValue >> 8);
+	pPayload[size++] = (uint8_t)dwValue;
 
-			case USART_STATE_ERROR:
-			case USART_STATE_RX_TIMEOUT:
-				break;
-
-			default:
-				break;
-		}
-	}
+	return size;
 }
 
 /*
- * @func:  		PollRxBuff
+ * @func:  		ProfileCmdHandler
  *
- * @brief:		The function to process received messages based on format
+ * @brief:		The function to handle the PROFILE GET and SET commands
  *
- * @param:		None
+ * @param:		pCmd - Received command (GET: slot index and page follow CmdID and CmdType)
  *
  * @retval:		None
  *
- * @note:		None
+ * @note:		The dispatcher keeps one handler per command id, so the SET (reset)
+ * 			is handled here too. The layout of the GET answer is given with
+ * 			CMD_ID_PROFILE. The PC reads the slots one by one, from 0 to the
+ * 			number of slots returned
  */
-uint8_t PollRxBuff (void)
+void ProfileCmdHandler (const cmd_receive_t *pCmd)
 {
-	// Variable to store value after retrieved from Queue
-	uint8_t byRxData;
+	const uint8_t *pRequest = (const uint8_t *)pCmd + sizeof(cmd_common_t);
+	uint8_t byPayload[4 + PROFILE_NAME_SIZE + 3 * 4 + SCHED_PROFILER_BUCKETS * 2];
+	uint8_t bySlot = 0;
+	uint8_t byPage = PROFILE_PAGE_RUNTIME;
+	uint8_t size = 0;
+
+	if (pCmd->cmdCommon.type == CMD_TYPE_SET)
+	{
+		ProfileResetCmdHandler(pCmd);
+		return;
+	}
+
+	// g_pRxFrame[0] counts Length, Option, CmdID, CmdType, payload and Seq
+	if (g_pRxFrame[0] >= (5 + 2))
+	{
+		bySlot = pRequest[0];
+		byPage = pRequest[1];
+	}
 
-	uint8_t byUartState = (uint8_t) USART_STATE_IDLE;
+	const sched_profile_t *pProfile = SchedProfiler_Get(bySlot);
 
-	while ((bufNumItems(&g_serialQueueRx) != 0) && (byUartState == USART_STATE_IDLE))
+	byPayload[size++] = PROFILE_VERSION;
+	byPayload[size++] = bySlot;
+	byPayload[size++] = SchedProfiler_Count();
+	byPayload[size++] = byPage;
+
+	if (pProfile != NULL)
 	{
-		bufDeDat(&g_serialQueueRx, &byRxData);			// Retrieve data from the queue (FIFO)
+		// strName is terminated within PROFILE_NAME_SIZE + 1 bytes
+		memset(&byPayload[size], 0, PROFILE_NAME_SIZE);
+		memcpy(&byPayload[size], pProfile->strName, strlen(pProfile->strName));
+		size += PROFILE_NAME_SIZE;
 
-		switch (g_RxBufState)
+		if (byPage == PROFILE_PAGE_LATENESS)
 		{
-			case RX_STATE_START_BYTE:
+			if (pProfile->dwLateCalls != 0)
 			{
-				if (byRxData == FRAME_SOF)
-				{
-					g_IndexRxBuf = 0;
-					g_byCheckXorRxBuf = CXOR_INIT_VAL;
-					g_RxBufState = RX_STATE_DATA_BYTES;
-				}
-				else if (byRxData == FRAME_ACK)
-				{
-					byUartState = USART_STATE_ACK_RECEIVED;
-				}
-				else if (byRxData == FRAME_NACK)
-				{
-					byUartState = USART_STATE_NACK_RECEIVED;
-				}
-				else
-				{
-					byUartState = USART_STATE_ERROR;
-				}
-			} break;
-
-			case RX_STATE_DATA_BYTES:
+				size = Profile_PutValue(byPayload, size,
+							SchedProfiler_CyclesToUs(pProfile->dwMinLate));
+				size = Profile_PutValue(byPayload, size,
+							SchedProfiler_CyclesToUs(pProfile->qwTotalLate /
+										 pProfile->dwLateCalls));
+				size = Profile_PutValue(byPayload, size,
+							SchedProfiler_CyclesToUs(pProfile->dwMaxLate));
+			}
+			else
 			{
-				if (g_IndexRxBuf < RX_BUFFER_SIZE)
-				{
-					// Retrieve the bytes in the transmission frame
-					g_strRxBuffer[g_IndexRxBuf] = byRxData;
-
-					if (g_IndexRxBuf > 0)
-					{
-						g_byCheckXorRxBuf ^= byRxData;		// Calculator CXOR
-					}
+				size = Profile_PutValue(byPayload, size, SCHED_PROFILER_NO_LATENESS);
+				size = Profile_PutValue(byPayload, size, SCHED_PROFILER_NO_LATENESS);
+				size = Profile_PutValue(byPayload, size, SCHED_PROFILER_NO_LATENESS);
+			}
 
-					g_IndexRxBuf++;
+			for (uint8_t i = 0; i < SCHED_PROFILER_BUCKETS; i++)
+			{
+				uint16_t wCount = (pProfile->aHistogram[i] > 0xFFFF) ?
+						  0xFFFF : (uint16_t)pProfile->aHistogram[i];
 
-					if (g_IndexRxBuf == *g_strRxBuffer)
-					{
-						g_RxBufState = RX_STATE_CXOR_BYTE;
-					}
-				}
-				else
-				{
-					g_RxBufState = RX_STATE_START_BYTE;
-					byUartState = USART_STATE_ERROR;
-				}
-			} break;
+				byPayload[size++] = (uint8_t)(wCount >> 8);
+				byPayload[size++] = (uint8_t)wCount;
+			}
+		}
+		else
+		{
+			size = Profile_PutValue(byPayload, size, pProfile->dwCalls);
 
-			case RX_STATE_CXOR_BYTE:
+			if (pProfile->dwCalls != 0)
 			{
-				if (byRxData == g_byCheckXorRxBuf)
-				{
-					byUartState = USART_STATE_DATA_RECEIVED;
-				}
-				else
-				{
-					byUartState = USART_STATE_ERROR;
-				}
-
-				g_RxBufState = RX_STATE_START_BYTE;
-			} break;
+				size = Profile_PutValue(byPayload, size,
+							SchedProfiler_CyclesToUs(pProfile->dwMinCycles));
+				size = Profile_PutValue(byPayload, size,
+							SchedProfiler_CyclesToUs(pProfile->qwTotalCycles /
+										 pProfile->dwCalls));
+			}
+			else
+			{
+				size = Profile_PutValue(byPayload, size, 0);
+				size = Profile_PutValue(byPayload, size, 0);
+			}
 
-			default:
-				g_RxBufState = RX_STATE_START_BYTE;
-				break;
+			size = Profile_PutValue(byPayload, size,
+						SchedProfiler_CyclesToUs(pProfile->dwMaxCycles));
 		}
 	}
 
-	return byUartState;
+	Serial_SendPacketCustom(CMD_OPT, CMD_ID_PROFILE, CMD_TYPE_RES, byPayload, size);
+}
+
+/*
+ * @func:  		ProfileResetCmdHandler
+ *
+ * @brief:		The function to clear the statistics of the scheduler callbacks
+ *
+ * @param:		pCmd - Received command (no payload)
+ *
+ * @retval:		None
+ *
+ * @note:		Called by ProfileCmdHandler for a SET. Answered with the version alone
+ */
+void ProfileResetCmdHandler (const cmd_receive_t *pCmd)
+{
+	uint8_t byVersion = PROFILE_VERSION;
+
+	(void)pCmd;
+
+	SchedProfiler_Reset();
+
+	Serial_SendPacketCustom(CMD_OPT, CMD_ID_PROFILE, CMD_TYPE_RES, &byVersion, sizeof(byVersion));
 }
+#endif
 
 /*
  * @func:  		ButtonCmdSetState
@@ -1002,13 +2460,16 @@ uint8_t PollRxBuff (void)
  */
 void ButtonCmdSetState (uint8_t button_event, uint8_t button_state)
 {
+	// Presses of button 3 counted towards the system information screen
+	static uint8_t byB3Count = 0;
+
 	switch (button_event)
 	{
 		case EVENT_OF_BUTTON_3_PRESS_LOGIC:
 		{
-			g_B3Count++;
+			byB3Count++;
 
-			if (g_B3Count == 5)
+			if (byB3Count == 5)
 			{
 				if (g_idTimerSensorUpdate != NO_TIMER)
 				{
@@ -1017,21 +2478,8 @@ void ButtonCmdSetState (uint8_t button_event, uint8_t button_state)
 				}
 
 				// Display system status information on the LCD screen-------------------------
-				memset(g_strTemp, 0, sizeof(g_strTemp));
-				memset(g_strHumi, 0, sizeof(g_strHumi));
-				memset(g_strLight, 0, sizeof(g_strLight));
-				ucg_ClearScreen(&g_ucg);
-				ucg_SetFont(&g_ucg, ucg_font_ncenR08_hf);
-				ucg_DrawString(&g_ucg, 0, 12, 0, "Device: Board");
-				ucg_DrawString(&g_ucg, 0, 24, 0, "STM32 Nucleo.");
-				ucg_DrawString(&g_ucg, 0, 36, 0, "Code: STM32F401RE_");
-				ucg_DrawString(&g_ucg, 0, 48, 0, "NUCLEO.");
-				ucg_DrawString(&g_ucg, 0, 60, 0, "Manufacturer:");
-				ucg_DrawString(&g_ucg, 0, 72, 0, "STMicroelectronics.");
-				ucg_DrawString(&g_ucg, 0, 84, 0, "Kit expansion:");
-				ucg_DrawString(&g_ucg, 0, 97, 0, "Lumi Smarthome.");
-				ucg_DrawString(&g_ucg, 0, 110, 0, "Project:");
-				ucg_DrawString(&g_ucg, 0, 123, 0, "Simulator touch switch.");
+				EventQueue_Post(EVENT_PRIORITY_LOW, APP_EVENT_LCD_SYSTEM_INFO, NULL, 0,
+						EVENT_FLAG_NONE);
 
 				// Blink the green LED 5 times-------------------------------------------------
 				LedControl_BlinkStart(LED_ALL_ID, BLINK_GREEN, 10, 1000, LED_COLOR_BLACK);
@@ -1045,7 +2493,7 @@ void ButtonCmdSetState (uint8_t button_event, uint8_t button_state)
 
 				g_idTimerDisplayLCD = TimerStart("MultiSensorScan", 7000, 1, 	\
 								 (void*)MultiSensorScan, NULL);
-				g_B3Count = 0;
+				byB3Count = 0;
 			}
 		} break;
 
@@ -1058,19 +2506,19 @@ void ButtonCmdSetState (uint8_t button_event, uint8_t button_state)
 				g_ledWhite = 0;
 				g_ledBlue = 0;
 				LedControl_SetAllColor(LED_COLOR_RED, 50);
-				LedControl_SendPacketRespond(LED_KIT_ID0, LED_COLOR_RED, 50);
-				LedControl_SendPacketRespond(LED_KIT_ID1, LED_COLOR_RED, 50);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID0, LED_COLOR_RED, 50);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID1, LED_COLOR_RED, 50);
 			}
 			else
 			{
 				g_ledRed = 0;
 				LedControl_SetAllColor(LED_COLOR_RED, 0);
-				LedControl_SendPacketRespond(LED_KIT_ID0, LED_COLOR_RED, 0);
-				LedControl_SendPacketRespond(LED_KIT_ID1, LED_COLOR_RED, 0);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID0, LED_COLOR_RED, 0);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID1, LED_COLOR_RED, 0);
 			}
 
 			BuzzerControl_SetMelody(pbeep);
-			BuzzerControl_SendPacketRespond(1);
+			BuzzerControl_SendPacketRespondCustom(1);
 		} break;
 
 		case EVENT_OF_BUTTON_2_PRESS_LOGIC:
@@ -1082,19 +2530,19 @@ void ButtonCmdSetState (uint8_t button_event, uint8_t button_state)
 				g_ledWhite = 0;
 				g_ledBlue = 0;
 				LedControl_SetAllColor(LED_COLOR_GREEN, 50);
-				LedControl_SendPacketRespond(LED_KIT_ID0, LED_COLOR_GREEN, 50);
-				LedControl_SendPacketRespond(LED_KIT_ID1, LED_COLOR_GREEN, 50);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID0, LED_COLOR_GREEN, 50);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID1, LED_COLOR_GREEN, 50);
 			}
 			else
 			{
 				g_ledGreen = 0;
 				LedControl_SetAllColor(LED_COLOR_GREEN, 0);
-				LedControl_SendPacketRespond(LED_KIT_ID0, LED_COLOR_GREEN, 0);
-				LedControl_SendPacketRespond(LED_KIT_ID1, LED_COLOR_GREEN, 0);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID0, LED_COLOR_GREEN, 0);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID1, LED_COLOR_GREEN, 0);
 			}
 
 			BuzzerControl_SetMelody(pbeep);
-			BuzzerControl_SendPacketRespond(1);
+			BuzzerControl_SendPacketRespondCustom(1);
 		} break;
 
 		case EVENT_OF_BUTTON_4_PRESS_LOGIC:
@@ -1106,19 +2554,19 @@ void ButtonCmdSetState (uint8_t button_event, uint8_t button_state)
 				g_ledWhite = 1;
 				g_ledBlue = 0;
 				LedControl_SetAllColor(LED_COLOR_WHITE, 50);
-				LedControl_SendPacketRespond(LED_KIT_ID0, LED_COLOR_WHITE, 50);
-				LedControl_SendPacketRespond(LED_KIT_ID1, LED_COLOR_WHITE, 50);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID0, LED_COLOR_WHITE, 50);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID1, LED_COLOR_WHITE, 50);
 			}
 			else
 			{
 				g_ledWhite = 0;
 				LedControl_SetAllColor(LED_COLOR_WHITE, 0);
-				LedControl_SendPacketRespond(LED_KIT_ID0, LED_COLOR_WHITE, 0);
-				LedControl_SendPacketRespond(LED_KIT_ID1, LED_COLOR_WHITE, 0);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID0, LED_COLOR_WHITE, 0);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID1, LED_COLOR_WHITE, 0);
 			}
 
 			BuzzerControl_SetMelody(pbeep);
-			BuzzerControl_SendPacketRespond(1);
+			BuzzerControl_SendPacketRespondCustom(1);
 		} break;
 
 		case EVENT_OF_BUTTON_5_PRESS_LOGIC:
@@ -1130,19 +2578,19 @@ void ButtonCmdSetState (uint8_t button_event, uint8_t button_state)
 				g_ledWhite = 0;
 				g_ledBlue = 1;
 				LedControl_SetAllColor(LED_COLOR_BLUE, 50);
-				LedControl_SendPacketRespond(LED_KIT_ID0, LED_COLOR_BLUE, 50);
-				LedControl_SendPacketRespond(LED_KIT_ID1, LED_COLOR_BLUE, 50);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID0, LED_COLOR_BLUE, 50);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID1, LED_COLOR_BLUE, 50);
 			}
 			else
 			{
 				g_ledBlue = 0;
 				LedControl_SetAllColor(LED_COLOR_BLUE, 0);
-				LedControl_SendPacketRespond(LED_KIT_ID0, LED_COLOR_BLUE, 0);
-				LedControl_SendPacketRespond(LED_KIT_ID1, LED_COLOR_BLUE, 0);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID0, LED_COLOR_BLUE, 0);
+				LedControl_SendPacketRespondCustom(LED_KIT_ID1, LED_COLOR_BLUE, 0);
 			}
 
 			BuzzerControl_SetMelody(pbeep);
-			BuzzerControl_SendPacketRespond(1);
+			BuzzerControl_SendPacketRespondCustom(1);
 		} break;
 
 		default:
@@ -1239,13 +2687,14 @@ void BuzzerCmdSetState (uint8_t buzzer_state)
  * @brief:		The function to display a text segment on the LCD screen
  * 			when receiving a message from PC_Simulator_KIT
  *
- * @param:		text - Text segment to be displayed
+ * @param[1]:		text - Text segment to be displayed, ended by 0x0D or by byLength
+ * @param[2]:		byLength - Number of bytes of the payload that holds the text
  *
  * @retval:		None
  *
- * @note:		None
+ * @note:		The sensor updates stop at once, the text is drawn by the EventQueue
  */
-void LcdCmdSetState (char *text)
+void LcdCmdSetState (const char *text, uint8_t byLength)
 {
 	if (g_idTimerSensorUpdate != NO_TIMER)
 	{
@@ -1253,23 +2702,96 @@ void LcdCmdSetState (char *text)
 		g_idTimerSensorUpdate = NO_TIMER;
 	}
 
-	memset(g_strTemp, 0, sizeof(g_strTemp));
-	memset(g_strHumi, 0, sizeof(g_strHumi));
-	memset(g_strLight, 0, sizeof(g_strLight));
-
 	uint8_t i = 0;
-	static char buffer[20];
 
-	memset((uint8_t *)buffer, 0, sizeof(buffer));
+	if (byLength > EVENT_PAYLOAD_SIZE)
+	{
+		byLength = EVENT_PAYLOAD_SIZE;
+	}
 
-	while (text[i] != 0x0D)
+	while ((i < byLength) && (text[i] != 0x0D))
 	{
-		buffer[i] = text[i];
 		i++;
 	}
 
+	EventQueue_Post(EVENT_PRIORITY_LOW, APP_EVENT_LCD_TEXT, text, i, EVENT_FLAG_NONE);
+}
+
+/*
+ * @func:  		LcdShowSystemInfo
+ *
+ * @brief:		The function to display system status information on the LCD screen
+ *
+ * @param:		None
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+void LcdShowSystemInfo (void)
+{
+	ucg_ClearScreen(&g_ucg);
+	ucg_SetFont(&g_ucg, ucg_font_ncenR08_hf);
+	ucg_DrawString(&g_ucg, 0, 12, 0, "Device: Board");
+	ucg_DrawString(&g_ucg, 0, 24, 0, "STM32 Nucleo.");
+	ucg_DrawString(&g_ucg, 0, 36, 0, "Code: STM32F401RE_");
+	ucg_DrawString(&g_ucg, 0, 48, 0, "NUCLEO.");
+	ucg_DrawString(&g_ucg, 0, 60, 0, "Manufacturer:");
+	ucg_DrawString(&g_ucg, 0, 72, 0, "STMicroelectronics.");
+	ucg_DrawString(&g_ucg, 0, 84, 0, "Kit expansion:");
+	ucg_DrawString(&g_ucg, 0, 97, 0, "Lumi Smarthome.");
+	ucg_DrawString(&g_ucg, 0, 110, 0, "Project:");
+	ucg_DrawString(&g_ucg, 0, 123, 0, "Simulator touch switch.");
+}
+
+/*
+ * @func:  		LcdShowSensors
+ *
+ * @brief:		The function to display temperature, humidity, and light intensity values
+ * 			on the LCD screen
+ *
+ * @param:		pSensors - Readings to be displayed
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+void LcdShowSensors (const lcd_sensors_t *pSensors)
+{
+	char strTemp[30];
+	char strHumi[30];
+	char strLight[30];
+
+	sprintf(strTemp, "Temp = %d oC     ", pSensors->temperature);
+	sprintf(strHumi, "Humi = %d %%     ", pSensors->humidity);
+	sprintf(strLight, "Light = %d Lux     ", pSensors->light);
+
+	ucg_DrawString(&g_ucg, 0, 40, 0, strTemp);
+	ucg_DrawString(&g_ucg, 0, 65, 0, strHumi);
+	ucg_DrawString(&g_ucg, 0, 90, 0, strLight);
+}
+
+/*
+ * @func:  		LcdShowText
+ *
+ * @brief:		The function to display a text segment on the LCD screen
+ *
+ * @param[1]:		pText - Text segment to be displayed, not terminated
+ * @param[2]:		byLength - Length of the text segment
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+void LcdShowText (const uint8_t *pText, uint8_t byLength)
+{
+	char buffer[EVENT_PAYLOAD_SIZE + 1];
+
+	memcpy(buffer, pText, byLength);
+	buffer[byLength] = 0;
+
 	ucg_ClearScreen(&g_ucg);
-	ucg_DrawString(&g_ucg, 0, 40, 0, (char *)buffer);
+	ucg_DrawString(&g_ucg, 0, 40, 0, buffer);
 }
 
 
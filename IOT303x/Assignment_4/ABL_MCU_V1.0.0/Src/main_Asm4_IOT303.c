@@ -16,6 +16,7 @@
 #include <stdint.h>
 #include "system_stm32f4xx.h"
 #include "timer.h"
+#include "timebase.h"
 #include "stm32f401re_rcc.h"
 #include "stm32f401re_gpio.h"
 #include "stm32f401re_adc.h"
@@ -322,30 +323,17 @@ void TimerOCSetPwm (uint32_t Compare)
  */
 void ABL_Process (void)
 {
- 	uint32_t dwTimeCurrent;
- 	static uint32_t dwTimeTotal, dwTimeInit;
+ 	static uint32_t dwTimeInit;
+ 	uint32_t dwTimeCurrent = GetMilSecTick();
 
- 	dwTimeCurrent = GetMilSecTick();
-
- 	if (dwTimeCurrent >= dwTimeInit)
- 	{
- 		dwTimeTotal += dwTimeCurrent - dwTimeInit;
- 	}
- 	else
- 	{
- 		dwTimeTotal += 0xFFFFFFFFU + dwTimeCurrent - dwTimeInit;
- 	}
-
- 	if (dwTimeTotal >= 100)
+ 	if (TimeBase_ElapsedMs(dwTimeInit, dwTimeCurrent) >= 100)
  	{
  		// Time scan 100ms
- 		dwTimeTotal = 0;
+ 		dwTimeInit = dwTimeCurrent;
 
  		g_AdcValueUpdate = LightSensor_AdcPollingRead();
  		g_AdcValueUpdate = KalmanFilter_updateEstimate(g_AdcValueUpdate);
  	}
-
- 	dwTimeInit = dwTimeCurrent;
 }
 
 /*
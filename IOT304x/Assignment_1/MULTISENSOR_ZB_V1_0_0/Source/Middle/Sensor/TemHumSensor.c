@@ -185,7 +185,8 @@ boolean Si7020_Measure (uint32_t *buffer, uint8_t command)
  *
  * @retVal:		True if both value are received, false otherwise
  *
- * @note:		None
+ * @note:		With SI7020_TEMP_FROM_RH, only the RH command converts: the temperature
+ * 				is read back with SI7020_READ_TEMP_FROM_RH, which must follow it
  */
 boolean Si7020_MeasureTempAndHumi (uint32_t *humiData, uint32_t *tempData)
 {
@@ -198,7 +199,11 @@ boolean Si7020_MeasureTempAndHumi (uint32_t *humiData, uint32_t *tempData)
 		return false;
 
 	// Get temperature value
-	retVal = Si7020_Measure ((uint32_t*) tempData, SI7020_READ_TEMP);
+#if (SI7020_TEMP_FROM_RH == 1)
+	retVal = Si7020_Measure ((uint32_t*) tempData, SI7020_READ_TEMP_FROM_RH);
+#else
+	retVal = Si7020_Measure ((uint32_t*) tempData, SI7020_MEASURE_TEMP);
+#endif
 
 	if (retVal)
 		*tempData = ( (((*tempData) * 21965) >> 13) - 46850 )/1000;
@@ -31,12 +31,19 @@
 /* Device ID value for Si7020 */
 #define SI7020_DEVICE_ID       0x14
 
-/* Si7013 Read Temperature Command */
-#define SI7020_READ_TEMP       0xE0
+/* Si7020 Measure Temperature Command (a conversion of its own) */
+#define SI7020_MEASURE_TEMP    0xE3
 
-/* Si7013 Read RH Command */
+/* Si7020 Read Temperature Value from Previous RH Measurement (no conversion) */
+#define SI7020_READ_TEMP_FROM_RH  0xE0
+
+/* Si7020 Measure RH Command */
 #define SI7020_READ_RH         0xE5
 
+/* 1: a sample is one RH conversion, the temperature is the one measured for it;
+ * 0: the temperature has a conversion of its own */
+#define SI7020_TEMP_FROM_RH    1
+
 /* SI7013 ID */
 #define SI7020_READ_ID_1       0xFC
 #define SI7020_READ_ID_2       0xC9
@@ -103,22 +103,12 @@ uint32_t Timer_GetMilSecTick (void)
  *
  * @retVal:		TimeTotal - Time between events
  *
- * @note:		None
+ * @note:		Valid for events less than 49.7 days apart
  */
 uint32_t CalculatorTime (uint32_t TimeInit, uint32_t TimeCurrent)
 {
-	uint32_t TimeTotal;
-
-	if (TimeCurrent >= TimeInit)
-	{
-		TimeTotal = TimeCurrent - TimeInit;
-	}
-	else
-	{
-		TimeTotal = 0xFFFFFFFFU + TimeCurrent - TimeInit;
-	}
-
-	return TimeTotal;
+	// Unsigned subtraction is right across the wrap of the counter
+	return TimeCurrent - TimeInit;
 }
 
 /* END FILE */
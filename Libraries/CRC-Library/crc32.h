@@ -0,0 +1,89 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: CRC-32 (polynomial 0x04C11DB7) for the serial frames
+ *
+ ******************************************************************************/
+#ifndef _CRC32_H_
+#define _CRC32_H_
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <stdint.h>
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+/*!
+ * CRC-32/MPEG-2: polynomial 0x04C11DB7, initial value 0xFFFFFFFF, bits shifted
+ * most significant first, no final XOR. It is what the STM32F4 CRC unit
+ * computes when each word is written with its first byte in bits 31..24, so
+ * the same value is obtained on the MCU (hardware) and on a PC (table).
+ */
+#define CRC32_INIT_VAL                      0xFFFFFFFFUL
+
+/* 1: Crc32_Compute uses the CRC unit of the MCU, 0: the table only */
+#ifndef CRC32_USE_HW
+#if defined(STM32F4) || defined(STM32F401xx)
+#define CRC32_USE_HW                        1
+#else
+#define CRC32_USE_HW                        0
+#endif
+#endif
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   Crc32_Init
+ * @brief  Supplies the clock of the CRC unit (nothing without CRC32_USE_HW)
+ * @param  None
+ * @retval None
+ */
+void
+Crc32_Init(void);
+
+/**
+ * @func   Crc32_Update
+ * @brief  Continues a CRC-32 over more bytes, one table lookup per byte
+ * @param  dwCrc: CRC of the previous bytes (CRC32_INIT_VAL to start)
+ * @param  pData: Bytes
+ * @param  wLength: Number of bytes
+ * @retval CRC-32 including pData
+ */
+uint32_t
+Crc32_Update(
+    uint32_t dwCrc,
+    const uint8_t *pData,
+    uint16_t wLength
+);
+
+/**
+ * @func   Crc32_Compute
+ * @brief  Computes the CRC-32 of a buffer
+ * @param  pData: Bytes
+ * @param  wLength: Number of bytes
+ * @retval CRC-32 of pData
+ * @note   With CRC32_USE_HW the CRC unit takes 4 bytes per write; it is shared,
+ *         so do not call this from an interrupt and from the main loop.
+ */
+uint32_t
+Crc32_Compute(
+    const uint8_t *pData,
+    uint16_t wLength
+);
+
+#endif /* END FILE */
@@ -0,0 +1,257 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: Event queue with priority levels and inline payloads
+ *
+ ******************************************************************************/
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <string.h>
+#include "typed_queue.h"
+#include "eventqueue.h"
+#ifdef USE_SCHED_PROFILER
+#include "schedprofiler.h"
+#endif
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+DECLARE_QUEUE(eventLevel, event_t, EVENT_QUEUE_DEPTH)
+
+/* Profiler slot of an event code not registered yet */
+#define EVENT_PROFILE_UNSET         0xFEu
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+static eventLevel_t g_aEventLevel[EVENT_PRIORITY_LEVELS];
+
+static event_handler_f g_pfnEventHandler = NULL;
+
+static eventqueue_stats_t g_eventQueueStats;
+
+#ifdef USE_SCHED_PROFILER
+static uint8_t g_aEventProfileSlot[EVENT_PROFILE_CODES];
+#endif
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+/**
+ * @func   EventQueue_FindWaiting
+ * @brief  Finds an event waiting in a level
+ * @param  pLevel: Priority level
+ * @param  byEvent: Event code
+ * @retval Pointer to the oldest such event, NULL if none
+ */
+static event_t *
+EventQueue_FindWaiting(
+    eventLevel_t *pLevel,
+    uint8_t byEvent
+) {
+    uint16_t wIndex;
+
+    for (wIndex = pLevel->wTailIndex; wIndex != pLevel->wHeadIndex; wIndex++) {
+        event_t *pEvent = &pLevel->aItems[wIndex & (EVENT_QUEUE_DEPTH - 1)];
+
+        if (pEvent->byEvent == byEvent) {
+            return pEvent;
+        }
+    }
+
+    return NULL;
+}
+
+#ifdef USE_SCHED_PROFILER
+/**
+ * @func   EventQueue_ProfileSlot
+ * @brief  Gets the profiler slot of an event code, named "Event 0xNN"
+ * @param  byEvent: Event code
+ * @retval Slot index, SCHED_PROFILER_NO_SLOT if not profiled
+ */
+static uint8_t
+EventQueue_ProfileSlot(
+    uint8_t byEvent
+) {
+    static const char strHex[] = "0123456789ABCDEF";
+    char strName[] = "Event 0x00";
+
+    if (byEvent >= EVENT_PROFILE_CODES) {
+        return SCHED_PROFILER_NO_SLOT;
+    }
+
+    if (g_aEventProfileSlot[byEvent] == EVENT_PROFILE_UNSET) {
+        strName[8] = strHex[byEvent >> 4];
+        strName[9] = strHex[byEvent & 0x0F];
+        g_aEventProfileSlot[byEvent] = SchedProfiler_Register(strName);
+    }
+
+    return g_aEventProfileSlot[byEvent];
+}
+#endif
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   EventQueue_Init
+ * @brief  Empties every level and sets the handler
+ * @param  handler: Function called by EventQueue_Process for each event
+ * @retval None
+ */
+void
+EventQueue_Init(
+    event_handler_f handler
+) {
+    uint8_t i;
+
+    for (i = 0; i < EVENT_PRIORITY_LEVELS; i++) {
+        eventLevelInit(&g_aEventLevel[i]);
+    }
+
+    memset(&g_eventQueueStats, 0, sizeof(g_eventQueueStats));
+    g_pfnEventHandler = handler;
+
+#ifdef USE_SCHED_PROFILER
+    memset(g_aEventProfileSlot, EVENT_PROFILE_UNSET, sizeof(g_aEventProfileSlot));
+#endif
+}
+
+/**
+ * @func   EventQueue_Post
+ * @brief  Queues an event
+ * @param  byPriority: EVENT_PRIORITY_HIGH, EVENT_PRIORITY_NORMAL or
+ *         EVENT_PRIORITY_LOW
+ * @param  byEvent: Event code
+ * @param  pPayload: Data copied into the event (NULL if byLength is 0)
+ * @param  byLength: Length of the data, at most EVENT_PAYLOAD_SIZE
+ * @param  byFlags: EVENT_FLAG_NONE or EVENT_FLAG_COALESCE
+ * @retval ERR_OK, ERR_BUF_FULL if the level is full or the data too long
+ */
+uint8_t
+EventQueue_Post(
+    uint8_t byPriority,
+    uint8_t byEvent,
+    const void *pPayload,
+    uint8_t byLength,
+    uint8_t byFlags
+) {
+    eventLevel_t *pLevel;
+    event_t *pEvent;
+    event_t event;
+
+    if (byPriority >= EVENT_PRIORITY_LEVELS) {
+        byPriority = EVENT_PRIORITY_LEVELS - 1;
+    }
+
+    if (byLength > EVENT_PAYLOAD_SIZE) {
+        g_eventQueueStats.dwDropped++;
+        return ERR_BUF_FULL;
+    }
+
+    pLevel = &g_aEventLevel[byPriority];
+
+    if (byFlags & EVENT_FLAG_COALESCE) {
+        pEvent = EventQueue_FindWaiting(pLevel, byEvent);
+
+        if (pEvent != NULL) {
+            pEvent->byLength = byLength;
+            if (byLength != 0) {
+                memcpy(pEvent->aPayload, pPayload, byLength);
+            }
+            g_eventQueueStats.dwCoalesced++;
+            return ERR_OK;
+        }
+    }
+
+    event.byEvent = byEvent;
+    event.byLength = byLength;
+#ifdef USE_SCHED_PROFILER
+    event.dwPostCycles = SchedProfiler_Now();
+#endif
+    if (byLength != 0) {
+        memcpy(event.aPayload, pPayload, byLength);
+    }
+
+    if (eventLevelPush(pLevel, &event) != ERR_OK) {
+        g_eventQueueStats.dwDropped++;
+        return ERR_BUF_FULL;
+    }
+
+    g_eventQueueStats.dwPosted++;
+
+    return ERR_OK;
+}
+
+/**
+ * @func   EventQueue_Process
+ * @brief  Hands the first event of the highest non-empty level to the handler
+ * @param  byLowestPriority: Lowest level served by this call, e.g.
+ *         EVENT_PRIORITY_NORMAL to hold the slow work back while busy
+ * @retval 1 if an event was handled, 0 if none was waiting
+ */
+uint8_t
+EventQueue_Process(
+    uint8_t byLowestPriority
+) {
+    event_t event;
+    uint8_t i;
+#ifdef USE_SCHED_PROFILER
+    uint32_t dwStartCycles;
+#endif
+
+    for (i = 0; (i <= byLowestPriority) && (i < EVENT_PRIORITY_LEVELS); i++) {
+        /* Taken out first: the handler may post to the same level */
+        if (eventLevelPop(&g_aEventLevel[i], &event) == ERR_OK) {
+            if (g_pfnEventHandler != NULL) {
+#ifdef USE_SCHED_PROFILER
+                dwStartCycles = SchedProfiler_Now();
+                g_pfnEventHandler(&event);
+                SchedProfiler_Record(EventQueue_ProfileSlot(event.byEvent), dwStartCycles,
+                                     dwStartCycles - event.dwPostCycles);
+#else
+                g_pfnEventHandler(&event);
+#endif
+            }
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @func   EventQueue_IsEmpty
+ * @brief  Tells whether an event is waiting at any level
+ * @param  None
+ * @retval 1 if no event is waiting
+ */
+uint8_t
+EventQueue_IsEmpty(void) {
+    uint8_t i;
+
+    for (i = 0; i < EVENT_PRIORITY_LEVELS; i++) {
+        if (!eventLevelIsEmpty(&g_aEventLevel[i])) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @func   EventQueue_GetStats
+ * @brief  Gets the queue counters
+ * @param  None
+ * @retval Pointer to the counters
+ */
+const eventqueue_stats_t *
+EventQueue_GetStats(void) {
+    return &g_eventQueueStats;
+}
+
+/* END FILE */
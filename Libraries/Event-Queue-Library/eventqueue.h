@@ -0,0 +1,173 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: Event queue with priority levels and inline payloads
+ *
+ ******************************************************************************/
+#ifndef _EVENTQUEUE_H_
+#define _EVENTQUEUE_H_
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <stdint.h>
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+/*!
+ * Variant of the SDK event scheduler (EventSchedulerAdd) whose events carry
+ * their data, so that the handler does not read it from globals.
+ *
+ * Each priority level is a FIFO of EVENT_QUEUE_DEPTH events (DECLARE_QUEUE).
+ * EventQueue_Process hands one event to the handler per call, taken from the
+ * highest level that is not empty: an event posted at EVENT_PRIORITY_HIGH is
+ * handled before the ones waiting at the lower levels, whatever their age.
+ *
+ * An event posted with EVENT_FLAG_COALESCE replaces the payload of an event
+ * with the same code still waiting at the same level, instead of being queued
+ * a second time (e.g. only the latest screen content is drawn).
+ *
+ * Events are posted and processed from the main loop only: coalescing updates
+ * an event already in the queue.
+ *
+ * With USE_SCHED_PROFILER, each event code is recorded by Sched-Profiler-Library
+ * as "Event 0xNN", with its wait in the queue as lateness.
+ */
+
+#define EVENT_PRIORITY_HIGH         0u  /* User-visible answers (buttons, commands) */
+#define EVENT_PRIORITY_NORMAL       1u
+#define EVENT_PRIORITY_LOW          2u  /* Slow work that may wait (LCD redraws) */
+#define EVENT_PRIORITY_LEVELS       3u
+
+/* Events waiting per priority level (power of two) */
+#ifndef EVENT_QUEUE_DEPTH
+#define EVENT_QUEUE_DEPTH           8u
+#endif
+
+/* Largest payload carried by an event (bytes) */
+#ifndef EVENT_PAYLOAD_SIZE
+#define EVENT_PAYLOAD_SIZE          20u
+#endif
+
+/* Event codes profiled with USE_SCHED_PROFILER, from 0 */
+#ifndef EVENT_PROFILE_CODES
+#define EVENT_PROFILE_CODES         16u
+#endif
+
+/* Flags of EventQueue_Post */
+#define EVENT_FLAG_NONE             0x00
+#define EVENT_FLAG_COALESCE         0x01
+
+/*!
+ * Event and its payload
+ */
+typedef struct __event__ {
+
+    uint8_t byEvent;                        /*< Event code, chosen by the application */
+
+    uint8_t byLength;                       /*< Bytes used in aPayload */
+
+    uint8_t aPayload[EVENT_PAYLOAD_SIZE];   /*< Data of the event */
+
+#ifdef USE_SCHED_PROFILER
+    uint32_t dwPostCycles;                  /*< Cycle counter at the first post */
+#endif
+
+} event_t, *event_p;
+
+/*!
+ * Queue counters
+ */
+typedef struct __eventqueue_stats__ {
+
+    uint32_t dwPosted;      /*< Events queued */
+
+    uint32_t dwCoalesced;   /*< Events merged into one already waiting */
+
+    uint32_t dwDropped;     /*< Events refused (level full or payload too long) */
+
+} eventqueue_stats_t, *eventqueue_stats_p;
+
+/*! @brief Handles an event, the payload is valid during the call only */
+typedef void (* event_handler_f)(const event_t *pEvent);
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   EventQueue_Init
+ * @brief  Empties every level and sets the handler
+ * @param  handler: Function called by EventQueue_Process for each event
+ * @retval None
+ */
+void
+EventQueue_Init(
+    event_handler_f handler
+);
+
+/**
+ * @func   EventQueue_Post
+ * @brief  Queues an event
+ * @param  byPriority: EVENT_PRIORITY_HIGH, EVENT_PRIORITY_NORMAL or
+ *         EVENT_PRIORITY_LOW
+ * @param  byEvent: Event code
+ * @param  pPayload: Data copied into the event (NULL if byLength is 0)
+ * @param  byLength: Length of the data, at most EVENT_PAYLOAD_SIZE
+ * @param  byFlags: EVENT_FLAG_NONE or EVENT_FLAG_COALESCE
+ * @retval ERR_OK, ERR_BUF_FULL if the level is full or the data too long
+ */
+uint8_t
+EventQueue_Post(
+    uint8_t byPriority,
+    uint8_t byEvent,
+    const void *pPayload,
+    uint8_t byLength,
+    uint8_t byFlags
+);
+
+/**
+ * @func   EventQueue_Process
+ * @brief  Hands the first event of the highest non-empty level to the handler
+ * @param  byLowestPriority: Lowest level served by this call, e.g.
+ *         EVENT_PRIORITY_NORMAL to hold the slow work back while busy
+ * @retval 1 if an event was handled, 0 if none was waiting
+ */
+uint8_t
+EventQueue_Process(
+    uint8_t byLowestPriority
+);
+
+/**
+ * @func   EventQueue_IsEmpty
+ * @brief  Tells whether an event is waiting at any level
+ * @param  None
+ * @retval 1 if no event is waiting
+ */
+uint8_t
+EventQueue_IsEmpty(void);
+
+/**
+ * @func   EventQueue_GetStats
+ * @brief  Gets the queue counters
+ * @param  None
+ * @retval Pointer to the counters
+ */
+const eventqueue_stats_t *
+EventQueue_GetStats(void);
+
+#endif /* _EVENTQUEUE_H_ */
+
+/* END FILE */
@@ -0,0 +1,281 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: Streaming parser for the SOF/length/CXOR serial frames
+ *
+ ******************************************************************************/
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <string.h>
+#include "frameparser.h"
+#include "crc32.h"
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+/**
+ * @func   FrameParser_Drop
+ * @brief  Removes bytes from the front of the work buffer
+ * @param  pParser: Pointer to the parser
+ * @param  wLength: Number of bytes
+ * @retval None
+ */
+static void
+FrameParser_Drop(
+    frameparser_p pParser,
+    uint16_t wLength
+) {
+    pParser->wCount -= wLength;
+    
+    if (pParser->wCount != 0) {
+        memmove(pParser->pBuffer, &pParser->pBuffer[wLength], pParser->wCount);
+    }
+}
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   FrameParser_Xor
+ * @brief  Xor's a block of bytes, a 32-bit word at a time
+ * @param  pData: Bytes to xor
+ * @param  wLength: Number of bytes
+ * @param  byInit: Initial value (CXOR_INIT_VAL for a frame)
+ * @retval byInit xor'ed with every byte of pData
+ */
+uint8_t
+FrameParser_Xor(
+    const uint8_t *pData,
+    uint16_t wLength,
+    uint8_t byInit
+) {
+    uint8_t byXor = byInit;
+    uint32_t dwXor = 0;
+    uint32_t dwWord;
+    
+    /* Bytes up to a word boundary */
+    while ((wLength != 0) && (((uintptr_t)pData & 0x03) != 0)) {
+        byXor ^= *pData++;
+        wLength--;
+    }
+    
+    /* Aligned words: one load per four bytes */
+    while (wLength >= 4) {
+        memcpy(&dwWord, pData, 4);
+        dwXor ^= dwWord;
+        pData += 4;
+        wLength -= 4;
+    }
+    
+    /* Fold the four byte lanes, the xor of bytes does not depend on order */
+    dwXor ^= dwXor >> 16;
+    dwXor ^= dwXor >> 8;
+    byXor ^= (uint8_t)dwXor;
+    
+    while (wLength != 0) {
+        byXor ^= *pData++;
+        wLength--;
+    }
+    
+    return byXor;
+}
+
+/**
+ * @func   FrameParser_Parse
+ * @brief  Parses the message at the start of a contiguous block
+ * @param  pData: Received bytes
+ * @param  wLength: Number of received bytes
+ * @param  byMaxLength: Largest Length byte accepted
+ * @param  pwUsed: Receives the number of bytes the result covers
+ * @retval UART_STATE_xxx
+ */
+uint8_t
+FrameParser_Parse(
+    const uint8_t *pData,
+    uint16_t wLength,
+    uint8_t byMaxLength,
+    uint16_t *pwUsed
+) {
+    uint16_t wSkip = 0;
+    uint16_t wFrameSize;
+    uint8_t byLength;
+    uint8_t byTrailer;
+    uint8_t byValid;
+    uint32_t dwCrc;
+    
+    *pwUsed = 0;
+    
+    if (wLength == 0) {
+        return UART_STATE_IDLE;
+    }
+    
+    if (pData[0] == FRAME_ACK) {
+        *pwUsed = 1;
+        return UART_STATE_ACK_RECEIVED;
+    }
+    
+    if (pData[0] == FRAME_NACK) {
+        *pwUsed = 1;
+        return UART_STATE_NACK_RECEIVED;
+    }
+    
+    if (pData[0] != FRAME_SOF) {
+        /* Skip the whole run of garbage up to the next possible message */
+        while ((wSkip < wLength) && (pData[wSkip] != FRAME_SOF) &&
+               (pData[wSkip] != FRAME_ACK) && (pData[wSkip] != FRAME_NACK)) {
+            wSkip++;
+        }
+        
+        *pwUsed = wSkip;
+        return UART_STATE_ERROR;
+    }
+    
+    if (wLength < 2) {
+        return UART_STATE_IDLE;
+    }
+    
+    byLength = pData[1];
+    
+    if ((byLength < 2) || (byLength > byMaxLength)) {
+        *pwUsed = 1;
+        return UART_STATE_ERROR;
+    }
+    
+    if (wLength < 3) {
+        return UART_STATE_IDLE;
+    }
+    
+    byTrailer = FRAME_PARSER_TRAILER_SIZE(pData[2]);
+    wFrameSize = 1 + byLength + byTrailer;
+    
+    if (wLength < wFrameSize) {
+        return UART_STATE_IDLE;
+    }
+    
+    if (byTrailer == FRAME_PARSER_CRC32_SIZE) {
+        dwCrc = ((uint32_t)pData[byLength + 1] << 24) | ((uint32_t)pData[byLength + 2] << 16) |
+                ((uint32_t)pData[byLength + 3] << 8) | (uint32_t)pData[byLength + 4];
+        byValid = (Crc32_Compute(&pData[2], byLength - 1) == dwCrc);
+    } else {
+        byValid = (FrameParser_Xor(&pData[2], byLength - 1, CXOR_INIT_VAL) == pData[wFrameSize - 1]);
+    }
+    
+    if (!byValid) {
+        *pwUsed = 1;
+        return UART_STATE_ERROR;
+    }
+    
+    *pwUsed = wFrameSize;
+    
+    return UART_STATE_DATA_RECEIVED;
+}
+
+/**
+ * @func   FrameParser_Init
+ * @brief  Initializes a block parser
+ * @param  pParser: Pointer to the parser
+ * @param  pBuffer: Work buffer
+ * @param  wBufferSize: Size of the work buffer
+ * @param  byMaxLength: Largest Length byte accepted
+ * @retval None
+ */
+void
+FrameParser_Init(
+    frameparser_p pParser,
+    uint8_t *pBuffer,
+    uint16_t wBufferSize,
+    uint8_t byMaxLength
+) {
+    pParser->pBuffer = pBuffer;
+    pParser->wBufferSize = wBufferSize;
+    pParser->wCount = 0;
+    pParser->wHeld = 0;
+    pParser->byMaxLength = byMaxLength;
+    
+    if ((uint16_t)(byMaxLength + FRAME_PARSER_OVERHEAD) > wBufferSize) {
+        pParser->byMaxLength = (uint8_t)(wBufferSize - FRAME_PARSER_OVERHEAD);
+    }
+}
+
+/**
+ * @func   FrameParser_Feed
+ * @brief  Appends received bytes to the parser
+ * @param  pParser: Pointer to the parser
+ * @param  pData: Received bytes
+ * @param  wLength: Number of received bytes
+ * @retval Number of bytes taken
+ */
+uint16_t
+FrameParser_Feed(
+    frameparser_p pParser,
+    const uint8_t *pData,
+    uint16_t wLength
+) {
+    uint16_t wFree;
+    
+    if (pParser->wHeld != 0) {
+        FrameParser_Drop(pParser, pParser->wHeld);
+        pParser->wHeld = 0;
+    }
+    
+    wFree = pParser->wBufferSize - pParser->wCount;
+    
+    if (wLength > wFree) {
+        wLength = wFree;
+    }
+    
+    memcpy(&pParser->pBuffer[pParser->wCount], pData, wLength);
+    pParser->wCount += wLength;
+    
+    return wLength;
+}
+
+/**
+ * @func   FrameParser_Poll
+ * @brief  Returns the next message of the bytes fed so far
+ * @param  pParser: Pointer to the parser
+ * @param  ppFrame: Receives the frame (from its SOF) on UART_STATE_DATA_RECEIVED
+ * @retval UART_STATE_xxx
+ */
+uint8_t
+FrameParser_Poll(
+    frameparser_p pParser,
+    const uint8_t **ppFrame
+) {
+    uint16_t wUsed;
+    uint8_t byState;
+    
+    if (pParser->wHeld != 0) {
+        FrameParser_Drop(pParser, pParser->wHeld);
+        pParser->wHeld = 0;
+    }
+    
+    byState = FrameParser_Parse(pParser->pBuffer, pParser->wCount,
+                                pParser->byMaxLength, &wUsed);
+    
+    if (byState == UART_STATE_DATA_RECEIVED) {
+        /* Kept in the buffer until the caller is done with it */
+        *ppFrame = pParser->pBuffer;
+        pParser->wHeld = wUsed;
+    } else if (wUsed != 0) {
+        FrameParser_Drop(pParser, wUsed);
+    }
+    
+    return byState;
+}
+
+/* END FILE */
@@ -0,0 +1,163 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: Streaming parser for the SOF/length/CXOR serial frames
+ *
+ ******************************************************************************/
+#ifndef _FRAMEPARSER_H_
+#define _FRAMEPARSER_H_
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <stdint.h>
+#include "serial.h"
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+/*!
+ * Frame layout (serial.h):
+ *
+ *   FRAME_SOF | Length | Option | CmdID | Type | Payload | Seq | CXOR
+ *
+ * Length counts the bytes from itself to Seq. CXOR is CXOR_INIT_VAL xor'ed
+ * with every byte from Option to Seq. When Option has CMD_OPT_CRC32 the CXOR
+ * byte is replaced by the CRC-32 (crc32.h) of Option..Seq, high byte first.
+ * FRAME_ACK and FRAME_NACK are sent as single bytes.
+ *
+ * The parser results are the UART_STATE values of serial.h:
+ * UART_STATE_IDLE (more bytes needed), UART_STATE_DATA_RECEIVED,
+ * UART_STATE_ACK_RECEIVED, UART_STATE_NACK_RECEIVED and UART_STATE_ERROR.
+ */
+#define CMD_OPT_CRC32                       0x04
+
+#define FRAME_PARSER_CRC32_SIZE             4
+
+/* Bytes after Seq: CRC-32 or CXOR */
+#define FRAME_PARSER_TRAILER_SIZE(byOption) \
+    (((byOption) & CMD_OPT_CRC32) ? FRAME_PARSER_CRC32_SIZE : 1)
+
+/* SOF and the largest trailer around Length..Seq */
+#define FRAME_PARSER_OVERHEAD               (1 + FRAME_PARSER_CRC32_SIZE)
+
+/*!
+ * Block parser
+ *
+ * Keeps the bytes of an incomplete frame between two FrameParser_Feed calls.
+ * The work buffer must hold byMaxLength + FRAME_PARSER_OVERHEAD bytes.
+ */
+typedef struct __frame_parser__ {
+    
+    uint8_t *pBuffer;       /*< Work buffer */
+    
+    uint16_t wBufferSize;   /*< Size of the work buffer */
+    
+    uint16_t wCount;        /*< Bytes in the work buffer */
+    
+    uint16_t wHeld;         /*< Bytes of the frame returned by the last poll */
+    
+    uint8_t byMaxLength;    /*< Largest Length byte accepted */
+    
+} frameparser_t, *frameparser_p;
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   FrameParser_Xor
+ * @brief  Xor's a block of bytes, a 32-bit word at a time
+ * @param  pData: Bytes to xor
+ * @param  wLength: Number of bytes
+ * @param  byInit: Initial value (CXOR_INIT_VAL for a frame)
+ * @retval byInit xor'ed with every byte of pData
+ */
+uint8_t
+FrameParser_Xor(
+    const uint8_t *pData,
+    uint16_t wLength,
+    uint8_t byInit
+);
+
+/**
+ * @func   FrameParser_Parse
+ * @brief  Parses the message at the start of a contiguous block
+ * @param  pData: Received bytes
+ * @param  wLength: Number of received bytes
+ * @param  byMaxLength: Largest Length byte accepted
+ * @param  pwUsed: Receives the number of bytes the result covers
+ * @retval UART_STATE_xxx
+ * @note   UART_STATE_DATA_RECEIVED: a valid frame starts at pData[0].
+ *         UART_STATE_ERROR: *pwUsed bytes are garbage. After a bad length,
+ *         CXOR or CRC-32 only the SOF is covered, so the bytes that follow are
+ *         scanned again and the next good frame is not lost.
+ *         UART_STATE_IDLE: the message is not complete, *pwUsed is 0.
+ */
+uint8_t
+FrameParser_Parse(
+    const uint8_t *pData,
+    uint16_t wLength,
+    uint8_t byMaxLength,
+    uint16_t *pwUsed
+);
+
+/**
+ * @func   FrameParser_Init
+ * @brief  Initializes a block parser
+ * @param  pParser: Pointer to the parser
+ * @param  pBuffer: Work buffer
+ * @param  wBufferSize: Size of the work buffer
+ * @param  byMaxLength: Largest Length byte accepted
+ * @retval None
+ */
+void
+FrameParser_Init(
+    frameparser_p pParser,
+    uint8_t *pBuffer,
+    uint16_t wBufferSize,
+    uint8_t byMaxLength
+);
+
+/**
+ * @func   FrameParser_Feed
+ * @brief  Appends received bytes to the parser
+ * @param  pParser: Pointer to the parser
+ * @param  pData: Received bytes
+ * @param  wLength: Number of received bytes
+ * @retval Number of bytes taken: call FrameParser_Poll until it returns
+ *         UART_STATE_IDLE, then feed the rest
+ */
+uint16_t
+FrameParser_Feed(
+    frameparser_p pParser,
+    const uint8_t *pData,
+    uint16_t wLength
+);
+
+/**
+ * @func   FrameParser_Poll
+ * @brief  Returns the next message of the bytes fed so far
+ * @param  pParser: Pointer to the parser
+ * @param  ppFrame: Receives the frame (from its SOF) on UART_STATE_DATA_RECEIVED,
+ *         valid until the next call
+ * @retval UART_STATE_xxx
+ */
+uint8_t
+FrameParser_Poll(
+    frameparser_p pParser,
+    const uint8_t **ppFrame
+);
+
+#endif /* END FILE */
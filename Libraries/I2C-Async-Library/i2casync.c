@@ -0,0 +1,332 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: Interrupt-driven I2C master transfers
+ *
+ ******************************************************************************/
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <stddef.h>
+#include "i2casync.h"
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+/* Steps of a transfer */
+#define I2C_ASYNC_IDLE              0u
+#define I2C_ASYNC_WRITE_ADDRESS     1u  /* START sent, address to send */
+#define I2C_ASYNC_WRITE_DATA        2u
+#define I2C_ASYNC_READ_ADDRESS      3u  /* (Repeated) START sent, address to send */
+#define I2C_ASYNC_READ_DATA         4u
+
+#define I2C_ASYNC_IT_ALL            (I2C_CR2_ITEVTEN | I2C_CR2_ITBUFEN | I2C_CR2_ITERREN)
+
+#define I2C_ASYNC_SR1_ERRORS        (I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_AF | \
+                                     I2C_SR1_OVR | I2C_SR1_TIMEOUT)
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+static i2c_async_transfer_t g_i2cTransfer;
+
+static volatile uint8_t g_byI2cStep = I2C_ASYNC_IDLE;
+
+static uint8_t g_byTxIndex;
+
+static uint8_t g_byRxIndex;
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+/**
+ * @func   I2cAsync_Finish
+ * @brief  Ends the transfer and calls its callback
+ * @param  byStatus: Status given to the callback
+ * @retval None
+ */
+static void
+I2cAsync_Finish(
+    uint8_t byStatus
+) {
+    I2C_ASYNC_INSTANCE->CR2 &= (uint16_t)~I2C_ASYNC_IT_ALL;
+    I2C_ASYNC_INSTANCE->CR1 &= (uint16_t)~I2C_CR1_POS;
+    g_byI2cStep = I2C_ASYNC_IDLE;
+
+    if (g_i2cTransfer.callback != NULL) {
+        g_i2cTransfer.callback(byStatus, g_i2cTransfer.pContext);
+    }
+}
+
+/**
+ * @func   I2cAsync_OnAddress
+ * @brief  Address acknowledged: prepares the data phase, then clears ADDR
+ * @param  None
+ * @retval None
+ */
+static void
+I2cAsync_OnAddress(void) {
+    I2C_TypeDef *pI2c = I2C_ASYNC_INSTANCE;
+
+    if (g_byI2cStep == I2C_ASYNC_WRITE_ADDRESS) {
+        g_byI2cStep = I2C_ASYNC_WRITE_DATA;
+        (void)pI2c->SR2;
+        return;
+    }
+
+    g_byI2cStep = I2C_ASYNC_READ_DATA;
+
+    /* The ACK / STOP of the last bytes are set before they arrive (RM0368) */
+    if (g_i2cTransfer.byRxLength == 1) {
+        pI2c->CR1 &= (uint16_t)~I2C_CR1_ACK;
+        (void)pI2c->SR2;
+        pI2c->CR1 |= I2C_CR1_STOP;
+    } else if (g_i2cTransfer.byRxLength == 2) {
+        pI2c->CR1 |= I2C_CR1_POS;
+        pI2c->CR1 &= (uint16_t)~I2C_CR1_ACK;
+        (void)pI2c->SR2;
+        /* Both bytes are taken on BTF */
+        pI2c->CR2 &= (uint16_t)~I2C_CR2_ITBUFEN;
+    } else {
+        pI2c->CR1 |= I2C_CR1_ACK;
+        (void)pI2c->SR2;
+        if (g_i2cTransfer.byRxLength == 3) {
+            pI2c->CR2 &= (uint16_t)~I2C_CR2_ITBUFEN;
+        }
+    }
+}
+
+/**
+ * @func   I2cAsync_OnWrite
+ * @brief  Moves the write phase on (TXE, then BTF after the last byte)
+ * @param  wStatus: SR1
+ * @retval None
+ */
+static void
+I2cAsync_OnWrite(
+    uint16_t wStatus
+) {
+    I2C_TypeDef *pI2c = I2C_ASYNC_INSTANCE;
+
+    if (g_byTxIndex < g_i2cTransfer.byTxLength) {
+        if (wStatus & I2C_SR1_TXE) {
+            pI2c->DR = g_i2cTransfer.pTxData[g_byTxIndex++];
+            if (g_byTxIndex == g_i2cTransfer.byTxLength) {
+                /* Wait for the last byte to leave the shift register */
+                pI2c->CR2 &= (uint16_t)~I2C_CR2_ITBUFEN;
+            }
+        }
+        return;
+    }
+
+    if (!(wStatus & I2C_SR1_BTF)) {
+        return;
+    }
+
+    if (g_i2cTransfer.byRxLength != 0) {
+        /* Repeated START, BTF is cleared once it is sent */
+        g_byI2cStep = I2C_ASYNC_READ_ADDRESS;
+        pI2c->CR1 |= I2C_CR1_ACK;
+        pI2c->CR2 |= I2C_CR2_ITBUFEN;
+        pI2c->CR1 |= I2C_CR1_START;
+    } else {
+        pI2c->CR1 |= I2C_CR1_STOP;
+        I2cAsync_Finish(I2C_ASYNC_OK);
+    }
+}
+
+/**
+ * @func   I2cAsync_OnRead
+ * @brief  Moves the read phase on (RXNE, BTF for the last bytes)
+ * @param  wStatus: SR1
+ * @retval None
+ */
+static void
+I2cAsync_OnRead(
+    uint16_t wStatus
+) {
+    I2C_TypeDef *pI2c = I2C_ASYNC_INSTANCE;
+    uint8_t *pRxData = g_i2cTransfer.pRxData;
+    uint8_t byLeft = g_i2cTransfer.byRxLength - g_byRxIndex;
+
+    if (g_i2cTransfer.byRxLength == 1) {
+        /* NACK and STOP set on ADDR */
+        if (wStatus & I2C_SR1_RXNE) {
+            pRxData[g_byRxIndex++] = (uint8_t)pI2c->DR;
+            I2cAsync_Finish(I2C_ASYNC_OK);
+        }
+    } else if (byLeft > 3) {
+        if (wStatus & I2C_SR1_RXNE) {
+            pRxData[g_byRxIndex++] = (uint8_t)pI2c->DR;
+            if ((byLeft - 1) == 3) {
+                pI2c->CR2 &= (uint16_t)~I2C_CR2_ITBUFEN;
+            }
+        }
+    } else if (wStatus & I2C_SR1_BTF) {
+        if (byLeft == 3) {
+            /* N-2 in DR, N-1 in the shift register: NACK the last one */
+            pI2c->CR1 &= (uint16_t)~I2C_CR1_ACK;
+            pRxData[g_byRxIndex++] = (uint8_t)pI2c->DR;
+        } else {
+            pI2c->CR1 |= I2C_CR1_STOP;
+            pRxData[g_byRxIndex++] = (uint8_t)pI2c->DR;
+            pRxData[g_byRxIndex++] = (uint8_t)pI2c->DR;
+            I2cAsync_Finish(I2C_ASYNC_OK);
+        }
+    }
+}
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   I2cAsync_Init
+ * @brief  Forgets any transfer, after the peripheral is set up
+ * @param  None
+ * @retval None
+ */
+void
+I2cAsync_Init(void) {
+    I2C_ASYNC_INSTANCE->CR2 &= (uint16_t)~I2C_ASYNC_IT_ALL;
+    I2C_ASYNC_INSTANCE->CR1 &= (uint16_t)~I2C_CR1_POS;
+    g_byI2cStep = I2C_ASYNC_IDLE;
+}
+
+/**
+ * @func   I2cAsync_Start
+ * @brief  Starts a transfer
+ * @param  pTransfer: Transfer, copied (not the buffers)
+ * @retval I2C_ASYNC_OK, I2C_ASYNC_BUSY or I2C_ASYNC_INVALID; on I2C_ASYNC_OK
+ *         the callback tells the end
+ */
+uint8_t
+I2cAsync_Start(
+    const i2c_async_transfer_t *pTransfer
+) {
+    I2C_TypeDef *pI2c = I2C_ASYNC_INSTANCE;
+
+    if ((pTransfer->byTxLength == 0) && (pTransfer->byRxLength == 0)) {
+        return I2C_ASYNC_INVALID;
+    }
+
+    if ((g_byI2cStep != I2C_ASYNC_IDLE) || (pI2c->SR2 & I2C_SR2_BUSY)) {
+        return I2C_ASYNC_BUSY;
+    }
+
+    g_i2cTransfer = *pTransfer;
+    g_byTxIndex = 0;
+    g_byRxIndex = 0;
+    g_byI2cStep = (pTransfer->byTxLength != 0) ? I2C_ASYNC_WRITE_ADDRESS :
+                                                 I2C_ASYNC_READ_ADDRESS;
+
+    pI2c->CR1 &= (uint16_t)~I2C_CR1_POS;
+    pI2c->CR1 |= I2C_CR1_ACK;
+    pI2c->CR2 |= I2C_ASYNC_IT_ALL;
+    pI2c->CR1 |= I2C_CR1_START;
+
+    return I2C_ASYNC_OK;
+}
+
+/**
+ * @func   I2cAsync_IsBusy
+ * @brief  Tells whether a transfer is running
+ * @param  None
+ * @retval 1 until the callback of the transfer has been called
+ */
+uint8_t
+I2cAsync_IsBusy(void) {
+    return (g_byI2cStep != I2C_ASYNC_IDLE) ? 1 : 0;
+}
+
+/**
+ * @func   I2cAsync_Abort
+ * @brief  Stops the running transfer with a STOP and calls its callback with
+ *         I2C_ASYNC_ABORTED
+ * @param  None
+ * @retval None
+ */
+void
+I2cAsync_Abort(void) {
+    uint8_t byStep;
+
+    I2C_ASYNC_INSTANCE->CR2 &= (uint16_t)~I2C_ASYNC_IT_ALL;
+
+    /* An interrupt already pending may still end the transfer: the step is
+     * taken atomically, so the callback is called once */
+    byStep = __atomic_exchange_n(&g_byI2cStep, I2C_ASYNC_IDLE, __ATOMIC_RELAXED);
+
+    if (byStep != I2C_ASYNC_IDLE) {
+        I2C_ASYNC_INSTANCE->CR1 |= I2C_CR1_STOP;
+        I2cAsync_Finish(I2C_ASYNC_ABORTED);
+    }
+}
+
+/**
+ * @func   I2C_ASYNC_EV_IRQHandler
+ * @brief  Event interrupt: START sent, address sent, byte sent or received
+ * @param  None
+ * @retval None
+ */
+void
+I2C_ASYNC_EV_IRQHandler(void) {
+    I2C_TypeDef *pI2c = I2C_ASYNC_INSTANCE;
+    uint16_t wStatus = pI2c->SR1;
+
+    switch (g_byI2cStep) {
+    case I2C_ASYNC_WRITE_ADDRESS:
+    case I2C_ASYNC_READ_ADDRESS:
+        /* Reading SR1 then writing DR clears SB, reading SR1 then SR2 ADDR */
+        if (wStatus & I2C_SR1_SB) {
+            pI2c->DR = (uint8_t)((g_i2cTransfer.byAddress << 1) |
+                                 ((g_byI2cStep == I2C_ASYNC_READ_ADDRESS) ? 1 : 0));
+        } else if (wStatus & I2C_SR1_ADDR) {
+            I2cAsync_OnAddress();
+        }
+        break;
+
+    case I2C_ASYNC_WRITE_DATA:
+        I2cAsync_OnWrite(wStatus);
+        break;
+
+    case I2C_ASYNC_READ_DATA:
+        I2cAsync_OnRead(wStatus);
+        break;
+
+    default:
+        /* Not ours (aborted): stop the events */
+        pI2c->CR2 &= (uint16_t)~I2C_ASYNC_IT_ALL;
+        break;
+    }
+}
+
+/**
+ * @func   I2C_ASYNC_ER_IRQHandler
+ * @brief  Error interrupt: ends the transfer with a STOP
+ * @param  None
+ * @retval None
+ */
+void
+I2C_ASYNC_ER_IRQHandler(void) {
+    I2C_TypeDef *pI2c = I2C_ASYNC_INSTANCE;
+    uint16_t wStatus = pI2c->SR1;
+
+    /* Error flags are cleared by writing 0 */
+    pI2c->SR1 = (uint16_t)~(wStatus & I2C_ASYNC_SR1_ERRORS);
+
+    /* After an arbitration loss the bus belongs to another master */
+    if (!(wStatus & I2C_SR1_ARLO)) {
+        pI2c->CR1 |= I2C_CR1_STOP;
+    }
+
+    if (g_byI2cStep == I2C_ASYNC_IDLE) {
+        pI2c->CR2 &= (uint16_t)~I2C_ASYNC_IT_ALL;
+        return;
+    }
+
+    I2cAsync_Finish((wStatus & I2C_SR1_AF) ? I2C_ASYNC_NACK : I2C_ASYNC_BUS_ERROR);
+}
+
+/* END FILE */
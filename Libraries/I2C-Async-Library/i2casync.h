@@ -0,0 +1,130 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: Interrupt-driven I2C master transfers
+ *
+ ******************************************************************************/
+#ifndef _I2CASYNC_H_
+#define _I2CASYNC_H_
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <stdint.h>
+#include "stm32f401re.h"
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+/*!
+ * One transfer at a time on an I2C peripheral already set up by the
+ * application (pins, I2C_Init, I2C_Cmd, NVIC of its event and error
+ * interrupts). A transfer writes bytes, reads bytes, or writes then reads
+ * after a repeated START; I2cAsync_Start returns at once and the event and
+ * error interrupts move it on, so the CPU is free while the bus works.
+ *
+ * The end of the transfer is told by the callback, from the interrupt: keep it
+ * short (set a flag, e.g. for PT_AWAIT_FLAG). The buffers must stay valid until
+ * then. A transfer that never ends (bus held low) is stopped by I2cAsync_Abort
+ * after a timeout of the caller: the callback is then called by I2cAsync_Abort,
+ * with I2C_ASYNC_ABORTED.
+ *
+ * The library defines the interrupt handlers of I2C_ASYNC_INSTANCE.
+ */
+#ifndef I2C_ASYNC_INSTANCE
+#define I2C_ASYNC_INSTANCE          I2C1
+#define I2C_ASYNC_EV_IRQHandler     I2C1_EV_IRQHandler
+#define I2C_ASYNC_ER_IRQHandler     I2C1_ER_IRQHandler
+#endif
+
+/* Status of a transfer */
+#define I2C_ASYNC_OK                0u
+#define I2C_ASYNC_BUSY              1u  /* A transfer is running, or the bus is busy */
+#define I2C_ASYNC_NACK              2u  /* Address or data not acknowledged */
+#define I2C_ASYNC_BUS_ERROR         3u  /* Bus error, arbitration lost, overrun */
+#define I2C_ASYNC_ABORTED           4u  /* Stopped by I2cAsync_Abort */
+#define I2C_ASYNC_INVALID           5u  /* Nothing to write nor read */
+
+/*! @brief End of a transfer, called from the interrupt */
+typedef void (* i2c_async_done_f)(uint8_t byStatus, void *pContext);
+
+/*!
+ * Transfer: writes byTxLength bytes, then reads byRxLength bytes
+ */
+typedef struct __i2c_async_transfer__ {
+
+    uint8_t byAddress;              /*< 7-bit address of the slave */
+
+    const uint8_t *pTxData;
+
+    uint8_t byTxLength;             /*< 0: read only */
+
+    uint8_t *pRxData;
+
+    uint8_t byRxLength;             /*< 0: write only */
+
+    i2c_async_done_f callback;
+
+    void *pContext;                 /*< Given back to the callback */
+
+} i2c_async_transfer_t, *i2c_async_transfer_p;
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   I2cAsync_Init
+ * @brief  Forgets any transfer, after the peripheral is set up
+ * @param  None
+ * @retval None
+ */
+void
+I2cAsync_Init(void);
+
+/**
+ * @func   I2cAsync_Start
+ * @brief  Starts a transfer
+ * @param  pTransfer: Transfer, copied (not the buffers)
+ * @retval I2C_ASYNC_OK, I2C_ASYNC_BUSY or I2C_ASYNC_INVALID; on I2C_ASYNC_OK
+ *         the callback tells the end
+ */
+uint8_t
+I2cAsync_Start(
+    const i2c_async_transfer_t *pTransfer
+);
+
+/**
+ * @func   I2cAsync_IsBusy
+ * @brief  Tells whether a transfer is running
+ * @param  None
+ * @retval 1 until the callback of the transfer has been called
+ */
+uint8_t
+I2cAsync_IsBusy(void);
+
+/**
+ * @func   I2cAsync_Abort
+ * @brief  Stops the running transfer with a STOP and calls its callback with
+ *         I2C_ASYNC_ABORTED
+ * @param  None
+ * @retval None
+ * @note   Nothing is called if the transfer has already ended
+ */
+void
+I2cAsync_Abort(void);
+
+#endif /* _I2CASYNC_H_ */
+
+/* END FILE */
@@ -0,0 +1,174 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: Stackless coroutines (protothreads) for multi-step sequences
+ *
+ ******************************************************************************/
+#ifndef _PROTOTHREAD_H_
+#define _PROTOTHREAD_H_
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <stdint.h>
+#include "timer.h"
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+/*!
+ * A protothread is a function called again and again from the main loop
+ * that returns wherever it has to wait, and carries on from that point on
+ * the next call. Only the resume point (the source line of the wait) and
+ * the start of the current PT_AWAIT_MS are kept, in a pt_t: a sequence that
+ * used to block in delay_ms lets the rest of the loop run during its waits.
+ *
+ * Example:
+ *     static pt_t g_ptBlink;
+ *
+ *     static PT_THREAD(Thread_Blink (pt_t *pt))
+ *     {
+ *         PT_BEGIN(pt);
+ *         while (1)
+ *         {
+ *             LedOn();
+ *             PT_AWAIT_MS(pt, 100);
+ *             LedOff();
+ *             PT_AWAIT_FLAG(pt, g_byButtonPressed);
+ *         }
+ *         PT_END(pt);
+ *     }
+ *
+ *     PT_INIT(&g_ptBlink);
+ *     while (1) { processTimerScheduler(); Thread_Blink(&g_ptBlink); }
+ *
+ * The body is a switch statement on the resume point, so:
+ * - local variables lose their value across a wait: keep them static or in
+ *   a structure that holds the pt_t;
+ * - the body must not contain a switch statement waiting inside its cases;
+ * - two waits cannot share a source line.
+ *
+ * Waits rely on GetMilSecTick of the SDK timer (or of Timer-Wheel-Library)
+ * and are wrap-safe: only elapsed times (now - start) are compared.
+ */
+#define PT_WAITING                  0u  /* Blocked in a wait */
+#define PT_YIELDED                  1u  /* Gave the CPU back, runnable */
+#define PT_EXITED                   2u  /* Left with PT_EXIT */
+#define PT_ENDED                    3u  /* Reached PT_END */
+
+/* Resume points are case labels reached from the code above them */
+#if defined(__GNUC__) && (__GNUC__ >= 7)
+#define PT_FALLTHROUGH              __attribute__((fallthrough))
+#else
+#define PT_FALLTHROUGH              ((void)0)
+#endif
+
+/*!
+ * Protothread state
+ */
+typedef struct __pt__ {
+
+    uint16_t wResume;       /*< Source line to resume from, 0 at the start */
+
+    uint32_t dwWaitStart;   /*< Tick the current PT_AWAIT_MS started at */
+
+} pt_t, *pt_p;
+
+/*! @brief Declares a protothread function */
+#define PT_THREAD(declaration)      uint8_t declaration
+
+/*! @brief Starts (or restarts) a protothread from its beginning */
+#define PT_INIT(pt)                 ((pt)->wResume = 0)
+
+/*! @brief Opens the body of a protothread */
+#define PT_BEGIN(pt)                                                           \
+    {                                                                          \
+        uint8_t byPtYield = 1;                                                 \
+        (void)byPtYield;                                                       \
+        switch ((pt)->wResume) {                                               \
+        case 0:
+
+/*! @brief Closes the body of a protothread, which then starts over */
+#define PT_END(pt)                                                             \
+        }                                                                      \
+        PT_INIT(pt);                                                           \
+        return PT_ENDED;                                                       \
+    }
+
+/*! @brief Returns here until cond is true */
+#define PT_WAIT_UNTIL(pt, cond)                                                \
+    do {                                                                       \
+        (pt)->wResume = __LINE__;                                              \
+        PT_FALLTHROUGH;                                                        \
+        case __LINE__:                                                         \
+        if (!(cond)) {                                                         \
+            return PT_WAITING;                                                 \
+        }                                                                      \
+    } while (0)
+
+/*! @brief Returns here while cond is true */
+#define PT_WAIT_WHILE(pt, cond)     PT_WAIT_UNTIL(pt, !(cond))
+
+/*! @brief Returns here for dwMs milliseconds of the SDK timer */
+#define PT_AWAIT_MS(pt, dwMs)                                                  \
+    do {                                                                       \
+        (pt)->dwWaitStart = GetMilSecTick();                                   \
+        PT_WAIT_UNTIL(pt, (uint32_t)(GetMilSecTick() - (pt)->dwWaitStart) >=   \
+                          (uint32_t)(dwMs));                                   \
+    } while (0)
+
+/*! @brief Returns here until flag is set (e.g. by an interrupt), then clears it */
+#define PT_AWAIT_FLAG(pt, flag)                                                \
+    do {                                                                       \
+        PT_WAIT_UNTIL(pt, (flag) != 0);                                        \
+        (flag) = 0;                                                            \
+    } while (0)
+
+/*! @brief Gives the CPU back once, and carries on at the next call */
+#define PT_YIELD(pt)                                                           \
+    do {                                                                       \
+        byPtYield = 0;                                                         \
+        (pt)->wResume = __LINE__;                                              \
+        PT_FALLTHROUGH;                                                        \
+        case __LINE__:                                                         \
+        if (byPtYield == 0) {                                                  \
+            return PT_YIELDED;                                                 \
+        }                                                                      \
+    } while (0)
+
+/*! @brief Runs a child protothread to its end, returning here meanwhile */
+#define PT_SPAWN(pt, child, thread)                                            \
+    do {                                                                       \
+        PT_INIT(child);                                                        \
+        PT_WAIT_UNTIL(pt, (thread) >= PT_EXITED);                              \
+    } while (0)
+
+/*! @brief Leaves the protothread, which starts over at the next call */
+#define PT_EXIT(pt)                                                            \
+    do {                                                                       \
+        PT_INIT(pt);                                                           \
+        return PT_EXITED;                                                      \
+    } while (0)
+
+/*! @brief Calls a protothread, true while it has not ended */
+#define PT_SCHEDULE(thread)         ((thread) < PT_EXITED)
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+
+#endif /* _PROTOTHREAD_H_ */
+
+/* END FILE */
@@ -22,6 +22,13 @@
 /******************************************************************************/
 /*                     EXPORTED TYPES and DEFINITIONS                         */
 /******************************************************************************/
+/* The index written by the other side is read with acquire semantics and the
+ * own index is published with release semantics, so the data copied into (or
+ * out of) the storage is visible before the index that hands it over. On the
+ * Cortex-M4 this is a plain halfword access plus a DMB. */
+#define QUEUE_LOAD_OWN(p)              __atomic_load_n((p), __ATOMIC_RELAXED)
+#define QUEUE_LOAD_OTHER(p)            __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define QUEUE_PUBLISH(p, v)            __atomic_store_n((p), (v), __ATOMIC_RELEASE)
 /******************************************************************************/
 /*                              PRIVATE DATA                                  */
 /******************************************************************************/
@@ -31,6 +38,107 @@
 /******************************************************************************/
 /*                            PRIVATE FUNCTIONS                               */
 /******************************************************************************/
+/**
+ * @func   bufCopyIn
+ * @brief  Copies bytes into the storage, splitting at the wrap point
+ * @param  pQueue: Pointer to the FIFO object
+ * @param  wIndex: Free-running index of the first byte
+ * @param  pSrc: Source data
+ * @param  wLength: Number of bytes
+ * @retval None
+ */
+static void
+bufCopyIn(
+    buffqueue_p pQueue,
+    uint16_t wIndex,
+    const uint8_t *pSrc,
+    uint16_t wLength
+) {
+    uint16_t wOffset = wIndex & (pQueue->wBufferSize - 1);
+    uint16_t wFirst = pQueue->wBufferSize - wOffset;
+    
+    if (wFirst >= wLength) {
+        memcpy(&pQueue->pData[wOffset], pSrc, wLength);
+    } else {
+        memcpy(&pQueue->pData[wOffset], pSrc, wFirst);
+        memcpy(pQueue->pData, &pSrc[wFirst], wLength - wFirst);
+    }
+}
+
+/**
+ * @func   bufRecordPush
+ * @brief  Updates the counters after items have been published
+ * @param  pQueue: Pointer to the FIFO object
+ * @param  wHead: Head index just published
+ * @param  wNumItems: Number of items added
+ * @retval None
+ */
+static void
+bufRecordPush(
+    buffqueue_p pQueue,
+    uint16_t wHead,
+    uint16_t wNumItems
+) {
+    buffqueue_stats_p pStats = pQueue->pStats;
+    uint16_t wItems;
+    
+    if (pStats == NULL) {
+        return;
+    }
+    
+    wItems = (uint16_t)(wHead - QUEUE_LOAD_OTHER(&pQueue->wTailIndex)) /
+             pQueue->byItemSize;
+    
+    pStats->dwTotalItems += wNumItems;
+    
+    if (wItems > pStats->wPeakItems) {
+        pStats->wPeakItems = wItems;
+    }
+}
+
+/**
+ * @func   bufRecordDrop
+ * @brief  Counts items lost or refused because the FIFO was full
+ * @param  pQueue: Pointer to the FIFO object
+ * @param  wNumItems: Number of items
+ * @retval None
+ */
+static void
+bufRecordDrop(
+    buffqueue_p pQueue,
+    uint16_t wNumItems
+) {
+    if (pQueue->pStats != NULL) {
+        pQueue->pStats->dwOverflowDrops += wNumItems;
+    }
+}
+
+/**
+ * @func   bufCopyOut
+ * @brief  Copies bytes out of the storage, splitting at the wrap point
+ * @param  pQueue: Pointer to the FIFO object
+ * @param  wIndex: Free-running index of the first byte
+ * @param  pDst: Destination buffer
+ * @param  wLength: Number of bytes
+ * @retval None
+ */
+static void
+bufCopyOut(
+    buffqueue_p pQueue,
+    uint16_t wIndex,
+    uint8_t *pDst,
+    uint16_t wLength
+) {
+    uint16_t wOffset = wIndex & (pQueue->wBufferSize - 1);
+    uint16_t wFirst = pQueue->wBufferSize - wOffset;
+    
+    if (wFirst >= wLength) {
+        memcpy(pDst, &pQueue->pData[wOffset], wLength);
+    } else {
+        memcpy(pDst, &pQueue->pData[wOffset], wFirst);
+        memcpy(&pDst[wFirst], pQueue->pData, wLength - wFirst);
+    }
+}
 /******************************************************************************/
 /*                            EXPORTED FUNCTIONS                              */
 /******************************************************************************/
@@ -40,7 +148,7 @@
  * @param  pBuffer: Data to be pushed into the FIFO
  * @param  pQueue: Pointer to the FIFO object
  * @param  sizeofElement: Size of a element in the buffer
- * @param  numberOfElement: Size of the buffer
+ * @param  numberOfElement: Size of the buffer in bytes (power of two)
  * @retval None
  */
 void
@@ -52,10 +160,46 @@ bufInit(
 ) {
     pQueue->wBufferSize = numberOfElement;
     pQueue->byItemSize = sizeofElement;
+    pQueue->byPolicy = QUEUE_POLICY_REJECT;
     pQueue->pData = (uint8_t *)pBuffer;
+    pQueue->pStats = NULL;
     bufFlush(pQueue);
 }
 
+/**
+ * @func   bufSetPolicy
+ * @brief  Selects what a push does when the FIFO is full
+ * @param  pQueue: Pointer to the FIFO object
+ * @param  byPolicy: QUEUE_POLICY_xxx
+ * @retval None
+ */
+void
+bufSetPolicy(
+    buffqueue_p pQueue,
+    uint8_t byPolicy
+) {
+    pQueue->byPolicy = byPolicy;
+}
+
+/**
+ * @func   bufAttachStats
+ * @brief  Attaches (and clears) counters to the FIFO
+ * @param  pQueue: Pointer to the FIFO object
+ * @param  pStats: Counters to update, NULL to detach
+ * @retval None
+ */
+void
+bufAttachStats(
+    buffqueue_p pQueue,
+    buffqueue_stats_p pStats
+) {
+    if (pStats != NULL) {
+        memset(pStats, 0, sizeof(buffqueue_stats_t));
+    }
+    
+    pQueue->pStats = pStats;
+}
+
 /**
  * @func   bufNumItems
  * @brief  Returns the number of items in a ring buffer
@@ -66,20 +210,26 @@ uint16_t
 bufNumItems(
 	  buffqueue_p pQueue
 ) {
-    return pQueue->wCountElement;
+    uint16_t wUsed = (uint16_t)(QUEUE_LOAD_OTHER(&pQueue->wHeadIndex) -
+                                QUEUE_LOAD_OTHER(&pQueue->wTailIndex));
+    
+    return (pQueue->byItemSize == 1) ? wUsed : (wUsed / pQueue->byItemSize);
 }
 
 /**
  * @func   bufIsFull
  * @brief  Returns whether a ring buffer is full
  * @param  pQueue The buffer for which it should be returned whether it is full.
- * @return 1 if full; 0 otherwise
+ * @return 1 if there is no room for one more item; 0 otherwise
  */
 uint8_t
 bufIsFull(
     buffqueue_p pQueue
 ) {
-    return (pQueue->wCountElement > (pQueue->wBufferSize / pQueue->byItemSize));
+    uint16_t wUsed = (uint16_t)(QUEUE_LOAD_OTHER(&pQueue->wHeadIndex) -
+                                QUEUE_LOAD_OTHER(&pQueue->wTailIndex));
+    
+    return ((pQueue->wBufferSize - wUsed) < pQueue->byItemSize) ? 1 : 0;
 }
 
 /**
@@ -92,7 +242,8 @@ uint8_t
 bufIsEmpty(
     buffqueue_p pQueue
 ) {
-    return (pQueue->wCountElement == 0) ? 1 : 0;
+    return (QUEUE_LOAD_OTHER(&pQueue->wHeadIndex) ==
+            QUEUE_LOAD_OTHER(&pQueue->wTailIndex)) ? 1 : 0;
 }
 
 /**
@@ -107,7 +258,6 @@ bufFlush(
 ) {
     pQueue->wHeadIndex = 0;
     pQueue->wTailIndex = 0;
-    pQueue->wCountElement = 0;
     
     memset(pQueue->pData, 0, pQueue->wBufferSize);
 }
@@ -117,29 +267,43 @@ bufFlush(
  * @brief  Pushes data to the FIFO
  * @param  pQueue: Pointer to the FIFO object
  * @param  pReceiverData: Received data to be pushed into the FIFO
- * @retval ERR_OK or ERR_BUF_FUL
+ * @retval ERR_BUF_FULL if full and the policy is QUEUE_POLICY_REJECT,
+ *         ERR_OK otherwise
  */
 uint8_t
 bufEnDat(
     buffqueue_p pQueue,
     uint8_t* pReceiverData
 ) {
-	uint8_t i;
-	
-    /* Place data in buffer */
-    for (i = 0; i < pQueue->byItemSize; i++) {
-        pQueue->pData[pQueue->wHeadIndex] = pReceiverData[i];
-        pQueue->wHeadIndex = ((pQueue->wHeadIndex + 1)  & (pQueue->wBufferSize - 1));
-        pQueue->wCountElement++;
+    uint16_t wHead = QUEUE_LOAD_OWN(&pQueue->wHeadIndex);
+    uint16_t wTail = QUEUE_LOAD_OTHER(&pQueue->wTailIndex);
+    
+    if ((pQueue->wBufferSize - (uint16_t)(wHead - wTail)) < pQueue->byItemSize) {
+        bufRecordDrop(pQueue, 1);
+        
+        if (pQueue->byPolicy == QUEUE_POLICY_REJECT) {
+            return ERR_BUF_FULL;
+        }
+        
+        if (pQueue->byPolicy == QUEUE_POLICY_DROP_NEWEST) {
+            return ERR_OK;
+        }
+        
+        /* QUEUE_POLICY_DROP_OLDEST: make room by discarding the oldest item */
+        QUEUE_PUBLISH(&pQueue->wTailIndex, (uint16_t)(wTail + pQueue->byItemSize));
     }
     
-    if (bufIsFull(pQueue)) {
-        /* Is going to overwrite the oldest byte */
-        /* Increase tail index */
-        pQueue->wCountElement = (pQueue->wBufferSize / pQueue->byItemSize);
-        pQueue->wTailIndex = (pQueue->wTailIndex + pQueue->byItemSize) & (pQueue->wBufferSize - 1);
+    /* Place data in buffer */
+    if (pQueue->byItemSize == 1) {
+        pQueue->pData[wHead & (pQueue->wBufferSize - 1)] = *pReceiverData;
+    } else {
+        bufCopyIn(pQueue, wHead, pReceiverData, pQueue->byItemSize);
     }
     
+    wHead = (uint16_t)(wHead + pQueue->byItemSize);
+    QUEUE_PUBLISH(&pQueue->wHeadIndex, wHead);
+    bufRecordPush(pQueue, wHead, 1);
+    
     return ERR_OK;
 }
 
@@ -155,20 +319,198 @@ bufDeDat(
     buffqueue_p pQueue,
     uint8_t *pBuffer
 ) {
-    uint8_t i;
+    uint16_t wTail = QUEUE_LOAD_OWN(&pQueue->wTailIndex);
+    uint16_t wUsed = (uint16_t)(QUEUE_LOAD_OTHER(&pQueue->wHeadIndex) - wTail);
     
-    if (bufIsEmpty(pQueue)) {
+    if (wUsed < pQueue->byItemSize) {
         /* No items */
         return ERR_BUF_EMPTY;
     }
     
-    for (i = 0; i < pQueue->byItemSize; i++) {
-        pBuffer[i] = pQueue->pData[pQueue->wTailIndex];
-        pQueue->wTailIndex = ((pQueue->wTailIndex + 1) & (pQueue->wBufferSize - 1));
-        pQueue->wCountElement--;
+    if (pQueue->byItemSize == 1) {
+        *pBuffer = pQueue->pData[wTail & (pQueue->wBufferSize - 1)];
+    } else {
+        bufCopyOut(pQueue, wTail, pBuffer, pQueue->byItemSize);
     }
     
+    QUEUE_PUBLISH(&pQueue->wTailIndex, (uint16_t)(wTail + pQueue->byItemSize));
+    
     return ERR_OK;
 }
 
+/**
+ * @func   bufWrite
+ * @brief  Pushes up to wNumItems items to the FIFO with at most two copies
+ * @param  pQueue: Pointer to the FIFO object
+ * @param  pData: Items to be pushed into the FIFO
+ * @param  wNumItems: Number of items in pData
+ * @retval Number of items taken from pData: the items queued with
+ *         QUEUE_POLICY_REJECT, wNumItems with the other policies
+ */
+uint16_t
+bufWrite(
+    buffqueue_p pQueue,
+    const void *pData,
+    uint16_t wNumItems
+) {
+    uint16_t wHead = QUEUE_LOAD_OWN(&pQueue->wHeadIndex);
+    uint16_t wFree = pQueue->wBufferSize -
+                     (uint16_t)(wHead - QUEUE_LOAD_OTHER(&pQueue->wTailIndex));
+    uint16_t wFreeItems = (pQueue->byItemSize == 1) ? wFree : (wFree / pQueue->byItemSize);
+    uint16_t wCount = wNumItems;
+    uint16_t wLength;
+    uint16_t i;
+    
+    if (wCount > wFreeItems) {
+        if (pQueue->byPolicy == QUEUE_POLICY_DROP_OLDEST) {
+            /* Rare path: let bufEnDat discard the oldest items one by one */
+            for (i = 0; i < wNumItems; i++) {
+                bufEnDat(pQueue, (uint8_t *)pData + (i * pQueue->byItemSize));
+            }
+            
+            return wNumItems;
+        }
+        
+        bufRecordDrop(pQueue, (uint16_t)(wCount - wFreeItems));
+        wCount = wFreeItems;
+    }
+    
+    if (wCount != 0) {
+        wLength = (uint16_t)(wCount * pQueue->byItemSize);
+        bufCopyIn(pQueue, wHead, (const uint8_t *)pData, wLength);
+        wHead = (uint16_t)(wHead + wLength);
+        QUEUE_PUBLISH(&pQueue->wHeadIndex, wHead);
+        bufRecordPush(pQueue, wHead, wCount);
+    }
+    
+    return (pQueue->byPolicy == QUEUE_POLICY_REJECT) ? wCount : wNumItems;
+}
+
+/**
+ * @func   bufRead
+ * @brief  Pops up to wNumItems items from the FIFO with at most two copies
+ * @param  pQueue: Pointer to the FIFO object
+ * @param  pBuffer: Buffer receiving the popped items
+ * @param  wNumItems: Maximum number of items to pop
+ * @retval Number of items actually popped
+ */
+uint16_t
+bufRead(
+    buffqueue_p pQueue,
+    void *pBuffer,
+    uint16_t wNumItems
+) {
+    uint16_t wTail = QUEUE_LOAD_OWN(&pQueue->wTailIndex);
+    uint16_t wUsed = (uint16_t)(QUEUE_LOAD_OTHER(&pQueue->wHeadIndex) - wTail);
+    uint16_t wUsedItems = (pQueue->byItemSize == 1) ? wUsed : (wUsed / pQueue->byItemSize);
+    uint16_t wLength;
+    
+    if (wNumItems > wUsedItems) {
+        wNumItems = wUsedItems;
+    }
+    
+    if (wNumItems == 0) {
+        return 0;
+    }
+    
+    wLength = (uint16_t)(wNumItems * pQueue->byItemSize);
+    bufCopyOut(pQueue, wTail, (uint8_t *)pBuffer, wLength);
+    QUEUE_PUBLISH(&pQueue->wTailIndex, (uint16_t)(wTail + wLength));
+    
+    return wNumItems;
+}
+
+/**
+ * @func   bufPeekContiguous
+ * @brief  Returns the oldest queued bytes in place, up to the wrap point
+ * @param  pQueue: Pointer to the FIFO object
+ * @param  pwLength: Receives the number of contiguous bytes at the pointer
+ * @retval Pointer into the queue storage, valid until bufConsume
+ */
+uint8_t *
+bufPeekContiguous(
+    buffqueue_p pQueue,
+    uint16_t *pwLength
+) {
+    uint16_t wTail = QUEUE_LOAD_OWN(&pQueue->wTailIndex);
+    uint16_t wUsed = (uint16_t)(QUEUE_LOAD_OTHER(&pQueue->wHeadIndex) - wTail);
+    uint16_t wOffset = wTail & (pQueue->wBufferSize - 1);
+    uint16_t wFirst = pQueue->wBufferSize - wOffset;
+    
+    *pwLength = (wUsed < wFirst) ? wUsed : wFirst;
+    
+    return &pQueue->pData[wOffset];
+}
+
+/**
+ * @func   bufConsume
+ * @brief  Releases bytes returned by bufPeekContiguous
+ * @param  pQueue: Pointer to the FIFO object
+ * @param  wLength: Number of bytes to release
+ * @retval None
+ */
+void
+bufConsume(
+    buffqueue_p pQueue,
+    uint16_t wLength
+) {
+    uint16_t wTail = QUEUE_LOAD_OWN(&pQueue->wTailIndex);
+    uint16_t wUsed = (uint16_t)(QUEUE_LOAD_OTHER(&pQueue->wHeadIndex) - wTail);
+    
+    if (wLength > wUsed) {
+        wLength = wUsed;
+    }
+    
+    QUEUE_PUBLISH(&pQueue->wTailIndex, (uint16_t)(wTail + wLength));
+}
+
+/**
+ * @func   bufReserve
+ * @brief  Returns the free space after the newest byte in place, up to the
+ *         wrap point
+ * @param  pQueue: Pointer to the FIFO object
+ * @param  pwLength: Receives the number of contiguous free bytes
+ * @retval Pointer into the queue storage, valid until bufCommit
+ */
+uint8_t *
+bufReserve(
+    buffqueue_p pQueue,
+    uint16_t *pwLength
+) {
+    uint16_t wHead = QUEUE_LOAD_OWN(&pQueue->wHeadIndex);
+    uint16_t wFree = pQueue->wBufferSize -
+                     (uint16_t)(wHead - QUEUE_LOAD_OTHER(&pQueue->wTailIndex));
+    uint16_t wOffset = wHead & (pQueue->wBufferSize - 1);
+    uint16_t wFirst = pQueue->wBufferSize - wOffset;
+    
+    *pwLength = (wFree < wFirst) ? wFree : wFirst;
+    
+    return &pQueue->pData[wOffset];
+}
+
+/**
+ * @func   bufCommit
+ * @brief  Publishes bytes written into the space given by bufReserve
+ * @param  pQueue: Pointer to the FIFO object
+ * @param  wLength: Number of bytes written
+ * @retval None
+ */
+void
+bufCommit(
+    buffqueue_p pQueue,
+    uint16_t wLength
+) {
+    uint16_t wHead = QUEUE_LOAD_OWN(&pQueue->wHeadIndex);
+    uint16_t wFree = pQueue->wBufferSize -
+                     (uint16_t)(wHead - QUEUE_LOAD_OTHER(&pQueue->wTailIndex));
+    
+    if (wLength > wFree) {
+        wLength = wFree;
+    }
+    
+    wHead = (uint16_t)(wHead + wLength);
+    QUEUE_PUBLISH(&pQueue->wHeadIndex, wHead);
+    bufRecordPush(pQueue, wHead, wLength / pQueue->byItemSize);
+}
+
 /* END FILE */
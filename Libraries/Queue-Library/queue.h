@@ -27,27 +27,64 @@
 #define ERR_OK                         0x00 
 #define ERR_BUF_FULL                   0x01
 #define ERR_BUF_EMPTY                  0x02     
+
+/* Overflow policies, applied when an item is pushed to a full FIFO */
+#define QUEUE_POLICY_REJECT            0x00 /* Keep the queue, return ERR_BUF_FULL */
+#define QUEUE_POLICY_DROP_NEWEST       0x01 /* Keep the queue, discard the new item */
+#define QUEUE_POLICY_DROP_OLDEST       0x02 /* Discard the oldest item, see bufSetPolicy */
 /******************************************************************************/
 /*                              PRIVATE DATA                                  */
 /******************************************************************************/
 /*!
  * FIFO structure
+ *
+ * Single-producer/single-consumer ring buffer: the producer (e.g. an UART
+ * interrupt) only ever writes wHeadIndex, the consumer (the main loop) only
+ * ever writes wTailIndex. Both indexes are free-running byte counters that are
+ * masked on access, so the fill level is (wHeadIndex - wTailIndex) and no
+ * counter is shared between the two sides. The buffer size must be a power of
+ * two and not larger than 32768 bytes.
+ *
+ * The layout fits in the 16 bytes the prebuilt SDK objects reserve for their
+ * own buffqueue_t, so this library can be linked in place of the SDK buff.
+ * Projects that do so define USE_QUEUE_LIBRARY, which makes the SDK buff.h
+ * include this header instead of its own definition.
  */
 typedef struct __buff_queue__ {
     
-    uint16_t wBufferSize;      /*< Size of buffer */
+    uint16_t wBufferSize;      /*< Size of buffer in bytes (power of two) */
     
-    uint16_t wCountElement;  /*< Count element */
+    uint16_t wHeadIndex; /*< Free-running write index, owned by the producer */
     
-    uint8_t byItemSize; /*< The size of each items that the queue will hold. */
+    uint16_t wTailIndex; /*< Free-running read index, owned by the consumer */
     
-    uint16_t wHeadIndex; /*< Points to the beginning of the queue storage area. */
+    uint8_t byItemSize; /*< The size of each items that the queue will hold. */
     
-    uint16_t wTailIndex; /*< Points to the byte at the end of the queue storage area */
+    uint8_t byPolicy;   /*< Overflow policy, QUEUE_POLICY_xxx */
     
     uint8_t *pData;    /*< Data memory */
     
+    struct __buff_queue_stats__ *pStats; /*< Optional counters, NULL if none */
+    
 } buffqueue_t, *buffqueue_p;
+
+/*!
+ * FIFO counters
+ *
+ * Updated by the producer side only. Attach one with bufAttachStats and read
+ * it back (debugger, diagnostics command) to size a queue from measurements.
+ */
+typedef struct __buff_queue_stats__ {
+    
+    uint16_t wPeakItems;      /*< Highest number of items queued at once */
+    
+    uint16_t wReserved;       /*< Padding */
+    
+    uint32_t dwTotalItems;    /*< Items accepted into the queue */
+    
+    uint32_t dwOverflowDrops; /*< Items discarded or refused on overflow */
+    
+} buffqueue_stats_t, *buffqueue_stats_p;
 /******************************************************************************/
 /*                              EXPORTED DATA                                 */
 /******************************************************************************/
@@ -65,7 +102,7 @@ typedef struct __buff_queue__ {
  * @param  pBuffer: Data to be pushed into the FIFO
  * @param  pQueue: Pointer to the FIFO object
  * @param  sizeofElement: Size of a element in the buffer
- * @param  numberOfElement: Size of the buffer
+ * @param  numberOfElement: Size of the buffer in bytes (power of two)
  * @retval None
  */
 void
@@ -77,10 +114,40 @@ bufInit(
 );
 
 /**
- * @func   bufNumEle
- * @brief  Determine number of bytes in FIFO has not been processed
+ * @func   bufSetPolicy
+ * @brief  Selects what a push does when the FIFO is full
  * @param  pQueue: Pointer to the FIFO object
- * @retval Number of bytes in FIFO
+ * @param  byPolicy: QUEUE_POLICY_REJECT (default), QUEUE_POLICY_DROP_NEWEST
+ *         or QUEUE_POLICY_DROP_OLDEST
+ * @retval None
+ * @note   QUEUE_POLICY_DROP_OLDEST makes the producer move wTailIndex, so it
+ *         is not lock-free: use it only when the consumer cannot run during
+ *         a push (same context, or the consumer masks the producer's IRQ).
+ */
+void
+bufSetPolicy(
+    buffqueue_p pQueue,
+    uint8_t byPolicy
+);
+
+/**
+ * @func   bufAttachStats
+ * @brief  Attaches (and clears) counters to the FIFO
+ * @param  pQueue: Pointer to the FIFO object
+ * @param  pStats: Counters to update, NULL to detach
+ * @retval None
+ */
+void
+bufAttachStats(
+    buffqueue_p pQueue,
+    buffqueue_stats_p pStats
+);
+
+/**
+ * @func   bufNumItems
+ * @brief  Determine number of items in FIFO has not been processed
+ * @param  pQueue: Pointer to the FIFO object
+ * @retval Number of items in FIFO
  */
 uint16_t 
 bufNumItems(
@@ -114,6 +181,7 @@ bufIsEmpty(
  * @brief  Flushes the FIFO
  * @param  pQueue: Pointer to the FIFO object
  * @retval None
+ * @note   Not safe while the producer or the consumer is running
  */
 void
 bufFlush(
@@ -122,12 +190,13 @@ bufFlush(
 
 /**
  * @func   bufEnDat
- * @brief  Pushes data to the FIFO
+ * @brief  Pushes data to the FIFO (producer side)
  * @param  pQueue: Pointer to the FIFO object
  * @param  pReceiverData: Received data to be pushed into the FIFO
- * @retval ERR_OK or ERR_BUF_FUL
+ * @retval ERR_BUF_FULL if full and the policy is QUEUE_POLICY_REJECT,
+ *         ERR_OK otherwise
  */
-uint8_t 
+uint8_t
 bufEnDat(
     buffqueue_p pQueue,
     uint8_t *pReceiverData
@@ -135,7 +204,7 @@ bufEnDat(
 
 /**
  * @func   bufDeDat
- * @brief  Pops data from the FIFO
+ * @brief  Pops data from the FIFO (consumer side)
  * @param  pQueue: Pointer to the FIFO object
  * @param  pBuffer: Data in the FIFO popped into the buffer
  * @retval ERR_OK or ERR_BUF_EMPTY
@@ -146,4 +215,90 @@ bufDeDat(
     uint8_t *pBuffer
 );
 
+/**
+ * @func   bufWrite
+ * @brief  Pushes up to wNumItems items to the FIFO (producer side)
+ * @param  pQueue: Pointer to the FIFO object
+ * @param  pData: Items to be pushed into the FIFO
+ * @param  wNumItems: Number of items in pData
+ * @retval Number of items taken from pData: the items queued with
+ *         QUEUE_POLICY_REJECT, wNumItems with the other policies
+ */
+uint16_t
+bufWrite(
+    buffqueue_p pQueue,
+    const void *pData,
+    uint16_t wNumItems
+);
+
+/**
+ * @func   bufRead
+ * @brief  Pops up to wNumItems items from the FIFO (consumer side)
+ * @param  pQueue: Pointer to the FIFO object
+ * @param  pBuffer: Buffer receiving the popped items
+ * @param  wNumItems: Maximum number of items to pop
+ * @retval Number of items actually popped
+ */
+uint16_t
+bufRead(
+    buffqueue_p pQueue,
+    void *pBuffer,
+    uint16_t wNumItems
+);
+
+/**
+ * @func   bufPeekContiguous
+ * @brief  Returns the oldest queued bytes in place, up to the wrap point
+ *         (consumer side)
+ * @param  pQueue: Pointer to the FIFO object
+ * @param  pwLength: Receives the number of contiguous bytes at the pointer
+ * @retval Pointer into the queue storage, valid until bufConsume
+ */
+uint8_t *
+bufPeekContiguous(
+    buffqueue_p pQueue,
+    uint16_t *pwLength
+);
+
+/**
+ * @func   bufConsume
+ * @brief  Releases bytes returned by bufPeekContiguous (consumer side)
+ * @param  pQueue: Pointer to the FIFO object
+ * @param  wLength: Number of bytes to release
+ * @retval None
+ */
+void
+bufConsume(
+    buffqueue_p pQueue,
+    uint16_t wLength
+);
+
+/**
+ * @func   bufReserve
+ * @brief  Returns the free space after the newest byte in place, up to the
+ *         wrap point (producer side)
+ * @param  pQueue: Pointer to the FIFO object
+ * @param  pwLength: Receives the number of contiguous free bytes
+ * @retval Pointer into the queue storage, valid until bufCommit
+ */
+uint8_t *
+bufReserve(
+    buffqueue_p pQueue,
+    uint16_t *pwLength
+);
+
+/**
+ * @func   bufCommit
+ * @brief  Publishes bytes written into the space given by bufReserve
+ *         (producer side)
+ * @param  pQueue: Pointer to the FIFO object
+ * @param  wLength: Number of bytes written
+ * @retval None
+ */
+void
+bufCommit(
+    buffqueue_p pQueue,
+    uint16_t wLength
+);
+
 #endif /* END FILE */
@@ -0,0 +1,182 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: Typed ring buffer queue generated at compile time
+ *
+ ******************************************************************************/
+#ifndef _TYPED_QUEUE_H_
+#define _TYPED_QUEUE_H_
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <stdint.h>
+#include <stddef.h>
+#include "queue.h"
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+/* Also usable from the C++ tools built on the PC */
+#ifdef __cplusplus
+#define TYPED_QUEUE_STATIC_ASSERT       static_assert
+#else
+#define TYPED_QUEUE_STATIC_ASSERT       _Static_assert
+#endif
+
+/*!
+ * DECLARE_QUEUE(name, type, capacity)
+ *
+ * Generates a single-producer/single-consumer queue of 'capacity' items of
+ * 'type'. The item size and the index mask are compile time constants, so a
+ * push or a pop is one struct assignment plus one masked index, instead of
+ * the per-byte copy of bufEnDat/bufDeDat. The same ownership rules as
+ * buffqueue_t apply: only the producer writes wHeadIndex, only the consumer
+ * writes wTailIndex. 'capacity' must be a power of two, at most 32768.
+ *
+ * Example:
+ *     DECLARE_QUEUE(evtQueue, event_t, 16)
+ *
+ *     static evtQueue_t g_evtQueue;
+ *
+ *     evtQueueInit(&g_evtQueue);
+ *     evtQueuePush(&g_evtQueue, &event);    // ERR_OK or ERR_BUF_FULL
+ *     evtQueuePop(&g_evtQueue, &event);     // ERR_OK or ERR_BUF_EMPTY
+ *
+ * A consumer that works on the oldest item in place (e.g. a DMA transfer)
+ * uses evtQueuePeek, which returns NULL when empty, then evtQueueConsume.
+ * A producer that builds the newest item in place (e.g. a frame) uses
+ * evtQueueReserve, which returns NULL when full, then evtQueueCommit.
+ */
+#define DECLARE_QUEUE(name, type, capacity)                                    \
+                                                                               \
+TYPED_QUEUE_STATIC_ASSERT(                                                     \
+    (((capacity) & ((capacity) - 1)) == 0) &&                                  \
+    ((capacity) != 0) && ((capacity) <= 32768),                                \
+    #name ": capacity must be a power of two not above 32768");                \
+                                                                               \
+typedef struct {                                                               \
+    uint16_t wHeadIndex;     /*< Free-running write index, owned by producer */\
+    uint16_t wTailIndex;     /*< Free-running read index, owned by consumer */ \
+    type aItems[capacity];   /*< Item storage */                               \
+} name##_t;                                                                    \
+                                                                               \
+static inline void                                                             \
+name##Init(                                                                    \
+    name##_t *pQueue                                                           \
+) {                                                                            \
+    pQueue->wHeadIndex = 0;                                                    \
+    pQueue->wTailIndex = 0;                                                    \
+}                                                                              \
+                                                                               \
+static inline uint16_t                                                         \
+name##Count(                                                                   \
+    name##_t *pQueue                                                           \
+) {                                                                            \
+    return (uint16_t)(                                                         \
+        __atomic_load_n(&pQueue->wHeadIndex, __ATOMIC_ACQUIRE) -               \
+        __atomic_load_n(&pQueue->wTailIndex, __ATOMIC_ACQUIRE));               \
+}                                                                              \
+                                                                               \
+static inline uint8_t                                                          \
+name##IsEmpty(                                                                 \
+    name##_t *pQueue                                                           \
+) {                                                                            \
+    return (name##Count(pQueue) == 0);                                         \
+}                                                                              \
+                                                                               \
+static inline uint8_t                                                          \
+name##IsFull(                                                                  \
+    name##_t *pQueue                                                           \
+) {                                                                            \
+    return (name##Count(pQueue) == (capacity));                                \
+}                                                                              \
+                                                                               \
+static inline uint8_t                                                          \
+name##Push(                                                                    \
+    name##_t *pQueue,                                                          \
+    const type *pItem                                                          \
+) {                                                                            \
+    uint16_t wHead = __atomic_load_n(&pQueue->wHeadIndex, __ATOMIC_RELAXED);   \
+                                                                               \
+    if ((uint16_t)(wHead - __atomic_load_n(&pQueue->wTailIndex,                \
+                                           __ATOMIC_ACQUIRE)) == (capacity)) { \
+        return ERR_BUF_FULL;                                                   \
+    }                                                                          \
+                                                                               \
+    pQueue->aItems[wHead & ((capacity) - 1)] = *pItem;                         \
+    __atomic_store_n(&pQueue->wHeadIndex, (uint16_t)(wHead + 1),               \
+                     __ATOMIC_RELEASE);                                        \
+                                                                               \
+    return ERR_OK;                                                             \
+}                                                                              \
+                                                                               \
+static inline uint8_t                                                          \
+name##Pop(                                                                     \
+    name##_t *pQueue,                                                          \
+    type *pItem                                                                \
+) {                                                                            \
+    uint16_t wTail = __atomic_load_n(&pQueue->wTailIndex, __ATOMIC_RELAXED);   \
+                                                                               \
+    if (__atomic_load_n(&pQueue->wHeadIndex, __ATOMIC_ACQUIRE) == wTail) {     \
+        return ERR_BUF_EMPTY;                                                  \
+    }                                                                          \
+                                                                               \
+    *pItem = pQueue->aItems[wTail & ((capacity) - 1)];                         \
+    __atomic_store_n(&pQueue->wTailIndex, (uint16_t)(wTail + 1),               \
+                     __ATOMIC_RELEASE);                                        \
+                                                                               \
+    return ERR_OK;                                                             \
+}                                                                              \
+                                                                               \
+static inline type *                                                           \
+name##Reserve(                                                                 \
+    name##_t *pQueue                                                           \
+) {                                                                            \
+    uint16_t wHead = __atomic_load_n(&pQueue->wHeadIndex, __ATOMIC_RELAXED);   \
+                                                                               \
+    if ((uint16_t)(wHead - __atomic_load_n(&pQueue->wTailIndex,                \
+                                           __ATOMIC_ACQUIRE)) == (capacity)) { \
+        return NULL;                                                           \
+    }                                                                          \
+                                                                               \
+    return &pQueue->aItems[wHead & ((capacity) - 1)];                          \
+}                                                                              \
+                                                                               \
+static inline void                                                             \
+name##Commit(                                                                  \
+    name##_t *pQueue                                                           \
+) {                                                                            \
+    uint16_t wHead = __atomic_load_n(&pQueue->wHeadIndex, __ATOMIC_RELAXED);   \
+                                                                               \
+    __atomic_store_n(&pQueue->wHeadIndex, (uint16_t)(wHead + 1),               \
+                     __ATOMIC_RELEASE);                                        \
+}                                                                              \
+                                                                               \
+static inline type *                                                           \
+name##Peek(                                                                    \
+    name##_t *pQueue                                                           \
+) {                                                                            \
+    uint16_t wTail = __atomic_load_n(&pQueue->wTailIndex, __ATOMIC_RELAXED);   \
+                                                                               \
+    if (__atomic_load_n(&pQueue->wHeadIndex, __ATOMIC_ACQUIRE) == wTail) {     \
+        return NULL;                                                           \
+    }                                                                          \
+                                                                               \
+    return &pQueue->aItems[wTail & ((capacity) - 1)];                          \
+}                                                                              \
+                                                                               \
+static inline void                                                             \
+name##Consume(                                                                 \
+    name##_t *pQueue                                                           \
+) {                                                                            \
+    uint16_t wTail = __atomic_load_n(&pQueue->wTailIndex, __ATOMIC_RELAXED);   \
+                                                                               \
+    if (__atomic_load_n(&pQueue->wHeadIndex, __ATOMIC_ACQUIRE) != wTail) {     \
+        __atomic_store_n(&pQueue->wTailIndex, (uint16_t)(wTail + 1),           \
+                         __ATOMIC_RELEASE);                                    \
+    }                                                                          \
+}
+
+#endif /* END FILE */
@@ -0,0 +1,272 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: Sliding window retransmission on top of the serial frames
+ *
+ ******************************************************************************/
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <string.h>
+#include "reliablelink.h"
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+/**
+ * @func   ReliableLink_FindSlot
+ * @brief  Finds the pending frame with a sequence number
+ * @param  pLink: Pointer to the link
+ * @param  bySequence: Sequence byte
+ * @retval Pointer to the slot, NULL if no frame with this number is pending
+ */
+static reliable_slot_t *
+ReliableLink_FindSlot(
+    reliablelink_p pLink,
+    uint8_t bySequence
+) {
+    uint8_t i;
+    
+    for (i = 0; i < RELIABLE_WINDOW_SIZE; i++) {
+        if ((pLink->aSlot[i].byLength != 0) &&
+            (pLink->aSlot[i].bySequence == bySequence)) {
+            return &pLink->aSlot[i];
+        }
+    }
+    
+    return NULL;
+}
+
+/**
+ * @func   ReliableLink_Resend
+ * @brief  Sends a pending frame again
+ * @param  pLink: Pointer to the link
+ * @param  pSlot: Pending frame
+ * @param  dwNow: Current time (ms)
+ * @retval None
+ */
+static void
+ReliableLink_Resend(
+    reliablelink_p pLink,
+    reliable_slot_t *pSlot,
+    uint32_t dwNow
+) {
+    if (pSlot->byRetries >= RELIABLE_RETRIES_MAX) {
+        pSlot->byLength = 0;
+        pLink->dwDropped++;
+        return;
+    }
+    
+    pSlot->byRetries++;
+    pSlot->dwSentTick = dwNow;
+    pLink->dwRetransmits++;
+    pLink->send(pSlot->aData, pSlot->byLength);
+}
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   ReliableLink_Init
+ * @brief  Initializes the link
+ * @param  pLink: Pointer to the link
+ * @param  send: Function used to transmit (and retransmit) frames
+ * @retval None
+ */
+void
+ReliableLink_Init(
+    reliablelink_p pLink,
+    reliable_send_frame send
+) {
+    memset(pLink, 0, sizeof(reliablelink_t));
+    pLink->send = send;
+}
+
+/**
+ * @func   ReliableLink_Send
+ * @brief  Sends a frame and keeps it until it is acknowledged
+ * @param  pLink: Pointer to the link
+ * @param  pFrame: Complete frame (SOF to CXOR)
+ * @param  byLength: Length of the frame
+ * @param  bySequence: Sequence byte of the frame
+ * @param  dwNow: Current time (ms)
+ * @retval 1 if sent, 0 if the window is full (or the frame too long)
+ */
+uint8_t
+ReliableLink_Send(
+    reliablelink_p pLink,
+    const uint8_t *pFrame,
+    uint8_t byLength,
+    uint8_t bySequence,
+    uint32_t dwNow
+) {
+    reliable_slot_t *pSlot = NULL;
+    uint8_t i;
+    
+    if ((byLength == 0) || (byLength > RELIABLE_FRAME_SIZE_MAX)) {
+        return 0;
+    }
+    
+    for (i = 0; i < RELIABLE_WINDOW_SIZE; i++) {
+        if (pLink->aSlot[i].byLength == 0) {
+            pSlot = &pLink->aSlot[i];
+            break;
+        }
+    }
+    
+    if (pSlot == NULL) {
+        return 0;
+    }
+    
+    memcpy(pSlot->aData, pFrame, byLength);
+    pSlot->byLength = byLength;
+    pSlot->bySequence = bySequence;
+    pSlot->byRetries = 0;
+    pSlot->dwSentTick = dwNow;
+    
+    pLink->send(pSlot->aData, byLength);
+    
+    return 1;
+}
+
+/**
+ * @func   ReliableLink_OnAck
+ * @brief  Releases the frame acknowledged by the peer
+ * @param  pLink: Pointer to the link
+ * @param  bySequence: Sequence byte following FRAME_ACK
+ * @retval None
+ */
+void
+ReliableLink_OnAck(
+    reliablelink_p pLink,
+    uint8_t bySequence
+) {
+    reliable_slot_t *pSlot = ReliableLink_FindSlot(pLink, bySequence);
+    
+    if (pSlot != NULL) {
+        pSlot->byLength = 0;
+    }
+}
+
+/**
+ * @func   ReliableLink_OnNack
+ * @brief  Sends again the frame refused by the peer
+ * @param  pLink: Pointer to the link
+ * @param  bySequence: Sequence byte following FRAME_NACK
+ * @param  dwNow: Current time (ms)
+ * @retval None
+ */
+void
+ReliableLink_OnNack(
+    reliablelink_p pLink,
+    uint8_t bySequence,
+    uint32_t dwNow
+) {
+    reliable_slot_t *pSlot = ReliableLink_FindSlot(pLink, bySequence);
+    
+    if (pSlot != NULL) {
+        ReliableLink_Resend(pLink, pSlot, dwNow);
+    }
+}
+
+/**
+ * @func   ReliableLink_Process
+ * @brief  Sends again the frames whose answer timed out
+ * @param  pLink: Pointer to the link
+ * @param  dwNow: Current time (ms)
+ * @retval None
+ */
+void
+ReliableLink_Process(
+    reliablelink_p pLink,
+    uint32_t dwNow
+) {
+    uint8_t i;
+    
+    for (i = 0; i < RELIABLE_WINDOW_SIZE; i++) {
+        if ((pLink->aSlot[i].byLength != 0) &&
+            ((uint32_t)(dwNow - pLink->aSlot[i].dwSentTick) >= RELIABLE_TIMEOUT_MS)) {
+            ReliableLink_Resend(pLink, &pLink->aSlot[i], dwNow);
+        }
+    }
+}
+
+/**
+ * @func   ReliableLink_NextTimeout
+ * @brief  Gets the time left before ReliableLink_Process sends a frame again
+ * @param  pLink: Pointer to the link
+ * @param  dwNow: Current time (ms)
+ * @retval Milliseconds (0 if overdue), RELIABLE_NO_TIMEOUT if no frame waits
+ */
+uint32_t
+ReliableLink_NextTimeout(
+    reliablelink_p pLink,
+    uint32_t dwNow
+) {
+    uint32_t dwNext = RELIABLE_NO_TIMEOUT;
+    uint32_t dwElapsed;
+    uint8_t i;
+    
+    for (i = 0; i < RELIABLE_WINDOW_SIZE; i++) {
+        if (pLink->aSlot[i].byLength == 0) {
+            continue;
+        }
+        
+        dwElapsed = dwNow - pLink->aSlot[i].dwSentTick;
+        if (dwElapsed >= RELIABLE_TIMEOUT_MS) {
+            return 0;
+        }
+        
+        if ((RELIABLE_TIMEOUT_MS - dwElapsed) < dwNext) {
+            dwNext = RELIABLE_TIMEOUT_MS - dwElapsed;
+        }
+    }
+    
+    return dwNext;
+}
+
+/**
+ * @func   ReliableLink_IsDuplicate
+ * @brief  Records a received sequence number
+ * @param  pLink: Pointer to the link
+ * @param  bySequence: Sequence byte of a received reliable frame
+ * @retval 1 if the frame was already received (answer it, do not handle it)
+ */
+uint8_t
+ReliableLink_IsDuplicate(
+    reliablelink_p pLink,
+    uint8_t bySequence
+) {
+    uint8_t i;
+    
+    for (i = 0; i < pLink->byRecentCount; i++) {
+        if (pLink->aRecentSeq[i] == bySequence) {
+            pLink->dwDuplicates++;
+            return 1;
+        }
+    }
+    
+    pLink->aRecentSeq[pLink->byRecentIndex] = bySequence;
+    pLink->byRecentIndex = (pLink->byRecentIndex + 1) % RELIABLE_RECENT_SIZE;
+    
+    if (pLink->byRecentCount < RELIABLE_RECENT_SIZE) {
+        pLink->byRecentCount++;
+    }
+    
+    return 0;
+}
+
+/* END FILE */
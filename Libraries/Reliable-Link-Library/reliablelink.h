@@ -0,0 +1,205 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: Sliding window retransmission on top of the serial frames
+ *
+ ******************************************************************************/
+#ifndef _RELIABLELINK_H_
+#define _RELIABLELINK_H_
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <stdint.h>
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+/*!
+ * Protocol
+ *
+ * A frame whose Option byte has CMD_OPT_RELIABLE set must be answered with
+ * the two bytes FRAME_ACK, Seq (or FRAME_NACK, Seq to ask for it again),
+ * Seq being the sequence byte of that frame. Up to RELIABLE_WINDOW_SIZE
+ * frames may wait for their answer at the same time; a frame that gets no
+ * answer within RELIABLE_TIMEOUT_MS is sent again, at most
+ * RELIABLE_RETRIES_MAX times. The receiver answers every copy of a frame but
+ * hands it to the application once (duplicate suppression on Seq).
+ */
+#define CMD_OPT_RELIABLE                    0x02
+
+#ifndef RELIABLE_WINDOW_SIZE
+#define RELIABLE_WINDOW_SIZE                4   /* Unacknowledged frames */
+#endif
+
+#ifndef RELIABLE_FRAME_SIZE_MAX
+#define RELIABLE_FRAME_SIZE_MAX             48  /* Bytes kept per frame */
+#endif
+
+#define RELIABLE_TIMEOUT_MS                 100
+#define RELIABLE_RETRIES_MAX                3
+
+/* Returned by ReliableLink_NextTimeout when no frame waits for its answer */
+#define RELIABLE_NO_TIMEOUT                 0xFFFFFFFFUL
+
+/* Sequence numbers remembered by the receiver for duplicate suppression */
+#define RELIABLE_RECENT_SIZE                (2 * RELIABLE_WINDOW_SIZE)
+
+/*! @brief Hands a frame to the transmitter (e.g. the TX queue) */
+typedef void (* reliable_send_frame)(const uint8_t *pFrame, uint8_t byLength);
+
+/*!
+ * A frame waiting for its answer
+ */
+typedef struct __reliable_slot__ {
+    
+    uint8_t aData[RELIABLE_FRAME_SIZE_MAX]; /*< Copy of the frame */
+    
+    uint8_t byLength;       /*< Length of the frame, 0 when the slot is free */
+    
+    uint8_t bySequence;     /*< Sequence byte of the frame */
+    
+    uint8_t byRetries;      /*< Number of times it has been sent again */
+    
+    uint32_t dwSentTick;    /*< Time of the last transmission (ms) */
+    
+} reliable_slot_t;
+
+/*!
+ * Link state
+ */
+typedef struct __reliable_link__ {
+    
+    reliable_slot_t aSlot[RELIABLE_WINDOW_SIZE]; /*< Sender window */
+    
+    reliable_send_frame send;   /*< Transmit function */
+    
+    uint8_t aRecentSeq[RELIABLE_RECENT_SIZE]; /*< Last sequence numbers received */
+    
+    uint8_t byRecentCount;      /*< Valid entries in aRecentSeq */
+    
+    uint8_t byRecentIndex;      /*< Next entry of aRecentSeq to overwrite */
+    
+    uint32_t dwRetransmits;     /*< Frames sent again (NACK or timeout) */
+    
+    uint32_t dwDropped;         /*< Frames given up after RELIABLE_RETRIES_MAX */
+    
+    uint32_t dwDuplicates;      /*< Received frames suppressed as duplicates */
+    
+} reliablelink_t, *reliablelink_p;
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   ReliableLink_Init
+ * @brief  Initializes the link
+ * @param  pLink: Pointer to the link
+ * @param  send: Function used to transmit (and retransmit) frames
+ * @retval None
+ */
+void
+ReliableLink_Init(
+    reliablelink_p pLink,
+    reliable_send_frame send
+);
+
+/**
+ * @func   ReliableLink_Send
+ * @brief  Sends a frame and keeps it until it is acknowledged
+ * @param  pLink: Pointer to the link
+ * @param  pFrame: Complete frame (SOF to CXOR)
+ * @param  byLength: Length of the frame
+ * @param  bySequence: Sequence byte of the frame
+ * @param  dwNow: Current time (ms)
+ * @retval 1 if sent, 0 if the window is full (or the frame too long)
+ */
+uint8_t
+ReliableLink_Send(
+    reliablelink_p pLink,
+    const uint8_t *pFrame,
+    uint8_t byLength,
+    uint8_t bySequence,
+    uint32_t dwNow
+);
+
+/**
+ * @func   ReliableLink_OnAck
+ * @brief  Releases the frame acknowledged by the peer
+ * @param  pLink: Pointer to the link
+ * @param  bySequence: Sequence byte following FRAME_ACK
+ * @retval None
+ */
+void
+ReliableLink_OnAck(
+    reliablelink_p pLink,
+    uint8_t bySequence
+);
+
+/**
+ * @func   ReliableLink_OnNack
+ * @brief  Sends again the frame refused by the peer
+ * @param  pLink: Pointer to the link
+ * @param  bySequence: Sequence byte following FRAME_NACK
+ * @param  dwNow: Current time (ms)
+ * @retval None
+ */
+void
+ReliableLink_OnNack(
+    reliablelink_p pLink,
+    uint8_t bySequence,
+    uint32_t dwNow
+);
+
+/**
+ * @func   ReliableLink_Process
+ * @brief  Sends again the frames whose answer timed out
+ * @param  pLink: Pointer to the link
+ * @param  dwNow: Current time (ms)
+ * @retval None
+ */
+void
+ReliableLink_Process(
+    reliablelink_p pLink,
+    uint32_t dwNow
+);
+
+/**
+ * @func   ReliableLink_NextTimeout
+ * @brief  Gets the time left before ReliableLink_Process sends a frame again
+ * @param  pLink: Pointer to the link
+ * @param  dwNow: Current time (ms)
+ * @retval Milliseconds (0 if overdue), RELIABLE_NO_TIMEOUT if no frame waits
+ */
+uint32_t
+ReliableLink_NextTimeout(
+    reliablelink_p pLink,
+    uint32_t dwNow
+);
+
+/**
+ * @func   ReliableLink_IsDuplicate
+ * @brief  Records a received sequence number
+ * @param  pLink: Pointer to the link
+ * @param  bySequence: Sequence byte of a received reliable frame
+ * @retval 1 if the frame was already received (answer it, do not handle it)
+ */
+uint8_t
+ReliableLink_IsDuplicate(
+    reliablelink_p pLink,
+    uint8_t bySequence
+);
+
+#endif /* END FILE */
@@ -16,6 +16,11 @@
  ******************************************************************************/
 #ifndef _TIMER_H_
 #define _TIMER_H_
+
+#ifdef USE_TIMER_WHEEL_LIBRARY
+/* The project links Libraries/Timer-Wheel-Library, which replaces this timer */
+#include "timerwheel.h"
+#else
 /******************************************************************************/
 /*                              INCLUDE FILES                                 */
 /******************************************************************************/
@@ -121,6 +126,8 @@ GetMilSecTick(void);
 void
 processTimerScheduler(void);
 
+#endif /* USE_TIMER_WHEEL_LIBRARY */
+
 #endif
 
 /* END FILE */
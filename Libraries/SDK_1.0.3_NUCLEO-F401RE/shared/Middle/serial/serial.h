@@ -35,6 +35,10 @@
 #define BAUD38400               		 38400
 #define BAUD57600               		 57600
 #define BAUD115200              		 115200
+#define BAUD230400              		 230400
+#define BAUD460800              		 460800
+#define BAUD921600              		 921600
+#define BAUD2000000             		 2000000
 
 #define NO_PARITY               		 0
 #define EVEN_PARITY             		 1
@@ -16,6 +16,11 @@
  ******************************************************************************/
 #ifndef _BUFF_H_
 #define _BUFF_H_
+
+#ifdef USE_QUEUE_LIBRARY
+/* The project links Libraries/Queue-Library, which replaces this FIFO */
+#include "queue.h"
+#else
 /******************************************************************************/
 /*                              INCLUDE FILES                                 */
 /******************************************************************************/
@@ -145,4 +150,6 @@ bufDeDat(
     uint8_t *pBuffer
 );
 
+#endif /* USE_QUEUE_LIBRARY */
+
 #endif /* END FILE */
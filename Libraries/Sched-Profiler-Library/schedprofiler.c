@@ -0,0 +1,255 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: Run time and lateness of the scheduler callbacks
+ *
+ ******************************************************************************/
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <stddef.h>
+#include <string.h>
+#include "schedprofiler.h"
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+/* Upper bounds of the histogram buckets but the last (us) */
+static const uint32_t g_adwBucketUs[SCHED_PROFILER_BUCKETS - 1] = {
+    10, 100, 1000, 10000
+};
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+static sched_profile_t g_aProfile[SCHED_PROFILER_SLOTS];
+
+static uint8_t g_byProfileCount = 0;
+
+static uint32_t g_dwCyclesPerUs = 1;
+
+/* g_adwBucketUs converted once, the records only compare */
+static uint32_t g_adwBucketCycles[SCHED_PROFILER_BUCKETS - 1];
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+/**
+ * @func   SchedProfiler_Clear
+ * @brief  Clears the statistics of a slot
+ * @param  pProfile: Slot
+ * @retval None
+ */
+static void
+SchedProfiler_Clear(
+    sched_profile_t *pProfile
+) {
+    pProfile->dwCalls = 0;
+    pProfile->dwMinCycles = 0xFFFFFFFFUL;
+    pProfile->dwMaxCycles = 0;
+    pProfile->qwTotalCycles = 0;
+    pProfile->dwLateCalls = 0;
+    pProfile->dwMinLate = 0xFFFFFFFFUL;
+    pProfile->dwMaxLate = 0;
+    pProfile->qwTotalLate = 0;
+    memset(pProfile->aHistogram, 0, sizeof(pProfile->aHistogram));
+}
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   SchedProfiler_Init
+ * @brief  Removes every slot and starts the cycle counter
+ * @param  dwCyclesPerUs: Cycle counter frequency (MHz), SystemCoreClock / 1000000
+ * @retval None
+ */
+void
+SchedProfiler_Init(
+    uint32_t dwCyclesPerUs
+) {
+    uint8_t i;
+
+    g_byProfileCount = 0;
+    g_dwCyclesPerUs = (dwCyclesPerUs != 0) ? dwCyclesPerUs : 1;
+
+    for (i = 0; i < (SCHED_PROFILER_BUCKETS - 1); i++) {
+        g_adwBucketCycles[i] = g_adwBucketUs[i] * g_dwCyclesPerUs;
+    }
+
+#if defined(STM32F4)
+    /* Shared with the other users of CYCCNT: started, never reset */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+/**
+ * @func   SchedProfiler_Register
+ * @brief  Gets the slot of a callback, created on the first call
+ * @param  strName: Name of the callback, the first SCHED_PROFILER_NAME_SIZE - 1
+ *         characters tell the slots apart
+ * @retval Slot index, SCHED_PROFILER_NO_SLOT if every slot is taken
+ */
+uint8_t
+SchedProfiler_Register(
+    const char *strName
+) {
+    sched_profile_t *pProfile;
+    uint8_t i;
+
+    if (strName == NULL) {
+        strName = "?";
+    }
+
+    for (i = 0; i < g_byProfileCount; i++) {
+        if (strncmp(g_aProfile[i].strName, strName,
+                    SCHED_PROFILER_NAME_SIZE - 1) == 0) {
+            return i;
+        }
+    }
+
+    if (g_byProfileCount >= SCHED_PROFILER_SLOTS) {
+        return SCHED_PROFILER_NO_SLOT;
+    }
+
+    pProfile = &g_aProfile[g_byProfileCount];
+    strncpy(pProfile->strName, strName, SCHED_PROFILER_NAME_SIZE - 1);
+    pProfile->strName[SCHED_PROFILER_NAME_SIZE - 1] = 0;
+    SchedProfiler_Clear(pProfile);
+
+    return g_byProfileCount++;
+}
+
+/**
+ * @func   SchedProfiler_Record
+ * @brief  Records a call that has just returned
+ * @param  bySlot: Slot index (SCHED_PROFILER_NO_SLOT is ignored)
+ * @param  dwStartCycles: SchedProfiler_Now before the call
+ * @param  dwLateCycles: Time from due to dispatch, or SCHED_PROFILER_NO_LATENESS
+ * @retval None
+ */
+void
+SchedProfiler_Record(
+    uint8_t bySlot,
+    uint32_t dwStartCycles,
+    uint32_t dwLateCycles
+) {
+    uint32_t dwCycles = SCHED_PROFILER_CYCLES() - dwStartCycles;
+    sched_profile_t *pProfile;
+    uint8_t byBucket = 0;
+
+    if (bySlot >= g_byProfileCount) {
+        return;
+    }
+
+    pProfile = &g_aProfile[bySlot];
+
+    pProfile->dwCalls++;
+    pProfile->qwTotalCycles += dwCycles;
+    if (dwCycles < pProfile->dwMinCycles) {
+        pProfile->dwMinCycles = dwCycles;
+    }
+    if (dwCycles > pProfile->dwMaxCycles) {
+        pProfile->dwMaxCycles = dwCycles;
+    }
+
+    while ((byBucket < (SCHED_PROFILER_BUCKETS - 1)) &&
+           (dwCycles >= g_adwBucketCycles[byBucket])) {
+        byBucket++;
+    }
+    pProfile->aHistogram[byBucket]++;
+
+    if (dwLateCycles != SCHED_PROFILER_NO_LATENESS) {
+        pProfile->dwLateCalls++;
+        pProfile->qwTotalLate += dwLateCycles;
+        if (dwLateCycles < pProfile->dwMinLate) {
+            pProfile->dwMinLate = dwLateCycles;
+        }
+        if (dwLateCycles > pProfile->dwMaxLate) {
+            pProfile->dwMaxLate = dwLateCycles;
+        }
+    }
+}
+
+/**
+ * @func   SchedProfiler_MsToCycles
+ * @brief  Converts milliseconds of the tick to cycles
+ * @param  dwMs: Milliseconds
+ * @retval Cycles, saturated at SCHED_PROFILER_NO_LATENESS - 1
+ */
+uint32_t
+SchedProfiler_MsToCycles(
+    uint32_t dwMs
+) {
+    uint64_t qwCycles = (uint64_t)dwMs * 1000u * g_dwCyclesPerUs;
+
+    if (qwCycles >= SCHED_PROFILER_NO_LATENESS) {
+        return SCHED_PROFILER_NO_LATENESS - 1;
+    }
+
+    return (uint32_t)qwCycles;
+}
+
+/**
+ * @func   SchedProfiler_CyclesToUs
+ * @brief  Converts cycles to microseconds
+ * @param  qwCycles: Cycles
+ * @retval Microseconds, saturated at 0xFFFFFFFF
+ */
+uint32_t
+SchedProfiler_CyclesToUs(
+    uint64_t qwCycles
+) {
+    uint64_t qwUs = qwCycles / g_dwCyclesPerUs;
+
+    return (qwUs > 0xFFFFFFFFUL) ? 0xFFFFFFFFUL : (uint32_t)qwUs;
+}
+
+/**
+ * @func   SchedProfiler_Count
+ * @brief  Gets the number of slots in use
+ * @param  None
+ * @retval Number of slots
+ */
+uint8_t
+SchedProfiler_Count(void) {
+    return g_byProfileCount;
+}
+
+/**
+ * @func   SchedProfiler_Get
+ * @brief  Gets the statistics of a slot
+ * @param  bySlot: Slot index
+ * @retval Pointer to the statistics, NULL past the last slot
+ */
+const sched_profile_t *
+SchedProfiler_Get(
+    uint8_t bySlot
+) {
+    if (bySlot >= g_byProfileCount) {
+        return NULL;
+    }
+
+    return &g_aProfile[bySlot];
+}
+
+/**
+ * @func   SchedProfiler_Reset
+ * @brief  Clears the statistics, the slots keep their names and indexes
+ * @param  None
+ * @retval None
+ */
+void
+SchedProfiler_Reset(void) {
+    uint8_t i;
+
+    for (i = 0; i < g_byProfileCount; i++) {
+        SchedProfiler_Clear(&g_aProfile[i]);
+    }
+}
+
+/* END FILE */
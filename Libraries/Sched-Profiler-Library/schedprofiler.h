@@ -0,0 +1,199 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: Run time and lateness of the scheduler callbacks
+ *
+ ******************************************************************************/
+#ifndef _SCHEDPROFILER_H_
+#define _SCHEDPROFILER_H_
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <stdint.h>
+#if defined(STM32F4)
+#include "stm32f401re.h"
+#endif
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+/*!
+ * One slot per callback, found by name: the timers of Timer-Wheel-Library
+ * (name given to TimerStart), the events of Event-Queue-Library and any
+ * handler the application wraps itself. Each call records its run time and,
+ * when known, how late it was dispatched (after the expiry tick of a timer,
+ * after the post of an event), in cycles of the DWT cycle counter.
+ *
+ * The libraries record their callbacks when USE_SCHED_PROFILER is defined
+ * for the whole project; without it they do not reference this library.
+ */
+
+/* Number of callbacks profiled, the next ones are not recorded */
+#ifndef SCHED_PROFILER_SLOTS
+#define SCHED_PROFILER_SLOTS        16u
+#endif
+
+/* Name of a slot, terminator included */
+#define SCHED_PROFILER_NAME_SIZE    12u
+
+/* Run time histogram: below 10 us, 100 us, 1 ms, 10 ms, and above */
+#define SCHED_PROFILER_BUCKETS      5u
+
+#define SCHED_PROFILER_NO_SLOT      0xFFu
+#define SCHED_PROFILER_NO_LATENESS  0xFFFFFFFFUL
+
+/* Cycle counter (counts up, wraps), 0 where there is none */
+#ifndef SCHED_PROFILER_CYCLES
+#if defined(STM32F4)
+#define SCHED_PROFILER_CYCLES()     (DWT->CYCCNT)
+#else
+#define SCHED_PROFILER_CYCLES()     (0u)
+#endif
+#endif
+
+/*!
+ * Statistics of a callback (cycles)
+ */
+typedef struct __sched_profile__ {
+
+    char strName[SCHED_PROFILER_NAME_SIZE];
+
+    uint32_t dwCalls;
+
+    uint32_t dwMinCycles;
+
+    uint32_t dwMaxCycles;
+
+    uint64_t qwTotalCycles;
+
+    uint32_t dwLateCalls;                       /*< Calls with a lateness */
+
+    uint32_t dwMinLate;
+
+    uint32_t dwMaxLate;                         /*< dwMaxLate - dwMinLate: jitter */
+
+    uint64_t qwTotalLate;
+
+    uint32_t aHistogram[SCHED_PROFILER_BUCKETS];
+
+} sched_profile_t, *sched_profile_p;
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   SchedProfiler_Init
+ * @brief  Removes every slot and starts the cycle counter
+ * @param  dwCyclesPerUs: Cycle counter frequency (MHz), SystemCoreClock / 1000000
+ * @retval None
+ */
+void
+SchedProfiler_Init(
+    uint32_t dwCyclesPerUs
+);
+
+/**
+ * @func   SchedProfiler_Register
+ * @brief  Gets the slot of a callback, created on the first call
+ * @param  strName: Name of the callback, the first SCHED_PROFILER_NAME_SIZE - 1
+ *         characters tell the slots apart
+ * @retval Slot index, SCHED_PROFILER_NO_SLOT if every slot is taken
+ */
+uint8_t
+SchedProfiler_Register(
+    const char *strName
+);
+
+/**
+ * @func   SchedProfiler_Now
+ * @brief  Reads the cycle counter, before calling the callback
+ * @param  None
+ * @retval Cycle count
+ */
+static inline uint32_t
+SchedProfiler_Now(void) {
+    return SCHED_PROFILER_CYCLES();
+}
+
+/**
+ * @func   SchedProfiler_Record
+ * @brief  Records a call that has just returned
+ * @param  bySlot: Slot index (SCHED_PROFILER_NO_SLOT is ignored)
+ * @param  dwStartCycles: SchedProfiler_Now before the call
+ * @param  dwLateCycles: Time from due to dispatch, or SCHED_PROFILER_NO_LATENESS
+ * @retval None
+ */
+void
+SchedProfiler_Record(
+    uint8_t bySlot,
+    uint32_t dwStartCycles,
+    uint32_t dwLateCycles
+);
+
+/**
+ * @func   SchedProfiler_MsToCycles
+ * @brief  Converts milliseconds of the tick to cycles
+ * @param  dwMs: Milliseconds
+ * @retval Cycles, saturated at SCHED_PROFILER_NO_LATENESS - 1
+ */
+uint32_t
+SchedProfiler_MsToCycles(
+    uint32_t dwMs
+);
+
+/**
+ * @func   SchedProfiler_CyclesToUs
+ * @brief  Converts cycles to microseconds
+ * @param  qwCycles: Cycles
+ * @retval Microseconds, saturated at 0xFFFFFFFF
+ */
+uint32_t
+SchedProfiler_CyclesToUs(
+    uint64_t qwCycles
+);
+
+/**
+ * @func   SchedProfiler_Count
+ * @brief  Gets the number of slots in use
+ * @param  None
+ * @retval Number of slots
+ */
+uint8_t
+SchedProfiler_Count(void);
+
+/**
+ * @func   SchedProfiler_Get
+ * @brief  Gets the statistics of a slot
+ * @param  bySlot: Slot index
+ * @retval Pointer to the statistics, NULL past the last slot
+ */
+const sched_profile_t *
+SchedProfiler_Get(
+    uint8_t bySlot
+);
+
+/**
+ * @func   SchedProfiler_Reset
+ * @brief  Clears the statistics, the slots keep their names and indexes
+ * @param  None
+ * @retval None
+ */
+void
+SchedProfiler_Reset(void);
+
+#endif /* _SCHEDPROFILER_H_ */
+
+/* END FILE */
@@ -0,0 +1,105 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: Table driven dispatcher for the serial commands
+ *
+ ******************************************************************************/
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <string.h>
+#include "serialcmd.h"
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+/* Indexed by command id: the dispatch cost does not depend on how many
+ * commands are registered. */
+static serial_cmd_handler g_pCmdHandler[SERIAL_CMD_TABLE_SIZE];
+
+/* Bit n set: the handler of this id accepts command type n */
+static uint8_t g_byCmdTypeMask[SERIAL_CMD_TABLE_SIZE];
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   SerialCmd_Init
+ * @brief  Removes every registered handler
+ * @param  None
+ * @retval None
+ */
+void
+SerialCmd_Init(void) {
+    memset(g_pCmdHandler, 0, sizeof(g_pCmdHandler));
+    memset(g_byCmdTypeMask, 0, sizeof(g_byCmdTypeMask));
+}
+
+/**
+ * @func   SerialCmd_Register
+ * @brief  Registers the handler of a command id for one command type
+ * @param  byCmdId: Command id (CMD_ID_xxx)
+ * @param  byCmdType: Command type (CMD_TYPE_xxx), at most SERIAL_CMD_TYPE_MAX
+ * @param  handler: Function called for matching frames
+ * @retval 1 if registered, 0 if the type is out of range, the handler is
+ *         NULL or the id already has another handler
+ */
+uint8_t
+SerialCmd_Register(
+    uint8_t byCmdId,
+    uint8_t byCmdType,
+    serial_cmd_handler handler
+) {
+    if ((byCmdType > SERIAL_CMD_TYPE_MAX) || (handler == NULL)) {
+        return 0;
+    }
+    
+    /* The types already registered would go to the new handler */
+    if ((g_byCmdTypeMask[byCmdId] != 0) && (g_pCmdHandler[byCmdId] != handler)) {
+        return 0;
+    }
+    
+    g_pCmdHandler[byCmdId] = handler;
+    g_byCmdTypeMask[byCmdId] |= (uint8_t)(1 << byCmdType);
+    
+    return 1;
+}
+
+/**
+ * @func   SerialCmd_Dispatch
+ * @brief  Calls the handler registered for a received command
+ * @param  pCmd: Pointer to the CmdID byte of a validated frame
+ * @retval 1 if a handler was called, 0 if the id/type is not registered
+ */
+uint8_t
+SerialCmd_Dispatch(
+    const uint8_t *pCmd
+) {
+    const cmd_receive_t *pReceive = (const cmd_receive_t *)pCmd;
+    uint8_t byCmdId = pReceive->cmdCommon.cmdid;
+    uint8_t byCmdType = pReceive->cmdCommon.type;
+    
+    if ((byCmdType > SERIAL_CMD_TYPE_MAX) ||
+        ((g_byCmdTypeMask[byCmdId] & (1 << byCmdType)) == 0)) {
+        return 0;
+    }
+    
+    g_pCmdHandler[byCmdId](pReceive);
+    
+    return 1;
+}
+
+/* END FILE */
@@ -0,0 +1,88 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: Table driven dispatcher for the serial commands
+ *
+ ******************************************************************************/
+#ifndef _SERIALCMD_H_
+#define _SERIALCMD_H_
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <stdint.h>
+#include "serial.h"
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+/*! @brief One handler slot per command id */
+#define SERIAL_CMD_TABLE_SIZE               256
+
+/*! @brief Command types that fit in the per-id type mask (CMD_TYPE_xxx) */
+#define SERIAL_CMD_TYPE_MAX                 7
+
+/*!
+ * @brief Command handler
+ *
+ * pCmd points at the CmdID byte of a validated frame, so the union member
+ * that matches the command (ledIndicator, buzzerState, ...) reads the
+ * payload in place. It is only valid during the call.
+ */
+typedef void (* serial_cmd_handler)(const cmd_receive_t *pCmd);
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   SerialCmd_Init
+ * @brief  Removes every registered handler
+ * @param  None
+ * @retval None
+ */
+void
+SerialCmd_Init(void);
+
+/**
+ * @func   SerialCmd_Register
+ * @brief  Registers the handler of a command id for one command type
+ * @param  byCmdId: Command id (CMD_ID_xxx)
+ * @param  byCmdType: Command type (CMD_TYPE_xxx), at most SERIAL_CMD_TYPE_MAX
+ * @param  handler: Function called for matching frames
+ * @retval 1 if registered, 0 if the type is out of range, the handler is
+ *         NULL or the id already has another handler
+ * @note   A command id has one handler: registering the same handler for
+ *         another type adds the type. A different handler is refused and
+ *         the registered one is kept; SerialCmd_Init clears every id.
+ */
+uint8_t
+SerialCmd_Register(
+    uint8_t byCmdId,
+    uint8_t byCmdType,
+    serial_cmd_handler handler
+);
+
+/**
+ * @func   SerialCmd_Dispatch
+ * @brief  Calls the handler registered for a received command
+ * @param  pCmd: Pointer to the CmdID byte of a validated frame
+ * @retval 1 if a handler was called, 0 if the id/type is not registered
+ */
+uint8_t
+SerialCmd_Dispatch(
+    const uint8_t *pCmd
+);
+
+#endif /* END FILE */
@@ -0,0 +1,210 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: Binary trace of the serial frames, for record and replay
+ *
+ ******************************************************************************/
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <string.h>
+#include "serialtrace.h"
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+static const uint8_t g_byTraceMagic[4] = {'S', 'T', 'R', 'C'};
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   SerialTrace_Init
+ * @brief  Starts a trace in a buffer
+ * @param  pTrace: Pointer to the trace
+ * @param  pBuffer: Buffer, at least SERIAL_TRACE_HEADER_SIZE bytes
+ * @param  wSize: Size of the buffer
+ * @param  dwNowUs: Current time (us)
+ * @retval None
+ */
+void
+SerialTrace_Init(
+    serialtrace_p pTrace,
+    uint8_t *pBuffer,
+    uint16_t wSize,
+    uint32_t dwNowUs
+) {
+    pTrace->pBuffer = pBuffer;
+    pTrace->wSize = wSize;
+    pTrace->wUsed = 0;
+    pTrace->dwLastUs = dwNowUs;
+    pTrace->dwDropped = 0;
+    
+    if (wSize >= SERIAL_TRACE_HEADER_SIZE) {
+        pTrace->wUsed = SerialTrace_WriteHeader(pBuffer);
+    }
+}
+
+/**
+ * @func   SerialTrace_Record
+ * @brief  Appends a frame to the trace
+ * @param  pTrace: Pointer to the trace
+ * @param  byChannel: SERIAL_TRACE_RX or SERIAL_TRACE_TX
+ * @param  dwNowUs: Current time (us)
+ * @param  pFrame: Frame
+ * @param  byLength: Length of the frame
+ * @retval 1 if recorded, 0 if the buffer is full
+ */
+uint8_t
+SerialTrace_Record(
+    serialtrace_p pTrace,
+    uint8_t byChannel,
+    uint32_t dwNowUs,
+    const uint8_t *pFrame,
+    uint8_t byLength
+) {
+    if ((pTrace->wUsed == 0) ||
+        ((uint32_t)(pTrace->wSize - pTrace->wUsed) < (uint32_t)SERIAL_TRACE_RECORD_MAX(byLength))) {
+        pTrace->dwDropped++;
+        return 0;
+    }
+    
+    pTrace->wUsed += SerialTrace_EncodeRecord(&pTrace->pBuffer[pTrace->wUsed], byChannel,
+                                              dwNowUs - pTrace->dwLastUs, pFrame, byLength);
+    pTrace->dwLastUs = dwNowUs;
+    
+    return 1;
+}
+
+/**
+ * @func   SerialTrace_WriteHeader
+ * @brief  Writes the header of a trace
+ * @param  pOut: SERIAL_TRACE_HEADER_SIZE bytes
+ * @retval SERIAL_TRACE_HEADER_SIZE
+ */
+uint8_t
+SerialTrace_WriteHeader(
+    uint8_t *pOut
+) {
+    memset(pOut, 0, SERIAL_TRACE_HEADER_SIZE);
+    memcpy(pOut, g_byTraceMagic, sizeof(g_byTraceMagic));
+    pOut[4] = SERIAL_TRACE_VERSION;
+    
+    return SERIAL_TRACE_HEADER_SIZE;
+}
+
+/**
+ * @func   SerialTrace_CheckHeader
+ * @brief  Checks the header of a trace
+ * @param  pIn: Start of the trace
+ * @param  wLength: Bytes available
+ * @retval 1 if it is a trace of SERIAL_TRACE_VERSION
+ */
+uint8_t
+SerialTrace_CheckHeader(
+    const uint8_t *pIn,
+    uint16_t wLength
+) {
+    return (wLength >= SERIAL_TRACE_HEADER_SIZE) &&
+           (memcmp(pIn, g_byTraceMagic, sizeof(g_byTraceMagic)) == 0) &&
+           (pIn[4] == SERIAL_TRACE_VERSION);
+}
+
+/**
+ * @func   SerialTrace_EncodeRecord
+ * @brief  Encodes one record
+ * @param  pOut: SERIAL_TRACE_RECORD_MAX(byLength) bytes
+ * @param  byChannel: Channel byte (direction and link)
+ * @param  dwDeltaUs: Time since the previous record (us)
+ * @param  pFrame: Frame
+ * @param  byLength: Length of the frame
+ * @retval Number of bytes written
+ */
+uint8_t
+SerialTrace_EncodeRecord(
+    uint8_t *pOut,
+    uint8_t byChannel,
+    uint32_t dwDeltaUs,
+    const uint8_t *pFrame,
+    uint8_t byLength
+) {
+    uint8_t bySize = 0;
+    
+    pOut[bySize++] = byChannel;
+    
+    while (dwDeltaUs >= 0x80) {
+        pOut[bySize++] = (uint8_t)(dwDeltaUs | 0x80);
+        dwDeltaUs >>= 7;
+    }
+    
+    pOut[bySize++] = (uint8_t)dwDeltaUs;
+    pOut[bySize++] = byLength;
+    
+    memcpy(&pOut[bySize], pFrame, byLength);
+    
+    return bySize + byLength;
+}
+
+/**
+ * @func   SerialTrace_DecodeRecord
+ * @brief  Decodes the record at the start of a block
+ * @param  pIn: Records
+ * @param  dwLength: Bytes available
+ * @param  pbyChannel: Receives the channel byte
+ * @param  pdwDeltaUs: Receives the time since the previous record
+ * @param  ppFrame: Receives the frame, inside pIn
+ * @param  pbyLength: Receives the length of the frame
+ * @retval Size of the record, 0 if it is truncated or malformed
+ */
+uint16_t
+SerialTrace_DecodeRecord(
+    const uint8_t *pIn,
+    uint32_t dwLength,
+    uint8_t *pbyChannel,
+    uint32_t *pdwDeltaUs,
+    const uint8_t **ppFrame,
+    uint8_t *pbyLength
+) {
+    uint32_t dwDelta = 0;
+    uint16_t wIndex = 1;
+    uint8_t byShift = 0;
+    
+    if (dwLength < 3) {
+        return 0;
+    }
+    
+    do {
+        if ((wIndex >= dwLength) || (byShift > 28)) {
+            return 0;
+        }
+        
+        dwDelta |= (uint32_t)(pIn[wIndex] & 0x7F) << byShift;
+        byShift += 7;
+    } while (pIn[wIndex++] & 0x80);
+    
+    if ((wIndex >= dwLength) || ((uint32_t)(wIndex + 1 + pIn[wIndex]) > dwLength)) {
+        return 0;
+    }
+    
+    *pbyChannel = pIn[0];
+    *pdwDeltaUs = dwDelta;
+    *pbyLength = pIn[wIndex];
+    *ppFrame = &pIn[wIndex + 1];
+    
+    return wIndex + 1 + pIn[wIndex];
+}
+
+/* END FILE */
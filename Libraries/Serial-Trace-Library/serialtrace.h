@@ -0,0 +1,172 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: Binary trace of the serial frames, for record and replay
+ *
+ ******************************************************************************/
+#ifndef _SERIALTRACE_H_
+#define _SERIALTRACE_H_
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <stdint.h>
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+/*!
+ * Trace layout
+ *
+ *   Header: 'S' 'T' 'R' 'C' Version 0 0 0
+ *   Record: Channel | Delta | Length | Frame
+ *
+ * Channel: bit 0 is SERIAL_TRACE_RX or SERIAL_TRACE_TX, bits 1..7 the link
+ * (0 on the device, the link id on the gateway). Delta: microseconds since
+ * the previous record, 7 bits per byte, low bits first, bit 7 set when
+ * another byte follows. Frame: the whole frame, from FRAME_SOF to its check
+ * (or FRAME_ACK / FRAME_NACK and Seq).
+ */
+#define SERIAL_TRACE_VERSION                0x01
+#define SERIAL_TRACE_HEADER_SIZE            8
+
+#define SERIAL_TRACE_RX                     0x00
+#define SERIAL_TRACE_TX                     0x01
+
+/* Largest record of a frame of byLength bytes */
+#define SERIAL_TRACE_RECORD_MAX(byLength)   (1 + 5 + 1 + (byLength))
+
+/*!
+ * Trace kept in a RAM buffer. Recording stops when it is full, so the
+ * buffer always holds the start of the capture and can be dumped as is.
+ */
+typedef struct __serial_trace__ {
+    
+    uint8_t *pBuffer;       /*< Header then records */
+    
+    uint16_t wSize;         /*< Size of the buffer */
+    
+    uint16_t wUsed;         /*< Bytes of the buffer in use */
+    
+    uint32_t dwLastUs;      /*< Time of the last record */
+    
+    uint32_t dwDropped;     /*< Frames not recorded (buffer full) */
+    
+} serialtrace_t, *serialtrace_p;
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   SerialTrace_Init
+ * @brief  Starts a trace in a buffer
+ * @param  pTrace: Pointer to the trace
+ * @param  pBuffer: Buffer, at least SERIAL_TRACE_HEADER_SIZE bytes
+ * @param  wSize: Size of the buffer
+ * @param  dwNowUs: Current time (us)
+ * @retval None
+ */
+void
+SerialTrace_Init(
+    serialtrace_p pTrace,
+    uint8_t *pBuffer,
+    uint16_t wSize,
+    uint32_t dwNowUs
+);
+
+/**
+ * @func   SerialTrace_Record
+ * @brief  Appends a frame to the trace
+ * @param  pTrace: Pointer to the trace
+ * @param  byChannel: SERIAL_TRACE_RX or SERIAL_TRACE_TX
+ * @param  dwNowUs: Current time (us)
+ * @param  pFrame: Frame
+ * @param  byLength: Length of the frame
+ * @retval 1 if recorded, 0 if the buffer is full
+ */
+uint8_t
+SerialTrace_Record(
+    serialtrace_p pTrace,
+    uint8_t byChannel,
+    uint32_t dwNowUs,
+    const uint8_t *pFrame,
+    uint8_t byLength
+);
+
+/**
+ * @func   SerialTrace_WriteHeader
+ * @brief  Writes the header of a trace
+ * @param  pOut: SERIAL_TRACE_HEADER_SIZE bytes
+ * @retval SERIAL_TRACE_HEADER_SIZE
+ */
+uint8_t
+SerialTrace_WriteHeader(
+    uint8_t *pOut
+);
+
+/**
+ * @func   SerialTrace_CheckHeader
+ * @brief  Checks the header of a trace
+ * @param  pIn: Start of the trace
+ * @param  wLength: Bytes available
+ * @retval 1 if it is a trace of SERIAL_TRACE_VERSION
+ */
+uint8_t
+SerialTrace_CheckHeader(
+    const uint8_t *pIn,
+    uint16_t wLength
+);
+
+/**
+ * @func   SerialTrace_EncodeRecord
+ * @brief  Encodes one record
+ * @param  pOut: SERIAL_TRACE_RECORD_MAX(byLength) bytes
+ * @param  byChannel: Channel byte (direction and link)
+ * @param  dwDeltaUs: Time since the previous record (us)
+ * @param  pFrame: Frame
+ * @param  byLength: Length of the frame
+ * @retval Number of bytes written
+ */
+uint8_t
+SerialTrace_EncodeRecord(
+    uint8_t *pOut,
+    uint8_t byChannel,
+    uint32_t dwDeltaUs,
+    const uint8_t *pFrame,
+    uint8_t byLength
+);
+
+/**
+ * @func   SerialTrace_DecodeRecord
+ * @brief  Decodes the record at the start of a block
+ * @param  pIn: Records
+ * @param  dwLength: Bytes available
+ * @param  pbyChannel: Receives the channel byte
+ * @param  pdwDeltaUs: Receives the time since the previous record
+ * @param  ppFrame: Receives the frame, inside pIn
+ * @param  pbyLength: Receives the length of the frame
+ * @retval Size of the record, 0 if it is truncated or malformed
+ */
+uint16_t
+SerialTrace_DecodeRecord(
+    const uint8_t *pIn,
+    uint32_t dwLength,
+    uint8_t *pbyChannel,
+    uint32_t *pdwDeltaUs,
+    const uint8_t **ppFrame,
+    uint8_t *pbyLength
+);
+
+#endif /* END FILE */
@@ -0,0 +1,222 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: 64-bit microsecond time base and wrap-free time helpers
+ *
+ ******************************************************************************/
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include "timebase.h"
+#if defined(STM32F4)
+#include "timer.h"
+#endif
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+#define TIME_BASE_US_PER_MS         1000u
+
+#if defined(STM32F4)
+#define TIME_BASE_TICK_MS()         GetMilSecTick()
+#else
+/* Millisecond tick of the mock clock, 32 bits as GetMilSecTick */
+#define TIME_BASE_TICK_MS()         ((uint32_t)(g_qwMockUs / TIME_BASE_US_PER_MS))
+#endif
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+static uint32_t g_dwCyclesPerUs = 1;
+
+/* GetMilSecTick at the last read, and its wraps since TimeBase_Init */
+static uint32_t g_dwLastMs = 0;
+
+static uint32_t g_dwMsWraps = 0;
+
+#if !defined(STM32F4)
+static uint64_t g_qwMockUs = 0;
+#endif
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+/**
+ * @func   TimeBase_ExtendMs
+ * @brief  Extends a GetMilSecTick value to 64 bits, interrupts masked
+ * @param  dwMs: Millisecond tick, not older than the last one read
+ * @retval Milliseconds, 64 bits
+ */
+static uint64_t
+TimeBase_ExtendMs(
+    uint32_t dwMs
+) {
+    if (dwMs < g_dwLastMs) {
+        g_dwMsWraps++;
+    }
+    g_dwLastMs = dwMs;
+
+    return ((uint64_t)g_dwMsWraps << 32) | dwMs;
+}
+
+#if defined(STM32F4)
+/**
+ * @func   TimeBase_Read
+ * @brief  Reads the millisecond tick and the SysTick count of the same instant
+ * @param  pdwCount: SysTick count (counting down within the millisecond)
+ * @retval Milliseconds, 64 bits
+ */
+static uint64_t
+TimeBase_Read(
+    uint32_t *pdwCount
+) {
+    uint32_t dwPrimask = __get_PRIMASK();
+    uint32_t dwMs;
+    uint32_t dwCount;
+    uint64_t qwMs;
+
+    __disable_irq();
+
+    dwMs = GetMilSecTick();
+    dwCount = SysTick->VAL;
+
+    if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+        /* SysTick reloaded but its interrupt has not counted the tick yet
+         * (read with interrupts masked, or from a higher priority) */
+        dwMs++;
+        dwCount = SysTick->VAL;
+    }
+
+    qwMs = TimeBase_ExtendMs(dwMs);
+
+    __set_PRIMASK(dwPrimask);
+
+    *pdwCount = dwCount;
+
+    return qwMs;
+}
+#endif
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   TimeBase_Init
+ * @brief  Sets the core clock and starts the cycle counter
+ * @param  dwCyclesPerUs: Core clock (MHz), SystemCoreClock / 1000000
+ * @retval None
+ */
+void
+TimeBase_Init(
+    uint32_t dwCyclesPerUs
+) {
+    g_dwCyclesPerUs = (dwCyclesPerUs != 0) ? dwCyclesPerUs : 1;
+    g_dwLastMs = TIME_BASE_TICK_MS();
+    g_dwMsWraps = 0;
+
+#if defined(STM32F4)
+    /* Shared with the other users of CYCCNT: started, never reset */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+/**
+ * @func   TimeBase_GetUs
+ * @brief  Gets the microseconds since TimerInit
+ * @param  None
+ * @retval Microseconds, 64 bits
+ */
+uint64_t
+TimeBase_GetUs(void) {
+#if defined(STM32F4)
+    uint32_t dwCount;
+    uint64_t qwMs = TimeBase_Read(&dwCount);
+    uint32_t dwUs = (SysTick->LOAD - dwCount) / g_dwCyclesPerUs;
+
+    /* SysTick spans more than a millisecond during a tickless sleep */
+    if (dwUs >= TIME_BASE_US_PER_MS) {
+        dwUs = TIME_BASE_US_PER_MS - 1;
+    }
+
+    return qwMs * TIME_BASE_US_PER_MS + dwUs;
+#else
+    uint64_t qwMs = TimeBase_ExtendMs(TIME_BASE_TICK_MS());
+
+    return qwMs * TIME_BASE_US_PER_MS + (uint32_t)(g_qwMockUs % TIME_BASE_US_PER_MS);
+#endif
+}
+
+/**
+ * @func   TimeBase_GetMs
+ * @brief  Gets the milliseconds since TimerInit
+ * @param  None
+ * @retval Milliseconds, 64 bits
+ */
+uint64_t
+TimeBase_GetMs(void) {
+#if defined(STM32F4)
+    uint32_t dwCount;
+
+    return TimeBase_Read(&dwCount);
+#else
+    return TimeBase_ExtendMs(TIME_BASE_TICK_MS());
+#endif
+}
+
+/**
+ * @func   TimeBase_CyclesToUs
+ * @brief  Converts cycles of the cycle counter to microseconds
+ * @param  dwCycles: Cycles
+ * @retval Microseconds
+ */
+uint32_t
+TimeBase_CyclesToUs(
+    uint32_t dwCycles
+) {
+    return dwCycles / g_dwCyclesPerUs;
+}
+
+#if !defined(STM32F4)
+/**
+ * @func   TimeBase_MockSetUs
+ * @brief  Sets the mock clock (host tests)
+ * @param  qwUs: Microseconds
+ * @retval None
+ */
+void
+TimeBase_MockSetUs(
+    uint64_t qwUs
+) {
+    g_qwMockUs = qwUs;
+}
+
+/**
+ * @func   TimeBase_MockAdvanceUs
+ * @brief  Moves the mock clock forward (host tests)
+ * @param  qwUs: Microseconds
+ * @retval None
+ */
+void
+TimeBase_MockAdvanceUs(
+    uint64_t qwUs
+) {
+    g_qwMockUs += qwUs;
+}
+
+/**
+ * @func   TimeBase_MockCycles
+ * @brief  Gets the cycle counter of the mock clock (host tests)
+ * @param  None
+ * @retval Cycles, wrapping as the DWT cycle counter
+ */
+uint32_t
+TimeBase_MockCycles(void) {
+    return (uint32_t)(g_qwMockUs * g_dwCyclesPerUs);
+}
+#endif
+
+/* END FILE */
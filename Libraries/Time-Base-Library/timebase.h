@@ -0,0 +1,221 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: 64-bit microsecond time base and wrap-free time helpers
+ *
+ ******************************************************************************/
+#ifndef _TIMEBASE_H_
+#define _TIMEBASE_H_
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <stdint.h>
+#if defined(STM32F4)
+#include "stm32f401re.h"
+#endif
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+/*!
+ * One time base for the timing code of the applications:
+ *
+ * - TimeBase_GetUs: microseconds since TimerInit on 64 bits, which do not wrap.
+ *   The milliseconds come from GetMilSecTick (SDK timer or Timer-Wheel-Library),
+ *   extended to 64 bits, the microseconds within the millisecond from SysTick.
+ *   SysTick keeps counting in the WFI sleep, when the DWT cycle counter stops.
+ * - TimeBase_GetCycles: DWT cycle counter, for short intervals of code that does
+ *   not sleep (latency, run time). It wraps every 51 s at 84 MHz.
+ * - TimeBase_ElapsedMs / TimeBase_IsReachedMs: for the 32-bit GetMilSecTick
+ *   stamps, right across the wrap (49.7 days) as long as the interval is shorter
+ *   than the wrap. They replace the "if (now >= init) ... else 0xFFFFFFFF ..."
+ *   copies, which were one millisecond short (or wrong) after the wrap.
+ *
+ * TimeBase_GetUs must be called at least once per 49.7 days to see each wrap
+ * of GetMilSecTick; any call from the main loop does it.
+ *
+ * Without STM32F4 (host tests) the time is a mock clock, set and moved by
+ * TimeBase_MockSetUs and TimeBase_MockAdvanceUs. Its milliseconds are cut to
+ * 32 bits, as GetMilSecTick, and go through the same 64-bit extension
+ * (see Tools/Time-Base-Test).
+ */
+
+/* DWT cycle counter (counts up, wraps) */
+#if defined(STM32F4)
+#define TIME_BASE_CYCLES()          (DWT->CYCCNT)
+#else
+#define TIME_BASE_CYCLES()          TimeBase_MockCycles()
+#endif
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   TimeBase_Init
+ * @brief  Sets the core clock and starts the cycle counter
+ * @param  dwCyclesPerUs: Core clock (MHz), SystemCoreClock / 1000000
+ * @retval None
+ */
+void
+TimeBase_Init(
+    uint32_t dwCyclesPerUs
+);
+
+/**
+ * @func   TimeBase_GetUs
+ * @brief  Gets the microseconds since TimerInit
+ * @param  None
+ * @retval Microseconds, 64 bits
+ */
+uint64_t
+TimeBase_GetUs(void);
+
+/**
+ * @func   TimeBase_GetMs
+ * @brief  Gets the milliseconds since TimerInit
+ * @param  None
+ * @retval Milliseconds, 64 bits
+ */
+uint64_t
+TimeBase_GetMs(void);
+
+/**
+ * @func   TimeBase_CyclesToUs
+ * @brief  Converts cycles of the cycle counter to microseconds
+ * @param  dwCycles: Cycles
+ * @retval Microseconds
+ */
+uint32_t
+TimeBase_CyclesToUs(
+    uint32_t dwCycles
+);
+
+#if !defined(STM32F4)
+/**
+ * @func   TimeBase_MockSetUs
+ * @brief  Sets the mock clock (host tests)
+ * @param  qwUs: Microseconds
+ * @retval None
+ */
+void
+TimeBase_MockSetUs(
+    uint64_t qwUs
+);
+
+/**
+ * @func   TimeBase_MockAdvanceUs
+ * @brief  Moves the mock clock forward (host tests)
+ * @param  qwUs: Microseconds
+ * @retval None
+ */
+void
+TimeBase_MockAdvanceUs(
+    uint64_t qwUs
+);
+
+/**
+ * @func   TimeBase_MockCycles
+ * @brief  Gets the cycle counter of the mock clock (host tests)
+ * @param  None
+ * @retval Cycles, wrapping as the DWT cycle counter
+ */
+uint32_t
+TimeBase_MockCycles(void);
+#endif
+
+/**
+ * @func   TimeBase_GetCycles
+ * @brief  Reads the cycle counter
+ * @param  None
+ * @retval Cycle count, TimeBase_GetCycles() - start is wrap-free
+ */
+static inline uint32_t
+TimeBase_GetCycles(void) {
+    return TIME_BASE_CYCLES();
+}
+
+/**
+ * @func   TimeBase_ElapsedMs
+ * @brief  Gets the time between two GetMilSecTick stamps
+ * @param  dwStart: Earlier stamp
+ * @param  dwNow: Later stamp
+ * @retval Milliseconds, right across the wrap of the tick
+ */
+static inline uint32_t
+TimeBase_ElapsedMs(
+    uint32_t dwStart,
+    uint32_t dwNow
+) {
+    return dwNow - dwStart;
+}
+
+/**
+ * @func   TimeBase_IsReachedMs
+ * @brief  Tells whether a GetMilSecTick deadline is reached
+ * @param  dwDeadline: Stamp of the deadline, GetMilSecTick() + delay
+ * @param  dwNow: Current stamp
+ * @retval 1 if reached or passed (by less than 24.8 days)
+ */
+static inline uint8_t
+TimeBase_IsReachedMs(
+    uint32_t dwDeadline,
+    uint32_t dwNow
+) {
+    return ((int32_t)(dwNow - dwDeadline) >= 0) ? 1 : 0;
+}
+
+/**
+ * @func   TimeBase_ElapsedUs
+ * @brief  Gets the time since a TimeBase_GetUs stamp
+ * @param  qwStart: Stamp
+ * @retval Microseconds
+ */
+static inline uint64_t
+TimeBase_ElapsedUs(
+    uint64_t qwStart
+) {
+    return TimeBase_GetUs() - qwStart;
+}
+
+/**
+ * @func   TimeBase_DeadlineUs
+ * @brief  Gets the deadline a delay from now
+ * @param  qwDelayUs: Delay (us)
+ * @retval Deadline for TimeBase_IsExpiredUs
+ */
+static inline uint64_t
+TimeBase_DeadlineUs(
+    uint64_t qwDelayUs
+) {
+    return TimeBase_GetUs() + qwDelayUs;
+}
+
+/**
+ * @func   TimeBase_IsExpiredUs
+ * @brief  Tells whether a deadline is reached
+ * @param  qwDeadlineUs: TimeBase_DeadlineUs
+ * @retval 1 if reached or passed
+ */
+static inline uint8_t
+TimeBase_IsExpiredUs(
+    uint64_t qwDeadlineUs
+) {
+    return (TimeBase_GetUs() >= qwDeadlineUs) ? 1 : 0;
+}
+
+#endif /* _TIMEBASE_H_ */
+
+/* END FILE */
@@ -0,0 +1,268 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: Tickless idle of the main loop until the next timer deadline
+ *
+ ******************************************************************************/
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <stddef.h>
+#include "idlesleep.h"
+#if (TIMER_WHEEL_USE_SYSTICK == 1)
+#include "stm32f401re.h"
+#endif
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+/* Largest value SysTick counts down from, plus one */
+#define IDLE_SYSTICK_RANGE          0x1000000UL
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+static idle_pending_f g_pfnPending = NULL;
+
+#if (TIMER_WHEEL_USE_SYSTICK == 1)
+/* SysTick counts (core cycles) in one millisecond */
+static uint32_t g_dwCyclesPerMs = 1;
+
+/* Longest sleep SysTick can time in one period (ms) */
+static uint32_t g_dwSleepMsLimit = IDLE_SLEEP_MS_MAX;
+#endif
+
+/* Time asleep since the last IdleSleep_GetPercent: whole milliseconds, and
+ * the cycles of the millisecond not complete yet */
+static uint32_t g_dwIdleMs = 0;
+static uint32_t g_dwIdleCycles = 0;
+
+static uint32_t g_dwWindowTick = 0;
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+#if (TIMER_WHEEL_USE_SYSTICK == 1)
+/**
+ * @func   IdleSleep_Account
+ * @brief  Adds a sleep to the idle time
+ * @param  dwCycles: Length of the sleep (SysTick counts)
+ * @retval None
+ */
+static void
+IdleSleep_Account(
+    uint32_t dwCycles
+) {
+    g_dwIdleCycles += dwCycles;
+    g_dwIdleMs += g_dwIdleCycles / g_dwCyclesPerMs;
+    g_dwIdleCycles %= g_dwCyclesPerMs;
+}
+
+/**
+ * @func   IdleSleep_WaitTick
+ * @brief  Sleeps until the next SysTick interrupt or any other interrupt
+ * @param  None
+ * @retval None
+ */
+static void
+IdleSleep_WaitTick(void) {
+    uint32_t dwStart = SysTick->VAL;
+    uint32_t dwEnd;
+
+    __DSB();
+    __WFI();
+    __ISB();
+
+    /* SysTick counts down and reloads at most once before it wakes the core */
+    dwEnd = SysTick->VAL;
+    if (dwEnd <= dwStart) {
+        IdleSleep_Account(dwStart - dwEnd);
+    } else {
+        IdleSleep_Account(dwStart + g_dwCyclesPerMs - dwEnd);
+    }
+}
+
+/**
+ * @func   IdleSleep_WaitTickless
+ * @brief  Sleeps with one SysTick interrupt at the deadline instead of one
+ *         every millisecond, then counts the milliseconds skipped
+ * @param  dwSleepMs: Time to the deadline (ms), 2 to g_dwSleepMsLimit
+ * @retval None
+ */
+static void
+IdleSleep_WaitTickless(
+    uint32_t dwSleepMs
+) {
+    uint32_t dwRemain;
+    uint32_t dwReload;
+    uint32_t dwCtrl;
+    uint32_t dwValue;
+    uint32_t dwElapsed;
+    uint32_t dwTotal;
+    uint32_t dwTicks;
+    uint32_t dwNext;
+
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+
+    if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+        /* A tick is due already: count it and come back on the next loop */
+        SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+        return;
+    }
+
+    /* Rest of the current millisecond, then the whole ones to the deadline */
+    dwRemain = SysTick->VAL;
+    if (dwRemain == 0) {
+        dwRemain = g_dwCyclesPerMs;
+    }
+    dwReload = dwRemain + (dwSleepMs - 1) * g_dwCyclesPerMs;
+
+    SysTick->LOAD = dwReload - 1;
+    SysTick->VAL = 0;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+    __DSB();
+    __WFI();
+    __ISB();
+
+    /* COUNTFLAG is cleared by the read, keep it */
+    dwCtrl = SysTick->CTRL;
+    SysTick->CTRL = dwCtrl & ~SysTick_CTRL_ENABLE_Msk;
+    dwValue = SysTick->VAL;
+
+    if (dwCtrl & SysTick_CTRL_COUNTFLAG_Msk) {
+        /* Woken by the deadline, SysTick went on with a new period */
+        dwElapsed = dwReload + (dwReload - 1 - dwValue);
+    } else {
+        /* Woken by another interrupt */
+        dwElapsed = dwReload - 1 - dwValue;
+    }
+
+    /* Milliseconds crossed since the last tick counted */
+    dwTotal = (g_dwCyclesPerMs - dwRemain) + dwElapsed;
+    dwTicks = dwTotal / g_dwCyclesPerMs;
+    if (dwCtrl & SysTick_CTRL_COUNTFLAG_Msk) {
+        /* The SysTick interrupt is pending and counts one of them */
+        dwTicks--;
+    }
+
+    /* Finish the current millisecond, then go back to the usual period. A
+     * reload of 0 would stop SysTick: a millisecond about to end is counted
+     * here instead */
+    dwNext = g_dwCyclesPerMs - (dwTotal % g_dwCyclesPerMs);
+    if (dwNext < 2) {
+        dwTicks++;
+        dwNext = g_dwCyclesPerMs;
+    }
+    SysTick->LOAD = dwNext - 1;
+    SysTick->VAL = 0;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = g_dwCyclesPerMs - 1;
+
+    TimerWheel_AddTicks(dwTicks);
+    IdleSleep_Account(dwElapsed);
+}
+#endif
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   IdleSleep_Init
+ * @brief  Initializes the idle hook, after TimerInit
+ * @param  pending: Function telling if the main loop has work left, or NULL
+ * @retval None
+ */
+void
+IdleSleep_Init(
+    idle_pending_f pending
+) {
+    g_pfnPending = pending;
+    g_dwIdleMs = 0;
+    g_dwIdleCycles = 0;
+    g_dwWindowTick = GetMilSecTick();
+
+#if (TIMER_WHEEL_USE_SYSTICK == 1)
+    g_dwCyclesPerMs = SysTick->LOAD + 1;
+    g_dwSleepMsLimit = IDLE_SYSTICK_RANGE / g_dwCyclesPerMs;
+
+    /* Keep the debugger connected while the core sleeps */
+    DBGMCU->CR |= DBGMCU_CR_DBG_SLEEP;
+#endif
+}
+
+/**
+ * @func   IdleSleep_Enter
+ * @brief  Sleeps until the next timer deadline, an interrupt or dwMaxSleepMs
+ * @param  dwMaxSleepMs: Deadline of the application itself (ms), or
+ *         TIMER_WHEEL_NO_DEADLINE
+ * @retval None
+ */
+void
+IdleSleep_Enter(
+    uint32_t dwMaxSleepMs
+) {
+#if (TIMER_WHEEL_USE_SYSTICK == 1)
+    uint32_t dwSleepMs;
+
+    /* An interrupt raised from here on wakes WFI up, and runs once unmasked */
+    __disable_irq();
+
+    if ((g_pfnPending != NULL) && g_pfnPending()) {
+        __enable_irq();
+        return;
+    }
+
+    dwSleepMs = TimerWheel_NextDeadline();
+    if (dwSleepMs > dwMaxSleepMs) {
+        dwSleepMs = dwMaxSleepMs;
+    }
+    if (dwSleepMs > IDLE_SLEEP_MS_MAX) {
+        dwSleepMs = IDLE_SLEEP_MS_MAX;
+    }
+    if (dwSleepMs > g_dwSleepMsLimit) {
+        dwSleepMs = g_dwSleepMsLimit;
+    }
+
+    if (dwSleepMs == 1) {
+        IdleSleep_WaitTick();
+    } else if (dwSleepMs > 1) {
+        IdleSleep_WaitTickless(dwSleepMs);
+    }
+
+    __enable_irq();
+#else
+    (void)dwMaxSleepMs;
+#endif
+}
+
+/**
+ * @func   IdleSleep_GetPercent
+ * @brief  Gets the share of time spent asleep since the previous call
+ * @param  None
+ * @retval Idle time (%), 100 minus the CPU load
+ */
+uint8_t
+IdleSleep_GetPercent(void) {
+    uint32_t dwNow = GetMilSecTick();
+    uint32_t dwTotal = dwNow - g_dwWindowTick;
+    uint8_t byPercent = 0;
+
+    if (dwTotal != 0) {
+        if (g_dwIdleMs >= dwTotal) {
+            byPercent = 100;
+        } else {
+            byPercent = (uint8_t)((g_dwIdleMs * 100UL) / dwTotal);
+        }
+    }
+
+    g_dwWindowTick = dwNow;
+    g_dwIdleMs = 0;
+
+    return byPercent;
+}
+
+/* END FILE */
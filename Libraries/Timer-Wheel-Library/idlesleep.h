@@ -0,0 +1,89 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: Tickless idle of the main loop until the next timer deadline
+ *
+ ******************************************************************************/
+#ifndef _IDLESLEEP_H_
+#define _IDLESLEEP_H_
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <stdint.h>
+#include "timerwheel.h"
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+/*!
+ * IdleSleep_Enter is called at the end of the main loop. With the interrupts
+ * masked it asks the application whether work is pending, then stops the core
+ * with WFI (Sleep mode) until the next deadline of the Timer-Wheel-Library or
+ * an interrupt, whichever comes first. For sleeps longer than a millisecond
+ * SysTick is programmed to interrupt once at the deadline instead of every
+ * millisecond, and the ticks skipped are added to GetMilSecTick on wake-up.
+ *
+ * Sleep mode keeps every peripheral (USART, DMA, ADC) running. STOP mode is
+ * not used: it stops the clocks of the USART and of the DMA receiving from it.
+ */
+
+/* Longest sleep (ms): bounds the delay of work the pending function cannot
+ * see, such as a second event left in the SDK event queue */
+#ifndef IDLE_SLEEP_MS_MAX
+#define IDLE_SLEEP_MS_MAX           20u
+#endif
+
+/*! @brief Returns 1 if the main loop has work left, called with interrupts masked */
+typedef uint8_t (* idle_pending_f)(void);
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   IdleSleep_Init
+ * @brief  Initializes the idle hook, after TimerInit
+ * @param  pending: Function telling if the main loop has work left, or NULL
+ * @retval None
+ */
+void
+IdleSleep_Init(
+    idle_pending_f pending
+);
+
+/**
+ * @func   IdleSleep_Enter
+ * @brief  Sleeps until the next timer deadline, an interrupt or dwMaxSleepMs
+ * @param  dwMaxSleepMs: Deadline of the application itself (ms), or
+ *         TIMER_WHEEL_NO_DEADLINE
+ * @retval None
+ */
+void
+IdleSleep_Enter(
+    uint32_t dwMaxSleepMs
+);
+
+/**
+ * @func   IdleSleep_GetPercent
+ * @brief  Gets the share of time spent asleep since the previous call
+ * @param  None
+ * @retval Idle time (%), 100 minus the CPU load
+ */
+uint8_t
+IdleSleep_GetPercent(void);
+
+#endif /* _IDLESLEEP_H_ */
+
+/* END FILE */
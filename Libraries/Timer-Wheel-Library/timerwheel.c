@@ -0,0 +1,574 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: Software timers on a hierarchical timing wheel
+ *
+ ******************************************************************************/
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <stddef.h>
+#include "timerwheel.h"
+#if (TIMER_WHEEL_USE_SYSTICK == 1)
+#include "stm32f401re.h"
+#endif
+#ifdef USE_SCHED_PROFILER
+#include "schedprofiler.h"
+#endif
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+#define TIMER_WHEEL_ROOT_MASK       (TIMER_WHEEL_ROOT_SIZE - 1u)
+#define TIMER_WHEEL_LEVEL_MASK      (TIMER_WHEEL_LEVEL_SIZE - 1u)
+
+/* Extra list holding the timers of the slot being expired */
+#define TIMER_WHEEL_SLOT_EXPIRED    TIMER_WHEEL_SLOTS
+/* Slot index of a timer that is not running */
+#define TIMER_WHEEL_SLOT_NONE       0xFFFFu
+
+/*!
+ * Timer, linked in the list of its slot (or in the free list)
+ */
+typedef struct __timer_wheel_node__ {
+
+    void (*callback)(void *);   /*< Function called on expiry */
+
+    void *pData;                /*< Parameter of callback */
+
+    char *pName;                /*< Name given to TimerStart */
+
+    uint32_t dwExpire;          /*< Tick of the next expiry */
+
+    uint32_t dwPeriod;          /*< Period (ms) */
+
+    uint16_t wSlot;             /*< Slot holding the timer, TIMER_WHEEL_SLOT_NONE if stopped */
+
+    uint8_t byNext;             /*< Next timer of the list, NO_TIMER at the end */
+
+    uint8_t byPrev;             /*< Previous timer of the list, NO_TIMER at the head */
+
+    uint8_t byRepeats;          /*< Expiries left, TIMER_REPEAT_FOREVER */
+
+#ifdef USE_SCHED_PROFILER
+    uint8_t byProfileSlot;      /*< Slot of pName in the scheduler profiler */
+#endif
+
+} timer_wheel_node_t;
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+static timer_wheel_node_t g_aTimer[TIMER_WHEEL_CAPACITY];
+
+/* First timer of each slot, NO_TIMER for an empty slot */
+static uint8_t g_aSlotHead[TIMER_WHEEL_SLOTS + 1];
+
+/* First stopped timer, the free list is linked with byNext */
+static uint8_t g_byFreeHead;
+
+static uint8_t g_byActiveCount;
+
+/* Next tick to be expired by processTimerScheduler */
+static uint32_t g_dwWheelTick;
+
+static volatile uint32_t g_dwMilSecTick;
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+/**
+ * @func   TimerWheel_SlotOf
+ * @brief  Chooses the slot of an expiry time
+ * @param  dwExpire: Tick of the expiry
+ * @retval Slot index
+ */
+static uint16_t
+TimerWheel_SlotOf(
+    uint32_t dwExpire
+) {
+    uint32_t dwDelta = dwExpire - g_dwWheelTick;
+    uint8_t byShift = TIMER_WHEEL_ROOT_BITS;
+    uint8_t i;
+
+    if ((int32_t)dwDelta < 0) {
+        /* Already due: expire on the next tick processed */
+        return (uint16_t)(g_dwWheelTick & TIMER_WHEEL_ROOT_MASK);
+    }
+
+    if (dwDelta < TIMER_WHEEL_ROOT_SIZE) {
+        return (uint16_t)(dwExpire & TIMER_WHEEL_ROOT_MASK);
+    }
+
+    for (i = 0; i < (TIMER_WHEEL_LEVELS - 1); i++) {
+        if (dwDelta < (1UL << (byShift + TIMER_WHEEL_LEVEL_BITS))) {
+            break;
+        }
+        byShift += TIMER_WHEEL_LEVEL_BITS;
+    }
+
+    return (uint16_t)(TIMER_WHEEL_ROOT_SIZE + i * TIMER_WHEEL_LEVEL_SIZE +
+                      ((dwExpire >> byShift) & TIMER_WHEEL_LEVEL_MASK));
+}
+
+/**
+ * @func   TimerWheel_Link
+ * @brief  Puts a timer at the head of a slot
+ * @param  byTimerId: Index of the timer
+ * @param  wSlot: Slot index
+ * @retval None
+ */
+static void
+TimerWheel_Link(
+    uint8_t byTimerId,
+    uint16_t wSlot
+) {
+    timer_wheel_node_t *pTimer = &g_aTimer[byTimerId];
+    uint8_t byHead = g_aSlotHead[wSlot];
+
+    pTimer->wSlot = wSlot;
+    pTimer->byPrev = NO_TIMER;
+    pTimer->byNext = byHead;
+    if (byHead != NO_TIMER) {
+        g_aTimer[byHead].byPrev = byTimerId;
+    }
+    g_aSlotHead[wSlot] = byTimerId;
+}
+
+/**
+ * @func   TimerWheel_Unlink
+ * @brief  Takes a timer out of its slot
+ * @param  byTimerId: Index of the timer
+ * @retval None
+ */
+static void
+TimerWheel_Unlink(
+    uint8_t byTimerId
+) {
+    timer_wheel_node_t *pTimer = &g_aTimer[byTimerId];
+
+    if (pTimer->byPrev != NO_TIMER) {
+        g_aTimer[pTimer->byPrev].byNext = pTimer->byNext;
+    } else {
+        g_aSlotHead[pTimer->wSlot] = pTimer->byNext;
+    }
+
+    if (pTimer->byNext != NO_TIMER) {
+        g_aTimer[pTimer->byNext].byPrev = pTimer->byPrev;
+    }
+
+    pTimer->wSlot = TIMER_WHEEL_SLOT_NONE;
+}
+
+/**
+ * @func   TimerWheel_Release
+ * @brief  Puts a timer taken out of its slot back in the free list
+ * @param  byTimerId: Index of the timer
+ * @retval None
+ */
+static void
+TimerWheel_Release(
+    uint8_t byTimerId
+) {
+    g_aTimer[byTimerId].byNext = g_byFreeHead;
+    g_byFreeHead = byTimerId;
+    g_byActiveCount--;
+}
+
+/**
+ * @func   TimerWheel_Arm
+ * @brief  Sets the period and expiry of a timer and links it in its slot
+ * @param  byTimerId: Index of the timer (not linked)
+ * @param  dwMilSecTick: Period (ms)
+ * @param  byRepeats: Number of expiries, as in TimerStart
+ * @retval None
+ */
+static void
+TimerWheel_Arm(
+    uint8_t byTimerId,
+    uint32_t dwMilSecTick,
+    uint8_t byRepeats
+) {
+    timer_wheel_node_t *pTimer = &g_aTimer[byTimerId];
+
+    if (dwMilSecTick > TIMER_WHEEL_PERIOD_MAX) {
+        dwMilSecTick = TIMER_WHEEL_PERIOD_MAX;
+    }
+
+    pTimer->dwPeriod = dwMilSecTick;
+    pTimer->dwExpire = g_dwMilSecTick + dwMilSecTick;
+    pTimer->byRepeats = (byRepeats == TIMER_REPEAT_ONE_TIME) ? 1 : byRepeats;
+    TimerWheel_Link(byTimerId, TimerWheel_SlotOf(pTimer->dwExpire));
+}
+
+/**
+ * @func   TimerWheel_Cascade
+ * @brief  Spreads the timers of a slot of an upper wheel on the wheels below
+ * @param  wSlot: Slot index
+ * @retval None
+ */
+static void
+TimerWheel_Cascade(
+    uint16_t wSlot
+) {
+    uint8_t byTimerId = g_aSlotHead[wSlot];
+    uint8_t byNext;
+
+    g_aSlotHead[wSlot] = NO_TIMER;
+    while (byTimerId != NO_TIMER) {
+        byNext = g_aTimer[byTimerId].byNext;
+        TimerWheel_Link(byTimerId,
+                        TimerWheel_SlotOf(g_aTimer[byTimerId].dwExpire));
+        byTimerId = byNext;
+    }
+}
+
+/**
+ * @func   TimerWheel_Expire
+ * @brief  Re-arms or releases a timer taken out of its slot, then calls it
+ * @param  byTimerId: Index of the timer
+ * @retval None
+ */
+static void
+TimerWheel_Expire(
+    uint8_t byTimerId
+) {
+    timer_wheel_node_t *pTimer = &g_aTimer[byTimerId];
+    void (*callback)(void *) = pTimer->callback;
+    void *pData = pTimer->pData;
+#ifdef USE_SCHED_PROFILER
+    uint8_t byProfileSlot = pTimer->byProfileSlot;
+    uint32_t dwLateCycles = SchedProfiler_MsToCycles(g_dwMilSecTick - pTimer->dwExpire);
+    uint32_t dwStartCycles;
+
+#if (TIMER_WHEEL_USE_SYSTICK == 1)
+    /* Plus the time elapsed since the current tick */
+    dwLateCycles += SysTick->LOAD - SysTick->VAL;
+#endif
+#endif
+
+    if (pTimer->byRepeats != TIMER_REPEAT_FOREVER) {
+        pTimer->byRepeats--;
+    }
+
+    if (pTimer->byRepeats != 0) {
+        /* From the previous expiry, so a late main loop does not add drift */
+        pTimer->dwExpire += pTimer->dwPeriod;
+        TimerWheel_Link(byTimerId, TimerWheel_SlotOf(pTimer->dwExpire));
+    } else {
+        TimerWheel_Release(byTimerId);
+    }
+
+    /* The callback may stop or start timers, this one included */
+    if (callback != NULL) {
+#ifdef USE_SCHED_PROFILER
+        dwStartCycles = SchedProfiler_Now();
+        callback(pData);
+        SchedProfiler_Record(byProfileSlot, dwStartCycles, dwLateCycles);
+#else
+        callback(pData);
+#endif
+    }
+}
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   TimerInit
+ * @brief  Stops every timer and starts the millisecond tick
+ * @param  None
+ * @retval None
+ */
+void
+TimerInit(void) {
+    uint16_t i;
+
+    for (i = 0; i < (TIMER_WHEEL_SLOTS + 1); i++) {
+        g_aSlotHead[i] = NO_TIMER;
+    }
+
+    for (i = 0; i < TIMER_WHEEL_CAPACITY; i++) {
+        g_aTimer[i].wSlot = TIMER_WHEEL_SLOT_NONE;
+        g_aTimer[i].byNext = ((uint16_t)(i + 1) < TIMER_WHEEL_CAPACITY) ? (uint8_t)(i + 1) : NO_TIMER;
+    }
+
+    g_byFreeHead = 0;
+    g_byActiveCount = 0;
+    g_dwWheelTick = g_dwMilSecTick;
+
+#if (TIMER_WHEEL_USE_SYSTICK == 1)
+    SysTick_Config(SystemCoreClock / 1000);
+#endif
+}
+
+/**
+ * @func   TimerStart
+ * @brief  Starts a timer
+ * @param  name: Name of the timer (kept for debugging)
+ * @param  dwMilSecTick: Period (ms)
+ * @param  byRepeats: Number of expiries, TIMER_REPEAT_ONE_TIME (same as 1)
+ *         or TIMER_REPEAT_FOREVER
+ * @param  callback: Function called from processTimerScheduler on expiry
+ * @param  pcallbackData: Parameter of callback
+ * @retval Index of the timer, NO_TIMER when all of them are running
+ */
+uint8_t
+TimerStart(
+    char* name,
+    uint32_t dwMilSecTick,
+    uint8_t byRepeats,
+    void (*callback)(void *),
+    void *pcallbackData
+) {
+    uint8_t byTimerId = g_byFreeHead;
+
+    if (byTimerId == NO_TIMER) {
+        return NO_TIMER;
+    }
+
+    g_byFreeHead = g_aTimer[byTimerId].byNext;
+    g_byActiveCount++;
+
+    g_aTimer[byTimerId].pName = name;
+#ifdef USE_SCHED_PROFILER
+    g_aTimer[byTimerId].byProfileSlot = SchedProfiler_Register(name);
+#endif
+    g_aTimer[byTimerId].callback = callback;
+    g_aTimer[byTimerId].pData = pcallbackData;
+    TimerWheel_Arm(byTimerId, dwMilSecTick, byRepeats);
+
+    return byTimerId;
+}
+
+/**
+ * @func   TimerChangePeriod
+ * @brief  Changes the period of a running timer from its next expiry on
+ * @param  byTimerId: Index of the timer
+ * @param  dwPeriodTicks: New period (ms)
+ * @retval None
+ */
+void
+TimerChangePeriod(
+    uint8_t byTimerId,
+    uint32_t dwPeriodTicks
+) {
+    if ((byTimerId >= TIMER_WHEEL_CAPACITY) ||
+        (g_aTimer[byTimerId].wSlot == TIMER_WHEEL_SLOT_NONE)) {
+        return;
+    }
+
+    if (dwPeriodTicks > TIMER_WHEEL_PERIOD_MAX) {
+        dwPeriodTicks = TIMER_WHEEL_PERIOD_MAX;
+    }
+
+    g_aTimer[byTimerId].dwPeriod = dwPeriodTicks;
+}
+
+/**
+ * @func   TimerRestart
+ * @brief  Starts a running timer again from now
+ * @param  byTimerId: Index of the timer
+ * @param  dwMilSecTick: Period (ms)
+ * @param  byRepeats: Number of expiries, as in TimerStart
+ * @retval byTimerId, NO_TIMER when the timer is not running
+ */
+uint8_t
+TimerRestart(
+    uint8_t byTimerId,
+    uint32_t dwMilSecTick,
+    uint8_t byRepeats
+) {
+    if ((byTimerId >= TIMER_WHEEL_CAPACITY) ||
+        (g_aTimer[byTimerId].wSlot == TIMER_WHEEL_SLOT_NONE)) {
+        return NO_TIMER;
+    }
+
+    TimerWheel_Unlink(byTimerId);
+    TimerWheel_Arm(byTimerId, dwMilSecTick, byRepeats);
+
+    return byTimerId;
+}
+
+/**
+ * @func   TimerStop
+ * @brief  Stops a timer, its index may be given to the next TimerStart
+ * @param  byTimerId: Index of the timer
+ * @retval 1 if the timer was running, 0 otherwise
+ */
+uint8_t
+TimerStop(
+    uint8_t byTimerId
+) {
+    if ((byTimerId >= TIMER_WHEEL_CAPACITY) ||
+        (g_aTimer[byTimerId].wSlot == TIMER_WHEEL_SLOT_NONE)) {
+        return 0;
+    }
+
+    TimerWheel_Unlink(byTimerId);
+    TimerWheel_Release(byTimerId);
+
+    return 1;
+}
+
+/**
+ * @func   GetMilSecTick
+ * @brief  Gets the number of milliseconds since TimerInit
+ * @param  None
+ * @retval Millisecond tick (wraps after 49.7 days)
+ */
+uint32_t
+GetMilSecTick(void) {
+    return g_dwMilSecTick;
+}
+
+/**
+ * @func   TimerWheel_Tick
+ * @brief  Counts one millisecond, called from SysTick_Handler (or a test)
+ * @param  None
+ * @retval None
+ */
+void
+TimerWheel_Tick(void) {
+    g_dwMilSecTick++;
+}
+
+/**
+ * @func   TimerWheel_AddTicks
+ * @brief  Counts several milliseconds at once, after a sleep without SysTick
+ *         interrupts
+ * @param  dwTicks: Number of milliseconds
+ * @retval None
+ */
+void
+TimerWheel_AddTicks(
+    uint32_t dwTicks
+) {
+    g_dwMilSecTick += dwTicks;
+}
+
+/**
+ * @func   TimerWheel_NextDeadline
+ * @brief  Gets the time processTimerScheduler may be left alone
+ * @param  None
+ * @retval Milliseconds to the next expiry (0 if processTimerScheduler is late),
+ *         TIMER_WHEEL_NO_DEADLINE if no timer is running
+ * @note   The time to the next cascade of the upper wheels is returned when it
+ *         comes first, so the result may be earlier than the real expiry, never
+ *         later
+ */
+uint32_t
+TimerWheel_NextDeadline(void) {
+    uint32_t dwNow = g_dwMilSecTick;
+    uint32_t dwTick = g_dwWheelTick;
+    uint32_t dwCascade;
+
+    if (g_byActiveCount == 0) {
+        return TIMER_WHEEL_NO_DEADLINE;
+    }
+
+    if ((int32_t)(dwNow - dwTick) >= 0) {
+        return 0;
+    }
+
+    /* The slots of the first wheel up to its wrap hold the earliest timers;
+     * those of the upper wheels only expire after the cascade */
+    dwCascade = (dwTick | TIMER_WHEEL_ROOT_MASK) + 1;
+    while (dwTick != dwCascade) {
+        if (g_aSlotHead[dwTick & TIMER_WHEEL_ROOT_MASK] != NO_TIMER) {
+            break;
+        }
+        dwTick++;
+    }
+
+    return dwTick - dwNow;
+}
+
+/**
+ * @func   TimerWheel_ActiveCount
+ * @brief  Gets the number of running timers
+ * @param  None
+ * @retval Number of running timers
+ */
+uint8_t
+TimerWheel_ActiveCount(void) {
+    return g_byActiveCount;
+}
+
+/**
+ * @func   processTimerScheduler
+ * @brief  Expires the timers due up to the current tick, called from the
+ *         main loop
+ * @param  None
+ * @retval None
+ */
+void
+processTimerScheduler(void) {
+    uint32_t dwNow = g_dwMilSecTick;
+    uint16_t wSlot;
+    uint8_t byTimerId;
+    uint8_t byShift;
+    uint8_t i;
+
+    if (g_byActiveCount == 0) {
+        /* Nothing to expire, the wheel does not need to turn */
+        g_dwWheelTick = dwNow + 1;
+        return;
+    }
+
+    while ((int32_t)(dwNow - g_dwWheelTick) >= 0) {
+        wSlot = (uint16_t)(g_dwWheelTick & TIMER_WHEEL_ROOT_MASK);
+
+        if (wSlot == 0) {
+            /* The first wheel wrapped: bring down the next slot of each
+             * upper wheel until one of them does not wrap either */
+            byShift = TIMER_WHEEL_ROOT_BITS;
+            for (i = 0; i < TIMER_WHEEL_LEVELS; i++) {
+                uint16_t wIndex = (uint16_t)((g_dwWheelTick >> byShift) &
+                                             TIMER_WHEEL_LEVEL_MASK);
+
+                TimerWheel_Cascade(TIMER_WHEEL_ROOT_SIZE +
+                                   i * TIMER_WHEEL_LEVEL_SIZE + wIndex);
+                if (wIndex != 0) {
+                    break;
+                }
+                byShift += TIMER_WHEEL_LEVEL_BITS;
+            }
+        }
+
+        /* Move the slot to the expired list, so that the timers started by
+         * the callbacks go to the next ticks and TimerStop still finds them */
+        byTimerId = g_aSlotHead[wSlot];
+        g_aSlotHead[wSlot] = NO_TIMER;
+        g_aSlotHead[TIMER_WHEEL_SLOT_EXPIRED] = byTimerId;
+        while (byTimerId != NO_TIMER) {
+            g_aTimer[byTimerId].wSlot = TIMER_WHEEL_SLOT_EXPIRED;
+            byTimerId = g_aTimer[byTimerId].byNext;
+        }
+
+        g_dwWheelTick++;
+
+        while ((byTimerId = g_aSlotHead[TIMER_WHEEL_SLOT_EXPIRED]) != NO_TIMER) {
+            TimerWheel_Unlink(byTimerId);
+            TimerWheel_Expire(byTimerId);
+        }
+    }
+}
+
+#if (TIMER_WHEEL_USE_SYSTICK == 1)
+/**
+ * @func   SysTick_Handler
+ * @brief  Interrupt of SysTick, every millisecond
+ * @param  None
+ * @retval None
+ */
+void
+SysTick_Handler(void) {
+    TimerWheel_Tick();
+}
+#endif
+
+/* END FILE */
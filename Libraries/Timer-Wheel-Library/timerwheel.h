@@ -0,0 +1,222 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2026
+ * Lumi, JSC.
+ * All Rights Reserved
+ *
+ * Description: Software timers on a hierarchical timing wheel
+ *
+ ******************************************************************************/
+#ifndef _TIMERWHEEL_H_
+#define _TIMERWHEEL_H_
+/******************************************************************************/
+/*                              INCLUDE FILES                                 */
+/******************************************************************************/
+#include <stdint.h>
+/******************************************************************************/
+/*                     EXPORTED TYPES and DEFINITIONS                         */
+/******************************************************************************/
+/*!
+ * The library implements the API of the SDK timer.h and is linked in place of
+ * the SDK timer. Projects that do so define USE_TIMER_WHEEL_LIBRARY, which
+ * makes the SDK timer.h include this header instead of its own definition.
+ *
+ * Every running timer sits in one slot of a wheel, chosen from its expiry
+ * time (ms). The first wheel has one slot per millisecond for the next 256 ms,
+ * each of the next four wheels has 64 slots of 64 times the span of a slot of
+ * the wheel below, so the five wheels cover the whole 32-bit tick range. When
+ * the first wheel wraps, the current slot of the second wheel is emptied into
+ * the first one, and so on upwards (cascade). A slot is a doubly linked list,
+ * so TimerStart and TimerStop take a constant time whatever the number of
+ * running timers, and processTimerScheduler only looks at the slot of the
+ * current millisecond.
+ *
+ * With USE_SCHED_PROFILER, each callback is recorded by Sched-Profiler-Library
+ * under the name given to TimerStart, with its lateness after the expiry tick.
+ */
+#ifndef TIMER_WHEEL_CAPACITY
+#define TIMER_WHEEL_CAPACITY        128u /* Timers, at most 255 (NO_TIMER is reserved) */
+#endif
+
+#if (TIMER_WHEEL_CAPACITY > 255u)
+#error "TIMER_WHEEL_CAPACITY must fit in a timer index (0..254)"
+#endif
+
+#define TIMER_WHEEL_ROOT_BITS       8u
+#define TIMER_WHEEL_LEVEL_BITS      6u
+#define TIMER_WHEEL_LEVELS          4u  /* Wheels above the first one */
+
+#define TIMER_WHEEL_ROOT_SIZE       (1u << TIMER_WHEEL_ROOT_BITS)
+#define TIMER_WHEEL_LEVEL_SIZE      (1u << TIMER_WHEEL_LEVEL_BITS)
+#define TIMER_WHEEL_SLOTS           (TIMER_WHEEL_ROOT_SIZE + \
+                                     TIMER_WHEEL_LEVELS * TIMER_WHEEL_LEVEL_SIZE)
+
+/* Longest period; longer ones are cut, as the tick is compared modulo 2^32 */
+#define TIMER_WHEEL_PERIOD_MAX      0x7FFFFFFFUL
+
+/* Returned by TimerWheel_NextDeadline when no timer is running */
+#define TIMER_WHEEL_NO_DEADLINE     0xFFFFFFFFUL
+
+#define MAX_TIMER                   TIMER_WHEEL_CAPACITY
+#define TIMER_REPEAT_ONE_TIME       0u
+#define TIMER_REPEAT_FOREVER        0xFFu
+#define NO_TIMER                    0xFFu
+
+typedef uint8_t SSwTimer;
+
+/* 1: TimerInit starts SysTick and SysTick_Handler counts the ticks */
+#ifndef TIMER_WHEEL_USE_SYSTICK
+#if defined(STM32F4) || defined(STM32F401xx)
+#define TIMER_WHEEL_USE_SYSTICK     1
+#else
+#define TIMER_WHEEL_USE_SYSTICK     0
+#endif
+#endif
+/******************************************************************************/
+/*                              PRIVATE DATA                                  */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                              EXPORTED DATA                                 */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            PRIVATE FUNCTIONS                               */
+/******************************************************************************/
+
+/******************************************************************************/
+/*                            EXPORTED FUNCTIONS                              */
+/******************************************************************************/
+/**
+ * @func   TimerInit
+ * @brief  Stops every timer and starts the millisecond tick
+ * @param  None
+ * @retval None
+ */
+void
+TimerInit(void);
+
+/**
+ * @func   TimerStart
+ * @brief  Starts a timer
+ * @param  name: Name of the timer (kept for debugging)
+ * @param  dwMilSecTick: Period (ms)
+ * @param  byRepeats: Number of expiries, TIMER_REPEAT_ONE_TIME (same as 1)
+ *         or TIMER_REPEAT_FOREVER
+ * @param  callback: Function called from processTimerScheduler on expiry
+ * @param  pcallbackData: Parameter of callback
+ * @retval Index of the timer, NO_TIMER when all of them are running
+ */
+uint8_t
+TimerStart(
+    char* name,
+    uint32_t dwMilSecTick,
+    uint8_t byRepeats,
+    void (*callback)(void *),
+    void *pcallbackData
+);
+
+/**
+ * @func   TimerChangePeriod
+ * @brief  Changes the period of a running timer from its next expiry on
+ * @param  byTimerId: Index of the timer
+ * @param  dwPeriodTicks: New period (ms)
+ * @retval None
+ */
+void
+TimerChangePeriod(
+    uint8_t byTimerId,
+    uint32_t dwPeriodTicks
+);
+
+/**
+ * @func   TimerRestart
+ * @brief  Starts a running timer again from now
+ * @param  byTimerId: Index of the timer
+ * @param  dwMilSecTick: Period (ms)
+ * @param  byRepeats: Number of expiries, as in TimerStart
+ * @retval byTimerId, NO_TIMER when the timer is not running
+ */
+uint8_t
+TimerRestart(
+    uint8_t byTimerId,
+    uint32_t dwMilSecTick,
+    uint8_t byRepeats
+);
+
+/**
+ * @func   TimerStop
+ * @brief  Stops a timer, its index may be given to the next TimerStart
+ * @param  byTimerId: Index of the timer
+ * @retval 1 if the timer was running, 0 otherwise
+ */
+uint8_t
+TimerStop(
+    uint8_t byTimerId
+);
+
+/**
+ * @func   GetMilSecTick
+ * @brief  Gets the number of milliseconds since TimerInit
+ * @param  None
+ * @retval Millisecond tick (wraps after 49.7 days)
+ */
+uint32_t
+GetMilSecTick(void);
+
+/**
+ * @func   TimerWheel_Tick
+ * @brief  Counts one millisecond, called from SysTick_Handler (or a test)
+ * @param  None
+ * @retval None
+ */
+void
+TimerWheel_Tick(void);
+
+/**
+ * @func   TimerWheel_AddTicks
+ * @brief  Counts several milliseconds at once, after a sleep without SysTick
+ *         interrupts
+ * @param  dwTicks: Number of milliseconds
+ * @retval None
+ */
+void
+TimerWheel_AddTicks(
+    uint32_t dwTicks
+);
+
+/**
+ * @func   TimerWheel_NextDeadline
+ * @brief  Gets the time processTimerScheduler may be left alone
+ * @param  None
+ * @retval Milliseconds to the next expiry (0 if processTimerScheduler is late),
+ *         TIMER_WHEEL_NO_DEADLINE if no timer is running
+ * @note   The time to the next cascade of the upper wheels is returned when it
+ *         comes first, so the result may be earlier than the real expiry, never
+ *         later
+ */
+uint32_t
+TimerWheel_NextDeadline(void);
+
+/**
+ * @func   TimerWheel_ActiveCount
+ * @brief  Gets the number of running timers
+ * @param  None
+ * @retval Number of running timers
+ */
+uint8_t
+TimerWheel_ActiveCount(void);
+
+/**
+ * @func   processTimerScheduler
+ * @brief  Expires the timers due up to the current tick, called from the
+ *         main loop
+ * @param  None
+ * @retval None
+ */
+void
+processTimerScheduler(void);
+
+#endif /* _TIMERWHEEL_H_ */
+
+/* END FILE */
@@ -0,0 +1,751 @@
+/*
+ * baud_throughput.cpp
+ *
+ *  Frames/s of the serial link before and after the baud rate negotiation, on Linux.
+ *
+ *  A pseudo-terminal pair links the PC side (master) to a stand-in for the KIT (slave) that
+ *  runs Frame-Parser, Serial-Command and Reliable-Link as the serial host firmware does. The
+ *  stand-in answers CMD_ID_BAUDRATE as BaudRateCmdHandler, with the same limits and the same
+ *  BRR check against PCLK1, and goes back to USART_BAUDRATE as SerialCustom_BaudRateProcess
+ *  when the switch is not confirmed.
+ *
+ *  A pty has no baud rate: each frame is held back until its bytes would have crossed a
+ *  UART at the rate of the line (LineTiming). LED frames are sent with CMD_OPT_RELIABLE as
+ *  fast as the line allows, with at most SEND_WINDOW of them waiting for their FRAME_ACK.
+ *  The load is sent once at the starting rate, then again after CMD_ID_BAUDRATE.
+ *
+ *  Usage: baud_throughput [-n frames] [-b start baud] baud
+ */
+
+/****************************************************************************************/
+/*                                      INCLUDEs                                	*/
+/****************************************************************************************/
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+extern "C" {
+#include "serial.h"
+#include "serialcmd.h"
+#include "frameparser.h"
+#include "reliablelink.h"
+}
+
+/****************************************************************************************/
+/*                                       DEFINEs                        		*/
+/****************************************************************************************/
+// Baud rate negotiation of main_Asm3_IOT303.c
+#define CMD_ID_BAUDRATE				0x89
+#define DEVICE_BAUDRATE				57600		// USART_BAUDRATE
+#define DEVICE_BAUDRATE_MAX			BAUD2000000	// USART_BAUDRATE_MAX
+#define DEVICE_BAUDRATE_TOLERANCE		20		// Per mille
+#define DEVICE_PCLK1_HZ				42000000	// APB1 clock of USART2 (84 MHz / 2)
+#define DEVICE_CONFIRM_TIMEOUT_MS		1000		// BAUDRATE_CONFIRM_TIMEOUT
+#define DEVICE_CONFIRM_ERRORS_MAX		3		// BAUDRATE_CONFIRM_ERRORS_MAX
+
+#define LINE_BITS_PER_BYTE			10		// 8N1
+#define LINE_QUEUE_US				200		// Bytes written this soon after the
+								// line went idle follow without a gap
+
+#define DEFAULT_FRAMES				5000
+#define SEND_WINDOW				64		// Frames waiting for their ACK
+#define ACK_TIMEOUT_MS				500		// A frame not acknowledged by then is lost
+#define ANSWER_TIMEOUT_MS			1000		// Wait for the answer to CMD_ID_BAUDRATE
+
+/****************************************************************************************/
+/*                                  STRUCTs AND ENUMs                           	*/
+/****************************************************************************************/
+typedef std::chrono::steady_clock clock_type;
+
+// State of the stand-in device, shared with the main thread once the device has stopped
+struct DeviceState
+{
+	int fd = -1;
+	uint64_t qwFramesOk = 0;
+	uint64_t qwFramesError = 0;
+	uint64_t qwLedCommands = 0;
+	uint64_t qwFallbacks = 0;			// Switches not confirmed in time
+	uint32_t dwBaudRate = DEVICE_BAUDRATE;
+	uint8_t bySequence = 0;				// Seq of the frames the device sends
+	bool bConfirming = false;			// New rate, no valid frame received yet
+	uint8_t byConfirmErrors = 0;
+	clock_type::time_point switchTime;
+};
+
+// Result of one load run
+struct LoadStats
+{
+	uint64_t qwSent = 0;
+	uint64_t qwBytesSent = 0;
+	uint64_t qwAcked = 0;
+	uint64_t qwLost = 0;				// No FRAME_ACK within ACK_TIMEOUT_MS
+	double elapsed = 0.0;				// Seconds from the first frame to the last ACK
+};
+
+/*
+ * Timing of the PC to KIT direction. Each write is held back until its last byte would
+ * have arrived at the baud rate of the line. Bytes following a late wake-up start where
+ * the line went idle, as the transmit buffer of a UART driver would.
+ */
+class LineTiming
+{
+public:
+	explicit LineTiming (uint32_t dwBaudRate) : m_dwBaudRate(dwBaudRate) {}
+
+	void SetBaudRate (uint32_t dwBaudRate) { m_dwBaudRate = dwBaudRate; }
+	uint32_t BaudRate (void) const { return m_dwBaudRate; }
+
+	// The line is idle from now on: the next bytes get no credit for an earlier gap
+	void Start (void) { m_free = clock_type::now(); }
+
+	void Wait (size_t length)
+	{
+		clock_type::time_point now = clock_type::now();
+		clock_type::duration wire = std::chrono::nanoseconds(
+			(uint64_t)length * LINE_BITS_PER_BYTE * 1000000000ULL / m_dwBaudRate);
+
+		m_free = std::max(m_free, now - std::chrono::microseconds(LINE_QUEUE_US)) + wire;
+		std::this_thread::sleep_until(m_free);
+	}
+
+private:
+	uint32_t m_dwBaudRate;
+	clock_type::time_point m_free{};		// End of the last byte on the wire
+};
+
+/****************************************************************************************/
+/*                                  GLOBAL VARIABLEs                 			*/
+/****************************************************************************************/
+// The dispatcher takes plain function pointers: the handlers reach the device through this
+static DeviceState 	*g_pDevice = nullptr;
+
+// The device does not send reliable frames itself, its link only suppresses duplicates
+static reliablelink_t 	g_deviceLink;
+
+/****************************************************************************************/
+/*                                     FUNCTIONs                                        */
+/****************************************************************************************/
+/*
+ * @func:  		WriteAll
+ *
+ * @brief:		The function to write bytes to one side of the pseudo-terminal
+ *
+ * @param[1]:		fd - Side to write to
+ * @param[2]:		pData - Bytes to write
+ * @param[3]:		length - Number of bytes
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+static void WriteAll (int fd, const uint8_t *pData, size_t length)
+{
+	while (length > 0)
+	{
+		ssize_t written = write(fd, pData, length);
+
+		if (written < 0)
+		{
+			if (errno == EINTR || errno == EAGAIN)
+			{
+				continue;
+			}
+
+			return;
+		}
+
+		pData += written;
+		length -= written;
+	}
+}
+
+/*
+ * @func:  		BuildFrame
+ *
+ * @brief:		The function to build a frame as Serial_SendPacketCustom does
+ *
+ * @param[1]:		byOption - Byte Option of the frame
+ * @param[2]:		byCmdId - Byte CmdID of the frame
+ * @param[3]:		byCmdType - Byte CmdType of the frame
+ * @param[4]:		payload - Bytes of the payload
+ * @param[5]:		bySequence - Sequence number
+ *
+ * @retval:		The frame, from FRAME_SOF to CXOR
+ *
+ * @note:		None
+ */
+static std::vector<uint8_t> BuildFrame (uint8_t byOption, uint8_t byCmdId, uint8_t byCmdType,
+					const std::vector<uint8_t> &payload, uint8_t bySequence)
+{
+	std::vector<uint8_t> frame;
+
+	frame.push_back(FRAME_SOF);
+	frame.push_back((uint8_t)(5 + payload.size()));
+	frame.push_back(byOption);
+	frame.push_back(byCmdId);
+	frame.push_back(byCmdType);
+	frame.insert(frame.end(), payload.begin(), payload.end());
+	frame.push_back(bySequence);
+	frame.push_back(FrameParser_Xor(&frame[2], frame.size() - 2, CXOR_INIT_VAL));
+
+	return frame;
+}
+
+/*
+ * @func:  		ReadBaudRate
+ *
+ * @brief:		The function to read the 4-byte big-endian rate of a CMD_ID_BAUDRATE frame
+ *
+ * @param:		pFrame - Frame, from its SOF
+ *
+ * @retval:		The rate, 0 if the payload is too short
+ *
+ * @note:		The rate follows CmdID and CmdType: 5 Length bytes and 4 payload bytes
+ */
+static uint32_t ReadBaudRate (const uint8_t *pFrame)
+{
+	if (pFrame[1] < (5 + 4))
+	{
+		return 0;
+	}
+
+	return ((uint32_t)pFrame[5] << 24) | ((uint32_t)pFrame[6] << 16) |
+	       ((uint32_t)pFrame[7] << 8) | (uint32_t)pFrame[8];
+}
+
+/*
+ * @func:  		DeviceIsBaudRateValid
+ *
+ * @brief:		The function to check a rate as BaudRateCmdHandler and USART2_ComputeBrr do
+ *
+ * @param:		dwBaudRate - Rate asked by the PC
+ *
+ * @retval:		true if USART2 can run at that rate within DEVICE_BAUDRATE_TOLERANCE
+ *
+ * @note:		None
+ */
+static bool DeviceIsBaudRateValid (uint32_t dwBaudRate)
+{
+	if ((dwBaudRate < BAUD9600) || (dwBaudRate > DEVICE_BAUDRATE_MAX))
+	{
+		return false;
+	}
+
+	// Oversampling by 8 above PCLK1 / 16: USARTDIV in 1/8 steps
+	uint32_t dwMinDivider = (dwBaudRate > (DEVICE_PCLK1_HZ / 16)) ? 8 : 16;
+	uint32_t dwDivider = (DEVICE_PCLK1_HZ + (dwBaudRate / 2)) / dwBaudRate;
+
+	if ((dwDivider < dwMinDivider) || (dwDivider > 0xFFFF))
+	{
+		return false;
+	}
+
+	uint32_t dwActual = DEVICE_PCLK1_HZ / dwDivider;
+	uint32_t dwError = (dwActual > dwBaudRate) ? (dwActual - dwBaudRate) : (dwBaudRate - dwActual);
+
+	return ((uint64_t)dwError * 1000 / dwBaudRate) <= DEVICE_BAUDRATE_TOLERANCE;
+}
+
+/*
+ * @func:  		DeviceLedHandler
+ *
+ * @brief:		The handler of CMD_ID_LED, only counts the commands
+ *
+ * @param:		pCmd - Received command
+ *
+ * @retval:		None
+ *
+ * @note:		The LED driver is not available on the PC
+ */
+static void DeviceLedHandler (const cmd_receive_t *pCmd)
+{
+	(void)pCmd;
+
+	g_pDevice->qwLedCommands++;
+}
+
+/*
+ * @func:  		DeviceBaudRateHandler
+ *
+ * @brief:		The handler of CMD_ID_BAUDRATE, answers then switches as the firmware does
+ *
+ * @param:		pCmd - Received command, at the CmdID byte of the frame
+ *
+ * @retval:		None
+ *
+ * @note:		The answer carries the rate accepted, or the current one on refusal, and
+ * 			leaves at the old rate
+ */
+static void DeviceBaudRateHandler (const cmd_receive_t *pCmd)
+{
+	DeviceState *pDevice = g_pDevice;
+	uint32_t dwRequested = ReadBaudRate((const uint8_t *)pCmd - 3);
+	bool bAccepted = DeviceIsBaudRateValid(dwRequested);
+	uint32_t dwBaudRate = bAccepted ? dwRequested : pDevice->dwBaudRate;
+
+	std::vector<uint8_t> answer = BuildFrame(0x00, CMD_ID_BAUDRATE, CMD_TYPE_RES,
+						 {(uint8_t)(dwBaudRate >> 24), (uint8_t)(dwBaudRate >> 16),
+						  (uint8_t)(dwBaudRate >> 8), (uint8_t)dwBaudRate},
+						 ++pDevice->bySequence);
+
+	WriteAll(pDevice->fd, answer.data(), answer.size());
+
+	if (bAccepted)
+	{
+		pDevice->dwBaudRate = dwBaudRate;
+		pDevice->bConfirming = true;
+		pDevice->byConfirmErrors = 0;
+		pDevice->switchTime = clock_type::now();
+	}
+}
+
+/*
+ * @func:  		DeviceSendFrame
+ *
+ * @brief:		The transmit function of g_deviceLink, never called (nothing sent reliably)
+ *
+ * @param[1]:		pFrame - Frame to send
+ * @param[2]:		byLength - Length of the frame
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+static void DeviceSendFrame (const uint8_t *pFrame, uint8_t byLength)
+{
+	(void)pFrame;
+	(void)byLength;
+}
+
+/*
+ * @func:  		DeviceRun
+ *
+ * @brief:		The function to read, parse and answer frames until bStop is set
+ *
+ * @param[1]:		device - State of the device, its fd the slave side
+ * @param[2]:		bStop - Set once the PC side is done
+ *
+ * @retval:		None
+ *
+ * @note:		Same order as processSerialReceiverCustom: ACK every copy, dispatch once
+ */
+static void DeviceRun (DeviceState &device, const std::atomic<bool> &bStop)
+{
+	uint8_t byWork[RX_BUFFER_SIZE + FRAME_PARSER_OVERHEAD];
+	uint8_t byRead[512];
+	frameparser_t parser;
+	const uint8_t *pFrame;
+	struct pollfd pfd = {device.fd, POLLIN, 0};
+
+	g_pDevice = &device;
+
+	FrameParser_Init(&parser, byWork, sizeof(byWork), RX_BUFFER_SIZE);
+	ReliableLink_Init(&g_deviceLink, DeviceSendFrame);
+
+	SerialCmd_Init();
+	SerialCmd_Register(CMD_ID_LED, CMD_TYPE_SET, DeviceLedHandler);
+	SerialCmd_Register(CMD_ID_BAUDRATE, CMD_TYPE_SET, DeviceBaudRateHandler);
+
+	while (!bStop.load())
+	{
+		if (device.bConfirming &&
+		    (((clock_type::now() - device.switchTime) >=
+		      std::chrono::milliseconds(DEVICE_CONFIRM_TIMEOUT_MS)) ||
+		     (device.byConfirmErrors >= DEVICE_CONFIRM_ERRORS_MAX)))
+		{
+			// Nothing valid received at the new rate
+			device.dwBaudRate = DEVICE_BAUDRATE;
+			device.qwFallbacks++;
+			device.bConfirming = false;
+		}
+
+		if (poll(&pfd, 1, 10) <= 0)
+		{
+			continue;
+		}
+
+		ssize_t length = read(device.fd, byRead, sizeof(byRead));
+
+		if (length <= 0)
+		{
+			continue;
+		}
+
+		for (ssize_t offset = 0; offset < length; )
+		{
+			offset += FrameParser_Feed(&parser, &byRead[offset], length - offset);
+
+			for (;;)
+			{
+				uint8_t byState = FrameParser_Poll(&parser, &pFrame);
+
+				if (byState == UART_STATE_IDLE)
+				{
+					break;
+				}
+
+				if (byState == UART_STATE_ERROR)
+				{
+					device.qwFramesError++;
+
+					if (device.bConfirming)
+					{
+						device.byConfirmErrors++;
+					}
+
+					continue;
+				}
+
+				// A valid frame at the new baud rate: the switch is confirmed
+				device.qwFramesOk++;
+				device.bConfirming = false;
+
+				// pFrame[1] is the length byte, [2] the option, [pFrame[1]] the Seq
+				if (pFrame[2] & CMD_OPT_RELIABLE)
+				{
+					uint8_t byAck[] = {FRAME_ACK, pFrame[pFrame[1]]};
+
+					WriteAll(device.fd, byAck, sizeof(byAck));
+
+					if (ReliableLink_IsDuplicate(&g_deviceLink, pFrame[pFrame[1]]))
+					{
+						continue;
+					}
+				}
+
+				SerialCmd_Dispatch(&pFrame[3]);
+			}
+		}
+	}
+
+	g_pDevice = nullptr;
+}
+
+/*
+ * @func:  		OpenPtyPair
+ *
+ * @brief:		The function to open a pseudo-terminal pair in raw mode
+ *
+ * @param[1]:		pMaster - Receives the master side (PC)
+ * @param[2]:		pSlave - Receives the slave side (device)
+ *
+ * @retval:		true on success
+ *
+ * @note:		None
+ */
+static bool OpenPtyPair (int *pMaster, int *pSlave)
+{
+	struct termios tio;
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+
+	if ((master < 0) || (grantpt(master) != 0) || (unlockpt(master) != 0))
+	{
+		perror("posix_openpt");
+		return false;
+	}
+
+	int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+
+	if (slave < 0)
+	{
+		perror("open slave");
+		close(master);
+		return false;
+	}
+
+	// No echo, no line editing, no CR/LF translation: the frames are binary
+	tcgetattr(slave, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(slave, TCSANOW, &tio);
+
+	*pMaster = master;
+	*pSlave = slave;
+
+	return true;
+}
+
+/*
+ * @func:  		SendLoad
+ *
+ * @brief:		The function to send LED frames as fast as the line allows
+ *
+ * @param[1]:		fd - Master side of the pseudo-terminal
+ * @param[2]:		line - Timing of the bytes on the way to the device
+ * @param[3]:		frames - Frames to send
+ * @param[4]:		bySequence - Last sequence number used, shared by the runs
+ *
+ * @retval:		Counters of the run
+ *
+ * @note:		The ACKs are read by a second thread during this call only
+ */
+static LoadStats SendLoad (int fd, LineTiming &line, unsigned long frames, uint8_t &bySequence)
+{
+	std::atomic<bool> bStopReader(false);
+	std::atomic<uint64_t> qwOutstanding(0);
+	std::vector<std::atomic<bool>> pending(256);
+	LoadStats stats;
+
+	std::thread readerThread([&] {
+		uint8_t byRead[512];
+		bool bAck = false;			// FRAME_ACK received, its Seq follows
+		struct pollfd pfd = {fd, POLLIN, 0};
+
+		while (!bStopReader.load())
+		{
+			if (poll(&pfd, 1, 10) <= 0)
+			{
+				continue;
+			}
+
+			ssize_t length = read(fd, byRead, sizeof(byRead));
+
+			for (ssize_t i = 0; i < length; i++)
+			{
+				if (!bAck)
+				{
+					bAck = (byRead[i] == FRAME_ACK);
+				}
+				else
+				{
+					if (pending[byRead[i]].exchange(false))
+					{
+						stats.qwAcked++;
+						qwOutstanding--;
+					}
+
+					bAck = false;
+				}
+			}
+		}
+	});
+
+	const std::vector<uint8_t> ledPayload = {0x00, 0x01, 0x00, 0x00, 0x01};
+	clock_type::time_point start = clock_type::now();
+
+	line.Start();
+
+	for (unsigned long n = 0; n < frames; n++)
+	{
+		std::vector<uint8_t> bytes = BuildFrame(CMD_OPT_RELIABLE, CMD_ID_LED, CMD_TYPE_SET,
+							ledPayload, ++bySequence);
+		clock_type::time_point deadline = clock_type::now() +
+						  std::chrono::milliseconds(ACK_TIMEOUT_MS);
+
+		// Wait for the ACKs once the window is full
+		while ((qwOutstanding.load() >= SEND_WINDOW) && (clock_type::now() < deadline))
+		{
+			std::this_thread::yield();
+		}
+
+		if (pending[bySequence].exchange(false))
+		{
+			// 256 frames later and still no ACK
+			stats.qwLost++;
+			qwOutstanding--;
+		}
+
+		// The frame is complete at the device once its last byte has crossed the line.
+		// It is marked pending before the write, so its ACK cannot come first
+		line.Wait(bytes.size());
+		qwOutstanding++;
+		pending[bySequence] = true;
+		WriteAll(fd, bytes.data(), bytes.size());
+
+		stats.qwSent++;
+		stats.qwBytesSent += bytes.size();
+	}
+
+	clock_type::time_point deadline = clock_type::now() + std::chrono::milliseconds(ACK_TIMEOUT_MS);
+
+	while ((qwOutstanding.load() != 0) && (clock_type::now() < deadline))
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(50));
+	}
+
+	stats.elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+
+	bStopReader = true;
+	readerThread.join();
+
+	stats.qwLost += qwOutstanding.load();
+
+	return stats;
+}
+
+/*
+ * @func:  		NegotiateBaudRate
+ *
+ * @brief:		The function to ask the device for a new baud rate with CMD_ID_BAUDRATE
+ *
+ * @param[1]:		fd - Master side of the pseudo-terminal
+ * @param[2]:		line - Timing of the bytes, moved to the rate accepted
+ * @param[3]:		dwBaudRate - Rate asked
+ * @param[4]:		bySequence - Last sequence number used
+ *
+ * @retval:		Rate of the link after the answer, 0 if no answer came
+ *
+ * @note:		The request and its answer travel at the old rate
+ */
+static uint32_t NegotiateBaudRate (int fd, LineTiming &line, uint32_t dwBaudRate, uint8_t &bySequence)
+{
+	std::vector<uint8_t> bytes = BuildFrame(0x00, CMD_ID_BAUDRATE, CMD_TYPE_SET,
+						{(uint8_t)(dwBaudRate >> 24), (uint8_t)(dwBaudRate >> 16),
+						 (uint8_t)(dwBaudRate >> 8), (uint8_t)dwBaudRate},
+						++bySequence);
+	uint8_t byWork[RX_BUFFER_SIZE + FRAME_PARSER_OVERHEAD];
+	uint8_t byRead[64];
+	frameparser_t parser;
+	const uint8_t *pFrame;
+	struct pollfd pfd = {fd, POLLIN, 0};
+
+	FrameParser_Init(&parser, byWork, sizeof(byWork), RX_BUFFER_SIZE);
+	line.Wait(bytes.size());
+	WriteAll(fd, bytes.data(), bytes.size());
+
+	clock_type::time_point deadline = clock_type::now() +
+					  std::chrono::milliseconds(ANSWER_TIMEOUT_MS);
+
+	while (clock_type::now() < deadline)
+	{
+		if (poll(&pfd, 1, 10) <= 0)
+		{
+			continue;
+		}
+
+		ssize_t length = read(fd, byRead, sizeof(byRead));
+
+		for (ssize_t offset = 0; offset < length; )
+		{
+			offset += FrameParser_Feed(&parser, &byRead[offset], length - offset);
+
+			for (;;)
+			{
+				uint8_t byState = FrameParser_Poll(&parser, &pFrame);
+
+				if (byState == UART_STATE_IDLE)
+				{
+					break;
+				}
+
+				if ((byState == UART_STATE_DATA_RECEIVED) &&
+				    (pFrame[3] == CMD_ID_BAUDRATE) && (pFrame[4] == CMD_TYPE_RES))
+				{
+					uint32_t dwAccepted = ReadBaudRate(pFrame);
+
+					line.SetBaudRate(dwAccepted);
+
+					return dwAccepted;
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * @func:  		PrintRun
+ *
+ * @brief:		The function to print the frames/s of one run next to the limit of the line
+ *
+ * @param[1]:		stats - Counters of the run
+ * @param[2]:		dwBaudRate - Rate of the line
+ *
+ * @retval:		Frames/s of the run
+ *
+ * @note:		None
+ */
+static double PrintRun (const LoadStats &stats, uint32_t dwBaudRate)
+{
+	double bytesPerFrame = (double)stats.qwBytesSent / stats.qwSent;
+	double framesPerSecond = stats.qwAcked / stats.elapsed;
+
+	printf("%8u Bd  %6.0f frames/s (line limit %.0f), %llu acked, %llu lost\n", dwBaudRate,
+	       framesPerSecond, dwBaudRate / (LINE_BITS_PER_BYTE * bytesPerFrame),
+	       (unsigned long long)stats.qwAcked, (unsigned long long)stats.qwLost);
+
+	return framesPerSecond;
+}
+
+int main (int argc, char *argv[])
+{
+	unsigned long frames = DEFAULT_FRAMES;
+	uint32_t dwStart = DEVICE_BAUDRATE;
+	int option;
+
+	while ((option = getopt(argc, argv, "n:b:")) != -1)
+	{
+		switch (option)
+		{
+			case 'n': frames = strtoul(optarg, nullptr, 0); break;
+			case 'b': dwStart = (uint32_t)strtoul(optarg, nullptr, 0); break;
+			default: optind = argc + 1; break;
+		}
+	}
+
+	if ((optind != argc - 1) || (frames == 0) || (dwStart == 0))
+	{
+		fprintf(stderr, "usage: %s [-n frames] [-b start baud] baud\n", argv[0]);
+		return 1;
+	}
+
+	uint32_t dwNegotiate = (uint32_t)strtoul(argv[optind], nullptr, 0);
+	int master, slave;
+
+	if (!OpenPtyPair(&master, &slave))
+	{
+		return 1;
+	}
+
+	std::atomic<bool> bStopDevice(false);
+	DeviceState device;
+	LineTiming line(dwStart);
+	uint8_t bySequence = 0;
+
+	device.fd = slave;
+	device.dwBaudRate = dwStart;
+
+	std::thread deviceThread([&] { DeviceRun(device, bStopDevice); });
+
+	LoadStats before = SendLoad(master, line, frames, bySequence);
+	double beforeRate = PrintRun(before, line.BaudRate());
+
+	uint32_t dwAccepted = NegotiateBaudRate(master, line, dwNegotiate, bySequence);
+	bool bPassed = (before.qwLost == 0) && (dwAccepted != 0);
+
+	printf("CMD_ID_BAUDRATE %u Bd asked, %u Bd accepted\n", dwNegotiate, dwAccepted);
+
+	if (dwAccepted != 0)
+	{
+		LoadStats after = SendLoad(master, line, frames, bySequence);
+		double afterRate = PrintRun(after, line.BaudRate());
+
+		printf("speed-up %.1fx\n", afterRate / beforeRate);
+
+		bPassed = bPassed && (after.qwLost == 0);
+	}
+
+	bStopDevice = true;
+	deviceThread.join();
+
+	close(master);
+	close(slave);
+
+	printf("device: %llu frames ok, %llu errors, %llu LED commands, %u Bd, %llu fallbacks\n",
+	       (unsigned long long)device.qwFramesOk, (unsigned long long)device.qwFramesError,
+	       (unsigned long long)device.qwLedCommands, device.dwBaudRate,
+	       (unsigned long long)device.qwFallbacks);
+
+	// The device must have kept the rate the PC moved to
+	return (bPassed && (device.dwBaudRate == line.BaudRate())) ? 0 : 2;
+}
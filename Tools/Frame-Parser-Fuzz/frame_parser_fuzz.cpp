@@ -0,0 +1,935 @@
+/*
+ * frame_parser_fuzz.cpp
+ *
+ *  Fuzz test and throughput benchmark of Frame-Parser-Library.
+ *
+ *  Three kinds of input are fed to FrameParser_Parse, each message in a buffer allocated
+ *  to its exact size so that AddressSanitizer stops on any read past the length given:
+ *
+ *  - random bytes, with SOF, ACK, NACK and small Length values more frequent than chance;
+ *  - every truncation of valid frames, alone and followed by a valid frame;
+ *  - streams of valid frames (CXOR and CRC-32) with corrupted frames and garbage between
+ *    them: flipped bits, replaced, dropped or inserted bytes, bad Length, cut frames.
+ *
+ *  At every position the result is checked against a reference decoder written byte by
+ *  byte from the frame layout: a valid frame must be returned, an invalid one rejected
+ *  with only its SOF consumed, and a garbage run skipped up to the next possible message.
+ *  An intact frame of a corrupted stream must be returned, unless a corrupted frame before
+ *  it passed its check by chance and covered it (counted, never an error). The same
+ *  streams are also fed in random blocks to FrameParser_Feed/Poll, which must return the
+ *  same frames.
+ *
+ *  The benchmark then gives the MB/s of FrameParser_Parse over clean and corrupted streams,
+ *  and of FrameParser_Feed/Poll in 64-byte blocks (one DMA idle-line commit).
+ *
+ *  Usage: frame_parser_fuzz [iterations]
+ */
+
+/****************************************************************************************/
+/*                                      INCLUDEs                                	*/
+/****************************************************************************************/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include "serial.h"
+#include "frameparser.h"
+#include "crc32.h"
+}
+
+/****************************************************************************************/
+/*                                       DEFINEs                        		*/
+/****************************************************************************************/
+#define MAX_LENGTH				RX_BUFFER_SIZE	// As processSerialReceiverCustom
+#define FRAME_SIZE_MAX				(1 + MAX_LENGTH + FRAME_PARSER_CRC32_SIZE)
+#define PARSE_WINDOW				64		// Bytes given to one Parse call
+#define BENCH_STREAM_BYTES			(1 << 20)
+#define BENCH_MIN_SECONDS			0.5
+
+typedef std::chrono::steady_clock bench_clock_t;
+typedef std::vector<uint8_t> bytes_t;
+
+/*
+ * Kinds of frames in a generated stream
+ */
+enum FrameCheck
+{
+	CHECK_CXOR,
+	CHECK_CRC32,
+	CHECK_MIXED,
+};
+
+/*
+ * A valid frame placed in a generated stream
+ */
+struct Placed
+{
+	size_t offset;
+	size_t size;
+};
+
+/*
+ * What the parser returned for a whole stream
+ */
+struct Decoded
+{
+	std::vector<bytes_t> frames;			// DATA_RECEIVED, in order
+	std::vector<size_t> offsets;			// Position of each frame in the stream
+	uint64_t qwAcks;				// ACK and NACK bytes
+	uint64_t qwErrors;				// UART_STATE_ERROR results
+};
+
+/****************************************************************************************/
+/*                                     VARIABLEs                                        */
+/****************************************************************************************/
+static std::mt19937 g_rng(1);
+static uint64_t g_qwFailures;
+static uint64_t g_qwChecks;
+static uint64_t g_qwFalseFrames;			// Corrupted frames that passed their check
+
+/****************************************************************************************/
+/*                                     FUNCTIONs                                        */
+/****************************************************************************************/
+/*
+ * @func:  		Fail
+ *
+ * @brief:		The function to report a failed check
+ *
+ * @param[1]:		strWhat - What went wrong
+ * @param[2]:		pData - Bytes given to the parser
+ * @param[3]:		wLength - Number of bytes
+ *
+ * @retval:		None
+ *
+ * @note:		Only the first failures are printed
+ */
+static void Fail (const char *strWhat, const uint8_t *pData, uint16_t wLength)
+{
+	if (g_qwFailures++ >= 10)
+	{
+		return;
+	}
+
+	printf("FAIL %s:", strWhat);
+
+	for (uint16_t i = 0; (i < wLength) && (i < 48); i++)
+	{
+		printf(" %02X", pData[i]);
+	}
+
+	printf("\n");
+}
+
+/*
+ * @func:  		RefCrc32
+ *
+ * @brief:		The function to compute the CRC-32/MPEG-2 one bit at a time
+ *
+ * @param[1]:		pData - Bytes
+ * @param[2]:		size - Number of bytes
+ *
+ * @retval:		CRC-32
+ *
+ * @note:		Independent of the table and of Crc32_Compute
+ */
+static uint32_t RefCrc32 (const uint8_t *pData, size_t size)
+{
+	uint32_t dwCrc = 0xFFFFFFFF;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		dwCrc ^= (uint32_t)pData[i] << 24;
+
+		for (uint8_t bit = 0; bit < 8; bit++)
+		{
+			dwCrc = (dwCrc & 0x80000000) ? ((dwCrc << 1) ^ 0x04C11DB7) : (dwCrc << 1);
+		}
+	}
+
+	return dwCrc;
+}
+
+/*
+ * @func:  		RefFrameSize
+ *
+ * @brief:		The function to decode the frame starting at a SOF, from the layout alone
+ *
+ * @param[1]:		pData - Bytes from the SOF
+ * @param[2]:		available - Number of bytes
+ *
+ * @retval:		Size of the valid frame, 0 if incomplete, -1 if invalid
+ *
+ * @note:		None
+ */
+static int RefFrameSize (const uint8_t *pData, size_t available)
+{
+	if (available < 2)
+	{
+		return 0;
+	}
+
+	uint8_t byLength = pData[1];
+
+	if ((byLength < 2) || (byLength > MAX_LENGTH))
+	{
+		return -1;
+	}
+
+	if (available < 3)
+	{
+		return 0;
+	}
+
+	bool bCrc = (pData[2] & CMD_OPT_CRC32) != 0;
+	size_t size = 1 + byLength + (bCrc ? 4 : 1);
+
+	if (available < size)
+	{
+		return 0;
+	}
+
+	// Option..Seq: pData[2] .. pData[byLength]
+	if (bCrc)
+	{
+		uint32_t dwCrc = ((uint32_t)pData[byLength + 1] << 24) |
+				 ((uint32_t)pData[byLength + 2] << 16) |
+				 ((uint32_t)pData[byLength + 3] << 8) | pData[byLength + 4];
+
+		return (RefCrc32(&pData[2], byLength - 1) == dwCrc) ? (int)size : -1;
+	}
+
+	uint8_t byXor = CXOR_INIT_VAL;
+
+	for (size_t i = 2; i <= byLength; i++)
+	{
+		byXor ^= pData[i];
+	}
+
+	return (byXor == pData[size - 1]) ? (int)size : -1;
+}
+
+/*
+ * @func:  		BuildFrame
+ *
+ * @brief:		The function to append a random valid frame to a stream
+ *
+ * @param[1]:		stream - Stream
+ * @param[2]:		check - CHECK_CXOR, CHECK_CRC32 or CHECK_MIXED
+ *
+ * @retval:		Size of the frame
+ *
+ * @note:		None
+ */
+static size_t BuildFrame (bytes_t &stream, FrameCheck check)
+{
+	bool bCrc = (check == CHECK_CRC32) || ((check == CHECK_MIXED) && (g_rng() & 1));
+	uint8_t byPayload = (uint8_t)(g_rng() % (MAX_LENGTH - 5 + 1));
+	uint8_t byLength = 5 + byPayload;
+	size_t start = stream.size();
+
+	stream.push_back(FRAME_SOF);
+	stream.push_back(byLength);
+	stream.push_back((uint8_t)((g_rng() & ~CMD_OPT_CRC32) | (bCrc ? CMD_OPT_CRC32 : 0)));
+
+	// CmdID, Type, payload, Seq
+	for (uint8_t i = 0; i < byPayload + 3; i++)
+	{
+		stream.push_back((uint8_t)g_rng());
+	}
+
+	if (bCrc)
+	{
+		uint32_t dwCrc = RefCrc32(&stream[start + 2], byLength - 1);
+
+		stream.push_back((uint8_t)(dwCrc >> 24));
+		stream.push_back((uint8_t)(dwCrc >> 16));
+		stream.push_back((uint8_t)(dwCrc >> 8));
+		stream.push_back((uint8_t)dwCrc);
+	}
+	else
+	{
+		uint8_t byXor = CXOR_INIT_VAL;
+
+		for (size_t i = start + 2; i < stream.size(); i++)
+		{
+			byXor ^= stream[i];
+		}
+
+		stream.push_back(byXor);
+	}
+
+	return stream.size() - start;
+}
+
+/*
+ * @func:  		RandomByte
+ *
+ * @brief:		The function to draw a garbage byte, often one that starts a message
+ *
+ * @param:		None
+ *
+ * @retval:		Byte
+ *
+ * @note:		None
+ */
+static uint8_t RandomByte (void)
+{
+	static const uint8_t aSpecial[] = { FRAME_SOF, FRAME_ACK, FRAME_NACK, 0, 1, 2, 5,
+					    MAX_LENGTH, MAX_LENGTH + 1, 0xFF };
+	uint32_t dwRandom = g_rng();
+
+	if ((dwRandom & 0x07) == 0)
+	{
+		return aSpecial[(dwRandom >> 8) % sizeof(aSpecial)];
+	}
+
+	return (uint8_t)(dwRandom >> 8);
+}
+
+/*
+ * @func:  		ParseExact
+ *
+ * @brief:		The function to call FrameParser_Parse on a copy of exactly wLength bytes
+ *
+ * @param[1]:		pData - Bytes
+ * @param[2]:		wLength - Number of bytes
+ * @param[3]:		pwUsed - Receives the bytes covered by the result
+ *
+ * @retval:		UART_STATE_xxx
+ *
+ * @note:		A read past wLength lands outside the allocation (AddressSanitizer)
+ */
+static uint8_t ParseExact (const uint8_t *pData, uint16_t wLength, uint16_t *pwUsed)
+{
+	uint8_t *pCopy = (uint8_t *)malloc(wLength ? wLength : 1);
+	uint8_t byState;
+
+	if (wLength != 0)
+	{
+		memcpy(pCopy, pData, wLength);
+	}
+
+	byState = FrameParser_Parse(pCopy, wLength, MAX_LENGTH, pwUsed);
+	free(pCopy);
+
+	return byState;
+}
+
+/*
+ * @func:  		CheckResult
+ *
+ * @brief:		The function to check one Parse result against the reference decoder
+ *
+ * @param[1]:		pData - Bytes given to the parser
+ * @param[2]:		wLength - Number of bytes
+ * @param[3]:		byState - Result
+ * @param[4]:		wUsed - Bytes covered by the result
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+static void CheckResult (const uint8_t *pData, uint16_t wLength, uint8_t byState,
+			 uint16_t wUsed)
+{
+	g_qwChecks++;
+
+	if (wUsed > wLength)
+	{
+		Fail("more bytes used than given", pData, wLength);
+		return;
+	}
+
+	if (wLength == 0)
+	{
+		if ((byState != UART_STATE_IDLE) || (wUsed != 0))
+		{
+			Fail("empty block not idle", pData, wLength);
+		}
+		return;
+	}
+
+	if ((pData[0] == FRAME_ACK) || (pData[0] == FRAME_NACK))
+	{
+		uint8_t byExpected = (pData[0] == FRAME_ACK) ? UART_STATE_ACK_RECEIVED :
+							       UART_STATE_NACK_RECEIVED;
+
+		if ((byState != byExpected) || (wUsed != 1))
+		{
+			Fail("ACK/NACK not returned alone", pData, wLength);
+		}
+		return;
+	}
+
+	if (pData[0] != FRAME_SOF)
+	{
+		// The whole garbage run, up to the next byte that may start a message
+		uint16_t wRun = 0;
+
+		while ((wRun < wLength) && (pData[wRun] != FRAME_SOF) &&
+		       (pData[wRun] != FRAME_ACK) && (pData[wRun] != FRAME_NACK))
+		{
+			wRun++;
+		}
+
+		if ((byState != UART_STATE_ERROR) || (wUsed != wRun))
+		{
+			Fail("garbage run not skipped", pData, wLength);
+		}
+		return;
+	}
+
+	int size = RefFrameSize(pData, wLength);
+
+	if (size > 0)
+	{
+		if ((byState != UART_STATE_DATA_RECEIVED) || (wUsed != size))
+		{
+			Fail("valid frame not returned", pData, wLength);
+		}
+	}
+	else if (size == 0)
+	{
+		if ((byState != UART_STATE_IDLE) || (wUsed != 0))
+		{
+			Fail("incomplete frame not idle", pData, wLength);
+		}
+	}
+	else if ((byState != UART_STATE_ERROR) || (wUsed != 1))
+	{
+		// Only the SOF is dropped, the bytes after it are scanned again
+		Fail("invalid frame not rejected by its SOF", pData, wLength);
+	}
+}
+
+/*
+ * @func:  		ParseStream
+ *
+ * @brief:		The function to parse a whole stream, checking every result
+ *
+ * @param[1]:		stream - Stream
+ *
+ * @retval:		Frames returned, ACK/NACK and errors counted
+ *
+ * @note:		Each call gets at most PARSE_WINDOW bytes, more than the largest frame
+ */
+static Decoded ParseStream (const bytes_t &stream)
+{
+	Decoded decoded = { {}, {}, 0, 0 };
+	size_t offset = 0;
+
+	while (offset < stream.size())
+	{
+		uint16_t wWindow = (uint16_t)std::min<size_t>(stream.size() - offset, PARSE_WINDOW);
+		uint16_t wUsed;
+		uint8_t byState = ParseExact(&stream[offset], wWindow, &wUsed);
+
+		CheckResult(&stream[offset], wWindow, byState, wUsed);
+
+		if (byState == UART_STATE_DATA_RECEIVED)
+		{
+			decoded.frames.emplace_back(&stream[offset], &stream[offset] + wUsed);
+			decoded.offsets.push_back(offset);
+		}
+		else if ((byState == UART_STATE_ACK_RECEIVED) || (byState == UART_STATE_NACK_RECEIVED))
+		{
+			decoded.qwAcks++;
+		}
+		else if (byState == UART_STATE_ERROR)
+		{
+			decoded.qwErrors++;
+		}
+
+		if (wUsed == 0)
+		{
+			break;					// Incomplete frame at the end
+		}
+
+		offset += wUsed;
+	}
+
+	return decoded;
+}
+
+/*
+ * @func:  		FeedStream
+ *
+ * @brief:		The function to feed a stream to the block parser in random blocks
+ *
+ * @param[1]:		stream - Stream
+ * @param[2]:		wMaxBlock - Largest block
+ *
+ * @retval:		Frames returned, in order
+ *
+ * @note:		None
+ */
+static std::vector<bytes_t> FeedStream (const bytes_t &stream, uint16_t wMaxBlock)
+{
+	uint8_t *pWork = (uint8_t *)malloc(MAX_LENGTH + FRAME_PARSER_OVERHEAD);
+	std::vector<bytes_t> frames;
+	frameparser_t parser;
+	size_t offset = 0;
+
+	FrameParser_Init(&parser, pWork, MAX_LENGTH + FRAME_PARSER_OVERHEAD, MAX_LENGTH);
+
+	while (offset < stream.size())
+	{
+		uint16_t wBlock = (uint16_t)std::min<size_t>(stream.size() - offset,
+							     g_rng() % wMaxBlock + 1);
+		uint16_t wTaken = 0;
+
+		while (wTaken < wBlock)
+		{
+			const uint8_t *pFrame;
+			uint8_t byState;
+
+			wTaken += FrameParser_Feed(&parser, &stream[offset + wTaken],
+						   (uint16_t)(wBlock - wTaken));
+
+			while ((byState = FrameParser_Poll(&parser, &pFrame)) != UART_STATE_IDLE)
+			{
+				if (byState == UART_STATE_DATA_RECEIVED)
+				{
+					frames.emplace_back(pFrame, pFrame + 1 + pFrame[1] +
+							    FRAME_PARSER_TRAILER_SIZE(pFrame[2]));
+				}
+			}
+		}
+
+		offset += wBlock;
+	}
+
+	free(pWork);
+
+	return frames;
+}
+
+/*
+ * @func:  		CorruptFrame
+ *
+ * @brief:		The function to append a corrupted frame (or garbage) to a stream
+ *
+ * @param[1]:		stream - Stream
+ * @param[2]:		check - Kind of frame
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+static void CorruptFrame (bytes_t &stream, FrameCheck check)
+{
+	bytes_t frame;
+	size_t size = BuildFrame(frame, check);
+	size_t pos = g_rng() % size;
+
+	switch (g_rng() % 7)
+	{
+	case 0:						// One flipped bit
+		frame[pos] ^= (uint8_t)(1 << (g_rng() % 8));
+		break;
+
+	case 1:						// One replaced byte
+		frame[pos] = RandomByte();
+		break;
+
+	case 2:						// One lost byte
+		frame.erase(frame.begin() + pos);
+		break;
+
+	case 3:						// One extra byte
+		frame.insert(frame.begin() + pos, RandomByte());
+		break;
+
+	case 4:						// Bad Length
+		frame[1] = (uint8_t)(g_rng() % 256);
+		break;
+
+	case 5:						// Cut short
+		frame.resize(pos);
+		break;
+
+	default:					// Garbage between frames
+		frame.resize(g_rng() % 16);
+		for (uint8_t &byte : frame)
+		{
+			byte = RandomByte();
+		}
+		break;
+	}
+
+	stream.insert(stream.end(), frame.begin(), frame.end());
+}
+
+/*
+ * @func:  		PadStream
+ *
+ * @brief:		The function to end a stream with the bytes the line carries after it
+ *
+ * @param:		stream - Stream
+ *
+ * @retval:		None
+ *
+ * @note:		A cut frame whose Length runs past the end keeps the parser waiting:
+ * 			the frames after it come out only once the rest of its Length arrived
+ */
+static void PadStream (bytes_t &stream)
+{
+	stream.insert(stream.end(), FRAME_SIZE_MAX, 0x00);
+}
+
+/*
+ * @func:  		CheckResync
+ *
+ * @brief:		The function to check that the intact frames of a stream are returned
+ *
+ * @param[1]:		stream - Stream
+ * @param[2]:		placed - Intact frames of the stream
+ * @param[3]:		decoded - What the parser returned
+ *
+ * @retval:		None
+ *
+ * @note:		An intact frame may only be missing under a corrupted frame that passed
+ * 			its check (counted in g_qwFalseFrames)
+ */
+static void CheckResync (const bytes_t &stream, const std::vector<Placed> &placed,
+			 const Decoded &decoded)
+{
+	size_t d = 0;
+
+	for (const Placed &frame : placed)
+	{
+		while ((d < decoded.offsets.size()) && (decoded.offsets[d] < frame.offset) &&
+		       (decoded.offsets[d] + decoded.frames[d].size() <= frame.offset))
+		{
+			d++;
+		}
+
+		g_qwChecks++;
+
+		if ((d < decoded.offsets.size()) && (decoded.offsets[d] == frame.offset))
+		{
+			continue;
+		}
+
+		if ((d < decoded.offsets.size()) && (decoded.offsets[d] < frame.offset))
+		{
+			g_qwFalseFrames++;
+			continue;
+		}
+
+		Fail("intact frame lost", &stream[frame.offset], (uint16_t)frame.size);
+	}
+}
+
+/*
+ * @func:  		FuzzRandomBytes
+ *
+ * @brief:		The function to parse streams of random bytes
+ *
+ * @param:		dwIterations - Number of streams
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+static void FuzzRandomBytes (uint32_t dwIterations)
+{
+	for (uint32_t i = 0; i < dwIterations; i++)
+	{
+		bytes_t stream(g_rng() % 300);
+
+		for (uint8_t &byte : stream)
+		{
+			byte = RandomByte();
+		}
+
+		ParseStream(stream);
+
+		// A single call on the whole stream, up to 0xFFFF bytes
+		uint16_t wUsed;
+		uint8_t byState = ParseExact(stream.data(), (uint16_t)stream.size(), &wUsed);
+
+		CheckResult(stream.data(), (uint16_t)stream.size(), byState, wUsed);
+	}
+}
+
+/*
+ * @func:  		FuzzTruncated
+ *
+ * @brief:		The function to parse every truncation of valid frames
+ *
+ * @param:		dwIterations - Number of frames
+ *
+ * @retval:		None
+ *
+ * @note:		A cut frame followed by a valid frame must not hide it
+ */
+static void FuzzTruncated (uint32_t dwIterations)
+{
+	for (uint32_t i = 0; i < dwIterations; i++)
+	{
+		bytes_t frame;
+		size_t size = BuildFrame(frame, CHECK_MIXED);
+
+		for (size_t cut = 0; cut <= size; cut++)
+		{
+			uint16_t wUsed;
+			uint8_t byState = ParseExact(frame.data(), (uint16_t)cut, &wUsed);
+
+			CheckResult(frame.data(), (uint16_t)cut, byState, wUsed);
+
+			if ((cut < size) && ((byState != UART_STATE_IDLE) || (wUsed != 0)))
+			{
+				Fail("truncated frame not idle", frame.data(), (uint16_t)cut);
+			}
+		}
+
+		// The same truncations followed by another frame
+		for (size_t cut = 1; cut < size; cut++)
+		{
+			bytes_t stream(frame.begin(), frame.begin() + cut);
+			std::vector<Placed> placed;
+
+			placed.push_back({ stream.size(), BuildFrame(stream, CHECK_MIXED) });
+			PadStream(stream);
+			CheckResync(stream, placed, ParseStream(stream));
+		}
+	}
+}
+
+/*
+ * @func:  		FuzzCorrupted
+ *
+ * @brief:		The function to parse streams of valid and corrupted frames
+ *
+ * @param:		dwIterations - Number of streams
+ *
+ * @retval:		None
+ *
+ * @note:		Also compares FrameParser_Feed/Poll with FrameParser_Parse
+ */
+static void FuzzCorrupted (uint32_t dwIterations)
+{
+	for (uint32_t i = 0; i < dwIterations; i++)
+	{
+		FrameCheck check = (FrameCheck)(i % 3);
+		uint32_t dwFrames = g_rng() % 20 + 1;
+		std::vector<Placed> placed;
+		bytes_t stream;
+
+		for (uint32_t f = 0; f < dwFrames; f++)
+		{
+			if (g_rng() % 10 < 3)
+			{
+				CorruptFrame(stream, check);
+			}
+			else
+			{
+				size_t offset = stream.size();
+
+				placed.push_back({ offset, BuildFrame(stream, check) });
+			}
+		}
+
+		PadStream(stream);
+
+		Decoded decoded = ParseStream(stream);
+
+		CheckResync(stream, placed, decoded);
+
+		g_qwChecks++;
+
+		if (FeedStream(stream, (uint16_t)(g_rng() % 80 + 1)) != decoded.frames)
+		{
+			Fail("Feed/Poll frames differ from Parse", stream.data(),
+			     (uint16_t)std::min<size_t>(stream.size(), 0xFFFF));
+		}
+	}
+}
+
+/*
+ * @func:  		BuildBenchStream
+ *
+ * @brief:		The function to build a stream for the benchmark
+ *
+ * @param[1]:		check - Kind of frames
+ * @param[2]:		dwCorruptPercent - Share of corrupted frames and garbage
+ *
+ * @retval:		Stream of about BENCH_STREAM_BYTES
+ *
+ * @note:		None
+ */
+static bytes_t BuildBenchStream (FrameCheck check, uint32_t dwCorruptPercent)
+{
+	bytes_t stream;
+
+	stream.reserve(BENCH_STREAM_BYTES + FRAME_SIZE_MAX);
+
+	while (stream.size() < BENCH_STREAM_BYTES)
+	{
+		if (g_rng() % 100 < dwCorruptPercent)
+		{
+			CorruptFrame(stream, check);
+		}
+		else
+		{
+			BuildFrame(stream, check);
+		}
+	}
+
+	return stream;
+}
+
+/*
+ * @func:  		BenchParse
+ *
+ * @brief:		The function to measure the MB/s of FrameParser_Parse over a stream
+ *
+ * @param[1]:		stream - Stream
+ * @param[2]:		pqwFrames - Receives the frames returned per pass
+ *
+ * @retval:		MB/s
+ *
+ * @note:		Parse is called on the rest of the stream, as on the contiguous RX queue
+ */
+static double BenchParse (const bytes_t &stream, uint64_t *pqwFrames)
+{
+	bench_clock_t::time_point start = bench_clock_t::now();
+	uint64_t qwBytes = 0;
+	double sec;
+
+	do
+	{
+		size_t offset = 0;
+		uint64_t qwFrames = 0;
+
+		while (offset < stream.size())
+		{
+			uint16_t wUsed;
+			uint16_t wLength = (uint16_t)std::min<size_t>(stream.size() - offset, 0xFFFF);
+
+			if (FrameParser_Parse(&stream[offset], wLength, MAX_LENGTH, &wUsed) ==
+			    UART_STATE_DATA_RECEIVED)
+			{
+				qwFrames++;
+			}
+
+			if (wUsed == 0)
+			{
+				break;
+			}
+
+			offset += wUsed;
+		}
+
+		*pqwFrames = qwFrames;
+		qwBytes += stream.size();
+		sec = std::chrono::duration<double>(bench_clock_t::now() - start).count();
+	} while (sec < BENCH_MIN_SECONDS);
+
+	return (double)qwBytes / sec / 1e6;
+}
+
+/*
+ * @func:  		BenchFeed
+ *
+ * @brief:		The function to measure the MB/s of FrameParser_Feed/Poll in 64-byte blocks
+ *
+ * @param:		stream - Stream
+ *
+ * @retval:		MB/s
+ *
+ * @note:		None
+ */
+static double BenchFeed (const bytes_t &stream)
+{
+	static uint8_t byWork[MAX_LENGTH + FRAME_PARSER_OVERHEAD];
+	bench_clock_t::time_point start = bench_clock_t::now();
+	uint64_t qwBytes = 0;
+	uint64_t qwFrames = 0;
+	frameparser_t parser;
+	double sec;
+
+	FrameParser_Init(&parser, byWork, sizeof(byWork), MAX_LENGTH);
+
+	do
+	{
+		for (size_t offset = 0; offset < stream.size(); )
+		{
+			uint16_t wBlock = (uint16_t)std::min<size_t>(stream.size() - offset, 64);
+			const uint8_t *pFrame;
+			uint8_t byState;
+
+			while (wBlock != 0)
+			{
+				uint16_t wTaken = FrameParser_Feed(&parser, &stream[offset], wBlock);
+
+				offset += wTaken;
+				wBlock -= wTaken;
+
+				while ((byState = FrameParser_Poll(&parser, &pFrame)) != UART_STATE_IDLE)
+				{
+					qwFrames += (byState == UART_STATE_DATA_RECEIVED) ? 1 : 0;
+				}
+			}
+		}
+
+		qwBytes += stream.size();
+		sec = std::chrono::duration<double>(bench_clock_t::now() - start).count();
+	} while (sec < BENCH_MIN_SECONDS);
+
+	// Keeps the loop from being optimised away
+	__asm__ __volatile__("" : : "r"(qwFrames) : "memory");
+
+	return (double)qwBytes / sec / 1e6;
+}
+
+/*
+ * @func:  		main
+ *
+ * @brief:		The function to run the fuzz tests, then the benchmark
+ *
+ * @param[1]:		argc - Number of arguments
+ * @param[2]:		argv - Iterations per fuzz test (optional)
+ *
+ * @retval:		0 if every check passed, 1 otherwise
+ *
+ * @note:		None
+ */
+int main (int argc, char *argv[])
+{
+	uint32_t dwIterations = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 20000;
+	uint64_t qwFrames;
+
+	Crc32_Init();
+
+	FuzzRandomBytes(dwIterations);
+	FuzzTruncated(dwIterations / 10);
+	FuzzCorrupted(dwIterations);
+
+	printf("fuzz: %llu checks, %llu failed, %llu frames covered by a corrupted frame "
+	       "that passed its check\n", (unsigned long long)g_qwChecks,
+	       (unsigned long long)g_qwFailures, (unsigned long long)g_qwFalseFrames);
+
+	printf("%-28s %10s %12s\n", "stream (1 MB)", "MB/s", "frames/pass");
+
+	bytes_t cxor = BuildBenchStream(CHECK_CXOR, 0);
+	bytes_t crc = BuildBenchStream(CHECK_CRC32, 0);
+	bytes_t corrupted = BuildBenchStream(CHECK_MIXED, 10);
+	double mbPerSec;
+
+	mbPerSec = BenchParse(cxor, &qwFrames);
+	printf("%-28s %10.1f %12llu\n", "Parse, CXOR", mbPerSec, (unsigned long long)qwFrames);
+	mbPerSec = BenchParse(crc, &qwFrames);
+	printf("%-28s %10.1f %12llu\n", "Parse, CRC-32", mbPerSec, (unsigned long long)qwFrames);
+	mbPerSec = BenchParse(corrupted, &qwFrames);
+	printf("%-28s %10.1f %12llu\n", "Parse, 10% corrupted", mbPerSec,
+	       (unsigned long long)qwFrames);
+	printf("%-28s %10.1f\n", "Feed/Poll 64 B, 10% corrupted", BenchFeed(corrupted));
+
+	return (g_qwFailures == 0) ? 0 : 1;
+}
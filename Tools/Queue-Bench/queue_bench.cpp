@@ -0,0 +1,437 @@
+/*
+ * queue_bench.cpp
+ *
+ *  Throughput and two-thread stress test of the SPSC ring buffer of Queue-Library.
+ *
+ *  For items of 1, 4, 16 and 64 bytes the benchmark gives the bytes per second moved
+ *  through one queue by bufEnDat/bufDeDat (one item per call) and by bufWrite/bufRead
+ *  (bulk), in one thread. The stress test then runs a producer and a consumer thread on
+ *  the same queue, as the UART interrupt and the main loop do on the board, with random
+ *  burst sizes on both sides. Every byte carries a value computed from its position in
+ *  the stream, so the consumer detects a lost, duplicated or reordered byte.
+ *
+ *  Usage: queue_bench [megabytes per run]
+ */
+
+/****************************************************************************************/
+/*                                      INCLUDEs                                	*/
+/****************************************************************************************/
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+extern "C" {
+#include "queue.h"
+}
+
+/****************************************************************************************/
+/*                                       DEFINEs                        		*/
+/****************************************************************************************/
+#define QUEUE_BYTES				1024		// Size of the queue under test
+#define BATCH_ITEMS				16		// Items per push/pop round
+#define BURST_ITEMS_MAX				32		// Largest random burst in the stress test
+
+typedef std::chrono::steady_clock bench_clock_t;
+
+/*
+ * Ways of moving data through the queue
+ */
+enum QueueApi
+{
+	API_SINGLE,					// bufEnDat / bufDeDat
+	API_BULK,					// bufWrite / bufRead
+	API_IN_PLACE,					// bufReserve/bufCommit, bufPeekContiguous/bufConsume
+};
+
+/*
+ * Outcome of one stress run
+ */
+struct StressResult
+{
+	uint64_t qwBytes;				// Bytes received by the consumer
+	uint64_t qwErrors;				// Bytes with an unexpected value
+	double mbPerSec;
+};
+
+/****************************************************************************************/
+/*                                     FUNCTIONs                                        */
+/****************************************************************************************/
+/*
+ * @func:  		ElapsedSec
+ *
+ * @brief:		The function to get the seconds since a time point
+ *
+ * @param[1]:		start - Time point
+ *
+ * @retval:		Seconds
+ *
+ * @note:		None
+ */
+static double ElapsedSec (bench_clock_t::time_point start)
+{
+	return std::chrono::duration<double>(bench_clock_t::now() - start).count();
+}
+
+/*
+ * @func:  		PatternByte
+ *
+ * @brief:		The function to get the value of a byte of the test stream
+ *
+ * @param[1]:		qwPos - Position of the byte in the stream
+ *
+ * @retval:		Byte value
+ *
+ * @note:		Not periodic over the queue size, so a byte read from the wrong slot
+ * 			does not match by chance
+ */
+static inline uint8_t PatternByte (uint64_t qwPos)
+{
+	return (uint8_t)(((qwPos * 0x9E3779B1u) >> 13) ^ qwPos);
+}
+
+/*
+ * @func:  		NextRandom
+ *
+ * @brief:		The function to step a xorshift generator
+ *
+ * @param[1]:		pdwState - State of the generator, not 0
+ *
+ * @retval:		Next value
+ *
+ * @note:		One generator per thread, no locking
+ */
+static inline uint32_t NextRandom (uint32_t *pdwState)
+{
+	uint32_t x = *pdwState;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*pdwState = x;
+
+	return x;
+}
+
+/*
+ * @func:  		BenchSingleThread
+ *
+ * @brief:		The function to measure the bytes per second of one queue in one thread
+ *
+ * @param[1]:		byItemSize - Item size in bytes
+ * @param[2]:		qwBytes - Bytes to move
+ * @param[3]:		api - API_SINGLE or API_BULK
+ *
+ * @retval:		MB/s, 0 if an item came out wrong
+ *
+ * @note:		Each round pushes BATCH_ITEMS items then pops them
+ */
+static double BenchSingleThread (uint8_t byItemSize, uint64_t qwBytes, QueueApi api)
+{
+	static uint8_t byStorage[QUEUE_BYTES];
+	uint8_t byIn[BATCH_ITEMS * 64];
+	uint8_t byOut[BATCH_ITEMS * 64];
+	uint16_t wBatchBytes = (uint16_t)(BATCH_ITEMS * byItemSize);
+	uint64_t qwRounds = qwBytes / wBatchBytes;
+	buffqueue_t queue;
+
+	bufInit(byStorage, &queue, byItemSize, QUEUE_BYTES);
+
+	for (uint16_t i = 0; i < wBatchBytes; i++)
+	{
+		byIn[i] = PatternByte(i);
+	}
+
+	bench_clock_t::time_point start = bench_clock_t::now();
+
+	for (uint64_t r = 0; r < qwRounds; r++)
+	{
+		if (api == API_SINGLE)
+		{
+			for (uint16_t i = 0; i < BATCH_ITEMS; i++)
+			{
+				bufEnDat(&queue, &byIn[i * byItemSize]);
+			}
+
+			for (uint16_t i = 0; i < BATCH_ITEMS; i++)
+			{
+				bufDeDat(&queue, &byOut[i * byItemSize]);
+			}
+		}
+		else
+		{
+			bufWrite(&queue, byIn, BATCH_ITEMS);
+			bufRead(&queue, byOut, BATCH_ITEMS);
+		}
+
+		// Keeps the copies from being optimised away
+		__asm__ __volatile__("" : : "r"(byOut) : "memory");
+	}
+
+	double sec = ElapsedSec(start);
+
+	for (uint16_t i = 0; i < wBatchBytes; i++)
+	{
+		if (byOut[i] != byIn[i])
+		{
+			return 0;
+		}
+	}
+
+	return (double)(qwRounds * wBatchBytes) / sec / 1e6;
+}
+
+/*
+ * @func:  		StressProducer
+ *
+ * @brief:		The function to push the test stream into the queue
+ *
+ * @param[1]:		pQueue - Queue under test
+ * @param[2]:		qwItems - Items to push
+ * @param[3]:		api - Producer API
+ *
+ * @retval:		None
+ *
+ * @note:		Yields when the queue is full, the host may have a single core
+ */
+static void StressProducer (buffqueue_p pQueue, uint64_t qwItems, QueueApi api)
+{
+	uint8_t byBurst[BURST_ITEMS_MAX * 64];
+	uint8_t byItemSize = pQueue->byItemSize;
+	uint32_t dwRandom = 0x1234567;
+	uint64_t qwPos = 0;
+	uint64_t qwSent = 0;
+
+	while (qwSent < qwItems)
+	{
+		uint16_t wCount = (uint16_t)(NextRandom(&dwRandom) % BURST_ITEMS_MAX + 1);
+		uint16_t wDone = 0;
+
+		if (wCount > qwItems - qwSent)
+		{
+			wCount = (uint16_t)(qwItems - qwSent);
+		}
+
+		for (uint16_t i = 0; i < wCount * byItemSize; i++)
+		{
+			byBurst[i] = PatternByte(qwPos + i);
+		}
+
+		if (api == API_SINGLE)
+		{
+			while (wDone < wCount)
+			{
+				if (bufEnDat(pQueue, &byBurst[wDone * byItemSize]) == ERR_OK)
+				{
+					wDone++;
+				}
+				else
+				{
+					std::this_thread::yield();
+				}
+			}
+		}
+		else if (api == API_BULK)
+		{
+			while (wDone < wCount)
+			{
+				uint16_t wPushed = bufWrite(pQueue, &byBurst[wDone * byItemSize],
+							    (uint16_t)(wCount - wDone));
+
+				wDone = (uint16_t)(wDone + wPushed);
+
+				if (wPushed == 0)
+				{
+					std::this_thread::yield();
+				}
+			}
+		}
+		else
+		{
+			// Byte queue only: write straight into the storage
+			while (wDone < wCount)
+			{
+				uint16_t wFree;
+				uint8_t *pSpace = bufReserve(pQueue, &wFree);
+
+				if (wFree == 0)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				if (wFree > wCount - wDone)
+				{
+					wFree = (uint16_t)(wCount - wDone);
+				}
+
+				memcpy(pSpace, &byBurst[wDone], wFree);
+				bufCommit(pQueue, wFree);
+				wDone = (uint16_t)(wDone + wFree);
+			}
+		}
+
+		qwPos += (uint64_t)wCount * byItemSize;
+		qwSent += wCount;
+	}
+}
+
+/*
+ * @func:  		StressConsumer
+ *
+ * @brief:		The function to pop the test stream and check every byte
+ *
+ * @param[1]:		pQueue - Queue under test
+ * @param[2]:		qwItems - Items expected
+ * @param[3]:		api - Consumer API
+ * @param[4]:		pResult - Receives the bytes and errors counted
+ *
+ * @retval:		None
+ *
+ * @note:		Yields when the queue is empty
+ */
+static void StressConsumer (buffqueue_p pQueue, uint64_t qwItems, QueueApi api,
+			    StressResult *pResult)
+{
+	uint8_t byBurst[BURST_ITEMS_MAX * 64];
+	uint8_t byItemSize = pQueue->byItemSize;
+	uint32_t dwRandom = 0x7654321;
+	uint64_t qwPos = 0;
+	uint64_t qwErrors = 0;
+
+	while (qwPos < qwItems * byItemSize)
+	{
+		uint16_t wLength = 0;
+		const uint8_t *pData = byBurst;
+
+		if (api == API_SINGLE)
+		{
+			if (bufDeDat(pQueue, byBurst) == ERR_OK)
+			{
+				wLength = byItemSize;
+			}
+		}
+		else if (api == API_BULK)
+		{
+			uint16_t wCount = (uint16_t)(NextRandom(&dwRandom) % BURST_ITEMS_MAX + 1);
+
+			wLength = (uint16_t)(bufRead(pQueue, byBurst, wCount) * byItemSize);
+		}
+		else
+		{
+			pData = bufPeekContiguous(pQueue, &wLength);
+		}
+
+		if (wLength == 0)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		for (uint16_t i = 0; i < wLength; i++)
+		{
+			if (pData[i] != PatternByte(qwPos + i))
+			{
+				qwErrors++;
+			}
+		}
+
+		if (api == API_IN_PLACE)
+		{
+			bufConsume(pQueue, wLength);
+		}
+
+		qwPos += wLength;
+	}
+
+	pResult->qwBytes = qwPos;
+	pResult->qwErrors = qwErrors;
+}
+
+/*
+ * @func:  		StressTwoThreads
+ *
+ * @brief:		The function to run the producer and the consumer on one queue
+ *
+ * @param[1]:		byItemSize - Item size in bytes
+ * @param[2]:		qwBytes - Bytes to move
+ * @param[3]:		api - API used on both sides
+ *
+ * @retval:		Bytes received, errors and MB/s
+ *
+ * @note:		Also checks that the queue is empty at the end
+ */
+static StressResult StressTwoThreads (uint8_t byItemSize, uint64_t qwBytes, QueueApi api)
+{
+	static uint8_t byStorage[QUEUE_BYTES];
+	uint64_t qwItems = qwBytes / byItemSize;
+	StressResult result = { 0, 0, 0 };
+	buffqueue_t queue;
+
+	bufInit(byStorage, &queue, byItemSize, QUEUE_BYTES);
+
+	bench_clock_t::time_point start = bench_clock_t::now();
+
+	std::thread consumer(StressConsumer, &queue, qwItems, api, &result);
+	std::thread producer(StressProducer, &queue, qwItems, api);
+
+	producer.join();
+	consumer.join();
+
+	result.mbPerSec = (double)result.qwBytes / ElapsedSec(start) / 1e6;
+
+	if ((result.qwBytes != qwItems * byItemSize) || !bufIsEmpty(&queue))
+	{
+		result.qwErrors++;
+	}
+
+	return result;
+}
+
+/*
+ * @func:  		main
+ *
+ * @brief:		The function to print the throughput table and the stress test result
+ *
+ * @param[1]:		argc - Number of arguments
+ * @param[2]:		argv - Megabytes per run (optional)
+ *
+ * @retval:		0 if the stream always came out intact, 1 otherwise
+ *
+ * @note:		None
+ */
+int main (int argc, char *argv[])
+{
+	uint64_t qwBytes = ((argc > 1) ? strtoull(argv[1], NULL, 0) : 64) * 1000000ULL;
+	const uint8_t aItemSizes[] = { 1, 4, 16, 64 };
+	uint64_t qwErrors = 0;
+
+	printf("%7s | %12s %12s | %12s %12s %8s\n", "item B", "endat MB/s", "bulk MB/s",
+	       "2 thr single", "2 thr bulk", "errors");
+
+	for (uint8_t byItemSize : aItemSizes)
+	{
+		double singleMb = BenchSingleThread(byItemSize, qwBytes, API_SINGLE);
+		double bulkMb = BenchSingleThread(byItemSize, qwBytes, API_BULK);
+		StressResult single = StressTwoThreads(byItemSize, qwBytes / 4, API_SINGLE);
+		StressResult bulk = StressTwoThreads(byItemSize, qwBytes, API_BULK);
+		uint64_t qwRunErrors = single.qwErrors + bulk.qwErrors +
+				       ((singleMb == 0) ? 1 : 0) + ((bulkMb == 0) ? 1 : 0);
+
+		printf("%7u | %12.1f %12.1f | %12.1f %12.1f %8llu\n", byItemSize, singleMb,
+		       bulkMb, single.mbPerSec, bulk.mbPerSec, (unsigned long long)qwRunErrors);
+
+		qwErrors += qwRunErrors;
+	}
+
+	StressResult inPlace = StressTwoThreads(1, qwBytes, API_IN_PLACE);
+
+	printf("reserve/commit + peek/consume, 2 threads: %.1f MB/s, %llu errors\n",
+	       inPlace.mbPerSec, (unsigned long long)inPlace.qwErrors);
+
+	qwErrors += inPlace.qwErrors;
+
+	return (qwErrors == 0) ? 0 : 1;
+}
@@ -0,0 +1,279 @@
+/*
+ * typed_queue_bench.cpp
+ *
+ *  Cost of one push + pop with the queues generated by DECLARE_QUEUE, next to
+ *  bufEnDat/bufDeDat of the generic buffqueue_t, for items of the sizes the firmware
+ *  queues: a byte, a word, and records of 16, 22 and 49 bytes.
+ *
+ *  Each round pushes BATCH_ITEMS items then pops them; the items popped are compared
+ *  with the items pushed.
+ *
+ *  Usage: typed_queue_bench [millions of items per run]
+ */
+
+/****************************************************************************************/
+/*                                      INCLUDEs                                	*/
+/****************************************************************************************/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+extern "C" {
+#include "queue.h"
+#include "typed_queue.h"
+}
+
+/****************************************************************************************/
+/*                                       DEFINEs                        		*/
+/****************************************************************************************/
+#define QUEUE_ITEMS				32		// Capacity of the typed queues
+#define QUEUE_BYTES				2048		// Storage of the generic queue
+#define BATCH_ITEMS				16		// Items per push/pop round
+
+typedef std::chrono::steady_clock bench_clock_t;
+
+struct record16_t { uint32_t dwValue[4]; };
+
+// An event id with a payload of up to 20 bytes
+struct record22_t { uint8_t byEvent; uint8_t byLength; uint8_t aPayload[20]; };
+
+// A serial frame of up to 48 bytes with its length
+struct record49_t { uint8_t byLength; uint8_t aData[48]; };
+
+DECLARE_QUEUE(byteQueue, uint8_t, QUEUE_ITEMS)
+DECLARE_QUEUE(wordQueue, uint32_t, QUEUE_ITEMS)
+DECLARE_QUEUE(record16Queue, record16_t, QUEUE_ITEMS)
+DECLARE_QUEUE(record22Queue, record22_t, QUEUE_ITEMS)
+DECLARE_QUEUE(record49Queue, record49_t, QUEUE_ITEMS)
+
+/****************************************************************************************/
+/*                                     FUNCTIONs                                        */
+/****************************************************************************************/
+/*
+ * @func:  		ElapsedNs
+ *
+ * @brief:		The function to get the nanoseconds since a time point
+ *
+ * @param[1]:		start - Time point
+ *
+ * @retval:		Nanoseconds
+ *
+ * @note:		None
+ */
+static double ElapsedNs (bench_clock_t::time_point start)
+{
+	return std::chrono::duration<double, std::nano>(bench_clock_t::now() - start).count();
+}
+
+/*
+ * @func:  		FillItems
+ *
+ * @brief:		The function to give every byte of the test items a distinct value
+ *
+ * @param[1]:		pItems - Items
+ * @param[2]:		size - Bytes of all the items
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+static void FillItems (void *pItems, size_t size)
+{
+	uint8_t *pByte = (uint8_t *)pItems;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		pByte[i] = (uint8_t)(i * 7 + 1);
+	}
+}
+
+/*
+ * @func:  		BenchTyped
+ *
+ * @brief:		The function to time one push + pop of a DECLARE_QUEUE queue
+ *
+ * @param[1]:		qwItems - Items to move
+ * @param[2]:		pbyError - Set to 1 if an item came out wrong
+ *
+ * @retval:		Nanoseconds per item
+ *
+ * @note:		Push and Pop are template arguments, so they are inlined as in the
+ * 			firmware
+ */
+template <typename T, typename Q, uint8_t (*Init)(Q *), uint8_t (*Push)(Q *, const T *),
+	  uint8_t (*Pop)(Q *, T *)>
+static double BenchTyped (uint64_t qwItems, uint8_t *pbyError)
+{
+	static Q queue;
+	T in[BATCH_ITEMS];
+	T out[BATCH_ITEMS];
+	uint64_t qwRounds = qwItems / BATCH_ITEMS;
+
+	Init(&queue);
+	FillItems(in, sizeof(in));
+
+	bench_clock_t::time_point start = bench_clock_t::now();
+
+	for (uint64_t r = 0; r < qwRounds; r++)
+	{
+		for (uint16_t i = 0; i < BATCH_ITEMS; i++)
+		{
+			Push(&queue, &in[i]);
+		}
+
+		for (uint16_t i = 0; i < BATCH_ITEMS; i++)
+		{
+			Pop(&queue, &out[i]);
+		}
+
+		// Keeps the copies from being optimised away
+		__asm__ __volatile__("" : : "r"(out) : "memory");
+	}
+
+	double ns = ElapsedNs(start) / (double)(qwRounds * BATCH_ITEMS);
+
+	if (memcmp(in, out, sizeof(in)) != 0)
+	{
+		*pbyError = 1;
+	}
+
+	return ns;
+}
+
+/*
+ * @func:  		BenchGeneric
+ *
+ * @brief:		The function to time one bufEnDat + bufDeDat of the same item type
+ *
+ * @param[1]:		qwItems - Items to move
+ * @param[2]:		pbyError - Set to 1 if an item came out wrong
+ *
+ * @retval:		Nanoseconds per item
+ *
+ * @note:		None
+ */
+template <typename T>
+static double BenchGeneric (uint64_t qwItems, uint8_t *pbyError)
+{
+	static uint8_t byStorage[QUEUE_BYTES];
+	T in[BATCH_ITEMS];
+	T out[BATCH_ITEMS];
+	uint64_t qwRounds = qwItems / BATCH_ITEMS;
+	buffqueue_t queue;
+
+	bufInit(byStorage, &queue, sizeof(T), QUEUE_BYTES);
+	FillItems(in, sizeof(in));
+
+	bench_clock_t::time_point start = bench_clock_t::now();
+
+	for (uint64_t r = 0; r < qwRounds; r++)
+	{
+		for (uint16_t i = 0; i < BATCH_ITEMS; i++)
+		{
+			bufEnDat(&queue, (uint8_t *)&in[i]);
+		}
+
+		for (uint16_t i = 0; i < BATCH_ITEMS; i++)
+		{
+			bufDeDat(&queue, (uint8_t *)&out[i]);
+		}
+
+		__asm__ __volatile__("" : : "r"(out) : "memory");
+	}
+
+	double ns = ElapsedNs(start) / (double)(qwRounds * BATCH_ITEMS);
+
+	if (memcmp(in, out, sizeof(in)) != 0)
+	{
+		*pbyError = 1;
+	}
+
+	return ns;
+}
+
+/*
+ * The Init functions of DECLARE_QUEUE return nothing: wrappers with the signature
+ * expected by BenchTyped
+ */
+#define TYPED_INIT(name)							\
+	static uint8_t name##BenchInit (name##_t *pQueue)			\
+	{									\
+		name##Init(pQueue);						\
+		return ERR_OK;							\
+	}
+
+TYPED_INIT(byteQueue)
+TYPED_INIT(wordQueue)
+TYPED_INIT(record16Queue)
+TYPED_INIT(record22Queue)
+TYPED_INIT(record49Queue)
+
+/*
+ * @func:  		PrintRow
+ *
+ * @brief:		The function to print the figures of one item type
+ *
+ * @param[1]:		strType - Name of the item type
+ * @param[2]:		size - Item size in bytes
+ * @param[3]:		typedNs - ns per item with DECLARE_QUEUE
+ * @param[4]:		genericNs - ns per item with bufEnDat/bufDeDat
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+static void PrintRow (const char *strType, size_t size, double typedNs, double genericNs)
+{
+	printf("%-12s %6zu | %10.2f %12.2f %8.1fx\n", strType, size, typedNs, genericNs,
+	       genericNs / typedNs);
+}
+
+/*
+ * @func:  		main
+ *
+ * @brief:		The function to print the cost per item of both queues
+ *
+ * @param[1]:		argc - Number of arguments
+ * @param[2]:		argv - Millions of items per run (optional)
+ *
+ * @retval:		0 if every item came out intact, 1 otherwise
+ *
+ * @note:		None
+ */
+int main (int argc, char *argv[])
+{
+	uint64_t qwItems = ((argc > 1) ? strtoull(argv[1], NULL, 0) : 20) * 1000000ULL;
+	uint8_t byError = 0;
+
+	printf("%-12s %6s | %10s %12s %9s\n", "item", "bytes", "typed ns", "endat ns",
+	       "speedup");
+
+	PrintRow("uint8_t", sizeof(uint8_t),
+		 BenchTyped<uint8_t, byteQueue_t, byteQueueBenchInit, byteQueuePush,
+			    byteQueuePop>(qwItems, &byError),
+		 BenchGeneric<uint8_t>(qwItems, &byError));
+	PrintRow("uint32_t", sizeof(uint32_t),
+		 BenchTyped<uint32_t, wordQueue_t, wordQueueBenchInit, wordQueuePush,
+			    wordQueuePop>(qwItems, &byError),
+		 BenchGeneric<uint32_t>(qwItems, &byError));
+	PrintRow("record16_t", sizeof(record16_t),
+		 BenchTyped<record16_t, record16Queue_t, record16QueueBenchInit, record16QueuePush,
+			    record16QueuePop>(qwItems, &byError),
+		 BenchGeneric<record16_t>(qwItems, &byError));
+	PrintRow("record22_t", sizeof(record22_t),
+		 BenchTyped<record22_t, record22Queue_t, record22QueueBenchInit, record22QueuePush,
+			    record22QueuePop>(qwItems, &byError),
+		 BenchGeneric<record22_t>(qwItems, &byError));
+	PrintRow("record49_t", sizeof(record49_t),
+		 BenchTyped<record49_t, record49Queue_t, record49QueueBenchInit, record49QueuePush,
+			    record49QueuePop>(qwItems, &byError),
+		 BenchGeneric<record49_t>(qwItems, &byError));
+
+	if (byError != 0)
+	{
+		printf("an item came out wrong\n");
+	}
+
+	return byError;
+}
@@ -0,0 +1,261 @@
+/*
+ * profile_dump.cpp
+ *
+ *  Prints the scheduler profile of a serial host board (CMD_ID_PROFILE, firmware built
+ *  with USE_SCHED_PROFILER) as a table: one line per timer, event or handler.
+ *
+ *  A frame carries 38 bytes of payload at most, so the board answers one slot and one
+ *  page per request; the slots are read one by one until the count it returns.
+ *
+ *  Usage: profile_dump <port> [reset]
+ */
+
+/****************************************************************************************/
+/*                                      INCLUDEs                                	*/
+/****************************************************************************************/
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "serial_gateway.h"
+
+/****************************************************************************************/
+/*                                       DEFINEs                        		*/
+/****************************************************************************************/
+// As in the serial host firmware
+#define CMD_ID_PROFILE				0x8C
+#define PROFILE_VERSION				0x01
+#define PROFILE_PAGE_RUNTIME			0x00
+#define PROFILE_PAGE_LATENESS			0x01
+#define PROFILE_NAME_SIZE			11
+#define PROFILE_BUCKETS				5
+#define PROFILE_NO_LATENESS			0xFFFFFFFFU
+
+#define PROFILE_ANSWER_TIMEOUT			1000		// ms
+
+/****************************************************************************************/
+/*                                  STRUCTs AND ENUMs                           	*/
+/****************************************************************************************/
+struct ProfileRow
+{
+	std::string strName;
+	uint32_t dwCalls = 0;
+	uint32_t dwMinUs = 0;
+	uint32_t dwAvgUs = 0;
+	uint32_t dwMaxUs = 0;
+	uint32_t dwLateMinUs = PROFILE_NO_LATENESS;
+	uint32_t dwLateAvgUs = PROFILE_NO_LATENESS;
+	uint32_t dwLateMaxUs = PROFILE_NO_LATENESS;
+	uint16_t awHistogram[PROFILE_BUCKETS] = {};
+};
+
+/****************************************************************************************/
+/*                                     FUNCTIONs                                        */
+/****************************************************************************************/
+/*
+ * @func:  		GetValue
+ *
+ * @brief:		The function to read a 4-byte value, high byte first
+ *
+ * @param:		pData - First byte
+ *
+ * @retval:		Value
+ *
+ * @note:		None
+ */
+static uint32_t GetValue (const uint8_t *pData)
+{
+	return ((uint32_t)pData[0] << 24) | ((uint32_t)pData[1] << 16) |
+	       ((uint32_t)pData[2] << 8) | pData[3];
+}
+
+/*
+ * @func:  		Request
+ *
+ * @brief:		The function to send a CMD_ID_PROFILE command and wait for its answer
+ *
+ * @param[1]:		gateway - Gateway holding the link
+ * @param[2]:		link - Link of the board
+ * @param[3]:		byCmdType - CMD_TYPE_GET or CMD_TYPE_SET
+ * @param[4]:		pPayload - Payload of the command
+ * @param[5]:		byLength - Length of the payload
+ * @param[6]:		answer - Set to the answered payload
+ * @param[7]:		pbAnswered - Set by the gateway callback
+ *
+ * @retval:		false on timeout
+ *
+ * @note:		None
+ */
+static bool Request (SerialGateway &gateway, int link, uint8_t byCmdType, const uint8_t *pPayload,
+		     uint8_t byLength, std::vector<uint8_t> &answer, bool *pbAnswered)
+{
+	*pbAnswered = false;
+	answer.clear();
+
+	if (!gateway.Send(link, 0x00, CMD_ID_PROFILE, byCmdType, pPayload, byLength))
+	{
+		return false;
+	}
+
+	auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(PROFILE_ANSWER_TIMEOUT);
+
+	while (!*pbAnswered && (std::chrono::steady_clock::now() < end))
+	{
+		gateway.Poll(10);
+	}
+
+	return *pbAnswered;
+}
+
+/*
+ * @func:  		PrintUs
+ *
+ * @brief:		The function to print a time column, "-" when not known
+ *
+ * @param:		dwUs - Time (us)
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+static void PrintUs (uint32_t dwUs)
+{
+	if (dwUs == PROFILE_NO_LATENESS)
+	{
+		printf(" %9s", "-");
+	}
+	else
+	{
+		printf(" %9u", dwUs);
+	}
+}
+
+int main (int argc, char *argv[])
+{
+	std::vector<uint8_t> answer;
+	bool bAnswered = false;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <port> [reset]\n", argv[0]);
+		return 1;
+	}
+
+	SerialGateway gateway([&] (const GatewayMessage &message)
+	{
+		if ((message.pCmd->cmdCommon.cmdid == CMD_ID_PROFILE) &&
+		    (message.pCmd->cmdCommon.type == CMD_TYPE_RES))
+		{
+			const uint8_t *pPayload = (const uint8_t *)message.pCmd + sizeof(cmd_common_t);
+
+			answer.assign(pPayload, pPayload + message.payloadLength);
+			bAnswered = true;
+		}
+	});
+
+	int link = gateway.OpenLink(argv[1], B57600);
+
+	if (link < 0)
+	{
+		fprintf(stderr, "cannot open %s\n", argv[1]);
+		return 1;
+	}
+
+	if ((argc > 2) && (strcmp(argv[2], "reset") == 0))
+	{
+		if (!Request(gateway, link, CMD_TYPE_SET, nullptr, 0, answer, &bAnswered))
+		{
+			fprintf(stderr, "no answer to the reset\n");
+			return 1;
+		}
+
+		printf("statistics cleared\n");
+		return 0;
+	}
+
+	std::vector<ProfileRow> rows;
+	uint8_t byCount = 1;
+
+	for (uint8_t bySlot = 0; bySlot < byCount; bySlot++)
+	{
+		ProfileRow row;
+
+		for (uint8_t byPage = PROFILE_PAGE_RUNTIME; byPage <= PROFILE_PAGE_LATENESS; byPage++)
+		{
+			const uint8_t byRequest[] = {bySlot, byPage};
+
+			if (!Request(gateway, link, CMD_TYPE_GET, byRequest, sizeof(byRequest), answer, &bAnswered) ||
+			    (answer.size() < 4) || (answer[0] != PROFILE_VERSION))
+			{
+				fprintf(stderr, "no profile answer for slot %u\n", bySlot);
+				return 1;
+			}
+
+			byCount = answer[2];
+
+			if (answer.size() < (4 + PROFILE_NAME_SIZE + 16))
+			{
+				// Past the last slot, or no slot at all
+				break;
+			}
+
+			const uint8_t *pData = &answer[4];
+
+			row.strName.assign((const char *)pData, strnlen((const char *)pData, PROFILE_NAME_SIZE));
+			pData += PROFILE_NAME_SIZE;
+
+			if (byPage == PROFILE_PAGE_RUNTIME)
+			{
+				row.dwCalls = GetValue(&pData[0]);
+				row.dwMinUs = GetValue(&pData[4]);
+				row.dwAvgUs = GetValue(&pData[8]);
+				row.dwMaxUs = GetValue(&pData[12]);
+			}
+			else if (answer.size() >= (4 + PROFILE_NAME_SIZE + 12 + 2 * PROFILE_BUCKETS))
+			{
+				row.dwLateMinUs = GetValue(&pData[0]);
+				row.dwLateAvgUs = GetValue(&pData[4]);
+				row.dwLateMaxUs = GetValue(&pData[8]);
+
+				for (unsigned i = 0; i < PROFILE_BUCKETS; i++)
+				{
+					row.awHistogram[i] = (uint16_t)((pData[12 + 2 * i] << 8) | pData[13 + 2 * i]);
+				}
+			}
+		}
+
+		if (bySlot < byCount)
+		{
+			rows.push_back(row);
+		}
+	}
+
+	// Jitter: spread of the lateness, max - min
+	printf("%-11s %9s %9s %9s %9s %9s %9s %9s |%7s %7s %7s %7s %7s\n",
+	       "name", "calls", "min us", "avg us", "max us", "late avg", "late max", "jitter",
+	       "<10us", "<100us", "<1ms", "<10ms", ">=10ms");
+
+	for (const ProfileRow &row : rows)
+	{
+		printf("%-11s %9u", row.strName.c_str(), row.dwCalls);
+		PrintUs((row.dwCalls != 0) ? row.dwMinUs : PROFILE_NO_LATENESS);
+		PrintUs((row.dwCalls != 0) ? row.dwAvgUs : PROFILE_NO_LATENESS);
+		PrintUs((row.dwCalls != 0) ? row.dwMaxUs : PROFILE_NO_LATENESS);
+		PrintUs(row.dwLateAvgUs);
+		PrintUs(row.dwLateMaxUs);
+		PrintUs((row.dwLateMinUs != PROFILE_NO_LATENESS) ?
+			(row.dwLateMaxUs - row.dwLateMinUs) : PROFILE_NO_LATENESS);
+		printf(" |");
+
+		for (unsigned i = 0; i < PROFILE_BUCKETS; i++)
+		{
+			printf(" %7u", row.awHistogram[i]);
+		}
+
+		printf("\n");
+	}
+
+	return 0;
+}
@@ -0,0 +1,217 @@
+/*
+ * gateway_benchmark.cpp
+ *
+ *  Frames per second decoded by SerialGateway with 1, 16 and 64 simulated boards.
+ *
+ *  Each board is a pseudo-terminal pair: a feeder thread writes multi-sensor telemetry
+ *  frames on the slave sides as fast as they are taken, the gateway reads the master sides
+ *  in the main thread and answers every 16th frame with a LED command.
+ *
+ *  Usage: gateway_benchmark [seconds per run]
+ */
+
+/****************************************************************************************/
+/*                                      INCLUDEs                                	*/
+/****************************************************************************************/
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "serial_gateway.h"
+
+/****************************************************************************************/
+/*                                       DEFINEs                        		*/
+/****************************************************************************************/
+#define CMD_ID_MULTI_SENSOR			0x88		// As in the serial host firmware
+#define FRAMES_PER_WRITE			32
+#define ANSWER_EVERY				16
+
+/****************************************************************************************/
+/*                                     FUNCTIONs                                        */
+/****************************************************************************************/
+/*
+ * @func:  		OpenBoard
+ *
+ * @brief:		The function to open a pseudo-terminal pair standing for a board
+ *
+ * @param[1]:		pMaster - Receives the gateway side
+ * @param[2]:		pSlave - Receives the board side (raw, non-blocking)
+ *
+ * @retval:		true on success
+ *
+ * @note:		None
+ */
+static bool OpenBoard (int *pMaster, int *pSlave)
+{
+	struct termios tio;
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+
+	if ((master < 0) || (grantpt(master) != 0) || (unlockpt(master) != 0))
+	{
+		return false;
+	}
+
+	int slave = open(ptsname(master), O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+	if (slave < 0)
+	{
+		close(master);
+		return false;
+	}
+
+	tcgetattr(slave, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(slave, TCSANOW, &tio);
+
+	*pMaster = master;
+	*pSlave = slave;
+
+	return true;
+}
+
+/*
+ * @func:  		RunBoards
+ *
+ * @brief:		The function to measure the gateway with a number of boards
+ *
+ * @param[1]:		boards - Number of simulated boards
+ * @param[2]:		seconds - Duration of the measure
+ *
+ * @retval:		false if the pseudo-terminals could not be opened
+ *
+ * @note:		None
+ */
+static bool RunBoards (unsigned boards, double seconds)
+{
+	std::vector<int> slaves;
+	std::atomic<bool> bStop(false);
+	uint64_t qwFrames = 0;
+	uint64_t qwAnswers = 0;
+	SerialGateway *pGateway = nullptr;
+
+	SerialGateway gateway([&] (const GatewayMessage &message)
+	{
+		static const uint8_t byLed[] = {0x00, 0x01, 0x00, 0x00, 0x01};
+
+		qwFrames++;
+
+		if ((message.pCmd->cmdCommon.cmdid == CMD_ID_MULTI_SENSOR) && ((qwFrames % ANSWER_EVERY) == 0))
+		{
+			qwAnswers += pGateway->Send(message.linkId, 0x00, CMD_ID_LED, CMD_TYPE_SET,
+						    byLed, sizeof(byLed));
+		}
+	});
+
+	pGateway = &gateway;
+
+	for (unsigned i = 0; i < boards; i++)
+	{
+		int master, slave;
+
+		if (!OpenBoard(&master, &slave) || (gateway.AddLink(master) < 0))
+		{
+			fprintf(stderr, "cannot open board %u\n", i);
+			return false;
+		}
+
+		slaves.push_back(slave);
+	}
+
+	// Telemetry frame of the serial host: version, timestamp, three TLVs
+	std::vector<uint8_t> batch;
+	const uint8_t byTelemetry[] = {0x01, 0x00, 0x00, 0x10, 0x00,
+				       CMD_ID_TEMP_SENSOR, 2, 0x00, 0xFA,
+				       CMD_ID_HUMI_SENSOR, 2, 0x01, 0x2C,
+				       CMD_ID_LIGHT_SENSOR, 2, 0x03, 0xE8};
+
+	for (unsigned i = 0; i < FRAMES_PER_WRITE; i++)
+	{
+		SerialGateway::EncodeFrame(batch, 0x00, CMD_ID_MULTI_SENSOR, CMD_TYPE_RES,
+					   byTelemetry, sizeof(byTelemetry), (uint8_t)i);
+	}
+
+	std::vector<size_t> offsets(boards, 0);
+
+	std::thread feeder([&]
+	{
+		uint8_t byDiscard[256];
+
+		while (!bStop.load())
+		{
+			for (unsigned i = 0; i < boards; i++)
+			{
+				// Keep every board streaming whole frames, and drain the LED commands
+				ssize_t written = write(slaves[i], &batch[offsets[i]], batch.size() - offsets[i]);
+
+				if (written > 0)
+				{
+					offsets[i] = (offsets[i] + written) % batch.size();
+				}
+
+				while (read(slaves[i], byDiscard, sizeof(byDiscard)) > 0)
+				{
+				}
+			}
+		}
+	});
+
+	auto start = std::chrono::steady_clock::now();
+	auto end = start + std::chrono::duration<double>(seconds);
+
+	while (std::chrono::steady_clock::now() < end)
+	{
+		gateway.Poll(10);
+	}
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	bStop = true;
+	feeder.join();
+
+	uint64_t qwErrors = 0;
+	uint64_t qwWrites = 0;
+
+	for (unsigned i = 0; i < boards; i++)
+	{
+		const GatewayLinkStats *pStats = gateway.Stats((int)i);
+
+		if (pStats != nullptr)
+		{
+			qwErrors += pStats->qwErrors;
+			qwWrites += pStats->qwWrites;
+		}
+
+		close(slaves[i]);
+	}
+
+	printf("%3u boards  %10.0f frames/s  %8.0f frames/s/board  %llu errors  "
+	       "%llu commands in %llu writes\n",
+	       boards, qwFrames / elapsed, qwFrames / elapsed / boards,
+	       (unsigned long long)qwErrors, (unsigned long long)qwAnswers,
+	       (unsigned long long)qwWrites);
+
+	return true;
+}
+
+int main (int argc, char *argv[])
+{
+	double seconds = (argc > 1) ? atof(argv[1]) : 2.0;
+	const unsigned boards[] = {1, 16, 64};
+
+	for (unsigned count : boards)
+	{
+		if (!RunBoards(count, seconds))
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,532 @@
+/*
+ * serial_gateway.cpp
+ *
+ *  Multiplexes serial links with epoll. Nothing blocks: reads take what is there, the
+ *  frame parser of the link keeps an incomplete frame until the rest arrives, and a batch
+ *  that does not fit in the driver is finished when epoll reports the link writable.
+ */
+
+/****************************************************************************************/
+/*                                      INCLUDEs                                	*/
+/****************************************************************************************/
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "serial_gateway.h"
+
+/****************************************************************************************/
+/*                                       DEFINEs                        		*/
+/****************************************************************************************/
+#define GATEWAY_EVENTS_MAX			64
+#define GATEWAY_READ_SIZE			1024
+
+/****************************************************************************************/
+/*                                  STRUCTs AND ENUMs                           	*/
+/****************************************************************************************/
+struct SerialGateway::Link
+{
+	int fd = -1;
+	int id = -1;
+	bool bWatchOutput = false;			// EPOLLOUT requested for an unfinished batch
+	uint8_t bySequence = 0;
+	frameparser_t parser;
+	uint8_t byWork[GATEWAY_MAX_LENGTH + FRAME_PARSER_OVERHEAD];
+	std::vector<uint8_t> txBatch;
+	size_t txSent = 0;				// Bytes of txBatch already written
+	GatewayLinkStats stats;
+};
+
+/****************************************************************************************/
+/*                                     FUNCTIONs                                        */
+/****************************************************************************************/
+SerialGateway::SerialGateway (message_callback callback) :
+	m_epoll(epoll_create1(EPOLL_CLOEXEC)), m_callback(std::move(callback))
+{
+}
+
+SerialGateway::~SerialGateway ()
+{
+	for (size_t i = 0; i < m_links.size(); i++)
+	{
+		RemoveLink((int)i);
+	}
+
+	StopTrace();
+
+	if (m_epoll >= 0)
+	{
+		close(m_epoll);
+	}
+}
+
+/*
+ * @func:  		SerialGateway::OpenLink
+ *
+ * @brief:		The function to open a serial port in raw 8N1 mode and add it
+ *
+ * @param[1]:		path - Serial port (/dev/ttyACM0, ...)
+ * @param[2]:		baudRate - Bxxx constant of termios.h
+ *
+ * @retval:		Link id, -1 on error
+ *
+ * @note:		None
+ */
+int SerialGateway::OpenLink (const char *path, speed_t baudRate)
+{
+	struct termios tio;
+	int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+
+	if (fd < 0)
+	{
+		return -1;
+	}
+
+	if (tcgetattr(fd, &tio) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+
+	cfmakeraw(&tio);
+	cfsetispeed(&tio, baudRate);
+	cfsetospeed(&tio, baudRate);
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS);
+
+	if (tcsetattr(fd, TCSANOW, &tio) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+
+	return AddLink(fd);
+}
+
+/*
+ * @func:  		SerialGateway::AddLink
+ *
+ * @brief:		The function to add an open descriptor
+ *
+ * @param:		fd - Serial port or pseudo-terminal, owned by the gateway from now on
+ *
+ * @retval:		Link id, -1 on error
+ *
+ * @note:		None
+ */
+int SerialGateway::AddLink (int fd)
+{
+	struct epoll_event event = {};
+	std::unique_ptr<Link> link(new Link);
+
+	if ((m_epoll < 0) || (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0))
+	{
+		close(fd);
+		return -1;
+	}
+
+	link->fd = fd;
+	link->id = (int)m_links.size();
+	FrameParser_Init(&link->parser, link->byWork, sizeof(link->byWork), GATEWAY_MAX_LENGTH);
+
+	event.events = EPOLLIN;
+	event.data.u32 = (uint32_t)link->id;
+
+	if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+
+	m_links.push_back(std::move(link));
+
+	return (int)m_links.size() - 1;
+}
+
+/*
+ * @func:  		SerialGateway::RemoveLink
+ *
+ * @brief:		The function to close a link
+ *
+ * @param:		linkId - Link id returned by AddLink / OpenLink
+ *
+ * @retval:		None
+ *
+ * @note:		Bytes not sent yet are lost. The id is not reused
+ */
+void SerialGateway::RemoveLink (int linkId)
+{
+	if ((linkId < 0) || ((size_t)linkId >= m_links.size()) || !m_links[linkId])
+	{
+		return;
+	}
+
+	epoll_ctl(m_epoll, EPOLL_CTL_DEL, m_links[linkId]->fd, nullptr);
+	close(m_links[linkId]->fd);
+	m_links[linkId].reset();
+}
+
+/*
+ * @func:  		SerialGateway::Send
+ *
+ * @brief:		The function to queue a frame for a link
+ *
+ * @param[1]:		linkId - Link id
+ * @param[2]:		byOption - Byte Option of the frame
+ * @param[3]:		byCmdId - Byte CmdID of the frame
+ * @param[4]:		byCmdType - Byte CmdType of the frame
+ * @param[5]:		pPayload - Bytes of the payload
+ * @param[6]:		byLengthPayload - Size of the payload
+ *
+ * @retval:		false if the link is unknown or its batch is full
+ *
+ * @note:		Written at the end of the next Poll, with every other frame of the link
+ */
+bool SerialGateway::Send (int linkId, uint8_t byOption, uint8_t byCmdId, uint8_t byCmdType,
+			  const uint8_t *pPayload, uint8_t byLengthPayload)
+{
+	if ((linkId < 0) || ((size_t)linkId >= m_links.size()) || !m_links[linkId])
+	{
+		return false;
+	}
+
+	Link &link = *m_links[linkId];
+
+	if ((link.txBatch.size() - link.txSent + byLengthPayload + 7) > GATEWAY_TX_BATCH_MAX)
+	{
+		link.stats.qwSendRefused++;
+		return false;
+	}
+
+	size_t start = link.txBatch.size();
+
+	link.bySequence++;
+	EncodeFrame(link.txBatch, byOption, byCmdId, byCmdType, pPayload, byLengthPayload, link.bySequence);
+
+	if (m_pTrace != nullptr)
+	{
+		TraceFrame(linkId, SERIAL_TRACE_TX, &link.txBatch[start], (uint8_t)(link.txBatch.size() - start));
+	}
+
+	return true;
+}
+
+/*
+ * @func:  		SerialGateway::Poll
+ *
+ * @brief:		The function to serve every ready link once
+ *
+ * @param:		timeoutMs - Longest wait for a link to be ready (-1: no limit)
+ *
+ * @retval:		Number of links that were ready, -1 on error
+ *
+ * @note:		The callback may call Send: the frame leaves at the end of this call
+ */
+int SerialGateway::Poll (int timeoutMs)
+{
+	struct epoll_event events[GATEWAY_EVENTS_MAX];
+	int ready = epoll_wait(m_epoll, events, GATEWAY_EVENTS_MAX, timeoutMs);
+
+	if (ready < 0)
+	{
+		return (errno == EINTR) ? 0 : -1;
+	}
+
+	for (int i = 0; i < ready; i++)
+	{
+		uint32_t id = events[i].data.u32;
+
+		if ((id < m_links.size()) && m_links[id] && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+		{
+			if (!ReadLink(*m_links[id]))
+			{
+				RemoveLink((int)id);
+			}
+		}
+	}
+
+	// One write per link, for the frames queued by the callbacks and since the last call
+	for (std::unique_ptr<Link> &link : m_links)
+	{
+		if (link && (link->txSent < link->txBatch.size()))
+		{
+			FlushLink(*link);
+		}
+	}
+
+	return ready;
+}
+
+/*
+ * @func:  		SerialGateway::Stats
+ *
+ * @brief:		The function to return the counters of a link
+ *
+ * @param:		linkId - Link id
+ *
+ * @retval:		The counters, nullptr if the link is unknown
+ *
+ * @note:		None
+ */
+const GatewayLinkStats *SerialGateway::Stats (int linkId) const
+{
+	if ((linkId < 0) || ((size_t)linkId >= m_links.size()) || !m_links[linkId])
+	{
+		return nullptr;
+	}
+
+	return &m_links[linkId]->stats;
+}
+
+/*
+ * @func:  		SerialGateway::StartTrace
+ *
+ * @brief:		The function to record the frames of every link in a trace file
+ *
+ * @param:		path - Trace file, replaced if it exists
+ *
+ * @retval:		false if the file cannot be created
+ *
+ * @note:		A trace already started is closed first
+ */
+bool SerialGateway::StartTrace (const char *path)
+{
+	uint8_t byHeader[SERIAL_TRACE_HEADER_SIZE];
+
+	StopTrace();
+
+	m_pTrace = fopen(path, "wb");
+
+	if (m_pTrace == nullptr)
+	{
+		return false;
+	}
+
+	fwrite(byHeader, 1, SerialTrace_WriteHeader(byHeader), m_pTrace);
+	m_traceLast = std::chrono::steady_clock::now();
+
+	return true;
+}
+
+/*
+ * @func:  		SerialGateway::StopTrace
+ *
+ * @brief:		The function to close the trace file
+ *
+ * @param:		None
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+void SerialGateway::StopTrace (void)
+{
+	if (m_pTrace != nullptr)
+	{
+		fclose(m_pTrace);
+		m_pTrace = nullptr;
+	}
+}
+
+/*
+ * @func:  		SerialGateway::TraceFrame
+ *
+ * @brief:		The function to append a frame to the trace file
+ *
+ * @param[1]:		linkId - Link of the frame
+ * @param[2]:		byDirection - SERIAL_TRACE_RX or SERIAL_TRACE_TX
+ * @param[3]:		pFrame - Frame
+ * @param[4]:		byLength - Length of the frame
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+void SerialGateway::TraceFrame (int linkId, uint8_t byDirection, const uint8_t *pFrame, uint8_t byLength)
+{
+	uint8_t byRecord[SERIAL_TRACE_RECORD_MAX(0xFF)];
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	uint32_t dwDeltaUs = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(now - m_traceLast).count();
+
+	// Keep the sub-microsecond rest for the next record, so the deltas add up
+	m_traceLast += std::chrono::microseconds(dwDeltaUs);
+
+	fwrite(byRecord, 1, SerialTrace_EncodeRecord(byRecord, (uint8_t)(((linkId & 0x7F) << 1) | byDirection),
+						     dwDeltaUs, pFrame, byLength), m_pTrace);
+}
+
+/*
+ * @func:  		SerialGateway::EncodeFrame
+ *
+ * @brief:		The function to append a frame to a buffer
+ *
+ * @param[1]:		buffer - Receives the frame
+ * @param[2]:		byOption - Byte Option of the frame
+ * @param[3]:		byCmdId - Byte CmdID of the frame
+ * @param[4]:		byCmdType - Byte CmdType of the frame
+ * @param[5]:		pPayload - Bytes of the payload
+ * @param[6]:		byLengthPayload - Size of the payload
+ * @param[7]:		bySequence - Sequence number
+ *
+ * @retval:		None
+ *
+ * @note:		CXOR check (CMD_OPT_CRC32 is not set by this function)
+ */
+void SerialGateway::EncodeFrame (std::vector<uint8_t> &buffer, uint8_t byOption, uint8_t byCmdId,
+				 uint8_t byCmdType, const uint8_t *pPayload, uint8_t byLengthPayload,
+				 uint8_t bySequence)
+{
+	size_t start = buffer.size();
+
+	buffer.push_back(FRAME_SOF);
+	buffer.push_back((uint8_t)(5 + byLengthPayload));
+	buffer.push_back(byOption);
+	buffer.push_back(byCmdId);
+	buffer.push_back(byCmdType);
+	buffer.insert(buffer.end(), pPayload, pPayload + byLengthPayload);
+	buffer.push_back(bySequence);
+	buffer.push_back(FrameParser_Xor(&buffer[start + 2], buffer.size() - start - 2, CXOR_INIT_VAL));
+}
+
+/*
+ * @func:  		SerialGateway::ReadLink
+ *
+ * @brief:		The function to read a ready link and decode its frames
+ *
+ * @param:		link - Ready link
+ *
+ * @retval:		false if the board is gone (the link must be removed)
+ *
+ * @note:		One read per call: a busy link does not starve the others
+ */
+bool SerialGateway::ReadLink (Link &link)
+{
+	uint8_t byRead[GATEWAY_READ_SIZE];
+	const uint8_t *pFrame;
+	ssize_t length = read(link.fd, byRead, sizeof(byRead));
+
+	if (length <= 0)
+	{
+		return (length < 0) && ((errno == EAGAIN) || (errno == EINTR));
+	}
+
+	link.stats.qwBytesReceived += length;
+
+	for (ssize_t offset = 0; offset < length; )
+	{
+		offset += FrameParser_Feed(&link.parser, &byRead[offset], (uint16_t)(length - offset));
+
+		for (;;)
+		{
+			uint8_t byState = FrameParser_Poll(&link.parser, &pFrame);
+
+			if (byState == UART_STATE_IDLE)
+			{
+				break;
+			}
+
+			switch (byState)
+			{
+				case UART_STATE_DATA_RECEIVED:
+				{
+					GatewayMessage message;
+
+					// pFrame[1] is the length byte, [2] the option, [3] the CmdID, [pFrame[1]] the Seq
+					message.linkId = link.id;
+					message.byOption = pFrame[2];
+					message.bySequence = pFrame[pFrame[1]];
+					message.pCmd = (const cmd_receive_t *)&pFrame[3];
+					message.payloadLength = pFrame[1] - 5;
+
+					link.stats.qwFrames++;
+
+					if (m_pTrace != nullptr)
+					{
+						TraceFrame(link.id, SERIAL_TRACE_RX, pFrame,
+							   (uint8_t)(1 + pFrame[1] + FRAME_PARSER_TRAILER_SIZE(pFrame[2])));
+					}
+
+					m_callback(message);
+				} break;
+
+				case UART_STATE_ACK_RECEIVED:
+					link.stats.qwAcks++;
+					break;
+
+				case UART_STATE_NACK_RECEIVED:
+					link.stats.qwNacks++;
+					break;
+
+				default:
+					link.stats.qwErrors++;
+					break;
+			}
+		}
+	}
+
+	return true;
+}
+
+/*
+ * @func:  		SerialGateway::FlushLink
+ *
+ * @brief:		The function to write the batch of a link
+ *
+ * @param:		link - Link with bytes to send
+ *
+ * @retval:		None
+ *
+ * @note:		What the driver does not take now is written on EPOLLOUT
+ */
+void SerialGateway::FlushLink (Link &link)
+{
+	ssize_t written = write(link.fd, &link.txBatch[link.txSent], link.txBatch.size() - link.txSent);
+
+	if (written > 0)
+	{
+		link.txSent += written;
+		link.stats.qwBytesSent += written;
+		link.stats.qwWrites++;
+	}
+
+	if (link.txSent == link.txBatch.size())
+	{
+		link.txBatch.clear();
+		link.txSent = 0;
+		WatchOutput(link, false);
+	}
+	else
+	{
+		WatchOutput(link, true);
+	}
+}
+
+/*
+ * @func:  		SerialGateway::WatchOutput
+ *
+ * @brief:		The function to wake Poll when an unfinished batch can go on
+ *
+ * @param[1]:		link - Link
+ * @param[2]:		bWatch - true while part of the batch is still to be written
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+void SerialGateway::WatchOutput (Link &link, bool bWatch)
+{
+	struct epoll_event event = {};
+
+	if (link.bWatchOutput == bWatch)
+	{
+		return;
+	}
+
+	event.events = EPOLLIN | (bWatch ? (uint32_t)EPOLLOUT : 0u);
+	event.data.u32 = (uint32_t)link.id;
+	epoll_ctl(m_epoll, EPOLL_CTL_MOD, link.fd, &event);
+	link.bWatchOutput = bWatch;
+}
@@ -0,0 +1,136 @@
+/*
+ * serial_gateway.h
+ *
+ *  One PC, many KIT boards: multiplexes serial (or pseudo-terminal) links with epoll in
+ *  the calling thread. Each link has its own frame parser and its own batch of outgoing
+ *  frames; the decoded frames of every link come out of one callback.
+ */
+
+#ifndef SERIAL_GATEWAY_H_
+#define SERIAL_GATEWAY_H_
+
+/****************************************************************************************/
+/*                                      INCLUDEs                                	*/
+/****************************************************************************************/
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <termios.h>
+
+extern "C" {
+#include "serial.h"
+#include "frameparser.h"
+#include "serialtrace.h"
+}
+
+/****************************************************************************************/
+/*                                       DEFINEs                        		*/
+/****************************************************************************************/
+// Largest Length byte accepted from a board
+#define GATEWAY_MAX_LENGTH			CMD_LENGTH_MAX
+
+// Outgoing bytes kept per link before Send refuses more
+#define GATEWAY_TX_BATCH_MAX			4096
+
+/****************************************************************************************/
+/*                                  STRUCTs AND ENUMs                           	*/
+/****************************************************************************************/
+// A decoded frame: pCmd points at its CmdID, valid during the callback only
+struct GatewayMessage
+{
+	int linkId;
+	uint8_t byOption;
+	uint8_t bySequence;
+	const cmd_receive_t *pCmd;
+	size_t payloadLength;
+};
+
+struct GatewayLinkStats
+{
+	uint64_t qwBytesReceived = 0;
+	uint64_t qwBytesSent = 0;
+	uint64_t qwFrames = 0;
+	uint64_t qwErrors = 0;				// Bad CXOR / CRC-32, bad length, garbage
+	uint64_t qwAcks = 0;
+	uint64_t qwNacks = 0;
+	uint64_t qwWrites = 0;				// write() calls: frames per write = batching
+	uint64_t qwSendRefused = 0;			// Send with the batch full
+};
+
+class SerialGateway
+{
+public:
+	typedef std::function<void (const GatewayMessage &message)> message_callback;
+
+	explicit SerialGateway (message_callback callback);
+	~SerialGateway ();
+
+	SerialGateway (const SerialGateway &) = delete;
+	SerialGateway &operator= (const SerialGateway &) = delete;
+
+	/*
+	 * @brief:		Opens a serial port in raw 8N1 mode and adds it
+	 * @retval:		Link id, -1 on error
+	 */
+	int OpenLink (const char *path, speed_t baudRate);
+
+	/*
+	 * @brief:		Adds an open descriptor (made non-blocking); the gateway closes it
+	 * @retval:		Link id, -1 on error
+	 */
+	int AddLink (int fd);
+
+	void RemoveLink (int linkId);
+
+	/*
+	 * @brief:		Queues a frame; the frames queued for a link leave in one write
+	 * @retval:		false if the link is unknown or its batch is full
+	 */
+	bool Send (int linkId, uint8_t byOption, uint8_t byCmdId, uint8_t byCmdType,
+		   const uint8_t *pPayload, uint8_t byLengthPayload);
+
+	/*
+	 * @brief:		Waits up to timeoutMs for the links, reads and decodes them, calls the
+	 * 			callback for each frame, then writes the batches
+	 * @retval:		Number of links that were ready, -1 on error
+	 */
+	int Poll (int timeoutMs);
+
+	const GatewayLinkStats *Stats (int linkId) const;
+
+	/*
+	 * @brief:		Records every frame received and sent in a trace file (serialtrace.h),
+	 * 			the link id (0..127) in the channel byte
+	 * @retval:		false if the file cannot be created
+	 */
+	bool StartTrace (const char *path);
+	void StopTrace (void);
+
+	/*
+	 * @brief:		Appends a frame to a buffer, built as Serial_SendPacketCustom does
+	 */
+	static void EncodeFrame (std::vector<uint8_t> &buffer, uint8_t byOption, uint8_t byCmdId,
+				 uint8_t byCmdType, const uint8_t *pPayload, uint8_t byLengthPayload,
+				 uint8_t bySequence);
+
+private:
+	struct Link;
+
+	bool ReadLink (Link &link);
+	void FlushLink (Link &link);
+	void WatchOutput (Link &link, bool bWatch);
+	void TraceFrame (int linkId, uint8_t byDirection, const uint8_t *pFrame, uint8_t byLength);
+
+	int m_epoll;
+	message_callback m_callback;
+	std::vector<std::unique_ptr<Link>> m_links;	// Indexed by link id, null once removed
+	FILE *m_pTrace = nullptr;
+	std::chrono::steady_clock::time_point m_traceLast;
+};
+
+#endif /* SERIAL_GATEWAY_H_ */
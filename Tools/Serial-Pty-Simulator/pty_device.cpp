@@ -0,0 +1,242 @@
+/*
+ * pty_device.cpp
+ *
+ *  Stand-in for the KIT board on the slave side of a pseudo-terminal.
+ *
+ *  Every received byte goes through FrameParser_Feed / FrameParser_Poll, valid frames go
+ *  through SerialCmd_Dispatch, and frames with CMD_OPT_RELIABLE are answered with FRAME_ACK
+ *  + Seq and de-duplicated by ReliableLink_IsDuplicate, as in SERIAL_RELIABLE_MODE of the
+ *  serial host firmware. The handlers only count the commands: the LED, buzzer and LCD
+ *  drivers are not available on the PC.
+ */
+
+/****************************************************************************************/
+/*                                      INCLUDEs                                	*/
+/****************************************************************************************/
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+
+#include "pty_device.h"
+
+extern "C" {
+#include "serial.h"
+#include "serialcmd.h"
+#include "frameparser.h"
+#include "reliablelink.h"
+}
+
+/****************************************************************************************/
+/*                                       DEFINEs                        		*/
+/****************************************************************************************/
+// Same limit as RX_BUFFER_SIZE of serial.h, used by the firmware
+#define DEVICE_MAX_LENGTH			RX_BUFFER_SIZE
+
+/****************************************************************************************/
+/*                                  GLOBAL VARIABLEs                 			*/
+/****************************************************************************************/
+// The dispatcher takes plain function pointers: the handlers count into the running device
+static PtyDeviceStats 	*g_pDeviceStats = nullptr;
+
+// The device does not send reliable frames itself, its link only suppresses duplicates
+static reliablelink_t 	g_deviceLink;
+
+/****************************************************************************************/
+/*                                 FUNCTIONs PROTOTYPE                                  */
+/****************************************************************************************/
+static void 	DeviceCmdHandler (const cmd_receive_t *pCmd);
+static void 	DeviceSendFrame (const uint8_t *pFrame, uint8_t byLength);
+
+/****************************************************************************************/
+/*                                     FUNCTIONs                                        */
+/****************************************************************************************/
+PtyDevice::PtyDevice (int fd) : m_fd(fd)
+{
+}
+
+/*
+ * @func:  		PtyDevice::Run
+ *
+ * @brief:		The function to read, parse and answer frames until bStop is set
+ *
+ * @param:		bStop - Set by the load generator once every frame has been sent
+ *
+ * @retval:		None
+ *
+ * @note:		Only one device may run at a time (the dispatcher table is global)
+ */
+void PtyDevice::Run (const std::atomic<bool> &bStop)
+{
+	uint8_t byWork[DEVICE_MAX_LENGTH + FRAME_PARSER_OVERHEAD];
+	uint8_t byRead[512];
+	frameparser_t parser;
+	const uint8_t *pFrame;
+	struct pollfd pfd = {m_fd, POLLIN, 0};
+
+	g_pDeviceStats = &m_stats;
+
+	FrameParser_Init(&parser, byWork, sizeof(byWork), DEVICE_MAX_LENGTH);
+	ReliableLink_Init(&g_deviceLink, DeviceSendFrame);
+
+	SerialCmd_Init();
+	SerialCmd_Register(CMD_ID_LED, CMD_TYPE_SET, DeviceCmdHandler);
+	SerialCmd_Register(CMD_ID_BUZZER, CMD_TYPE_SET, DeviceCmdHandler);
+	SerialCmd_Register(CMD_ID_BUTTON, CMD_TYPE_SET, DeviceCmdHandler);
+	SerialCmd_Register(CMD_ID_LCD, CMD_TYPE_SET, DeviceCmdHandler);
+
+	while (!bStop.load())
+	{
+		if (poll(&pfd, 1, 10) <= 0)
+		{
+			continue;
+		}
+
+		ssize_t length = read(m_fd, byRead, sizeof(byRead));
+
+		if (length <= 0)
+		{
+			if ((length < 0) && (errno == EINTR || errno == EAGAIN))
+			{
+				continue;
+			}
+
+			break;
+		}
+
+		m_stats.qwBytesReceived += length;
+
+		uint16_t wOffset = 0;
+
+		while (wOffset < length)
+		{
+			wOffset += FrameParser_Feed(&parser, &byRead[wOffset], length - wOffset);
+
+			for (;;)
+			{
+				uint8_t byState = FrameParser_Poll(&parser, &pFrame);
+
+				if (byState == UART_STATE_IDLE)
+				{
+					break;
+				}
+
+				if (byState == UART_STATE_DATA_RECEIVED)
+				{
+					HandleFrame(pFrame);
+				}
+				else if (byState == UART_STATE_ERROR)
+				{
+					m_stats.qwFramesError++;
+				}
+			}
+		}
+	}
+
+	g_pDeviceStats = nullptr;
+}
+
+/*
+ * @func:  		PtyDevice::HandleFrame
+ *
+ * @brief:		The function to acknowledge and dispatch a valid frame
+ *
+ * @param:		pFrame - Frame, from its SOF
+ *
+ * @retval:		None
+ *
+ * @note:		Same order as processSerialReceiverCustom: ACK every copy, dispatch once
+ */
+void PtyDevice::HandleFrame (const uint8_t *pFrame)
+{
+	m_stats.qwFramesOk++;
+
+	// pFrame[1] is the length byte, [2] the option, [3] the CmdID, [pFrame[1]] the Seq
+	if (pFrame[2] & CMD_OPT_RELIABLE)
+	{
+		uint8_t byAck[] = {FRAME_ACK, pFrame[pFrame[1]]};
+
+		WriteAll(byAck, sizeof(byAck));
+		m_stats.qwAckSent++;
+
+		if (ReliableLink_IsDuplicate(&g_deviceLink, pFrame[pFrame[1]]))
+		{
+			m_stats.qwDuplicates++;
+			return;
+		}
+	}
+
+	if (!SerialCmd_Dispatch(&pFrame[3]))
+	{
+		m_stats.qwUnknownCommands++;
+	}
+}
+
+/*
+ * @func:  		PtyDevice::WriteAll
+ *
+ * @brief:		The function to write bytes to the pseudo-terminal
+ *
+ * @param[1]:		pData - Bytes to write
+ * @param[2]:		length - Number of bytes
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+void PtyDevice::WriteAll (const uint8_t *pData, size_t length)
+{
+	while (length > 0)
+	{
+		ssize_t written = write(m_fd, pData, length);
+
+		if (written < 0)
+		{
+			if (errno == EINTR || errno == EAGAIN)
+			{
+				continue;
+			}
+
+			return;
+		}
+
+		pData += written;
+		length -= written;
+	}
+}
+
+/*
+ * @func:  		DeviceCmdHandler
+ *
+ * @brief:		The handler registered for every command the firmware accepts
+ *
+ * @param:		pCmd - Received command
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+static void DeviceCmdHandler (const cmd_receive_t *pCmd)
+{
+	if (g_pDeviceStats != nullptr)
+	{
+		g_pDeviceStats->aqwDispatched[pCmd->cmdCommon.cmdid]++;
+	}
+}
+
+/*
+ * @func:  		DeviceSendFrame
+ *
+ * @brief:		The transmit function of g_deviceLink, never called (nothing sent reliably)
+ *
+ * @param[1]:		pFrame - Frame to send
+ * @param[2]:		byLength - Length of the frame
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+static void DeviceSendFrame (const uint8_t *pFrame, uint8_t byLength)
+{
+	(void)pFrame;
+	(void)byLength;
+}
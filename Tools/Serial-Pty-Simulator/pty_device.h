@@ -0,0 +1,56 @@
+/*
+ * pty_device.h
+ *
+ *  Stand-in for the KIT board on the slave side of a pseudo-terminal: the
+ *  frame parser, command dispatcher and reliable link of the firmware,
+ *  compiled for Linux.
+ */
+
+#ifndef PTY_DEVICE_H_
+#define PTY_DEVICE_H_
+
+/****************************************************************************************/
+/*                                      INCLUDEs                                	*/
+/****************************************************************************************/
+#include <atomic>
+#include <cstdint>
+
+/****************************************************************************************/
+/*                                  STRUCTs AND ENUMs                           	*/
+/****************************************************************************************/
+// Counters of the device side, read once the device thread has stopped
+struct PtyDeviceStats
+{
+	uint64_t qwBytesReceived = 0;
+	uint64_t qwFramesOk = 0;			// Frames with a good length and CXOR / CRC-32
+	uint64_t qwFramesError = 0;			// UART_STATE_ERROR results (bad CXOR, bad length, garbage)
+	uint64_t qwDuplicates = 0;			// Reliable frames received again, not dispatched
+	uint64_t qwUnknownCommands = 0;			// Frames no handler was registered for
+	uint64_t qwAckSent = 0;
+	uint64_t aqwDispatched[256] = {};		// Frames dispatched, per CmdID
+};
+
+class PtyDevice
+{
+public:
+	/*
+	 * @brief:		fd - Slave side of the pseudo-terminal, in raw mode
+	 */
+	explicit PtyDevice (int fd);
+
+	/*
+	 * @brief:		Reads, parses and answers frames until bStop is set
+	 */
+	void Run (const std::atomic<bool> &bStop);
+
+	const PtyDeviceStats &Stats (void) const { return m_stats; }
+
+private:
+	void HandleFrame (const uint8_t *pFrame);
+	void WriteAll (const uint8_t *pData, size_t length);
+
+	int m_fd;
+	PtyDeviceStats m_stats;
+};
+
+#endif /* PTY_DEVICE_H_ */
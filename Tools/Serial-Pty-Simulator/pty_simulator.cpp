@@ -0,0 +1,558 @@
+/*
+ * pty_simulator.cpp
+ *
+ *  Load test of the serial protocol on Linux, in place of the PC_Simulator_KIT.
+ *
+ *  A pseudo-terminal pair connects this load generator (master side) to PtyDevice (slave
+ *  side), which runs the protocol code of the firmware. Commands of a scripted mix are sent
+ *  at a fixed rate with CMD_OPT_RELIABLE, so the device answers each one with FRAME_ACK +
+ *  Seq; the time to that ACK is the latency of the frame.
+ *
+ *  Usage: pty_simulator [-r frames/s] [-n frames] [-s script] [-c corrupt %] [-t timeout ms]
+ *
+ *  Script: one command per line, "name weight payload...", name being led, buzzer, button,
+ *  lcd or a CmdID (0x..), the payload in hexadecimal bytes or as a "quoted text":
+ *
+ *	led	4	00 01 00 00 01
+ *	buzzer	1	64
+ *	lcd	1	"Hello KIT"
+ */
+
+/****************************************************************************************/
+/*                                      INCLUDEs                                	*/
+/****************************************************************************************/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "pty_device.h"
+
+extern "C" {
+#include "serial.h"
+#include "frameparser.h"
+#include "reliablelink.h"
+}
+
+/****************************************************************************************/
+/*                                       DEFINEs                        		*/
+/****************************************************************************************/
+#define DEFAULT_RATE				1000		// Frames per second
+#define DEFAULT_FRAMES				10000
+#define DEFAULT_TIMEOUT_MS			500		// An ACK later than this counts as a drop
+
+/****************************************************************************************/
+/*                                  STRUCTs AND ENUMs                           	*/
+/****************************************************************************************/
+typedef std::chrono::steady_clock clock_type;
+
+// One command of the mix, picked with a probability proportional to its weight
+struct ScriptCommand
+{
+	uint8_t byCmdId;
+	unsigned weight;
+	std::vector<uint8_t> payload;
+};
+
+// A frame waiting for its FRAME_ACK, indexed by its sequence number. Whoever clears
+// bPending (the ACK reader or the sender reusing the number) owns the frame
+struct PendingFrame
+{
+	std::atomic<bool> bPending{false};
+	std::atomic<clock_type::rep> sent{0};
+};
+
+struct SimulatorStats
+{
+	uint64_t qwSent = 0;
+	uint64_t qwCorrupted = 0;			// Sent with a flipped bit (-c)
+	uint64_t qwAcked = 0;
+	uint64_t qwNacked = 0;
+	uint64_t qwLate = 0;				// ACK after the timeout
+	uint64_t qwDropped = 0;				// Never acknowledged
+	uint64_t qwUnexpected = 0;			// ACK for no pending frame, or other bytes
+	std::vector<double> latencyUs;
+};
+
+/****************************************************************************************/
+/*                                     FUNCTIONs                                        */
+/****************************************************************************************/
+/*
+ * @func:  		BuildFrame
+ *
+ * @brief:		The function to build a frame as Serial_SendPacketCustom does
+ *
+ * @param[1]:		byOption - Byte Option of the frame
+ * @param[2]:		byCmdId - Byte CmdID of the frame
+ * @param[3]:		byCmdType - Byte CmdType of the frame
+ * @param[4]:		payload - Bytes of the payload
+ * @param[5]:		bySequence - Sequence number
+ *
+ * @retval:		The frame, from FRAME_SOF to CXOR
+ *
+ * @note:		None
+ */
+static std::vector<uint8_t> BuildFrame (uint8_t byOption, uint8_t byCmdId, uint8_t byCmdType,
+					const std::vector<uint8_t> &payload, uint8_t bySequence)
+{
+	std::vector<uint8_t> frame;
+
+	frame.push_back(FRAME_SOF);
+	frame.push_back((uint8_t)(5 + payload.size()));
+	frame.push_back(byOption);
+	frame.push_back(byCmdId);
+	frame.push_back(byCmdType);
+	frame.insert(frame.end(), payload.begin(), payload.end());
+	frame.push_back(bySequence);
+	frame.push_back(FrameParser_Xor(&frame[2], frame.size() - 2, CXOR_INIT_VAL));
+
+	return frame;
+}
+
+/*
+ * @func:  		DefaultScript
+ *
+ * @brief:		The function to return the mix used without -s
+ *
+ * @param:		None
+ *
+ * @retval:		LED, buzzer and LCD commands
+ *
+ * @note:		None
+ */
+static std::vector<ScriptCommand> DefaultScript (void)
+{
+	const char text[] = "Load test";
+
+	return {
+		{CMD_ID_LED, 4, {0x00, 0x01, 0x00, 0x00, 0x01}},
+		{CMD_ID_BUZZER, 1, {0x64}},
+		{CMD_ID_LCD, 1, std::vector<uint8_t>(text, text + sizeof(text) - 1)},
+	};
+}
+
+/*
+ * @func:  		LoadScript
+ *
+ * @brief:		The function to read a command mix (see the top of this file)
+ *
+ * @param[1]:		path - Script file
+ * @param[2]:		script - Receives the commands
+ *
+ * @retval:		true if the file was read without error
+ *
+ * @note:		None
+ */
+static bool LoadScript (const char *path, std::vector<ScriptCommand> &script)
+{
+	std::ifstream file(path);
+	std::string line;
+	unsigned lineNumber = 0;
+
+	if (!file)
+	{
+		fprintf(stderr, "cannot open %s\n", path);
+		return false;
+	}
+
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+
+		std::istringstream fields(line);
+		std::string name;
+		ScriptCommand command;
+
+		if (!(fields >> name) || (name[0] == '#'))
+		{
+			continue;
+		}
+
+		if (name == "led")		command.byCmdId = CMD_ID_LED;
+		else if (name == "buzzer")	command.byCmdId = CMD_ID_BUZZER;
+		else if (name == "button")	command.byCmdId = CMD_ID_BUTTON;
+		else if (name == "lcd")		command.byCmdId = CMD_ID_LCD;
+		else				command.byCmdId = (uint8_t)strtoul(name.c_str(), nullptr, 0);
+
+		if (!(fields >> command.weight))
+		{
+			fprintf(stderr, "%s:%u: weight expected\n", path, lineNumber);
+			return false;
+		}
+
+		fields >> std::ws;
+
+		if (fields.peek() == '"')
+		{
+			std::string text;
+
+			fields.get();
+			std::getline(fields, text, '"');
+			command.payload.assign(text.begin(), text.end());
+		}
+		else
+		{
+			std::string byte;
+
+			while (fields >> byte)
+			{
+				command.payload.push_back((uint8_t)strtoul(byte.c_str(), nullptr, 16));
+			}
+		}
+
+		if ((5 + command.payload.size()) > RX_BUFFER_SIZE)
+		{
+			fprintf(stderr, "%s:%u: payload longer than RX_BUFFER_SIZE allows\n", path, lineNumber);
+			return false;
+		}
+
+		script.push_back(command);
+	}
+
+	return !script.empty();
+}
+
+/*
+ * @func:  		OpenPtyPair
+ *
+ * @brief:		The function to open a pseudo-terminal pair in raw mode
+ *
+ * @param[1]:		pMaster - Receives the master side (load generator)
+ * @param[2]:		pSlave - Receives the slave side (device)
+ *
+ * @retval:		true on success
+ *
+ * @note:		None
+ */
+static bool OpenPtyPair (int *pMaster, int *pSlave)
+{
+	struct termios tio;
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+
+	if ((master < 0) || (grantpt(master) != 0) || (unlockpt(master) != 0))
+	{
+		perror("posix_openpt");
+		return false;
+	}
+
+	int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+
+	if (slave < 0)
+	{
+		perror("open slave");
+		close(master);
+		return false;
+	}
+
+	// No echo, no line editing, no CR/LF translation: the frames are binary
+	tcgetattr(slave, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(slave, TCSANOW, &tio);
+
+	*pMaster = master;
+	*pSlave = slave;
+
+	return true;
+}
+
+/*
+ * @func:  		ReadAcks
+ *
+ * @brief:		The function to match the FRAME_ACK / FRAME_NACK + Seq answers of the device
+ *
+ * @param[1]:		fd - Master side of the pseudo-terminal
+ * @param[2]:		pending - Frames waiting for their answer
+ * @param[3]:		stats - Counters of the load generator
+ * @param[4]:		qwOutstanding - Number of frames waiting for their answer
+ * @param[5]:		timeout - Latency above which an ACK counts as late
+ * @param[6]:		bStop - Set when the last answer is no longer expected
+ *
+ * @retval:		None
+ *
+ * @note:		Runs in its own thread; pending is shared with the sender through the atomic
+ * 			flags
+ */
+static void ReadAcks (int fd, std::vector<PendingFrame> &pending, SimulatorStats &stats,
+		      std::atomic<uint64_t> &qwOutstanding, clock_type::duration timeout,
+		      const std::atomic<bool> &bStop)
+{
+	uint8_t byRead[512];
+	int previous = -1;				// FRAME_ACK / FRAME_NACK waiting for its Seq
+	struct pollfd pfd = {fd, POLLIN, 0};
+
+	while (!bStop.load())
+	{
+		if (poll(&pfd, 1, 10) <= 0)
+		{
+			continue;
+		}
+
+		ssize_t length = read(fd, byRead, sizeof(byRead));
+
+		if (length <= 0)
+		{
+			continue;
+		}
+
+		clock_type::time_point now = clock_type::now();
+
+		for (ssize_t i = 0; i < length; i++)
+		{
+			if (previous < 0)
+			{
+				if ((byRead[i] == FRAME_ACK) || (byRead[i] == FRAME_NACK))
+				{
+					previous = byRead[i];
+				}
+				else
+				{
+					stats.qwUnexpected++;
+				}
+
+				continue;
+			}
+
+			PendingFrame &frame = pending[byRead[i]];
+
+			if (previous == FRAME_NACK)
+			{
+				stats.qwNacked++;
+			}
+			else if (!frame.bPending.exchange(false))
+			{
+				stats.qwUnexpected++;
+			}
+			else
+			{
+				clock_type::duration latency = now - clock_type::time_point(
+					clock_type::duration(frame.sent.load()));
+
+				qwOutstanding--;
+
+				if (latency > timeout)
+				{
+					stats.qwLate++;
+				}
+				else
+				{
+					stats.qwAcked++;
+					stats.latencyUs.push_back(
+						std::chrono::duration<double, std::micro>(latency).count());
+				}
+			}
+
+			previous = -1;
+		}
+	}
+}
+
+/*
+ * @func:  		Percentile
+ *
+ * @brief:		The function to return a percentile of sorted latencies
+ *
+ * @param[1]:		sorted - Latencies in increasing order
+ * @param[2]:		percent - 0 to 100
+ *
+ * @retval:		The latency, 0 if there is none
+ *
+ * @note:		Nearest rank
+ */
+static double Percentile (const std::vector<double> &sorted, double percent)
+{
+	if (sorted.empty())
+	{
+		return 0.0;
+	}
+
+	size_t rank = (size_t)((percent / 100.0) * (sorted.size() - 1) + 0.5);
+
+	return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+int main (int argc, char *argv[])
+{
+	unsigned rate = DEFAULT_RATE;
+	unsigned long frames = DEFAULT_FRAMES;
+	double corruptPercent = 0.0;
+	unsigned timeoutMs = DEFAULT_TIMEOUT_MS;
+	std::vector<ScriptCommand> script;
+	int option;
+
+	while ((option = getopt(argc, argv, "r:n:s:c:t:")) != -1)
+	{
+		switch (option)
+		{
+			case 'r': rate = (unsigned)strtoul(optarg, nullptr, 0); break;
+			case 'n': frames = strtoul(optarg, nullptr, 0); break;
+			case 'c': corruptPercent = atof(optarg); break;
+			case 't': timeoutMs = (unsigned)strtoul(optarg, nullptr, 0); break;
+			case 's':
+				if (!LoadScript(optarg, script))
+				{
+					return 1;
+				}
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-r frames/s] [-n frames] [-s script] "
+					"[-c corrupt %%] [-t timeout ms]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	if (script.empty())
+	{
+		script = DefaultScript();
+	}
+
+	if (rate == 0)
+	{
+		rate = DEFAULT_RATE;
+	}
+
+	int master, slave;
+
+	if (!OpenPtyPair(&master, &slave))
+	{
+		return 1;
+	}
+
+	std::atomic<bool> bStopDevice(false);
+	std::atomic<bool> bStopReader(false);
+	std::atomic<uint64_t> qwOutstanding(0);
+	std::vector<PendingFrame> pending(256);
+	SimulatorStats stats;
+	PtyDevice device(slave);
+	clock_type::duration timeout = std::chrono::milliseconds(timeoutMs);
+
+	std::thread deviceThread([&] { device.Run(bStopDevice); });
+	std::thread readerThread([&] { ReadAcks(master, pending, stats, qwOutstanding, timeout, bStopReader); });
+
+	// Pick the commands of the mix with their weights
+	std::vector<unsigned> weights;
+
+	for (const ScriptCommand &command : script)
+	{
+		weights.push_back(command.weight);
+	}
+
+	std::mt19937 random(1);
+	std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+	std::uniform_real_distribution<double> corrupt(0.0, 100.0);
+
+	clock_type::duration period = std::chrono::nanoseconds(1000000000ULL / rate);
+	clock_type::time_point start = clock_type::now();
+	clock_type::time_point next = start;
+	uint8_t bySequence = 0;
+
+	for (unsigned long n = 0; n < frames; n++)
+	{
+		const ScriptCommand &command = script[pick(random)];
+
+		bySequence++;
+
+		PendingFrame &frame = pending[bySequence];
+
+		if (frame.bPending.exchange(false))
+		{
+			// 256 frames later and still no ACK: the sequence number is reused
+			stats.qwDropped++;
+			qwOutstanding--;
+		}
+
+		std::vector<uint8_t> bytes = BuildFrame(CMD_OPT_RELIABLE, command.byCmdId, CMD_TYPE_SET,
+							command.payload, bySequence);
+
+		if ((corruptPercent > 0.0) && (corrupt(random) < corruptPercent))
+		{
+			// Flip one bit after the SOF and length, the CXOR no longer matches
+			bytes[2 + (random() % (bytes.size() - 2))] ^= (uint8_t)(1u << (random() % 8));
+			stats.qwCorrupted++;
+		}
+
+		std::this_thread::sleep_until(next);
+		next += period;
+
+		frame.sent = clock_type::now().time_since_epoch().count();
+		qwOutstanding++;
+		frame.bPending = true;
+
+		for (size_t written = 0; written < bytes.size(); )
+		{
+			ssize_t result = write(master, &bytes[written], bytes.size() - written);
+
+			if (result > 0)
+			{
+				written += result;
+			}
+		}
+
+		stats.qwSent++;
+	}
+
+	double elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+
+	// Wait for the last answers, then everything still pending is lost
+	clock_type::time_point deadline = clock_type::now() + timeout;
+
+	while ((qwOutstanding.load() != 0) && (clock_type::now() < deadline))
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	bStopReader = true;
+	readerThread.join();
+	bStopDevice = true;
+	deviceThread.join();
+
+	stats.qwDropped += qwOutstanding.load();
+
+	close(master);
+	close(slave);
+
+	const PtyDeviceStats &device_stats = device.Stats();
+
+	std::sort(stats.latencyUs.begin(), stats.latencyUs.end());
+
+	printf("sent          %llu frames in %.3f s (%.0f frames/s, target %u)\n",
+	       (unsigned long long)stats.qwSent, elapsed, stats.qwSent / elapsed, rate);
+	printf("corrupted     %llu\n", (unsigned long long)stats.qwCorrupted);
+	printf("acked         %llu\n", (unsigned long long)stats.qwAcked);
+	printf("nacked        %llu\n", (unsigned long long)stats.qwNacked);
+	printf("late          %llu (> %u ms)\n", (unsigned long long)stats.qwLate, timeoutMs);
+	printf("dropped       %llu\n", (unsigned long long)stats.qwDropped);
+	printf("unexpected    %llu bytes\n", (unsigned long long)stats.qwUnexpected);
+	printf("latency (us)  p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+	       Percentile(stats.latencyUs, 50), Percentile(stats.latencyUs, 90),
+	       Percentile(stats.latencyUs, 99), Percentile(stats.latencyUs, 99.9),
+	       stats.latencyUs.empty() ? 0.0 : stats.latencyUs.back());
+	printf("device        %llu bytes, %llu frames ok, %llu CXOR/length errors, "
+	       "%llu duplicates, %llu unknown\n",
+	       (unsigned long long)device_stats.qwBytesReceived,
+	       (unsigned long long)device_stats.qwFramesOk,
+	       (unsigned long long)device_stats.qwFramesError,
+	       (unsigned long long)device_stats.qwDuplicates,
+	       (unsigned long long)device_stats.qwUnknownCommands);
+
+	for (const ScriptCommand &command : script)
+	{
+		printf("  cmd 0x%02X    %llu dispatched\n", command.byCmdId,
+		       (unsigned long long)device_stats.aqwDispatched[command.byCmdId]);
+	}
+
+	// Every corrupted frame must be refused, every other one acknowledged in time
+	return ((stats.qwDropped + stats.qwLate) == stats.qwCorrupted) ? 0 : 2;
+}
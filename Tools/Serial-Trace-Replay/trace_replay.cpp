@@ -0,0 +1,291 @@
+/*
+ * trace_replay.cpp
+ *
+ *  Replays the frames received in a trace (serialtrace.h) through the receive path of the
+ *  serial host firmware, compiled for Linux, as fast as possible.
+ *
+ *  The path is the one of processSerialReceiverCustom / PollRxBuff: the bytes go through a
+ *  Queue-Library FIFO of SIZE_QUEUE_DATA_RX bytes, frames are parsed in place with
+ *  FrameParser_Parse (a frame that straddles the wrap point is copied first), then handed
+ *  to SerialCmd_Dispatch. Every CmdID / CmdType has a counting handler, so traces taken on
+ *  the gateway (answers of the boards) cost the same dispatch as commands.
+ *
+ *  Usage: trace_replay [-n passes] [-m max ns/frame] trace
+ *
+ *  Exit status 2 if a frame was lost or if a frame took longer than -m on average: a
+ *  throughput regression between two firmware releases.
+ */
+
+/****************************************************************************************/
+/*                                      INCLUDEs                                	*/
+/****************************************************************************************/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <unistd.h>
+
+extern "C" {
+#include "queue.h"
+#include "serial.h"
+#include "serialcmd.h"
+#include "frameparser.h"
+#include "serialtrace.h"
+}
+
+/****************************************************************************************/
+/*                                       DEFINEs                        		*/
+/****************************************************************************************/
+// As in main_Asm3_IOT303.c
+#define SIZE_QUEUE_DATA_RX 			256
+
+#define DEFAULT_PASSES				100
+
+/****************************************************************************************/
+/*                                  GLOBAL VARIABLEs                 			*/
+/****************************************************************************************/
+static uint8_t 		g_strRxBufData[SIZE_QUEUE_DATA_RX];
+static buffqueue_t 	g_serialQueueRx;
+static uint8_t 		g_strRxBuffer[RX_BUFFER_SIZE + FRAME_PARSER_OVERHEAD];
+static uint64_t 	g_qwDispatched = 0;
+static uint64_t 	g_qwErrors = 0;
+
+/****************************************************************************************/
+/*                                     FUNCTIONs                                        */
+/****************************************************************************************/
+/*
+ * @func:  		CountCmdHandler
+ *
+ * @brief:		The handler registered for every CmdID and CmdType
+ *
+ * @param:		pCmd - Received command
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+static void CountCmdHandler (const cmd_receive_t *pCmd)
+{
+	(void)pCmd;
+	g_qwDispatched++;
+}
+
+/*
+ * @func:  		ProcessRx
+ *
+ * @brief:		The function to parse and dispatch what the FIFO holds
+ *
+ * @param:		None
+ *
+ * @retval:		None
+ *
+ * @note:		PollRxBuff and processSerialReceiverCustom, without the peripherals
+ */
+static void ProcessRx (void)
+{
+	uint8_t *pData;
+	uint16_t wContiguous;
+	uint16_t wAvailable;
+	uint16_t wUsed;
+	uint8_t byState;
+
+	for (;;)
+	{
+		pData = bufPeekContiguous(&g_serialQueueRx, &wContiguous);
+
+		if (wContiguous == 0)
+		{
+			break;
+		}
+
+		byState = FrameParser_Parse(pData, wContiguous, RX_BUFFER_SIZE, &wUsed);
+		wAvailable = bufNumItems(&g_serialQueueRx);
+
+		if ((byState == UART_STATE_IDLE) && (wAvailable > wContiguous))
+		{
+			if (wAvailable > sizeof(g_strRxBuffer))
+			{
+				wAvailable = sizeof(g_strRxBuffer);
+			}
+
+			memcpy(g_strRxBuffer, pData, wContiguous);
+			memcpy(&g_strRxBuffer[wContiguous], g_strRxBufData, wAvailable - wContiguous);
+			pData = g_strRxBuffer;
+
+			byState = FrameParser_Parse(pData, wAvailable, RX_BUFFER_SIZE, &wUsed);
+		}
+
+		if (byState == UART_STATE_DATA_RECEIVED)
+		{
+			SerialCmd_Dispatch(&pData[3]);
+		}
+		else if (byState == UART_STATE_ERROR)
+		{
+			g_qwErrors++;
+		}
+
+		if (wUsed == 0)
+		{
+			break;
+		}
+
+		bufConsume(&g_serialQueueRx, wUsed);
+	}
+}
+
+/*
+ * @func:  		LoadTrace
+ *
+ * @brief:		The function to read the received frames of a trace
+ *
+ * @param[1]:		path - Trace file
+ * @param[2]:		stream - Receives the received frames, back to back
+ * @param[3]:		pFrames - Receives the number of received frames
+ *
+ * @retval:		false if the file is not a trace
+ *
+ * @note:		The sent frames (SERIAL_TRACE_TX) are skipped
+ */
+static bool LoadTrace (const char *path, std::vector<uint8_t> &stream, uint64_t *pFrames)
+{
+	std::vector<uint8_t> trace;
+	uint8_t byRead[4096];
+	size_t length;
+	FILE *pFile = fopen(path, "rb");
+
+	if (pFile == nullptr)
+	{
+		perror(path);
+		return false;
+	}
+
+	while ((length = fread(byRead, 1, sizeof(byRead), pFile)) > 0)
+	{
+		trace.insert(trace.end(), byRead, byRead + length);
+	}
+
+	fclose(pFile);
+
+	if (!SerialTrace_CheckHeader(trace.data(), (uint16_t)std::min<size_t>(trace.size(), 0xFFFF)))
+	{
+		fprintf(stderr, "%s: not a serial trace of version %u\n", path, SERIAL_TRACE_VERSION);
+		return false;
+	}
+
+	*pFrames = 0;
+
+	for (size_t offset = SERIAL_TRACE_HEADER_SIZE; offset < trace.size(); )
+	{
+		uint8_t byChannel;
+		uint32_t dwDeltaUs;
+		const uint8_t *pFrame;
+		uint8_t byLength;
+		uint16_t wRecord = SerialTrace_DecodeRecord(&trace[offset], trace.size() - offset,
+							    &byChannel, &dwDeltaUs, &pFrame, &byLength);
+
+		if (wRecord == 0)
+		{
+			fprintf(stderr, "%s: truncated record at byte %zu, ignored\n", path, offset);
+			break;
+		}
+
+		// ACK / NACK records are not frames: only the frames are counted as expected
+		if ((byChannel & SERIAL_TRACE_TX) == SERIAL_TRACE_RX)
+		{
+			stream.insert(stream.end(), pFrame, pFrame + byLength);
+
+			if ((byLength > 0) && (pFrame[0] == FRAME_SOF))
+			{
+				(*pFrames)++;
+			}
+		}
+
+		offset += wRecord;
+	}
+
+	return true;
+}
+
+int main (int argc, char *argv[])
+{
+	unsigned long passes = DEFAULT_PASSES;
+	double maxNsPerFrame = 0.0;
+	std::vector<uint8_t> stream;
+	uint64_t qwFrames;
+	int option;
+
+	while ((option = getopt(argc, argv, "n:m:")) != -1)
+	{
+		switch (option)
+		{
+			case 'n': passes = strtoul(optarg, nullptr, 0); break;
+			case 'm': maxNsPerFrame = atof(optarg); break;
+			default:
+				fprintf(stderr, "usage: %s [-n passes] [-m max ns/frame] trace\n", argv[0]);
+				return 1;
+		}
+	}
+
+	if ((optind >= argc) || !LoadTrace(argv[optind], stream, &qwFrames))
+	{
+		return 1;
+	}
+
+	if (qwFrames == 0)
+	{
+		fprintf(stderr, "%s: no received frame in the trace\n", argv[optind]);
+		return 1;
+	}
+
+	bufInit(g_strRxBufData, &g_serialQueueRx, sizeof(g_strRxBufData[0]), SIZE_QUEUE_DATA_RX);
+
+	SerialCmd_Init();
+
+	for (unsigned id = 0; id < SERIAL_CMD_TABLE_SIZE; id++)
+	{
+		SerialCmd_Register((uint8_t)id, CMD_TYPE_GET, CountCmdHandler);
+		SerialCmd_Register((uint8_t)id, CMD_TYPE_RES, CountCmdHandler);
+		SerialCmd_Register((uint8_t)id, CMD_TYPE_SET, CountCmdHandler);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (unsigned long pass = 0; pass < passes; pass++)
+	{
+		// The DMA commits bursts of bytes, the main loop parses what is there
+		for (size_t offset = 0; offset < stream.size(); )
+		{
+			size_t chunk = std::min<size_t>(stream.size() - offset, 0xFFFF);
+
+			offset += bufWrite(&g_serialQueueRx, &stream[offset], (uint16_t)chunk);
+			ProcessRx();
+		}
+	}
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	uint64_t qwExpected = qwFrames * passes;
+	double nsPerFrame = elapsed * 1e9 / qwExpected;
+
+	printf("trace         %llu frames, %zu bytes received\n", (unsigned long long)qwFrames, stream.size());
+	printf("replayed      %lu passes in %.3f s\n", passes, elapsed);
+	printf("dispatched    %llu of %llu frames, %llu errors\n", (unsigned long long)g_qwDispatched,
+	       (unsigned long long)qwExpected, (unsigned long long)g_qwErrors);
+	printf("throughput    %.0f frames/s, %.1f MB/s, %.1f ns/frame\n", qwExpected / elapsed,
+	       stream.size() * passes / elapsed / 1e6, nsPerFrame);
+
+	if (g_qwDispatched != qwExpected)
+	{
+		fprintf(stderr, "FAIL: %llu frames lost\n", (unsigned long long)(qwExpected - g_qwDispatched));
+		return 2;
+	}
+
+	if ((maxNsPerFrame > 0.0) && (nsPerFrame > maxNsPerFrame))
+	{
+		fprintf(stderr, "FAIL: %.1f ns/frame, more than %.1f\n", nsPerFrame, maxNsPerFrame);
+		return 2;
+	}
+
+	return 0;
+}
@@ -0,0 +1,228 @@
+/*
+ * timebase_test.cpp
+ *
+ *  Host test of Time-Base-Library on its mock clock.
+ *
+ *  - TimeBase_ElapsedMs / TimeBase_IsReachedMs on 32-bit GetMilSecTick stamps, around and
+ *    across the wrap of the tick, and for random stamps and delays;
+ *  - the 64-bit extension of the millisecond tick (TimeBase_GetMs / TimeBase_GetUs) over
+ *    several wraps of the 32-bit tick, read once per simulated hour;
+ *  - TimeBase_ElapsedUs / TimeBase_IsExpiredUs across the wrap of the tick, and the
+ *    difference of two TimeBase_GetCycles across the wrap of the cycle counter.
+ *
+ *  Usage: timebase_test
+ */
+
+/****************************************************************************************/
+/*                                      INCLUDEs                                	*/
+/****************************************************************************************/
+#include <cstdio>
+#include <random>
+
+extern "C" {
+#include "timebase.h"
+}
+
+/****************************************************************************************/
+/*                                       DEFINEs                        		*/
+/****************************************************************************************/
+#define CYCLES_PER_US				84		// Core clock of the KIT board (MHz)
+#define MS_PER_TICK_WRAP			(1ULL << 32)	// 49.7 days
+#define US_PER_HOUR				3600000000ULL
+#define RANDOM_CASES				1000000
+
+/****************************************************************************************/
+/*                                     VARIABLEs                                        */
+/****************************************************************************************/
+static uint32_t g_dwChecks;
+static uint32_t g_dwFailures;
+
+/****************************************************************************************/
+/*                                     FUNCTIONs                                        */
+/****************************************************************************************/
+/*
+ * @func:  		Check
+ *
+ * @brief:		The function to compare a result with the value expected
+ *
+ * @param[1]:		strWhat - Name of the check, printed if it fails
+ * @param[2]:		qwGot - Result
+ * @param[3]:		qwExpected - Value expected
+ *
+ * @retval:		None
+ *
+ * @note:		Only the first failures are printed
+ */
+static void Check (const char *strWhat, uint64_t qwGot, uint64_t qwExpected)
+{
+	g_dwChecks++;
+
+	if (qwGot == qwExpected)
+	{
+		return;
+	}
+
+	if (g_dwFailures++ < 20)
+	{
+		printf("FAIL %s: got %llu, expected %llu\n", strWhat, (unsigned long long)qwGot,
+		       (unsigned long long)qwExpected);
+	}
+}
+
+/*
+ * @func:  		TestElapsedMs
+ *
+ * @brief:		The function to test TimeBase_ElapsedMs and TimeBase_IsReachedMs
+ *
+ * @param:		None
+ *
+ * @retval:		None
+ *
+ * @note:		The stamps are plain 32-bit values: no clock is involved
+ */
+static void TestElapsedMs (void)
+{
+	// Before, across and after the wrap of the tick
+	Check("elapsed 10 -> 1010", TimeBase_ElapsedMs(10, 1010), 1000);
+	Check("elapsed same stamp", TimeBase_ElapsedMs(0x12345678, 0x12345678), 0);
+	Check("elapsed 0xFFFFFFFF -> 0", TimeBase_ElapsedMs(0xFFFFFFFF, 0), 1);
+	Check("elapsed 0xFFFFFF00 -> 0x100", TimeBase_ElapsedMs(0xFFFFFF00, 0x100), 0x200);
+	Check("elapsed 0 -> 0xFFFFFFFF", TimeBase_ElapsedMs(0, 0xFFFFFFFF), 0xFFFFFFFF);
+
+	// Deadline 0x200 ms after 0xFFFFFF00: 0x100 once the tick has wrapped
+	uint32_t dwDeadline = 0xFFFFFF00 + 0x200;
+
+	Check("reached before the wrap", TimeBase_IsReachedMs(dwDeadline, 0xFFFFFFF0), 0);
+	Check("reached 1 ms early", TimeBase_IsReachedMs(dwDeadline, 0xFF), 0);
+	Check("reached on time", TimeBase_IsReachedMs(dwDeadline, 0x100), 1);
+	Check("reached 1 ms late", TimeBase_IsReachedMs(dwDeadline, 0x101), 1);
+	Check("reached 24.8 days late", TimeBase_IsReachedMs(dwDeadline, dwDeadline + 0x7FFFFFFF), 1);
+
+	// Deadline just before the wrap, tick already wrapped
+	Check("reached after the wrap", TimeBase_IsReachedMs(0xFFFFFFFE, 0x00000003), 1);
+
+	std::mt19937 rng(1);
+
+	for (uint32_t i = 0; i < RANDOM_CASES; i++)
+	{
+		uint32_t dwStart = rng();
+		uint32_t dwDelay = rng() & 0x7FFFFFFF;
+		uint32_t dwDue = dwStart + dwDelay;
+
+		Check("random elapsed", TimeBase_ElapsedMs(dwStart, dwDue), dwDelay);
+		Check("random reached", TimeBase_IsReachedMs(dwDue, dwDue), 1);
+
+		if (dwDelay != 0)
+		{
+			Check("random reached early", TimeBase_IsReachedMs(dwDue, dwDue - 1), 0);
+		}
+	}
+}
+
+/*
+ * @func:  		TestExtension
+ *
+ * @brief:		The function to test the 64-bit extension of the millisecond tick
+ *
+ * @param:		None
+ *
+ * @retval:		None
+ *
+ * @note:		The mock clock starts 2 s before the first wrap of the 32-bit tick
+ */
+static void TestExtension (void)
+{
+	uint64_t qwStartUs = (MS_PER_TICK_WRAP - 2000) * 1000 + 123;
+
+	TimeBase_MockSetUs(qwStartUs);
+	TimeBase_Init(CYCLES_PER_US);
+
+	Check("ms at start", TimeBase_GetMs(), MS_PER_TICK_WRAP - 2000);
+	Check("us at start", TimeBase_GetUs(), qwStartUs);
+
+	// Across the wrap in 1 ms steps
+	for (uint32_t i = 1; i <= 4000; i++)
+	{
+		TimeBase_MockAdvanceUs(1000);
+		Check("ms across the wrap", TimeBase_GetMs(), MS_PER_TICK_WRAP - 2000 + i);
+	}
+
+	Check("us after the wrap", TimeBase_GetUs(), qwStartUs + 4000 * 1000ULL);
+
+	// Three more wraps, read once per hour (the main loop reads far more often)
+	uint64_t qwUs = qwStartUs + 4000 * 1000ULL;
+
+	while (qwUs < 4 * MS_PER_TICK_WRAP * 1000)
+	{
+		TimeBase_MockAdvanceUs(US_PER_HOUR);
+		qwUs += US_PER_HOUR;
+
+		Check("us over the wraps", TimeBase_GetUs(), qwUs);
+		Check("ms over the wraps", TimeBase_GetMs(), qwUs / 1000);
+	}
+}
+
+/*
+ * @func:  		TestDeadlines
+ *
+ * @brief:		The function to test the microsecond deadlines and the cycle counter
+ *
+ * @param:		None
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+static void TestDeadlines (void)
+{
+	// Microsecond deadline across the wrap of the 32-bit millisecond tick
+	TimeBase_MockSetUs(MS_PER_TICK_WRAP * 1000 - 700);
+	TimeBase_Init(CYCLES_PER_US);
+
+	uint64_t qwStart = TimeBase_GetUs();
+	uint64_t qwDeadline = TimeBase_DeadlineUs(1500);
+
+	TimeBase_MockAdvanceUs(1499);
+	Check("deadline 1 us early", TimeBase_IsExpiredUs(qwDeadline), 0);
+	Check("elapsed us across the wrap", TimeBase_ElapsedUs(qwStart), 1499);
+
+	TimeBase_MockAdvanceUs(1);
+	Check("deadline on time", TimeBase_IsExpiredUs(qwDeadline), 1);
+
+	// Cycle counter: wraps every 2^32 / 84 us (51.1 s)
+	TimeBase_MockSetUs(51130560);
+	TimeBase_Init(CYCLES_PER_US);
+
+	uint32_t dwStartCycles = TimeBase_GetCycles();
+
+	Check("cycles close to the wrap", dwStartCycles > 0xFFFFF000, 1);
+
+	TimeBase_MockAdvanceUs(100);
+
+	uint32_t dwCycles = TimeBase_GetCycles() - dwStartCycles;
+
+	Check("cycles across the wrap", dwCycles, 100 * CYCLES_PER_US);
+	Check("cycles to us", TimeBase_CyclesToUs(dwCycles), 100);
+}
+
+/*
+ * @func:  		main
+ *
+ * @brief:		The function to run the tests
+ *
+ * @param:		None
+ *
+ * @retval:		0 if every check passed, 1 otherwise
+ *
+ * @note:		None
+ */
+int main (void)
+{
+	TestElapsedMs();
+	TestExtension();
+	TestDeadlines();
+
+	printf("%u checks, %u failed\n", g_dwChecks, g_dwFailures);
+
+	return (g_dwFailures == 0) ? 0 : 1;
+}
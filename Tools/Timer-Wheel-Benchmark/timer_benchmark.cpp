@@ -0,0 +1,371 @@
+/*
+ * timer_benchmark.cpp
+ *
+ *  Cost of TimerStart, TimerStop and of the expiries in processTimerScheduler with the
+ *  Timer-Wheel-Library, as the number of running timers grows.
+ *
+ *  The library is built for the PC (no SysTick): the benchmark moves the millisecond tick
+ *  itself with TimerWheel_Tick, so a run of one million milliseconds takes a fraction of
+ *  a second. The same figures are given for a linear table of timers (the layout of the
+ *  SDK timer, scanned on every start and every tick) for comparison. Every expiry is
+ *  checked against the tick it was due at.
+ *
+ *  Usage: timer_benchmark [milliseconds per expiry run]
+ */
+
+/****************************************************************************************/
+/*                                      INCLUDEs                                	*/
+/****************************************************************************************/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include "timerwheel.h"
+}
+
+/****************************************************************************************/
+/*                                       DEFINEs                        		*/
+/****************************************************************************************/
+#define START_STOP_ROUNDS			20000
+#define PERIOD_MAX_MS				1000		// Expiry run: periods of 1..1000 ms
+
+typedef std::chrono::steady_clock bench_clock_t;
+
+/*
+ * A timer of the expiry run, checks that it is called on time
+ */
+struct TimerProbe
+{
+	uint32_t dwPeriod;
+	uint32_t dwDue;
+};
+
+/*
+ * Timer table scanned linearly, as in the SDK timer
+ */
+struct LinearTimer
+{
+	uint32_t dwExpire;
+	uint32_t dwPeriod;
+	uint8_t byRepeats;
+	void (*callback)(void *);
+	void *pData;
+};
+
+/****************************************************************************************/
+/*                                     VARIABLEs                                        */
+/****************************************************************************************/
+static std::vector<LinearTimer> g_linear;
+static uint32_t g_dwLinearTick;
+static uint64_t g_qwExpiries;
+static uint64_t g_qwLate;
+
+/****************************************************************************************/
+/*                                     FUNCTIONs                                        */
+/****************************************************************************************/
+/*
+ * @func:  		ElapsedNs
+ *
+ * @brief:		The function to get the nanoseconds since a time point
+ *
+ * @param[1]:		start - Time point
+ *
+ * @retval:		Nanoseconds
+ *
+ * @note:		None
+ */
+static double ElapsedNs (bench_clock_t::time_point start)
+{
+	return std::chrono::duration<double, std::nano>(bench_clock_t::now() - start).count();
+}
+
+/*
+ * @func:  		LinearStart
+ *
+ * @brief:		The function to start a timer of the linear table (first free entry)
+ *
+ * @param[1]:		dwPeriod - Period (ms)
+ * @param[2]:		callback - Function called on expiry
+ * @param[3]:		pData - Parameter of callback
+ *
+ * @retval:		Index of the timer, NO_TIMER if the table is full
+ *
+ * @note:		None
+ */
+static uint8_t LinearStart (uint32_t dwPeriod, void (*callback)(void *), void *pData)
+{
+	for (size_t i = 0; i < g_linear.size(); i++)
+	{
+		if (g_linear[i].callback == NULL)
+		{
+			g_linear[i] = { g_dwLinearTick + dwPeriod, dwPeriod, TIMER_REPEAT_FOREVER,
+					callback, pData };
+			return (uint8_t)i;
+		}
+	}
+
+	return NO_TIMER;
+}
+
+/*
+ * @func:  		LinearStop
+ *
+ * @brief:		The function to stop a timer of the linear table
+ *
+ * @param[1]:		byTimerId - Index of the timer
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+static void LinearStop (uint8_t byTimerId)
+{
+	g_linear[byTimerId].callback = NULL;
+}
+
+/*
+ * @func:  		LinearProcess
+ *
+ * @brief:		The function to count one millisecond and expire the linear table
+ *
+ * @param:		None
+ *
+ * @retval:		None
+ *
+ * @note:		Every entry is compared on every tick
+ */
+static void LinearProcess (void)
+{
+	g_dwLinearTick++;
+
+	for (LinearTimer &timer : g_linear)
+	{
+		if ((timer.callback != NULL) && ((int32_t)(g_dwLinearTick - timer.dwExpire) >= 0))
+		{
+			timer.dwExpire += timer.dwPeriod;
+			timer.callback(timer.pData);
+		}
+	}
+}
+
+/*
+ * @func:  		ProbeCallback
+ *
+ * @brief:		The function called on expiry in the wheel run, checks the tick
+ *
+ * @param[1]:		pData - TimerProbe of the timer
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+static void ProbeCallback (void *pData)
+{
+	TimerProbe *pProbe = (TimerProbe *) pData;
+
+	if (GetMilSecTick() != pProbe->dwDue)
+	{
+		g_qwLate++;
+	}
+
+	pProbe->dwDue += pProbe->dwPeriod;
+	g_qwExpiries++;
+}
+
+/*
+ * @func:  		CountCallback
+ *
+ * @brief:		The function called on expiry in the linear run
+ *
+ * @param[1]:		pData - Not used
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+static void CountCallback (void *pData)
+{
+	(void) pData;
+	g_qwExpiries++;
+}
+
+/*
+ * @func:  		BenchStartStop
+ *
+ * @brief:		The function to measure TimerStart / TimerStop with dwActive timers running
+ *
+ * @param[1]:		dwActive - Running timers, half of them are stopped and started again
+ * @param[2]:		rng - Random periods
+ * @param[3]:		pStartNs - Receives the nanoseconds per start (wheel)
+ * @param[4]:		pStopNs - Receives the nanoseconds per stop (wheel)
+ * @param[5]:		pLinearNs - Receives the nanoseconds per start (linear table)
+ *
+ * @retval:		None
+ *
+ * @note:		None
+ */
+static void BenchStartStop (uint32_t dwActive, std::mt19937 &rng, double *pStartNs,
+				double *pStopNs, double *pLinearNs)
+{
+	std::uniform_int_distribution<uint32_t> period(1, 3600000);
+	uint32_t dwBatch = (dwActive + 1) / 2;
+	std::vector<uint8_t> ids(dwBatch);
+	std::vector<uint32_t> periods(dwBatch);
+	double startNs = 0, stopNs = 0, linearNs = 0;
+
+	TimerInit();
+	for (uint32_t i = 0; i < dwActive - dwBatch; i++)
+	{
+		TimerStart((char *) "background", period(rng), TIMER_REPEAT_FOREVER, CountCallback, NULL);
+	}
+
+	g_linear.assign(dwActive, LinearTimer());
+	for (uint32_t i = 0; i < dwActive - dwBatch; i++)
+	{
+		LinearStart(period(rng), CountCallback, NULL);
+	}
+
+	for (int round = 0; round < START_STOP_ROUNDS; round++)
+	{
+		for (uint32_t i = 0; i < dwBatch; i++)
+		{
+			periods[i] = period(rng);
+		}
+
+		bench_clock_t::time_point start = bench_clock_t::now();
+		for (uint32_t i = 0; i < dwBatch; i++)
+		{
+			ids[i] = TimerStart((char *) "batch", periods[i], TIMER_REPEAT_FOREVER,
+						CountCallback, NULL);
+		}
+		startNs += ElapsedNs(start);
+
+		start = bench_clock_t::now();
+		for (uint32_t i = 0; i < dwBatch; i++)
+		{
+			TimerStop(ids[i]);
+		}
+		stopNs += ElapsedNs(start);
+
+		/* Each tick of the wheel is cheap when nothing is due, keep time moving */
+		TimerWheel_Tick();
+		processTimerScheduler();
+
+		start = bench_clock_t::now();
+		for (uint32_t i = 0; i < dwBatch; i++)
+		{
+			ids[i] = LinearStart(periods[i], CountCallback, NULL);
+		}
+		linearNs += ElapsedNs(start);
+
+		for (uint32_t i = 0; i < dwBatch; i++)
+		{
+			LinearStop(ids[i]);
+		}
+	}
+
+	*pStartNs = startNs / ((double) START_STOP_ROUNDS * dwBatch);
+	*pStopNs = stopNs / ((double) START_STOP_ROUNDS * dwBatch);
+	*pLinearNs = linearNs / ((double) START_STOP_ROUNDS * dwBatch);
+}
+
+/*
+ * @func:  		BenchExpiry
+ *
+ * @brief:		The function to run dwActive periodic timers for dwTicks milliseconds
+ *
+ * @param[1]:		dwActive - Running timers
+ * @param[2]:		dwTicks - Milliseconds to simulate
+ * @param[3]:		rng - Random periods
+ * @param[4]:		pTickNs - Receives the nanoseconds per millisecond (wheel)
+ * @param[5]:		pExpiryNs - Receives the nanoseconds per expiry (wheel)
+ * @param[6]:		pLinearTickNs - Receives the nanoseconds per millisecond (linear table)
+ *
+ * @retval:		None
+ *
+ * @note:		The callbacks are counted in the time, as the scheduler calls them
+ */
+static void BenchExpiry (uint32_t dwActive, uint32_t dwTicks, std::mt19937 &rng,
+				double *pTickNs, double *pExpiryNs, double *pLinearTickNs)
+{
+	std::uniform_int_distribution<uint32_t> period(1, PERIOD_MAX_MS);
+	std::vector<TimerProbe> probes(dwActive);
+
+	TimerInit();
+	for (TimerProbe &probe : probes)
+	{
+		probe.dwPeriod = period(rng);
+		probe.dwDue = GetMilSecTick() + probe.dwPeriod;
+		TimerStart((char *) "probe", probe.dwPeriod, TIMER_REPEAT_FOREVER, ProbeCallback, &probe);
+	}
+
+	g_qwExpiries = 0;
+	bench_clock_t::time_point start = bench_clock_t::now();
+	for (uint32_t i = 0; i < dwTicks; i++)
+	{
+		TimerWheel_Tick();
+		processTimerScheduler();
+	}
+	double ns = ElapsedNs(start);
+
+	*pTickNs = ns / dwTicks;
+	*pExpiryNs = (g_qwExpiries != 0) ? ns / (double) g_qwExpiries : 0;
+
+	g_linear.assign(dwActive, LinearTimer());
+	for (const TimerProbe &probe : probes)
+	{
+		LinearStart(probe.dwPeriod, CountCallback, NULL);
+	}
+
+	start = bench_clock_t::now();
+	for (uint32_t i = 0; i < dwTicks; i++)
+	{
+		LinearProcess();
+	}
+	*pLinearTickNs = ElapsedNs(start) / dwTicks;
+}
+
+/*
+ * @func:  		main
+ *
+ * @brief:		The function to print the costs for 16 to TIMER_WHEEL_CAPACITY timers
+ *
+ * @param[1]:		argc - Number of arguments
+ * @param[2]:		argv - [milliseconds per expiry run]
+ *
+ * @retval:		0 if every expiry came on time, 1 otherwise
+ *
+ * @note:		None
+ */
+int main (int argc, char *argv[])
+{
+	uint32_t dwTicks = (argc > 1) ? (uint32_t) strtoul(argv[1], NULL, 0) : 1000000;
+	const uint32_t aActive[] = { 16, 32, 64, 128, 192, 254 };
+	std::mt19937 rng(1);
+
+	printf("%8s | %10s %10s %12s | %10s %12s %12s\n", "timers", "start ns", "stop ns",
+	       "linear start", "tick ns", "expiry ns", "linear tick");
+
+	for (uint32_t dwActive : aActive)
+	{
+		double startNs, stopNs, linearStartNs, tickNs, expiryNs, linearTickNs;
+
+		if (dwActive > TIMER_WHEEL_CAPACITY)
+		{
+			continue;
+		}
+
+		BenchStartStop(dwActive, rng, &startNs, &stopNs, &linearStartNs);
+		BenchExpiry(dwActive, dwTicks, rng, &tickNs, &expiryNs, &linearTickNs);
+
+		printf("%8u | %10.1f %10.1f %12.1f | %10.1f %12.1f %12.1f\n", dwActive, startNs,
+		       stopNs, linearStartNs, tickNs, expiryNs, linearTickNs);
+	}
+
+	printf("late expiries: %llu\n", (unsigned long long) g_qwLate);
+
+	return (g_qwLate == 0) ? 0 : 1;
+}